@@ -6,25 +6,101 @@ CONFIG -= app_bundle
 TARGET = GamePadVirtual-Desktop
 TEMPLATE = app
 
+# Mesma lista do CMakeLists.txt e do GamePadVirtual-Desktop.vcxproj
 SOURCES += \
     src/main.cpp \
     src/mainwindow.cpp \
-    src/communication/connection_manager.cpp \
-    src/communication/wifi_server.cpp \
+    src/gamepaddisplaywidget.cpp \
+    src/server_runtime.cpp \
+    src/communication/ble_server.cpp \
     src/communication/bluetooth_server.cpp \
-    src/virtual_gamepad/gamepad_manager.cpp
+    src/communication/connection_manager.cpp \
+    src/communication/discovery_service.cpp \
+    src/communication/dsu_probe_client.cpp \
+    src/communication/dsu_server.cpp \
+    src/communication/input_transport.cpp \
+    src/communication/loopback_transport.cpp \
+    src/communication/network_server.cpp \
+    src/communication/session_registry.cpp \
+    src/communication/udp_server.cpp \
+    src/protocol/control_frame.cpp \
+    src/protocol/dsu_encoder.cpp \
+    src/protocol/signal_codec.cpp \
+    src/streaming/bitrate_controller.cpp \
+    src/streaming/encoder_probe.cpp \
+    src/streaming/pipeline_builder.cpp \
+    src/streaming/screen_streamer.cpp \
+    src/streaming/stream_tiers.cpp \
+    src/utils/crc32.cpp \
+    src/utils/input_emulator.cpp \
+    src/utils/log.cpp \
+    src/utils/metrics.cpp \
+    src/virtual_gamepad/controller_backend.cpp \
+    src/virtual_gamepad/controller_pool.cpp \
+    src/virtual_gamepad/gamepad_manager.cpp \
+    src/virtual_gamepad/input_load_generator.cpp \
+    src/virtual_gamepad/macro_engine.cpp \
+    src/virtual_gamepad/motion_timeline.cpp \
+    src/virtual_gamepad/null_backend.cpp \
+    src/virtual_gamepad/recording_backend.cpp
 
 HEADERS += \
-    src/mainwindow.h \
-    src/communication/connection_manager.h \
-    src/communication/wifi_server.h \
+    src/communication/ble_server.h \
     src/communication/bluetooth_server.h \
+    src/communication/connection_manager.h \
+    src/communication/discovery_service.h \
+    src/communication/dsu_probe_client.h \
+    src/communication/dsu_server.h \
+    src/communication/input_transport.h \
+    src/communication/loopback_transport.h \
+    src/communication/network_server.h \
+    src/communication/session_registry.h \
+    src/communication/udp_server.h \
+    src/controller_types.h \
+    src/gamepaddisplaywidget.h \
+    src/mainwindow.h \
+    src/protocol/control_frame.h \
+    src/protocol/dsu_encoder.h \
+    src/protocol/gamepad_packet.h \
+    src/protocol/signal_codec.h \
+    src/server_runtime.h \
+    src/streaming/bitrate_controller.h \
+    src/streaming/encoder_probe.h \
+    src/streaming/pipeline_builder.h \
+    src/streaming/screen_streamer.h \
+    src/streaming/stream_tiers.h \
+    src/utils/crc32.h \
+    src/utils/input_emulator.h \
+    src/utils/log.h \
+    src/utils/metrics.h \
+    src/virtual_gamepad/controller_backend.h \
+    src/virtual_gamepad/controller_pool.h \
     src/virtual_gamepad/gamepad_manager.h \
-    src/protocol/gamepad_packet.h
+    src/virtual_gamepad/input_load_generator.h \
+    src/virtual_gamepad/macro_engine.h \
+    src/virtual_gamepad/motion_timeline.h \
+    src/virtual_gamepad/null_backend.h \
+    src/virtual_gamepad/recording_backend.h \
+    src/virtual_gamepad/timer_wheel.h
+
+# Stream de tela (webrtcbin): GStreamer pelo pkg-config
+CONFIG += link_pkgconfig
+PKGCONFIG += gstreamer-1.0 gstreamer-video-1.0 gstreamer-rtp-1.0 gstreamer-sdp-1.0 gstreamer-webrtc-1.0
+DEFINES += GST_USE_UNSTABLE_API
+
+win32 {
+    SOURCES += src/virtual_gamepad/vigem_backend.cpp
+    HEADERS += src/virtual_gamepad/vigem_backend.h
+    RC_FILE = app_resources.rc
 
-msvc: QMAKE_CXXFLAGS = $$replace(QMAKE_CXXFLAGS, "/MD", "/MT")
+    msvc: QMAKE_CXXFLAGS = $$replace(QMAKE_CXXFLAGS, "/MD", "/MT")
 
-win32: LIBS += SetupAPI.lib
+    # ViGEmClient compilado pela solução do próprio diretório (ViGEmClient.sln)
+    INCLUDEPATH += $$PWD/ViGEmClient/include
+    LIBS += -L$$PWD/ViGEmClient/lib/release/x64 -lViGEmClient -lSetupAPI -lUser32
+}
 
-INCLUDEPATH += "C:/Projetos/GamePadVirtual-Desktop/ViGEmClient-master/include"
-LIBS += -L"C:/Projetos/GamePadVirtual-Desktop/ViGEmClient-master/lib/debug/x64" -lViGEmClient
\ No newline at end of file
+linux {
+    SOURCES += src/virtual_gamepad/uinput_backend.cpp
+    HEADERS += src/virtual_gamepad/uinput_backend.h
+}
@@ -6,7 +6,6 @@
 #include <QtBluetooth/QLowEnergyServiceData>
 #include <QtBluetooth/QBluetoothUuid>
 #include <QDebug>
-#include <QMutexLocker> // CORREÇÃO: Adicionado para uso do mutex
 
 // UUIDs para serviço e características BLE
 static const QBluetoothUuid SERVICE_UUID(QStringLiteral("00001812-0000-1000-8000-00805f9b34fb"));
@@ -14,11 +13,10 @@ static const QBluetoothUuid INPUT_CHAR_UUID(QStringLiteral("00002a4d-0000-1000-8
 static const QBluetoothUuid VIBRATION_CHAR_UUID(QStringLiteral("1a2b3c4d-5e6f-7a8b-9c0d-1e2f3a4b5c6d"));
 
 // --- CONSTRUTOR ---
-// Inicializa o servidor BLE e configura os slots de jogador
-BleServer::BleServer(QObject* parent) : QObject(parent)
+// Inicializa o servidor BLE (os slots de jogador ficam no SessionRegistry)
+BleServer::BleServer(SessionRegistry* sessions, QObject* parent)
+    : InputTransport(Session::Ble, sessions, parent)
 {
-    // Inicialização dos slots de jogador para 8 jogadores (todos livres)
-    for (int i = 0; i < 8; ++i) m_playerSlots[i] = false;
 }
 
 // --- DESTRUTOR ---
@@ -76,10 +74,11 @@ void BleServer::stopServer()
         m_gamepadService = nullptr;
     }
 
-    // CORREÇÃO: Limpeza segura com mutex
-    QMutexLocker locker(&m_mutex);
-    m_clientPlayerMap.clear();
-    for (int i = 0; i < 8; ++i) m_playerSlots[i] = false;
+    // Libera as sessões BLE
+    const quint32 players = m_sessions->playerMask(Session::Ble);
+    for (int i = 0; i < MAX_PLAYERS; ++i) {
+        if (players & (1u << i)) m_sessions->close(i);
+    }
 
     qDebug() << "Servidor BLE parado.";
 }
@@ -148,25 +147,17 @@ void BleServer::onCharacteristicWritten(const QLowEnergyCharacteristic& characte
     // Processamento de escrita na característica de entrada
     if (characteristic.uuid() == INPUT_CHAR_UUID) {
         QBluetoothAddress clientAddress = m_bleController->remoteAddress();
+        int playerIndex = m_sessions->playerForBluetoothAddress(Session::Ble, clientAddress.toUInt64());
 
-        // CORREÇÃO: Proteção contra race condition com Mutex
-        m_mutex.lock();
-        bool isKnown = m_clientPlayerMap.contains(clientAddress);
-        m_mutex.unlock();
-
-        if (!isKnown) {
-            QMutexLocker locker(&m_mutex); // Bloqueia escopo inteiro da criação
-            int playerIndex = findEmptySlot();
+        if (playerIndex == -1) {
+            const SessionHandle session = m_sessions->open(Session::Ble);
 
-            if (playerIndex != -1) {
-                m_playerSlots[playerIndex] = true;
-                m_clientPlayerMap[clientAddress] = playerIndex;
-                // Liberar mutex antes de emitir sinal para evitar deadlock se o slot chamar algo de volta
-                locker.unlock();
+            if (!session.isNull()) {
+                playerIndex = session.playerIndex;
+                m_sessions->setBluetoothAddress(playerIndex, clientAddress.toUInt64());
                 emit playerConnected(playerIndex, "Bluetooth LE");
             }
             else {
-                locker.unlock();
                 // --- SEÇÃO: REJEIÇÃO DE CONEXÃO ---
                 // Rejeição de conexão quando servidor está cheio
                 qDebug() << "Servidor cheio. Rejeitando cliente BLE:" << clientAddress.toString();
@@ -180,13 +171,8 @@ void BleServer::onCharacteristicWritten(const QLowEnergyCharacteristic& characte
         }
 
         // --- SEÇÃO: EMISSÃO DE PACOTE RECEBIDO ---
-        // CORREÇÃO: Leitura segura com mutex
-        m_mutex.lock();
-        int playerIndex = m_clientPlayerMap.value(clientAddress, -1);
-        m_mutex.unlock();
-
-        if (playerIndex != -1) {
-            emit packetReceived(playerIndex, newValue);
+        if (!ingest(playerIndex, newValue.constData(), newValue.size())) {
+            qWarning() << "Recebido pacote BLE com tamanho incorreto:" << newValue.size();
         }
     }
 }
@@ -206,19 +192,16 @@ void BleServer::onClientDisconnected()
     QBluetoothAddress clientAddress = m_bleController->remoteAddress();
 
     // CORREÇÃO: Limpeza correta dos slots quando desconectar
-    QMutexLocker locker(&m_mutex);
-    if (m_clientPlayerMap.contains(clientAddress)) {
-        int slot = m_clientPlayerMap.value(clientAddress);
-        m_playerSlots[slot] = false;
-        m_clientPlayerMap.remove(clientAddress);
-        locker.unlock(); // Libera antes de emitir
+    const int slot = m_sessions->playerForBluetoothAddress(Session::Ble, clientAddress.toUInt64());
+    if (slot != -1) {
+        m_sessions->close(slot);
         emit playerDisconnected(slot);
     }
 }
 
 // --- ENVIAR VIBRAÇÃO ---
 // Envia comando de vibração para jogador específico via BLE
-bool BleServer::sendVibration(int playerIndex, const QByteArray& command)
+bool BleServer::sendToPlayer(int playerIndex, const QByteArray& command)
 {
     // Envio de comando de vibração para jogador específico
     if (!m_gamepadService || !m_vibrationCharacteristic.isValid()) {
@@ -226,70 +209,35 @@ bool BleServer::sendVibration(int playerIndex, const QByteArray& command)
     }
 
     // --- SEÇÃO: BUSCA DO CLIENTE ---
-    // CORREÇÃO: Busca segura com mutex
-    QMutexLocker locker(&m_mutex);
-    QBluetoothAddress targetAddress;
-    bool found = false;
-
-    for (auto it = m_clientPlayerMap.constBegin(); it != m_clientPlayerMap.constEnd(); ++it) {
-        if (it.value() == playerIndex) {
-            targetAddress = it.key();
-            found = true;
-            break;
-        }
+    const SessionInfo* session = m_sessions->session(playerIndex);
+    if (!session || session->transport != Session::Ble) {
+        return false;
     }
 
     // --- SEÇÃO: ENVIO DE NOTIFICAÇÃO ---
     // CORREÇÃO: Verificar se o cliente conectado é o alvo
-    if (found && m_bleController && m_bleController->remoteAddress() == targetAddress) {
-        locker.unlock(); // Destrava para escrever
+    if (m_bleController && m_bleController->remoteAddress().toUInt64() == session->bluetoothAddress) {
         m_gamepadService->writeCharacteristic(m_vibrationCharacteristic, command, QLowEnergyService::WriteWithoutResponse);
         return true;
     }
     return false;
 }
 
-// --- ENCONTRAR SLOT VAZIO ---
-// Busca por slot de jogador disponível entre 8 slots
-int BleServer::findEmptySlot() const {
-    // Percorre todos os slots procurando um disponível
-    for (int i = 0; i < 8; ++i) {
-        if (!m_playerSlots[i]) return i; // Retorna o primeiro slot livre
-    }
-    return -1; // Nenhum slot disponível
-}
-
 // --- FORÇAR DESCONEXÃO DE JOGADOR ---
 // Força a desconexão de um jogador específico via BLE
 void BleServer::forceDisconnectPlayer(int playerIndex)
 {
-    QBluetoothAddress targetAddress;
-    bool found = false;
-
-    // CORREÇÃO: Busca segura com mutex
-    QMutexLocker locker(&m_mutex);
-    for (auto it = m_clientPlayerMap.constBegin(); it != m_clientPlayerMap.constEnd(); ++it) {
-        if (it.value() == playerIndex) {
-            targetAddress = it.key();
-            found = true;
-            break;
-        }
-    }
-    locker.unlock();
+    const SessionInfo* session = m_sessions->session(playerIndex);
 
-    if (found) {
+    if (session && session->transport == Session::Ble) {
         // Se o cliente for o que está ativamente conectado ao controlador,
         // desconecta-o. Isso acionará 'onClientDisconnected'.
-        if (m_bleController && m_bleController->remoteAddress() == targetAddress) {
+        if (m_bleController && m_bleController->remoteAddress().toUInt64() == session->bluetoothAddress) {
             m_bleController->disconnectFromDevice();
         }
         // Se não for o cliente ativo (caso de borda), apenas limpa o slot
         else {
-            // CORREÇÃO: Limpeza segura com mutex
-            QMutexLocker locker(&m_mutex);
-            m_playerSlots[playerIndex] = false;
-            m_clientPlayerMap.remove(targetAddress);
-            locker.unlock();
+            m_sessions->close(playerIndex);
             emit playerDisconnected(playerIndex);
         }
     }
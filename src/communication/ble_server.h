@@ -6,33 +6,32 @@
 #include <QtBluetooth/QLowEnergyService>
 #include <QtBluetooth/QLowEnergyCharacteristic>
 #include <QtBluetooth/QBluetoothAddress>
-#include <QMutex> // CORREO: Adicionado para thread-safety
-#include <QHash>
 #include <QTimer>
+#include "input_transport.h"
 
 // Classe principal do servidor BLE (Bluetooth Low Energy) para gerenciar conexes de jogadores
-class BleServer : public QObject
+class BleServer : public InputTransport
 {
     Q_OBJECT
 
 public:
-    explicit BleServer(QObject* parent = nullptr);
+    explicit BleServer(SessionRegistry* sessions, QObject* parent = nullptr);
     ~BleServer();
 
     // --- SEO: MTODOS PBLICOS ---
 
     // Envio de comando de vibrao para jogador
-    bool sendVibration(int playerIndex, const QByteArray& command);
+    bool sendToPlayer(int playerIndex, const QByteArray& command) override;
 
 public slots:
     // --- SEO: SLOTS PBLICOS ---
 
     // Incio e parada do servidor BLE
-    void startServer();
-    void stopServer();
+    void startServer() override;
+    void stopServer() override;
 
     // Fora a desconexo de um jogador especfico via BLE
-    void forceDisconnectPlayer(int playerIndex);
+    void forceDisconnectPlayer(int playerIndex) override;
 
 private slots:
     // --- SEO: SLOTS PRIVADOS ---
@@ -42,22 +41,11 @@ private slots:
     void onClientDisconnected();   // Trata desconexes de clientes
     void onCharacteristicWritten(const QLowEnergyCharacteristic& characteristic, const QByteArray& newValue); // Processa dados recebidos
 
-signals:
-    // --- SEO: SINAIS ---
-
-    // Sinais para comunicao externa
-    void packetReceived(int playerIndex, const QByteArray& packetData);  // Dados recebidos do gamepad
-    void playerConnected(int playerIndex, const QString& type);          // Novo jogador conectado
-    void playerDisconnected(int playerIndex);                            // Jogador desconectado
-    void logMessage(const QString& message);                             // Mensagens de log
-
 private:
     // --- SEO: MTODOS PRIVADOS ---
 
     // Configurao do servio BLE e caractersticas
     void setupService();
-    // Busca de slot vazio para novo jogador
-    int findEmptySlot() const;
 
     // --- SEO: MEMBROS PRIVADOS ---
 
@@ -68,14 +56,8 @@ private:
     // Caracterstica de vibrao (para feedback hptico)
     QLowEnergyCharacteristic m_vibrationCharacteristic;
 
-    // Estruturas protegidas por mutex
-    // Mapeamento de endereos de clientes para ndices de jogador
-    QHash<QBluetoothAddress, int> m_clientPlayerMap;
-    // Array de slots de jogador ocupados (8 jogadores mximo)
-    bool m_playerSlots[8];
-
-    // CORREO: Mutex para proteo de acesso concorrente
-    mutable QMutex m_mutex;
+    // Os jogadores BLE ficam no SessionRegistry, indexados pelo endereo do cliente.
+    // Os sinais do controlador chegam na thread principal, ento no h mutex.
 };
 
 #endif
\ No newline at end of file
@@ -7,13 +7,10 @@
 static const QBluetoothUuid ServiceUuid(QStringLiteral("00001101-0000-1000-8000-00805F9B34FB"));
 
 // --- CONSTRUTOR ---
-// Inicializa o servidor Bluetooth e configura os slots de jogador
-BluetoothServer::BluetoothServer(QObject* parent) : QObject(parent), m_btServer(nullptr)
+// Inicializa o servidor Bluetooth (os slots de jogador ficam no SessionRegistry)
+BluetoothServer::BluetoothServer(SessionRegistry* sessions, QObject* parent)
+    : InputTransport(Session::Bluetooth, sessions, parent), m_btServer(nullptr)
 {
-    // Inicialização dos slots de jogador como livres (false = disponível)
-    for (int i = 0; i < MAX_PLAYERS; ++i) {
-        m_playerSlots[i] = false;
-    }
 }
 
 // --- DESTRUTOR ---
@@ -92,10 +89,17 @@ void BluetoothServer::stopServer()
     // Parada e limpeza do servidor Bluetooth
     if (m_btServer) {
         m_btServer->close();
-        // Remove todos os sockets de clientes
-        qDeleteAll(m_clientSockets);
-        m_clientSockets.clear();
-        m_socketPlayerMap.clear();
+        // Remove todos os sockets de clientes e libera as sessões
+        const quint32 players = m_sessions->playerMask(Session::Bluetooth);
+        for (int i = 0; i < MAX_PLAYERS; ++i) {
+            if (!(players & (1u << i))) continue;
+            QBluetoothSocket* socket = playerSocket(i);
+            m_sessions->close(i);
+            if (socket) {
+                socket->disconnect(this);
+                delete socket;
+            }
+        }
         delete m_btServer;
         m_btServer = nullptr;
     }
@@ -113,8 +117,8 @@ void BluetoothServer::clientConnected()
     }
 
     // --- SEÇÃO: VERIFICAÇÃO DE SLOTS DISPONÍVEIS ---
-    int playerIndex = findEmptySlot();
-    if (playerIndex == -1) {
+    const SessionHandle session = m_sessions->open(Session::Bluetooth, socket);
+    if (session.isNull()) {
         // Rejeição de conexão quando servidor está cheio
         qDebug() << "Servidor cheio. Rejeitando cliente Bluetooth:" << socket->peerName();
         QByteArray fullMessage = "{\"type\":\"system\",\"code\":\"server_full\"}";
@@ -132,11 +136,8 @@ void BluetoothServer::clientConnected()
     connect(socket, &QBluetoothSocket::readyRead, this, &BluetoothServer::readSocket);
     connect(socket, &QBluetoothSocket::disconnected, this, &BluetoothServer::clientDisconnected);
 
-    // --- SEÇÃO: REGISTRO DO CLIENTE ---
-    // Adição do socket às listas de controle
-    m_clientSockets.append(socket);
-    m_playerSlots[playerIndex] = true;
-    m_socketPlayerMap[socket] = playerIndex;
+    const int playerIndex = session.playerIndex;
+    m_sessions->setBluetoothAddress(playerIndex, socket->peerAddress().toUInt64());
 
     qDebug() << "Novo jogador" << (playerIndex + 1) << "conectado via Bluetooth:" << socket->peerName();
     emit playerConnected(playerIndex, "Bluetooth");
@@ -148,16 +149,15 @@ void BluetoothServer::readSocket()
 {
     // Identifica qual socket está enviando dados
     QBluetoothSocket* socket = qobject_cast<QBluetoothSocket*>(sender());
-    if (!socket || !m_socketPlayerMap.contains(socket)) return;
-
-    int playerIndex = m_socketPlayerMap[socket];
+    const int playerIndex = socket ? m_sessions->playerForEndpoint(socket) : -1;
+    if (playerIndex == -1) return;
 
-    // Processamento de pacotes completos do gamepad
+    // Processamento de pacotes completos do gamepad (o stream RFCOMM só leva GamepadPacket)
+    char buffer[sizeof(GamepadPacket)];
     while (socket->bytesAvailable() >= static_cast<qint64>(sizeof(GamepadPacket)))
     {
-        QByteArray data = socket->read(sizeof(GamepadPacket));
-        const GamepadPacket* packet = reinterpret_cast<const GamepadPacket*>(data.constData());
-        emit packetReceived(playerIndex, *packet);
+        socket->read(buffer, sizeof(GamepadPacket));
+        ingest(playerIndex, buffer, sizeof(GamepadPacket));
     }
 }
 
@@ -170,11 +170,9 @@ void BluetoothServer::clientDisconnected()
     if (!socket) return;
 
     // --- SEÇÃO: LIMPEZA DE RECURSOS ---
-    if (m_socketPlayerMap.contains(socket)) {
-        int playerIndex = m_socketPlayerMap[socket];
-        m_playerSlots[playerIndex] = false;
-        m_socketPlayerMap.remove(socket);
-        m_clientSockets.removeAll(socket);
+    const int playerIndex = m_sessions->playerForEndpoint(socket);
+    if (playerIndex != -1) {
+        m_sessions->close(playerIndex);
         socket->deleteLater(); // Marca o socket para exclusão segura
 
         qDebug() << "Jogador" << (playerIndex + 1) << "desconectado (Bluetooth).";
@@ -182,46 +180,30 @@ void BluetoothServer::clientDisconnected()
     }
 }
 
-// --- ENCONTRAR SLOT VAZIO ---
-// Busca por slot de jogador disponível
-int BluetoothServer::findEmptySlot() const
+// --- SOCKET DO JOGADOR ---
+// Busca direta na tabela de sessões (nullptr se o jogador não for Bluetooth)
+QBluetoothSocket* BluetoothServer::playerSocket(int playerIndex) const
 {
-    // Percorre todos os slots procurando um disponível
-    for (int i = 0; i < MAX_PLAYERS; ++i) {
-        if (!m_playerSlots[i]) {
-            return i; // Retorna o primeiro slot livre encontrado
-        }
-    }
-    return -1; // Nenhum slot disponível
+    return static_cast<QBluetoothSocket*>(m_sessions->endpoint(playerIndex, Session::Bluetooth));
 }
 
 // --- ENVIAR PARA JOGADOR ---
 // Envio de dados para jogador específico via Bluetooth
 bool BluetoothServer::sendToPlayer(int playerIndex, const QByteArray& data)
 {
-    // Procura o socket correspondente ao índice do jogador
-    for (auto it = m_socketPlayerMap.constBegin(); it != m_socketPlayerMap.constEnd(); ++it) {
-        if (it.value() == playerIndex) {
-            it.key()->write(data); // Envia dados pelo socket
-            return true; // Sucesso no envio
-        }
+    QBluetoothSocket* socket = playerSocket(playerIndex);
+    if (!socket) {
+        return false; // Jogador não encontrado
     }
-    return false; // Jogador não encontrado
+    socket->write(data); // Envia dados pelo socket
+    return true;
 }
 
 // --- NOVA FUNÇÃO ADICIONADA (REQ 2 FIX) ---
 // Força a desconexão de um jogador específico via Bluetooth
 void BluetoothServer::forceDisconnectPlayer(int playerIndex)
 {
-    QBluetoothSocket* targetSocket = nullptr;
-
-    // Encontra o socket correspondente ao índice do jogador
-    for (auto it = m_socketPlayerMap.constBegin(); it != m_socketPlayerMap.constEnd(); ++it) {
-        if (it.value() == playerIndex) {
-            targetSocket = it.key();
-            break;
-        }
-    }
+    QBluetoothSocket* targetSocket = playerSocket(playerIndex);
 
     if (targetSocket) {
         // Chamar close() irá acionar o sinal clientDisconnected(),
@@ -4,35 +4,35 @@
 #include <QObject>
 #include <QBluetoothServer>
 #include <QBluetoothSocket>
-#include <QList>
 #include "../controller_types.h"
 #include "../protocol/gamepad_packet.h"
+#include "input_transport.h"
 
 
 // Classe principal do servidor Bluetooth para gerenciar conexes de jogadores
-class BluetoothServer : public QObject
+class BluetoothServer : public InputTransport
 {
     Q_OBJECT
 
 public:
-    explicit BluetoothServer(QObject* parent = nullptr);
+    explicit BluetoothServer(SessionRegistry* sessions, QObject* parent = nullptr);
     ~BluetoothServer();
 
     // --- SEO: MTODOS PBLICOS ---
 
     // Funo para envio de dados para jogador especfico
-    bool sendToPlayer(int playerIndex, const QByteArray& data);
+    bool sendToPlayer(int playerIndex, const QByteArray& data) override;
 
 public slots:
     // --- SEO: SLOTS PBLICOS ---
 
     // Incio e parada do servidor Bluetooth
-    void startServer();
-    void stopServer();
+    void startServer() override;
+    void stopServer() override;
 
     // --- MODIFICAO ADICIONADA (REQ 2 FIX) ---
     // Fora a desconexo de um jogador especfico via Bluetooth
-    void forceDisconnectPlayer(int playerIndex);
+    void forceDisconnectPlayer(int playerIndex) override;
 
 private slots:
     // --- SEO: SLOTS PRIVADOS ---
@@ -42,31 +42,16 @@ private slots:
     void readSocket();           // Processa dados recebidos dos sockets
     void clientDisconnected();   // Trata desconexes de clientes
 
-signals:
-    // --- SEO: SINAIS ---
-
-    // Sinais para comunicao externa
-    void packetReceived(int playerIndex, const GamepadPacket& packet);  // Pacote de gamepad recebido
-    void playerConnected(int playerIndex, const QString& type);         // Novo jogador conectado
-    void playerDisconnected(int playerIndex);                           // Jogador desconectado
-    void logMessage(const QString& message);                            // Mensagens de log
-
 private:
     // --- SEO: MTODOS PRIVADOS ---
 
-    // Busca de slot vazio para jogador
-    int findEmptySlot() const;
+    // Socket do jogador, se a sesso dele for Bluetooth clssico
+    QBluetoothSocket* playerSocket(int playerIndex) const;
 
     // --- SEO: MEMBROS PRIVADOS ---
 
     // Servidor Bluetooth principal (RFCOMM)
     QBluetoothServer* m_btServer;
-    // Lista de sockets de clientes conectados
-    QList<QBluetoothSocket*> m_clientSockets;
-    // Mapeamento de sockets para ndices de jogador
-    QHash<QBluetoothSocket*, int> m_socketPlayerMap;
-    // Array de slots de jogador ocupados (controle de disponibilidade)
-    bool m_playerSlots[MAX_PLAYERS];
 };
 
 #endif
\ No newline at end of file
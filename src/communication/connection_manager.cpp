@@ -7,28 +7,19 @@
 ConnectionManager::ConnectionManager(GamepadManager* gamepadManager, QObject* parent)
     : QObject(parent), m_gamepadManager(gamepadManager)
 {
-    // Inicialização dos servidores
-    m_networkServer = new NetworkServer(this);
-    m_bluetoothServer = new BluetoothServer(this);
-    m_bleServer = new BleServer(this);
+    // Inicialização dos servidores: todos alocam jogadores na mesma tabela de sessões
+    m_sessions = new SessionRegistry(this);
+    m_networkServer = new NetworkServer(m_sessions, this);
+    m_bluetoothServer = new BluetoothServer(m_sessions, this);
+    m_bleServer = new BleServer(m_sessions, this);
 
-    // Conexões do servidor de rede
-    connect(m_networkServer, &NetworkServer::playerConnected, this, &ConnectionManager::playerConnected);
-    connect(m_networkServer, &NetworkServer::playerDisconnected, this, &ConnectionManager::playerDisconnected);
-    connect(m_networkServer, &NetworkServer::packetReceived, m_gamepadManager, &GamepadManager::onPacketReceived);
-    connect(m_networkServer, &NetworkServer::logMessage, this, &ConnectionManager::logMessage);
+    // Conexões comuns dos transportes
+    addTransport(m_networkServer);
+    addTransport(m_bluetoothServer);
+    addTransport(m_bleServer);
 
-    // Conexões do servidor Bluetooth clássico
-    connect(m_bluetoothServer, &BluetoothServer::playerConnected, this, &ConnectionManager::playerConnected);
-    connect(m_bluetoothServer, &BluetoothServer::playerDisconnected, this, &ConnectionManager::playerDisconnected);
-    connect(m_bluetoothServer, &BluetoothServer::packetReceived, m_gamepadManager, &GamepadManager::onPacketReceived);
-    connect(m_bluetoothServer, &BluetoothServer::logMessage, this, &ConnectionManager::logMessage);
-
-    // Conexões do servidor BLE
-    connect(m_bleServer, &BleServer::playerConnected, this, &ConnectionManager::playerConnected);
-    connect(m_bleServer, &BleServer::playerDisconnected, this, &ConnectionManager::playerDisconnected);
-    connect(m_bleServer, &BleServer::logMessage, this, &ConnectionManager::logMessage);
-    connect(m_bleServer, &BleServer::packetReceived, this, &ConnectionManager::onBlePacketReceived);
+    // Conexões específicas do servidor de rede
+    connect(m_networkServer, &NetworkServer::macroProfileReceived, m_gamepadManager, &GamepadManager::setMacroProfile);
 
     // Sistema de vibração
     connect(m_gamepadManager, &GamepadManager::vibrationCommandReady, this, &ConnectionManager::onVibrationCommandReady);
@@ -39,19 +30,31 @@ ConnectionManager::~ConnectionManager()
     stopServices();
 }
 
+void ConnectionManager::addTransport(InputTransport* transport)
+{
+    if (!transport || m_transports[transport->kind()] == transport) return;
+    m_transports[transport->kind()] = transport;
+
+    connect(transport, &InputTransport::playerConnected, this, &ConnectionManager::playerConnected);
+    connect(transport, &InputTransport::playerDisconnected, this, &ConnectionManager::playerDisconnected);
+    connect(transport, &InputTransport::packetReceived, m_gamepadManager, &GamepadManager::onPacketReceived);
+    connect(transport, &InputTransport::motionSampleReceived, m_gamepadManager, &GamepadManager::onMotionSample);
+    connect(transport, &InputTransport::logMessage, this, &ConnectionManager::logMessage);
+}
+
 void ConnectionManager::startServices()
 {
-    m_networkServer->startServer();
-    m_bluetoothServer->startServer();
-    m_bleServer->startServer();
+    for (int kind = 0; kind < Session::TransportCount; ++kind) {
+        if (m_transports[kind] && m_enabled[kind]) m_transports[kind]->startServer();
+    }
     emit logMessage("Todos os servidores foram iniciados.");
 }
 
 void ConnectionManager::stopServices()
 {
-    m_networkServer->stopServer();
-    m_bluetoothServer->stopServer();
-    m_bleServer->stopServer();
+    for (InputTransport* transport : m_transports) {
+        if (transport) transport->stopServer();
+    }
     emit logMessage("Todos os servidores foram parados.");
 }
 
@@ -72,33 +75,24 @@ bool ConnectionManager::isStreamingEnabled() const
     return false;
 }
 
-void ConnectionManager::forceDisconnectPlayer(int playerIndex, const QString& type)
+void ConnectionManager::setResumeGracePeriod(int ms)
 {
-    if (type == "Wi-Fi" || type == "Ancoragem USB") {
-        m_networkServer->forceDisconnectPlayer(playerIndex);
-    }
-    else if (type == "Bluetooth") {
-        m_bluetoothServer->forceDisconnectPlayer(playerIndex);
-    }
-    else if (type == "Bluetooth LE") {
-        m_bleServer->forceDisconnectPlayer(playerIndex);
+    if (m_networkServer) {
+        m_networkServer->setResumeGracePeriod(ms);
     }
 }
 
-void ConnectionManager::onVibrationCommandReady(int playerIndex, const QByteArray& command)
+// O transporte dono do jogador vem da tabela de sessões
+void ConnectionManager::forceDisconnectPlayer(int playerIndex)
 {
-    m_networkServer->sendVibration(playerIndex, command);
-    m_bluetoothServer->sendToPlayer(playerIndex, command);
-    m_bleServer->sendVibration(playerIndex, command);
+    if (InputTransport* transport = m_transports[m_sessions->transport(playerIndex)]) {
+        transport->forceDisconnectPlayer(playerIndex);
+    }
 }
 
-void ConnectionManager::onBlePacketReceived(int playerIndex, const QByteArray& packet)
+void ConnectionManager::onVibrationCommandReady(int playerIndex, const QByteArray& command)
 {
-    if (packet.size() == sizeof(GamepadPacket)) {
-        const GamepadPacket* gamepadPacket = reinterpret_cast<const GamepadPacket*>(packet.constData());
-        m_gamepadManager->onPacketReceived(playerIndex, *gamepadPacket);
-    }
-    else {
-        qWarning() << "Recebido pacote BLE com tamanho incorreto:" << packet.size();
+    if (InputTransport* transport = m_transports[m_sessions->transport(playerIndex)]) {
+        transport->sendToPlayer(playerIndex, command);
     }
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include "network_server.h"
 #include "bluetooth_server.h" 
 #include "ble_server.h"
+#include "session_registry.h"
 #include "../virtual_gamepad/gamepad_manager.h"
 
 // --- ADIO: Include para a struct do pacote ---
@@ -23,6 +24,19 @@ public:
     explicit ConnectionManager(GamepadManager* gamepadManager, QObject* parent = nullptr);
     ~ConnectionManager();
 
+    // Tabela de sesses compartilhada por todos os transportes
+    SessionRegistry* sessions() const { return m_sessions; }
+    NetworkServer* networkServer() const { return m_networkServer; }
+
+    // Liga um transporte ao GamepadManager e ao roteamento por sesso (start/stop,
+    // desconexo, vibrao). Os servidores reais j vm registrados; aqui entram
+    // transportes extras como o LoopbackTransport. Um transporte por tipo.
+    void addTransport(InputTransport* transport);
+
+    // Transporte desligado no  iniciado por startServices() (padro: todos ligados)
+    void setTransportEnabled(Session::Transport transport, bool enabled) { m_enabled[transport] = enabled; }
+    bool isTransportEnabled(Session::Transport transport) const { return m_enabled[transport]; }
+
     // --- NOVO MTODO ADICIONADO AQUI ---
     // Nota: Geralmente colocamos como slot se for chamado pela UI via connect, 
     // mas pode ser public method se chamado via lambda.
@@ -32,20 +46,19 @@ public:
 public slots:
     void startServices();
     void stopServices();
-    void forceDisconnectPlayer(int playerIndex, const QString& type);
+    void forceDisconnectPlayer(int playerIndex);
 
     // --- ADICIONE ESTA LINHA ---
     void setStreamingEnabled(bool enabled);
     bool isStreamingEnabled() const;
     // ---------------------------
 
+    // Perodo de carncia para retomada de sesses Wi-Fi (0 desliga)
+    void setResumeGracePeriod(int ms);
+
 private slots:
     void onVibrationCommandReady(int playerIndex, const QByteArray& command);
 
-    // --- ADIO: Novo slot "tradutor" para BLE ---
-    void onBlePacketReceived(int playerIndex, const QByteArray& packet);
-    // --- FIM DA ADIO ---
-
 signals:
     void logMessage(const QString& message);
     void playerConnected(int playerIndex, const QString& type);
@@ -53,9 +66,14 @@ signals:
 
 private:
     GamepadManager* m_gamepadManager;
+    SessionRegistry* m_sessions;
     NetworkServer* m_networkServer;
     BluetoothServer* m_bluetoothServer;
     BleServer* m_bleServer;
+
+    // Transporte responsvel por cada tipo de sesso
+    InputTransport* m_transports[Session::TransportCount] = {};
+    bool m_enabled[Session::TransportCount] = { true, true, true, true, true };
 };
 
 #endif // CONNECTION_MANAGER_H
\ No newline at end of file
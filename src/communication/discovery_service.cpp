@@ -0,0 +1,244 @@
+﻿#include "discovery_service.h"
+#include "dsu_server.h"
+#include <QNetworkDatagram>
+#include <QHostInfo>
+#include <QRandomGenerator>
+#include <QtEndian>
+#include <QDebug>
+#include <QtAlgorithms>
+#include <cstring>
+
+// Mensagens do protocolo de descoberta
+static const QByteArray DISCOVERY_QUERY = "DISCOVER_GAMEPAD_VIRTUAL_SERVER";
+static const QByteArray DISCOVERY_QUERY_V2 = "DISCOVER_GAMEPAD_VIRTUAL_SERVER_V2";
+static const QByteArray DISCOVERY_ACK_PREFIX = "GAMEPAD_VIRTUAL_SERVER_ACK:";
+
+// Interfaces mudam raramente (ancoragem USB, troca de rede): relista a cada N anúncios
+static constexpr int INTERFACE_REFRESH_ANNOUNCES = 10;
+// Mudanças em sequência (ex: vários jogadores entrando) saem em um único anúncio
+static constexpr int CHANGE_COALESCE_MS = 100;
+
+DiscoveryService::DiscoveryService(QObject* parent)
+    : QObject(parent), m_serverId(QRandomGenerator::global()->generate())
+{
+    m_announceTimer = new QTimer(this);
+    m_announceTimer->setTimerType(Qt::PreciseTimer);
+    m_announceTimer->setInterval(Discovery::ANNOUNCE_INTERVAL_MS);
+    connect(m_announceTimer, &QTimer::timeout, this, &DiscoveryService::onAnnounceTimer);
+
+    m_changeTimer = new QTimer(this);
+    m_changeTimer->setSingleShot(true);
+    m_changeTimer->setInterval(CHANGE_COALESCE_MS);
+    connect(m_changeTimer, &QTimer::timeout, this, &DiscoveryService::announce);
+}
+
+DiscoveryService::~DiscoveryService()
+{
+    stop();
+}
+
+bool DiscoveryService::start(quint16 queryPort, quint16 controlPort, quint16 dataPort)
+{
+    stop();
+
+    m_controlPort = controlPort;
+    m_dataPort = dataPort;
+
+    // O nome do host não muda durante a execução: resolve uma vez só
+    QString hostName = QHostInfo::localHostName();
+    if (hostName.isEmpty()) {
+        hostName = "Servidor-PC";
+    }
+    m_name = hostName.toUtf8().left(Discovery::MAX_NAME_SIZE);
+    m_legacyAck = DISCOVERY_ACK_PREFIX + hostName.toUtf8();
+
+    m_socket = new QUdpSocket(this);
+    connect(m_socket, &QUdpSocket::readyRead, this, &DiscoveryService::readQueries);
+
+    if (!m_socket->bind(QHostAddress::AnyIPv4, queryPort, QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint)) {
+        qCritical() << "Falha ao iniciar servidor de Descoberta na porta" << queryPort;
+        delete m_socket;
+        m_socket = nullptr;
+        return false;
+    }
+    m_socket->setSocketOption(QAbstractSocket::MulticastTtlOption, 1);
+
+    markDirty();
+    refreshInterfaces();
+    announce();
+
+    m_lagClock.start();
+    m_announceTimer->start();
+
+    qDebug() << "Descoberta: consultas na porta" << queryPort << ", anúncios em"
+        << Discovery::MULTICAST_GROUP << ":" << Discovery::ANNOUNCE_PORT;
+    return true;
+}
+
+void DiscoveryService::stop()
+{
+    m_announceTimer->stop();
+    m_changeTimer->stop();
+    if (m_socket) {
+        m_socket->close();
+        delete m_socket;
+        m_socket = nullptr;
+    }
+}
+
+void DiscoveryService::setPlayerOccupied(int playerIndex, bool occupied)
+{
+    if (playerIndex < 0 || playerIndex >= MAX_PLAYERS) return;
+
+    const quint8 bit = static_cast<quint8>(1u << playerIndex);
+    const quint8 mask = occupied ? (m_occupiedMask | bit) : (m_occupiedMask & ~bit);
+    if (mask == m_occupiedMask) return;
+
+    m_occupiedMask = mask;
+    markDirty();
+}
+
+void DiscoveryService::setCapacity(int players)
+{
+    players = qBound(1, players, MAX_PLAYERS);
+    if (players == m_capacity) return;
+
+    m_capacity = players;
+    markDirty();
+}
+
+void DiscoveryService::setStreamingState(bool enabled, quint8 codecMask)
+{
+    if (!enabled) codecMask = 0;
+    if (enabled == m_streaming && codecMask == m_codecMask) return;
+
+    m_streaming = enabled;
+    m_codecMask = codecMask;
+    markDirty();
+}
+
+void DiscoveryService::markDirty()
+{
+    m_dirty = true;
+    if (m_socket && !m_changeTimer->isActive()) m_changeTimer->start();
+}
+
+const QByteArray& DiscoveryService::descriptor()
+{
+    if (m_dirty) rebuildDescriptor();
+    return m_descriptor;
+}
+
+void DiscoveryService::rebuildDescriptor()
+{
+    const int players = qPopulationCount(m_occupiedMask);
+    const quint8 freeMask = static_cast<quint8>(~m_occupiedMask & ((1u << m_capacity) - 1));
+
+    quint8 flags = 0;
+    if (m_streaming) flags |= Discovery::FLAG_STREAMING;
+    if (freeMask) flags |= Discovery::FLAG_ACCEPTING_PLAYERS;
+
+    m_descriptor.resize(Discovery::DESCRIPTOR_HEADER_SIZE + m_name.size());
+    uchar* p = reinterpret_cast<uchar*>(m_descriptor.data());
+    p[0] = 'G'; p[1] = 'P'; p[2] = 'V'; p[3] = 'D';
+    p[4] = Discovery::DESCRIPTOR_VERSION;
+    p[5] = flags;
+    qToLittleEndian<quint16>(m_controlPort, p + 6);
+    qToLittleEndian<quint16>(m_dataPort, p + 8);
+    qToLittleEndian<quint16>(DsuServer::BASE_PORT, p + 10);
+    p[12] = static_cast<quint8>(DsuServer::PORT_COUNT);
+    p[13] = static_cast<quint8>(m_capacity);
+    p[14] = static_cast<quint8>(players);
+    p[15] = freeMask;
+    p[16] = Discovery::PACKET_BASIC | Discovery::PACKET_TIMED | Discovery::PACKET_MOTION_BATCH;
+    p[17] = m_codecMask;
+    p[18] = static_cast<quint8>(currentLoad());
+    p[19] = static_cast<quint8>(m_name.size());
+    qToLittleEndian<quint32>(m_serverId, p + 20);
+    qToLittleEndian<quint32>(++m_generation, p + 24);
+    std::memcpy(p + Discovery::DESCRIPTOR_HEADER_SIZE, m_name.constData(), m_name.size());
+
+    m_dirty = false;
+}
+
+// Carga 0-100: o maior entre a ocupação dos slots e o atraso do event loop
+// (16 ms de atraso, um quadro, já conta como saturado)
+int DiscoveryService::currentLoad() const
+{
+    const int occupancy = qPopulationCount(m_occupiedMask) * 100 / m_capacity;
+    const int lag = qMin(100, static_cast<int>(m_loopLagMs * 100.0 / 16.0));
+    return qMax(occupancy, lag);
+}
+
+void DiscoveryService::refreshInterfaces()
+{
+    m_interfaces.clear();
+    m_announcesSinceRefresh = 0;
+
+    const QList<QNetworkInterface> all = QNetworkInterface::allInterfaces();
+    for (const QNetworkInterface& iface : all) {
+        const auto flags = iface.flags();
+        if (!(flags & QNetworkInterface::IsUp) || !(flags & QNetworkInterface::IsRunning)
+            || !(flags & QNetworkInterface::CanMulticast) || (flags & QNetworkInterface::IsLoopBack)) {
+            continue;
+        }
+
+        for (const QNetworkAddressEntry& entry : iface.addressEntries()) {
+            if (entry.ip().protocol() == QAbstractSocket::IPv4Protocol) {
+                m_interfaces.append(iface);
+                break;
+            }
+        }
+    }
+}
+
+void DiscoveryService::onAnnounceTimer()
+{
+    // Atraso do timer em relação ao intervalo nominal, suavizado
+    const qint64 elapsed = m_lagClock.restart();
+    const double lag = qMax<qint64>(0, elapsed - Discovery::ANNOUNCE_INTERVAL_MS);
+    const int previousLoad = currentLoad();
+    m_loopLagMs = m_loopLagMs * 0.75 + lag * 0.25;
+    if (currentLoad() / 10 != previousLoad / 10) m_dirty = true;
+
+    if (++m_announcesSinceRefresh >= INTERFACE_REFRESH_ANNOUNCES) refreshInterfaces();
+    announce();
+}
+
+void DiscoveryService::announce()
+{
+    if (!m_socket) return;
+    m_changeTimer->stop();
+
+    const QByteArray& data = descriptor();
+    const QHostAddress group(QString::fromLatin1(Discovery::MULTICAST_GROUP));
+
+    // Um envio por interface: o Wi-Fi e a ancoragem USB podem estar ativos juntos
+    for (const QNetworkInterface& iface : m_interfaces) {
+        m_socket->setMulticastInterface(iface);
+        m_socket->writeDatagram(data, group, Discovery::ANNOUNCE_PORT);
+    }
+}
+
+void DiscoveryService::readQueries()
+{
+    while (m_socket && m_socket->hasPendingDatagrams()) {
+        const QNetworkDatagram datagram = m_socket->receiveDatagram();
+        const QByteArray data = datagram.data();
+
+        const QByteArray* response = nullptr;
+        if (data == DISCOVERY_QUERY) {
+            response = &m_legacyAck;
+        }
+        else if (data == DISCOVERY_QUERY_V2) {
+            response = &descriptor();
+        }
+        else {
+            continue;
+        }
+
+        if (m_socket->writeDatagram(*response, datagram.senderAddress(), datagram.senderPort()) == -1) {
+            qWarning() << "Descoberta: falha ao responder para" << datagram.senderAddress().toString();
+        }
+    }
+}
@@ -0,0 +1,101 @@
+#ifndef DISCOVERY_SERVICE_H
+#define DISCOVERY_SERVICE_H
+
+#include <QObject>
+#include <QUdpSocket>
+#include <QHostAddress>
+#include <QNetworkInterface>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QList>
+#include "../controller_types.h"
+
+// Descritor binário v2 (little-endian), enviado por multicast e como resposta
+// a DISCOVERY_QUERY_V2. Campos novos só podem ser acrescentados no final:
+//   [0]  'GPVD'            [4]  u8 versão        [5]  u8 flags
+//   [6]  u16 porta TCP      [8]  u16 porta UDP    [10] u16 porta DSU base
+//   [12] u8 portas DSU      [13] u8 máx. jogadores [14] u8 jogadores
+//   [15] u8 slots livres (bit i = jogador i)       [16] u8 versões de pacote
+//   [17] u8 codecs          [18] u8 carga (0-100) [19] u8 tamanho do nome
+//   [20] u32 id do servidor [24] u32 geração       [28] nome (UTF-8)
+namespace Discovery {
+constexpr quint16 ANNOUNCE_PORT = 27017;
+constexpr char MULTICAST_GROUP[] = "239.255.70.16";
+constexpr int ANNOUNCE_INTERVAL_MS = 1000;
+
+constexpr quint8 DESCRIPTOR_VERSION = 1;
+constexpr int DESCRIPTOR_HEADER_SIZE = 28;
+constexpr int MAX_NAME_SIZE = 32;
+
+// flags
+constexpr quint8 FLAG_STREAMING = 0x01;
+constexpr quint8 FLAG_ACCEPTING_PLAYERS = 0x02;
+
+// Versões de pacote aceitas no canal UDP
+constexpr quint8 PACKET_BASIC = 0x01;        // GamepadPacket (20 bytes)
+constexpr quint8 PACKET_TIMED = 0x02;        // TimedGamepadPacket (24 bytes)
+constexpr quint8 PACKET_MOTION_BATCH = 0x04; // Lote de MotionSample (0x03)
+
+// Codecs do streaming ativo
+constexpr quint8 CODEC_H264 = 0x01;
+constexpr quint8 CODEC_VP8 = 0x02;
+constexpr quint8 CODEC_OPUS = 0x04;
+}
+
+// Serviço de descoberta. Responde às consultas por broadcast (o ACK legado e o
+// descritor v2) e anuncia o descritor por multicast em todas as interfaces
+// IPv4, periodicamente e logo após cada mudança de estado. O descritor só é
+// recodificado quando o estado muda; nome do host e interfaces ficam em cache.
+class DiscoveryService : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DiscoveryService(QObject* parent = nullptr);
+    ~DiscoveryService();
+
+    bool start(quint16 queryPort, quint16 controlPort, quint16 dataPort);
+    void stop();
+
+    void setPlayerOccupied(int playerIndex, bool occupied);
+    // Jogadores aceitos pelo servidor (anunciado como máximo de jogadores)
+    void setCapacity(int players);
+    void setStreamingState(bool enabled, quint8 codecMask);
+
+    const QByteArray& descriptor();
+
+private slots:
+    void readQueries();
+    void onAnnounceTimer();
+    void announce();
+
+private:
+    void markDirty();
+    void rebuildDescriptor();
+    void refreshInterfaces();
+    int currentLoad() const;
+
+    QUdpSocket* m_socket = nullptr;
+    QTimer* m_announceTimer;
+    QTimer* m_changeTimer;
+    QElapsedTimer m_lagClock;
+    QList<QNetworkInterface> m_interfaces;
+    int m_announcesSinceRefresh = 0;
+
+    QByteArray m_legacyAck;
+    QByteArray m_descriptor;
+    bool m_dirty = true;
+
+    quint32 m_serverId;
+    quint32 m_generation = 0;
+    QByteArray m_name;
+    quint16 m_controlPort = 0;
+    int m_capacity = MAX_PLAYERS;
+    quint16 m_dataPort = 0;
+    quint8 m_occupiedMask = 0;
+    bool m_streaming = false;
+    quint8 m_codecMask = 0;
+    double m_loopLagMs = 0.0;
+};
+
+#endif // DISCOVERY_SERVICE_H
@@ -0,0 +1,257 @@
+﻿#include "dsu_probe_client.h"
+#include "../protocol/dsu_encoder.h"
+#include "../utils/crc32.h"
+#include <QDebug>
+#include <QtEndian>
+#include <QRandomGenerator>
+#include <cstring>
+
+// --- RELATÓRIO ---
+
+QStringList DsuProbeReport::summary() const
+{
+    QStringList lines;
+    lines << QString("Resultado: %1").arg(passed() ? "OK" : "FALHOU");
+    lines << QString("Handshake: versão %1/%2, informações %3/%4")
+        .arg(versionReplies).arg(subscribers)
+        .arg(infoReplies).arg(subscribers * DSU_MAX_CONTROLLERS);
+    lines << QString("Pacotes: %1 em %2 streams (%3 Hz por stream, %4 s)")
+        .arg(packets).arg(streams).arg(rateHz, 0, 'f', 1).arg(durationSec, 0, 'f', 1);
+    lines << QString("Perda: %1 (%2%), fora de ordem: %3")
+        .arg(lost).arg(lossRatio() * 100.0, 0, 'f', 2).arg(outOfOrder);
+    lines << QString("CRC inválido: %1, malformados: %2").arg(crcErrors).arg(malformed);
+    lines << QString("Intervalo p50/p99: %1/%2 us, jitter p50/p99: %3/%4 us")
+        .arg(intervalP50Us).arg(intervalP99Us).arg(jitterP50Us).arg(jitterP99Us);
+    return lines;
+}
+
+QJsonObject DsuProbeReport::toJson() const
+{
+    QJsonObject obj;
+    obj["passed"] = passed();
+    obj["subscribers"] = subscribers;
+    obj["version_replies"] = versionReplies;
+    obj["info_replies"] = infoReplies;
+    obj["packets"] = packets;
+    obj["streams"] = streams;
+    obj["rate_hz"] = rateHz;
+    obj["lost"] = lost;
+    obj["loss_ratio"] = lossRatio();
+    obj["out_of_order"] = outOfOrder;
+    obj["crc_errors"] = crcErrors;
+    obj["malformed"] = malformed;
+    obj["interval_p50_us"] = intervalP50Us;
+    obj["interval_p99_us"] = intervalP99Us;
+    obj["jitter_p50_us"] = jitterP50Us;
+    obj["jitter_p99_us"] = jitterP99Us;
+    return obj;
+}
+
+// --- CLIENTE ---
+
+DsuProbeClient::DsuProbeClient(QObject* parent)
+    : QObject(parent), m_intervals("dsu_probe.interval_us"), m_jitter("dsu_probe.jitter_us")
+{
+    // Clientes reais renovam a assinatura periodicamente
+    m_resubscribeTimer = new QTimer(this);
+    m_resubscribeTimer->setInterval(500);
+    connect(m_resubscribeTimer, &QTimer::timeout, this, &DsuProbeClient::resubscribe);
+
+    m_durationTimer = new QTimer(this);
+    m_durationTimer->setSingleShot(true);
+    connect(m_durationTimer, &QTimer::timeout, this, &DsuProbeClient::finish);
+}
+
+DsuProbeClient::~DsuProbeClient()
+{
+    stop();
+}
+
+void DsuProbeClient::start(const DsuProbeConfig& config)
+{
+    stop();
+
+    m_config = config;
+    m_report = DsuProbeReport();
+    m_report.subscribers = qBound(1, config.subscribers, 64);
+    m_intervals.reset();
+    m_jitter.reset();
+
+    m_subscribers.resize(m_report.subscribers);
+    for (int k = 0; k < m_subscribers.size(); ++k) {
+        Subscriber& sub = m_subscribers[k];
+        sub = Subscriber();
+        sub.clientId = QRandomGenerator::global()->generate();
+        sub.socket = new QUdpSocket(this);
+        sub.socket->bind(QHostAddress::AnyIPv4, 0);
+        connect(sub.socket, &QUdpSocket::readyRead, this, [this, k]() { readDatagrams(k); });
+    }
+
+    qDebug() << "Sonda DSU:" << m_report.subscribers << "assinante(s) em"
+        << m_config.host.toString() << ":" << m_config.port << "por" << m_config.durationMs << "ms";
+
+    m_clock.start();
+    for (Subscriber& sub : m_subscribers) sendRequest(sub, Dsu::MSG_VERSION, QByteArray());
+    m_resubscribeTimer->start();
+    m_durationTimer->start(m_config.durationMs);
+}
+
+void DsuProbeClient::stop()
+{
+    m_resubscribeTimer->stop();
+    m_durationTimer->stop();
+    for (Subscriber& sub : m_subscribers) {
+        if (sub.socket) {
+            sub.socket->close();
+            sub.socket->deleteLater();
+            sub.socket = nullptr;
+        }
+    }
+    m_subscribers.clear();
+}
+
+void DsuProbeClient::sendRequest(Subscriber& sub, quint32 messageType, const QByteArray& payload)
+{
+    QByteArray request(Dsu::HEADER_SIZE + payload.size(), 0);
+    char* p = request.data();
+    p[0] = 'D'; p[1] = 'S'; p[2] = 'U'; p[3] = 'C';
+    qToLittleEndian<quint16>(Dsu::PROTOCOL_VERSION, p + 4);
+    qToLittleEndian<quint16>(static_cast<quint16>(request.size() - 16), p + 6);
+    qToLittleEndian<quint32>(sub.clientId, p + 12);
+    qToLittleEndian<quint32>(messageType, p + 16);
+    if (!payload.isEmpty()) std::memcpy(p + Dsu::HEADER_SIZE, payload.constData(), payload.size());
+    qToLittleEndian<quint32>(Crc32::compute(p, request.size()), p + 8);
+
+    sub.socket->writeDatagram(request, m_config.host, m_config.port);
+}
+
+void DsuProbeClient::resubscribe()
+{
+    // Assinatura de todos os slots (flags = 0) só depois do handshake completo
+    const QByteArray payload(8, 0);
+    for (Subscriber& sub : m_subscribers) {
+        if (sub.versionOk && sub.infoReplies >= DSU_MAX_CONTROLLERS) {
+            sendRequest(sub, Dsu::MSG_PAD_DATA, payload);
+        }
+    }
+}
+
+void DsuProbeClient::readDatagrams(int index)
+{
+    if (index < 0 || index >= m_subscribers.size()) return;
+    Subscriber& sub = m_subscribers[index];
+    if (!sub.socket) return;
+
+    char datagram[512];
+    while (sub.socket->hasPendingDatagrams()) {
+        const qint64 size = sub.socket->readDatagram(datagram, sizeof(datagram));
+        if (size > 0) handleDatagram(sub, datagram, size);
+    }
+}
+
+void DsuProbeClient::handleDatagram(Subscriber& sub, const char* data, qint64 size)
+{
+    if (size < Dsu::HEADER_SIZE || data[0] != 'D' || data[1] != 'S' || data[2] != 'U' || data[3] != 'S'
+        || qFromLittleEndian<quint16>(data + 4) != Dsu::PROTOCOL_VERSION
+        || qFromLittleEndian<quint16>(data + 6) != size - 16) {
+        m_report.malformed++;
+        return;
+    }
+
+    // CRC calculado com o campo zerado
+    char copy[512];
+    std::memcpy(copy, data, static_cast<size_t>(size));
+    std::memset(copy + 8, 0, 4);
+    if (Crc32::compute(copy, static_cast<size_t>(size)) != qFromLittleEndian<quint32>(data + 8)) {
+        m_report.crcErrors++;
+        return;
+    }
+
+    const quint32 messageType = qFromLittleEndian<quint32>(data + 16);
+    if (messageType == Dsu::MSG_VERSION && size == Dsu::VERSION_PACKET_SIZE) {
+        if (!sub.versionOk) {
+            sub.versionOk = true;
+            m_report.versionReplies++;
+
+            // Pede informações dos 4 slots: [int32 quantidade][slots...]
+            QByteArray payload(4 + DSU_MAX_CONTROLLERS, 0);
+            qToLittleEndian<qint32>(DSU_MAX_CONTROLLERS, payload.data());
+            for (int slot = 0; slot < DSU_MAX_CONTROLLERS; ++slot) payload[4 + slot] = static_cast<char>(slot);
+            sendRequest(sub, Dsu::MSG_PORT_INFO, payload);
+        }
+    }
+    else if (messageType == Dsu::MSG_PORT_INFO && size == Dsu::INFO_PACKET_SIZE) {
+        if (sub.infoReplies < DSU_MAX_CONTROLLERS) {
+            sub.infoReplies++;
+            m_report.infoReplies++;
+            if (sub.infoReplies == DSU_MAX_CONTROLLERS) {
+                const QByteArray payload(8, 0);
+                sendRequest(sub, Dsu::MSG_PAD_DATA, payload);
+            }
+        }
+    }
+    else if (messageType == Dsu::MSG_PAD_DATA && size == Dsu::DATA_PACKET_SIZE) {
+        handlePadData(sub, data);
+    }
+    else {
+        m_report.malformed++;
+    }
+}
+
+void DsuProbeClient::handlePadData(Subscriber& sub, const char* data)
+{
+    const int slot = static_cast<unsigned char>(data[20]);
+    if (slot >= DSU_MAX_CONTROLLERS) {
+        m_report.malformed++;
+        return;
+    }
+
+    SlotStream& stream = sub.streams[slot];
+    const quint32 counter = qFromLittleEndian<quint32>(data + 32);
+    const qint64 nowUs = m_clock.nsecsElapsed() / 1000;
+
+    if (stream.hasCounter) {
+        const quint32 delta = counter - stream.lastCounter;
+        if (delta == 0 || delta >= 0x80000000u) {
+            m_report.outOfOrder++;
+            return;
+        }
+        m_report.lost += delta - 1;
+    }
+    stream.hasCounter = true;
+    stream.lastCounter = counter;
+    stream.packets++;
+    m_report.packets++;
+
+    if (stream.lastArrivalUs >= 0) {
+        const qint64 interval = nowUs - stream.lastArrivalUs;
+        m_intervals.record(interval);
+        if (stream.lastIntervalUs >= 0) m_jitter.record(qAbs(interval - stream.lastIntervalUs));
+        stream.lastIntervalUs = interval;
+    }
+    stream.lastArrivalUs = nowUs;
+}
+
+void DsuProbeClient::finish()
+{
+    m_resubscribeTimer->stop();
+
+    m_report.durationSec = m_clock.elapsed() / 1000.0;
+    for (const Subscriber& sub : m_subscribers) {
+        for (const SlotStream& stream : sub.streams) {
+            if (stream.packets > 0) m_report.streams++;
+        }
+    }
+    if (m_report.streams > 0 && m_report.durationSec > 0.0) {
+        m_report.rateHz = m_report.packets / (m_report.durationSec * m_report.streams);
+    }
+    m_report.intervalP50Us = m_intervals.percentile(0.50);
+    m_report.intervalP99Us = m_intervals.percentile(0.99);
+    m_report.jitterP50Us = m_jitter.percentile(0.50);
+    m_report.jitterP99Us = m_jitter.percentile(0.99);
+
+    for (const QString& line : m_report.summary()) qDebug().noquote() << "Sonda DSU:" << line;
+
+    stop();
+    emit finished(m_report);
+}
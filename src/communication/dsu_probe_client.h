@@ -0,0 +1,102 @@
+#ifndef DSU_PROBE_CLIENT_H
+#define DSU_PROBE_CLIENT_H
+
+#include <QObject>
+#include <QUdpSocket>
+#include <QHostAddress>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QVector>
+#include <QStringList>
+#include <QJsonObject>
+#include "../controller_types.h"
+#include "../utils/metrics.h"
+
+struct DsuProbeConfig {
+    QHostAddress host = QHostAddress(QHostAddress::LocalHost);
+    quint16 port = 26760;
+    int subscribers = 1;
+    int durationMs = 5000;
+};
+
+// Resultado consolidado de todos os assinantes simulados
+struct DsuProbeReport {
+    int subscribers = 0;
+    int versionReplies = 0;
+    int infoReplies = 0;
+    qint64 packets = 0;
+    qint64 crcErrors = 0;
+    qint64 malformed = 0;              // Cabeçalho, tamanho ou tipo inválidos
+    qint64 lost = 0;                   // Lacunas no contador por slot
+    qint64 outOfOrder = 0;             // Contador repetido ou voltando
+    int streams = 0;                   // Pares (assinante, slot) que receberam dados
+    double durationSec = 0.0;
+    double rateHz = 0.0;               // Média por stream
+    qint64 intervalP50Us = 0;
+    qint64 intervalP99Us = 0;
+    qint64 jitterP50Us = 0;            // |intervalo - intervalo anterior|
+    qint64 jitterP99Us = 0;
+
+    bool handshakeOk() const { return versionReplies >= subscribers && infoReplies >= subscribers * DSU_MAX_CONTROLLERS; }
+    double lossRatio() const { return (packets + lost) > 0 ? static_cast<double>(lost) / (packets + lost) : 0.0; }
+    bool passed() const { return handshakeOk() && crcErrors == 0 && malformed == 0 && packets > 0 && lossRatio() < 0.01; }
+
+    QStringList summary() const;
+    QJsonObject toJson() const;
+};
+
+// Cliente DSU simulado: faz o handshake versão/informação/assinatura como um
+// emulador, valida CRC e contadores de cada pacote e mede taxa, jitter e perda.
+// Cada assinante usa um socket próprio (porta efêmera), como clientes distintos.
+class DsuProbeClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DsuProbeClient(QObject* parent = nullptr);
+    ~DsuProbeClient();
+
+    void start(const DsuProbeConfig& config);
+    void stop();
+    bool isRunning() const { return m_durationTimer->isActive(); }
+
+signals:
+    void finished(const DsuProbeReport& report);
+
+private slots:
+    void resubscribe();
+    void finish();
+
+private:
+    struct SlotStream {
+        bool hasCounter = false;
+        quint32 lastCounter = 0;
+        qint64 lastArrivalUs = -1;
+        qint64 lastIntervalUs = -1;
+        qint64 packets = 0;
+    };
+
+    struct Subscriber {
+        QUdpSocket* socket = nullptr;
+        quint32 clientId = 0;
+        bool versionOk = false;
+        int infoReplies = 0;
+        SlotStream streams[DSU_MAX_CONTROLLERS];
+    };
+
+    void sendRequest(Subscriber& sub, quint32 messageType, const QByteArray& payload);
+    void readDatagrams(int index);
+    void handleDatagram(Subscriber& sub, const char* data, qint64 size);
+    void handlePadData(Subscriber& sub, const char* data);
+
+    DsuProbeConfig m_config;
+    QVector<Subscriber> m_subscribers;
+    QElapsedTimer m_clock;
+    QTimer* m_resubscribeTimer;
+    QTimer* m_durationTimer;
+    DsuProbeReport m_report;
+    LatencyStat m_intervals;
+    LatencyStat m_jitter;
+};
+
+#endif // DSU_PROBE_CLIENT_H
@@ -0,0 +1,414 @@
+﻿#include "dsu_server.h"
+#include "../utils/metrics.h"
+#include <QDebug>
+#include <QtEndian>
+#include <QNetworkInterface>
+
+#ifdef Q_OS_LINUX
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#endif
+
+DsuServer::DsuServer(QObject* parent)
+    : QObject(parent)
+{
+    for (int i = 0; i < MAX_PLAYERS; ++i) m_playerConnected[i] = false;
+    for (int k = 0; k < PORT_COUNT; ++k) {
+        m_ports[k].encoder = new DsuEncoder(0, k * DSU_MAX_CONTROLLERS);
+    }
+
+    m_clock.start();
+
+    m_expiryTimer = new QTimer(this);
+    m_expiryTimer->setInterval(1000);
+    connect(m_expiryTimer, &QTimer::timeout, this, &DsuServer::expireSubscriptions);
+}
+
+DsuServer::~DsuServer()
+{
+    stop();
+    for (PortState& ps : m_ports) {
+        delete ps.encoder;
+        ps.encoder = nullptr;
+    }
+}
+
+bool DsuServer::start()
+{
+    bool allBound = true;
+
+    for (int k = 0; k < PORT_COUNT; ++k) {
+        PortState& ps = m_ports[k];
+        if (ps.socket) continue;
+
+        const quint16 port = BASE_PORT + k;
+        ps.socket = new QUdpSocket(this);
+        if (!ps.socket->bind(QHostAddress::AnyIPv4, port, QUdpSocket::ShareAddress)) {
+            qCritical() << "Falha ao vincular socket CemuhookUDP na porta" << port;
+            delete ps.socket;
+            ps.socket = nullptr;
+            allBound = false;
+            continue;
+        }
+
+        qDebug() << "Socket CemuhookUDP vinculado na porta" << port
+            << "(jogadores" << (k * DSU_MAX_CONTROLLERS + 1) << "a" << qMin((k + 1) * DSU_MAX_CONTROLLERS, MAX_PLAYERS) << ")";
+        connect(ps.socket, &QUdpSocket::readyRead, this, [this, k]() { readPendingDatagrams(k); });
+    }
+
+    const QList<QHostAddress> ipAddressesList = QNetworkInterface::allAddresses();
+    for (const QHostAddress& address : ipAddressesList) {
+        if (address.protocol() == QAbstractSocket::IPv4Protocol && address != QHostAddress::LocalHost) {
+            qDebug() << "Endereço de rede DSU disponível:" << address.toString();
+        }
+    }
+
+    m_expiryTimer->start();
+    return allBound;
+}
+
+void DsuServer::stop()
+{
+    m_expiryTimer->stop();
+    for (PortState& ps : m_ports) {
+        if (ps.socket) {
+            ps.socket->close();
+            ps.socket->deleteLater();
+            ps.socket = nullptr;
+        }
+        ps.subscribedSlots = 0;
+    }
+    m_subscribers.clear();
+}
+
+void DsuServer::setPlayerConnected(int playerIndex, bool connected)
+{
+    if (playerIndex < 0 || playerIndex >= MAX_PLAYERS) return;
+    m_playerConnected[playerIndex] = connected;
+}
+
+// --- ENVIO ---
+
+void DsuServer::publish(int playerIndex, const GamepadPacket& packet, quint64 timestampUs)
+{
+    if (playerIndex < 0 || playerIndex >= MAX_PLAYERS) return;
+
+    const int serverIndex = playerIndex / DSU_MAX_CONTROLLERS;
+    const int slot = playerIndex % DSU_MAX_CONTROLLERS;
+    PortState& ps = m_ports[serverIndex];
+    if (!ps.socket || !(ps.subscribedSlots & (1u << slot))) return;
+
+    // Custo do encode e do fan-out (total por pacote e dividido pelo número de assinantes).
+    // Amostra 1 a cada 64 pacotes para a medição não pesar no caminho quente.
+    static LatencyStat* encodeStat = Metrics::instance().latency("dsu.encode_ns");
+    static LatencyStat* fanoutStat = Metrics::instance().latency("dsu.fanout_ns");
+    static LatencyStat* perSubscriberStat = Metrics::instance().latency("dsu.fanout_per_subscriber_ns");
+    static CounterStat* sentCounter = Metrics::instance().counter("dsu.datagrams_sent");
+
+    const quint32 counter = ps.packetCounter[slot]++;
+    const qint64 startNs = m_clock.nsecsElapsed();
+
+    // Um único encode por slot: todos os assinantes recebem os mesmos bytes
+    const char* data = ps.encoder->encodePadData(slot, packet, counter, timestampUs);
+    const qint64 encodedNs = m_clock.nsecsElapsed();
+    const int receivers = sendToSubscribers(serverIndex, slot, data, Dsu::DATA_PACKET_SIZE);
+
+    sentCounter->add(receivers);
+    if ((counter & 63) == 0) encodeStat->record(encodedNs - startNs);
+    if ((counter & 63) == 0 && receivers > 0) {
+        const qint64 elapsed = m_clock.nsecsElapsed() - startNs;
+        fanoutStat->record(elapsed);
+        perSubscriberStat->record(elapsed / receivers);
+    }
+}
+
+int DsuServer::sendToSubscribers(int serverIndex, int slot, const char* data, int size)
+{
+    QUdpSocket* socket = m_ports[serverIndex].socket;
+    const qint64 now = m_clock.elapsed();
+
+#ifdef Q_OS_LINUX
+    // Um único syscall para todos os assinantes do slot
+    if (!m_portableSend) {
+        mmsghdr messages[MAX_SUBSCRIBERS];
+        iovec payload;
+        payload.iov_base = const_cast<char*>(data);
+        payload.iov_len = static_cast<size_t>(size);
+
+        unsigned int count = 0;
+        for (Subscriber& sub : m_subscribers) {
+            if (sub.serverIndex != serverIndex || sub.slotDeadline[slot] <= now) continue;
+            msghdr& header = messages[count].msg_hdr;
+            header = msghdr();
+            header.msg_name = &sub.nativeAddress;
+            header.msg_namelen = sizeof(sub.nativeAddress);
+            header.msg_iov = &payload;
+            header.msg_iovlen = 1;
+            messages[count].msg_len = 0;
+            ++count;
+        }
+        if (count == 0) return 0;
+
+        const int sent = ::sendmmsg(static_cast<int>(socket->socketDescriptor()), messages, count, MSG_DONTWAIT);
+        if (sent >= 0) return sent;
+        // Em caso de erro cai no caminho portátil abaixo
+    }
+#endif
+
+    int receivers = 0;
+    for (const Subscriber& sub : m_subscribers) {
+        if (sub.serverIndex != serverIndex || sub.slotDeadline[slot] <= now) continue;
+        if (socket->writeDatagram(data, size, sub.address, sub.port) == size) ++receivers;
+    }
+    return receivers;
+}
+
+// --- REQUISIÇÕES DOS CLIENTES ---
+
+void DsuServer::readPendingDatagrams(int serverIndex)
+{
+    QUdpSocket* socket = m_ports[serverIndex].socket;
+    if (!socket) return;
+
+    // Requisições DSU têm no máximo algumas dezenas de bytes: buffer na pilha
+    char datagram[512];
+
+    while (socket->hasPendingDatagrams()) {
+        QHostAddress senderAddress;
+        quint16 senderPort;
+
+        qint64 bytesRead = socket->readDatagram(datagram, sizeof(datagram), &senderAddress, &senderPort);
+
+        if (bytesRead <= 0 || senderAddress.isNull() || senderPort == 0) continue;
+        if (bytesRead < Dsu::HEADER_SIZE) continue;
+        if (datagram[0] != 'D' || datagram[1] != 'S' || datagram[2] != 'U' || datagram[3] != 'C') continue;
+
+        quint16 version = qFromLittleEndian<quint16>(datagram + 4);
+        if (version != Dsu::PROTOCOL_VERSION) continue;
+
+        quint32 requestType = qFromLittleEndian<quint32>(datagram + 16);
+        const DsuEncoder* encoder = m_ports[serverIndex].encoder;
+
+        // Respostas de versão/informação são estáticas e já saem com CRC
+        if (requestType == Dsu::MSG_VERSION)
+        {
+            qDebug() << "Cliente DSU solicitou VERSÃO";
+            socket->writeDatagram(encoder->versionReply(), Dsu::VERSION_PACKET_SIZE, senderAddress, senderPort);
+        }
+        else if (requestType == Dsu::MSG_PORT_INFO)
+        {
+            qDebug() << "Cliente DSU solicitou INFORMAÇÕES";
+            const int firstPlayer = serverIndex * DSU_MAX_CONTROLLERS;
+            auto replyInfo = [&](int slot) {
+                const int player = firstPlayer + slot;
+                const bool connected = player < MAX_PLAYERS && m_playerConnected[player];
+                socket->writeDatagram(encoder->portInfo(slot, connected), Dsu::INFO_PACKET_SIZE, senderAddress, senderPort);
+            };
+
+            bool anyRequested = false;
+            for (int i = 0; (24 + i) < bytesRead; i++) {
+                int slot = static_cast<unsigned char>(datagram[24 + i]);
+                if (slot >= DSU_MAX_CONTROLLERS) continue;
+                anyRequested = true;
+                replyInfo(slot);
+            }
+            if (!anyRequested) {
+                for (int slot = 0; slot < DSU_MAX_CONTROLLERS; slot++) replyInfo(slot);
+            }
+        }
+        else if (requestType == Dsu::MSG_PAD_DATA)
+        {
+            handleSubscription(serverIndex, datagram, bytesRead, senderAddress, senderPort);
+        }
+        else {
+            qDebug() << "Tipo de requisição DSU desconhecido:" << QString::number(requestType, 16);
+        }
+    }
+}
+
+// 0x100002: byte 20 = flags (bit 0: por slot, bit 1: por MAC, 0: todos),
+// byte 21 = slot, bytes 22-27 = MAC. O cliente reenvia periodicamente para manter a assinatura.
+void DsuServer::handleSubscription(int serverIndex, const char* data, qint64 size, const QHostAddress& address, quint16 port)
+{
+    quint8 slotMask = 0;
+    const quint8 flags = size >= 28 ? static_cast<quint8>(data[20]) : 0;
+
+    if (flags == 0) {
+        slotMask = (1u << DSU_MAX_CONTROLLERS) - 1;
+    }
+    else {
+        if (flags & 0x01) {
+            const int slot = static_cast<unsigned char>(data[21]);
+            if (slot < DSU_MAX_CONTROLLERS) slotMask |= (1u << slot);
+        }
+        if (flags & 0x02) {
+            const int slot = slotForMac(serverIndex, reinterpret_cast<const unsigned char*>(data + 22));
+            if (slot >= 0) slotMask |= (1u << slot);
+        }
+    }
+    if (slotMask == 0) return;
+
+    int index = findSubscriber(serverIndex, address, port);
+    if (index < 0) {
+        if (m_subscribers.size() >= MAX_SUBSCRIBERS) {
+            qWarning() << "Limite de assinantes DSU atingido, ignorando" << address.toString() << ":" << port;
+            return;
+        }
+
+        Subscriber sub;
+        sub.address = address;
+        sub.port = port;
+        sub.serverIndex = serverIndex;
+#ifdef Q_OS_LINUX
+        sub.nativeAddress.sin_family = AF_INET;
+        sub.nativeAddress.sin_port = htons(port);
+        sub.nativeAddress.sin_addr.s_addr = htonl(address.toIPv4Address());
+#endif
+        m_subscribers.append(sub);
+        index = m_subscribers.size() - 1;
+
+        qDebug() << "CLIENTE DSU INSCRITO:" << address.toString() << ":" << port
+            << "na porta" << (BASE_PORT + serverIndex) << "- total:" << m_subscribers.size();
+        Metrics::instance().counter("dsu.subscribers")->set(m_subscribers.size());
+        emit subscriberAdded(address.toString(), port, m_subscribers.size());
+    }
+
+    const qint64 deadline = m_clock.elapsed() + SUBSCRIPTION_TIMEOUT_MS;
+    Subscriber& sub = m_subscribers[index];
+    for (int slot = 0; slot < DSU_MAX_CONTROLLERS; ++slot) {
+        if (slotMask & (1u << slot)) sub.slotDeadline[slot] = deadline;
+    }
+
+    m_ports[serverIndex].subscribedSlots |= slotMask;
+}
+
+int DsuServer::findSubscriber(int serverIndex, const QHostAddress& address, quint16 port) const
+{
+    for (int i = 0; i < m_subscribers.size(); ++i) {
+        const Subscriber& sub = m_subscribers[i];
+        if (sub.serverIndex == serverIndex && sub.port == port && sub.address == address) return i;
+    }
+    return -1;
+}
+
+// O MAC anunciado é AA:BB:CC:DD:EE:(FF + jogador)
+int DsuServer::slotForMac(int serverIndex, const unsigned char* mac) const
+{
+    if (mac[0] != 0xAA || mac[1] != 0xBB || mac[2] != 0xCC || mac[3] != 0xDD || mac[4] != 0xEE) return -1;
+
+    const int player = static_cast<quint8>(mac[5] + 1);
+    const int slot = player - serverIndex * DSU_MAX_CONTROLLERS;
+    return (slot >= 0 && slot < DSU_MAX_CONTROLLERS) ? slot : -1;
+}
+
+void DsuServer::expireSubscriptions()
+{
+    const qint64 now = m_clock.elapsed();
+
+    for (int i = m_subscribers.size() - 1; i >= 0; --i) {
+        const Subscriber& sub = m_subscribers[i];
+        bool alive = false;
+        for (int slot = 0; slot < DSU_MAX_CONTROLLERS; ++slot) {
+            if (sub.slotDeadline[slot] > now) alive = true;
+        }
+        if (alive) continue;
+
+        const QString address = sub.address.toString();
+        const quint16 port = sub.port;
+        m_subscribers.removeAt(i);
+
+        qDebug() << "Cliente DSU" << address << ":" << port << "expirou. Total:" << m_subscribers.size();
+        Metrics::instance().counter("dsu.subscribers")->set(m_subscribers.size());
+        emit subscriberRemoved(address, port, m_subscribers.size());
+    }
+
+    refreshSubscribedSlots();
+}
+
+void DsuServer::refreshSubscribedSlots()
+{
+    const qint64 now = m_clock.elapsed();
+
+    for (PortState& ps : m_ports) ps.subscribedSlots = 0;
+    for (const Subscriber& sub : m_subscribers) {
+        for (int slot = 0; slot < DSU_MAX_CONTROLLERS; ++slot) {
+            if (sub.slotDeadline[slot] > now) m_ports[sub.serverIndex].subscribedSlots |= (1u << slot);
+        }
+    }
+}
+
+void DsuServer::printStatus() const
+{
+    for (int k = 0; k < PORT_COUNT; ++k) {
+        const PortState& ps = m_ports[k];
+        qDebug() << "Socket DSU porta" << (BASE_PORT + k) << "vinculado:"
+            << (ps.socket && ps.socket->state() == QUdpSocket::BoundState)
+            << "Slots assinados:" << QString::number(ps.subscribedSlots, 2);
+    }
+
+    const qint64 now = m_clock.elapsed();
+    qDebug() << "Assinantes DSU:" << m_subscribers.size();
+    for (const Subscriber& sub : m_subscribers) {
+        QString slots;
+        for (int slot = 0; slot < DSU_MAX_CONTROLLERS; ++slot) {
+            if (sub.slotDeadline[slot] > now) slots += QString::number(sub.serverIndex * DSU_MAX_CONTROLLERS + slot + 1) + " ";
+        }
+        qDebug() << " " << sub.address.toString() << ":" << sub.port << "Jogadores:" << slots.trimmed();
+    }
+}
+
+// --- BENCHMARK ---
+
+QStringList DsuServer::runFanoutBenchmark(int packets)
+{
+    packets = qMax(1, packets);
+    const int counts[] = { 1, 4, 16, 32 };
+
+    QStringList lines;
+    lines << QString("DSU fan-out em loopback: %1 pacotes por caso, %2 bytes por datagrama")
+        .arg(packets).arg(Dsu::DATA_PACKET_SIZE);
+    QString header = "  assinantes    ";
+    for (int count : counts) header += QString("%1").arg(count, 10);
+    lines << header;
+
+    // Modo 0: sendmmsg (só Linux); modo 1: laço de writeDatagram
+    for (int mode = 0; mode < 2; ++mode) {
+#ifndef Q_OS_LINUX
+        if (mode == 0) continue;
+#endif
+        QString row = mode == 0 ? "  sendmmsg      " : "  writeDatagram ";
+        QString perRow = "  por assinante ";
+        for (int count : counts) {
+            DsuServer server;
+            server.m_portableSend = (mode == 1);
+            PortState& ps = server.m_ports[0];
+            ps.socket = new QUdpSocket(&server);
+            if (!ps.socket->bind(QHostAddress::LocalHost, 0)) {
+                lines << "Falha ao abrir o socket de envio em 127.0.0.1";
+                return lines;
+            }
+
+            // Receptores só para existir a porta: o excedente é descartado pelo kernel.
+            // A assinatura passa pelo mesmo caminho de um pedido 0x100002 (flags 0 = todos os slots)
+            for (int i = 0; i < count; ++i) {
+                QUdpSocket* receiver = new QUdpSocket(&server);
+                receiver->bind(QHostAddress::LocalHost, 0);
+                const char request[28] = {};
+                server.handleSubscription(0, request, sizeof(request), QHostAddress::LocalHost, receiver->localPort());
+            }
+
+            GamepadPacket packet = {};
+            QElapsedTimer timer;
+            timer.start();
+            for (int i = 0; i < packets; ++i) {
+                packet.leftStickX = static_cast<int8_t>(i);
+                server.publish(0, packet, quint64(i) * 4000);
+            }
+            const double us = timer.nsecsElapsed() / 1000.0 / packets;
+            row += QString("%1").arg(QString("%1us").arg(us, 0, 'f', 1), 10);
+            perRow += QString("%1").arg(QString("%1us").arg(us / count, 0, 'f', 2), 10);
+        }
+        lines << row << perRow;
+    }
+    return lines;
+}
@@ -0,0 +1,93 @@
+#ifndef DSU_SERVER_H
+#define DSU_SERVER_H
+
+#include <QObject>
+#include <QUdpSocket>
+#include <QHostAddress>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QVector>
+#include "../controller_types.h"
+#include "../protocol/gamepad_packet.h"
+#include "../protocol/dsu_encoder.h"
+
+#ifdef Q_OS_LINUX
+#include <netinet/in.h>
+#endif
+
+// Servidor de movimento Cemuhook/DSU com vários assinantes simultâneos.
+// O protocolo expõe só 4 slots por servidor, então cada porta atende um grupo
+// de 4 jogadores: 26760 -> jogadores 1-4, 26761 -> jogadores 5-8.
+class DsuServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr quint16 BASE_PORT = 26760;
+    static constexpr int PORT_COUNT = (MAX_PLAYERS + DSU_MAX_CONTROLLERS - 1) / DSU_MAX_CONTROLLERS;
+    static constexpr int MAX_SUBSCRIBERS = 32;
+    static constexpr int SUBSCRIPTION_TIMEOUT_MS = 10000;
+
+    explicit DsuServer(QObject* parent = nullptr);
+    ~DsuServer();
+
+    bool start();
+    void stop();
+
+    // Estado refletido nas respostas 0x100001
+    void setPlayerConnected(int playerIndex, bool connected);
+
+    // Codifica o estado do jogador uma única vez e envia para todos os assinantes do slot.
+    // 'timestampUs' é o instante da amostra de movimento (base de tempo do chamador).
+    void publish(int playerIndex, const GamepadPacket& packet, quint64 timestampUs);
+
+    int subscriberCount() const { return m_subscribers.size(); }
+    void printStatus() const;
+
+    // --bench-dsu-fanout: custo do publish() com 1, 4, 16 e 32 assinantes em
+    // 127.0.0.1, com sendmmsg (Linux) e com o laço de writeDatagram
+    static QStringList runFanoutBenchmark(int packets);
+
+signals:
+    void subscriberAdded(const QString& address, quint16 port, int totalSubscribers);
+    void subscriberRemoved(const QString& address, quint16 port, int totalSubscribers);
+
+private slots:
+    void expireSubscriptions();
+
+private:
+    // Um assinante é um par endereço:porta em uma das portas do servidor.
+    // Cada slot tem seu próprio prazo: o cliente renova as assinaturas que quer manter.
+    struct Subscriber {
+        QHostAddress address;
+        quint16 port = 0;
+        int serverIndex = 0;
+        qint64 slotDeadline[DSU_MAX_CONTROLLERS] = {};
+#ifdef Q_OS_LINUX
+        sockaddr_in nativeAddress = {};
+#endif
+    };
+
+    struct PortState {
+        QUdpSocket* socket = nullptr;
+        DsuEncoder* encoder = nullptr;
+        quint32 packetCounter[DSU_MAX_CONTROLLERS] = {};
+        quint8 subscribedSlots = 0;           // Máscara dos slots com pelo menos um assinante
+    };
+
+    void readPendingDatagrams(int serverIndex);
+    void handleSubscription(int serverIndex, const char* data, qint64 size, const QHostAddress& address, quint16 port);
+    int findSubscriber(int serverIndex, const QHostAddress& address, quint16 port) const;
+    int slotForMac(int serverIndex, const unsigned char* mac) const;
+    void refreshSubscribedSlots();
+    int sendToSubscribers(int serverIndex, int slot, const char* data, int size);
+
+    PortState m_ports[PORT_COUNT];
+    QVector<Subscriber> m_subscribers;
+    bool m_playerConnected[MAX_PLAYERS];
+    QElapsedTimer m_clock;                    // Prazos das assinaturas e medição do fan-out
+    QTimer* m_expiryTimer;
+    bool m_portableSend = false;              // Benchmark: laço de writeDatagram também no Linux
+};
+
+#endif // DSU_SERVER_H
@@ -0,0 +1,50 @@
+﻿#include "input_transport.h"
+#include "../utils/metrics.h"
+
+InputTransport::InputTransport(Session::Transport kind, SessionRegistry* sessions, QObject* parent)
+    : QObject(parent), m_sessions(sessions), m_kind(kind)
+{
+}
+
+bool InputTransport::ingest(int playerIndex, const char* data, int size)
+{
+    static CounterStat* packetsCounter = Metrics::instance().counter("ingest.packets");
+    static CounterStat* rejectedCounter = Metrics::instance().counter("ingest.rejected");
+
+    // 1. Estado do controle (20 bytes)
+    if (size == static_cast<int>(sizeof(GamepadPacket))) {
+        emit packetReceived(playerIndex, *reinterpret_cast<const GamepadPacket*>(data));
+    }
+    // 2. Estado do controle com relógio do sensor (24 bytes)
+    else if (size == static_cast<int>(sizeof(TimedGamepadPacket))) {
+        const TimedGamepadPacket* timed = reinterpret_cast<const TimedGamepadPacket*>(data);
+        emit packetReceived(playerIndex, timed->state);
+
+        MotionSample sample;
+        sample.sensorTimestampUs = timed->sensorTimestampUs;
+        sample.gyroX = timed->state.gyroX;
+        sample.gyroY = timed->state.gyroY;
+        sample.gyroZ = timed->state.gyroZ;
+        sample.accelX = timed->state.accelX;
+        sample.accelY = timed->state.accelY;
+        sample.accelZ = timed->state.accelZ;
+        emit motionSampleReceived(playerIndex, sample);
+    }
+    // 3. Lote de amostras de movimento na taxa nativa do sensor ([0x03][n][n x 16 bytes])
+    else if (size > MOTION_BATCH_HEADER_SIZE && static_cast<quint8>(data[0]) == MOTION_BATCH_TYPE
+        && static_cast<quint8>(data[1]) <= MOTION_BATCH_MAX_SAMPLES
+        && size == MOTION_BATCH_HEADER_SIZE + static_cast<quint8>(data[1]) * static_cast<int>(sizeof(MotionSample))) {
+        const int count = static_cast<quint8>(data[1]);
+        const MotionSample* samples = reinterpret_cast<const MotionSample*>(data + MOTION_BATCH_HEADER_SIZE);
+        for (int k = 0; k < count; ++k) {
+            emit motionSampleReceived(playerIndex, samples[k]);
+        }
+    }
+    else {
+        rejectedCounter->add();
+        return false;
+    }
+
+    packetsCounter->add();
+    return true;
+}
@@ -0,0 +1,50 @@
+#ifndef INPUT_TRANSPORT_H
+#define INPUT_TRANSPORT_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+#include "session_registry.h"
+#include "../protocol/gamepad_packet.h"
+
+// Base comum dos transportes de entrada (Wi-Fi, Bluetooth, BLE e loopback).
+// Cada transporte cuida só do seu meio: sockets, rádio, enquadramento do
+// stream e sessões. A validação e a decodificação dos pacotes de controle
+// ficam em ingest(), iguais para todos, e saem pelos mesmos sinais; assim o
+// ConnectionManager liga qualquer transporte do mesmo jeito e o caminho até o
+// controle virtual pode ser exercitado sem socket nem rádio.
+class InputTransport : public QObject
+{
+    Q_OBJECT
+
+public:
+    InputTransport(Session::Transport kind, SessionRegistry* sessions, QObject* parent = nullptr);
+
+    Session::Transport kind() const { return m_kind; }
+
+    virtual void startServer() = 0;
+    virtual void stopServer() = 0;
+    virtual void forceDisconnectPlayer(int playerIndex) = 0;
+    // Comandos para o cliente (vibração, avisos do sistema)
+    virtual bool sendToPlayer(int playerIndex, const QByteArray& data) = 0;
+
+signals:
+    void packetReceived(int playerIndex, const GamepadPacket& packet);
+    void motionSampleReceived(int playerIndex, const MotionSample& sample);
+    void playerConnected(int playerIndex, const QString& type);
+    void playerDisconnected(int playerIndex);
+    void logMessage(const QString& message);
+
+protected:
+    // Decodifica um pacote de entrada e emite os sinais correspondentes.
+    // Formatos aceitos: GamepadPacket, TimedGamepadPacket e lote de MotionSample.
+    // Retorna false (sem emitir nada) se o tamanho/tipo não for reconhecido.
+    bool ingest(int playerIndex, const char* data, int size);
+
+    SessionRegistry* m_sessions;
+
+private:
+    Session::Transport m_kind;
+};
+
+#endif // INPUT_TRANSPORT_H
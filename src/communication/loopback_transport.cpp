@@ -0,0 +1,83 @@
+﻿#include "loopback_transport.h"
+#include <QDebug>
+
+LoopbackTransport::LoopbackTransport(SessionRegistry* sessions, QObject* parent)
+    : InputTransport(Session::Synthetic, sessions, parent)
+{
+}
+
+LoopbackTransport::~LoopbackTransport()
+{
+    stopServer();
+}
+
+void LoopbackTransport::stopServer()
+{
+    if (!m_sessions) return;
+
+    // Os slots do diagnóstico DSU também são Synthetic, mas não têm endpoint deste transporte
+    const quint32 players = m_sessions->playerMask(Session::Synthetic);
+    for (int i = 0; i < MAX_PLAYERS; ++i) {
+        if ((players & (1u << i)) && m_sessions->endpoint(i, Session::Synthetic) == this) {
+            disconnectPlayer(i);
+        }
+    }
+}
+
+int LoopbackTransport::connectPlayer(int playerIndex)
+{
+    const SessionHandle session = (playerIndex < 0)
+        ? m_sessions->open(Session::Synthetic, this)
+        : m_sessions->openAt(playerIndex, Session::Synthetic, this);
+    if (session.isNull()) return -1;
+
+    emit playerConnected(session.playerIndex, "Loopback");
+    return session.playerIndex;
+}
+
+void LoopbackTransport::disconnectPlayer(int playerIndex)
+{
+    if (m_sessions->endpoint(playerIndex, Session::Synthetic) != this) return;
+
+    m_sessions->close(playerIndex);
+    emit playerDisconnected(playerIndex);
+}
+
+void LoopbackTransport::forceDisconnectPlayer(int playerIndex)
+{
+    disconnectPlayer(playerIndex);
+}
+
+bool LoopbackTransport::sendToPlayer(int playerIndex, const QByteArray& data)
+{
+    if (m_sessions->endpoint(playerIndex, Session::Synthetic) != this) return false;
+
+    m_commandsReceived++;
+    m_lastCommand = data;
+    return true;
+}
+
+bool LoopbackTransport::inject(int playerIndex, const char* data, int size)
+{
+    return ingest(playerIndex, data, size);
+}
+
+bool LoopbackTransport::inject(int playerIndex, const GamepadPacket& packet)
+{
+    return ingest(playerIndex, reinterpret_cast<const char*>(&packet), sizeof(GamepadPacket));
+}
+
+qint64 LoopbackTransport::injectTimed(int playerIndex, const GamepadPacket& state, qint64 count, int rateHz, quint32 startUs)
+{
+    if (count <= 0 || rateHz <= 0) return 0;
+
+    TimedGamepadPacket packet;
+    packet.state = state;
+
+    qint64 accepted = 0;
+    for (qint64 i = 0; i < count; ++i) {
+        packet.sensorTimestampUs = startUs + static_cast<quint32>(i * 1000000LL / rateHz);
+        if (ingest(playerIndex, reinterpret_cast<const char*>(&packet), sizeof(TimedGamepadPacket))) accepted++;
+    }
+    return accepted;
+}
@@ -0,0 +1,46 @@
+#ifndef LOOPBACK_TRANSPORT_H
+#define LOOPBACK_TRANSPORT_H
+
+#include "input_transport.h"
+
+// Transporte em processo, sem socket nem rádio: os pacotes injetados passam
+// pelo mesmo ingest() dos transportes reais e saem pelos mesmos sinais, de
+// forma síncrona. Serve para medir o caminho ingestão -> controle virtual de
+// forma determinística (inclusive no Linux) e para testes de carga.
+// Os jogadores ocupam sessões Session::Synthetic no SessionRegistry.
+class LoopbackTransport : public InputTransport
+{
+    Q_OBJECT
+
+public:
+    explicit LoopbackTransport(SessionRegistry* sessions, QObject* parent = nullptr);
+    ~LoopbackTransport();
+
+    void startServer() override {}
+    void stopServer() override;
+    void forceDisconnectPlayer(int playerIndex) override;
+    bool sendToPlayer(int playerIndex, const QByteArray& data) override;
+
+    // Abre uma sessão no primeiro slot livre (ou no slot pedido); -1 se não houver
+    int connectPlayer(int playerIndex = -1);
+    void disconnectPlayer(int playerIndex);
+
+    // Injeta um pacote bruto em qualquer formato aceito por ingest()
+    bool inject(int playerIndex, const char* data, int size);
+    bool inject(int playerIndex, const GamepadPacket& packet);
+
+    // Injeta 'count' pacotes TimedGamepadPacket com o estado dado e relógio do
+    // sensor exato: amostra i = startUs + i * 1e6 / rateHz (sem jitter).
+    // Retorna quantos foram aceitos.
+    qint64 injectTimed(int playerIndex, const GamepadPacket& state, qint64 count, int rateHz, quint32 startUs = 0);
+
+    // Comandos que voltaram para o "cliente" (vibração)
+    qint64 commandsReceived() const { return m_commandsReceived; }
+    const QByteArray& lastCommand() const { return m_lastCommand; }
+
+private:
+    qint64 m_commandsReceived = 0;
+    QByteArray m_lastCommand;
+};
+
+#endif // LOOPBACK_TRANSPORT_H
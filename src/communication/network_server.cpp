@@ -2,21 +2,51 @@
 
 #include <QNetworkDatagram>
 
-#include <QHostInfo>
+#include <QJsonDocument>
 
 #include "../utils/input_emulator.h"
 
+#include "../utils/metrics.h"
 
+#include "../utils/log.h"
 
-NetworkServer::NetworkServer(QObject* parent)
+#include <QTimer>
 
-    : QObject(parent),
+#include <utility>
+
+
+
+// Quanto uma conexão nova espera pelo pedido de retomada enquanto há sessões suspensas
+
+constexpr int RESUME_WAIT_MS = 300;
+
+// IP do cliente (IPv4 mapeado em IPv6 vira IPv4)
+
+static QHostAddress peerAddress(const QTcpSocket* socket)
+
+{
+
+    QHostAddress address = socket->peerAddress();
+
+    if (address.protocol() == QAbstractSocket::IPv6Protocol) {
+
+        address = QHostAddress(address.toIPv4Address());
+
+    }
+
+    return address;
+
+}
+
+NetworkServer::NetworkServer(SessionRegistry* sessions, QObject* parent)
+
+    : InputTransport(Session::Network, sessions, parent),
 
     m_tcpServer(nullptr),
 
     m_udpSocket(nullptr),
 
-    m_discoverySocket(nullptr),
+    m_discovery(nullptr),
 
     m_streamer(nullptr),
 
@@ -28,77 +58,79 @@ NetworkServer::NetworkServer(QObject* parent)
 
     for (int i = 0; i < MAX_PLAYERS; ++i) {
 
-        m_playerSlots[i] = false;
-
-    }
+        m_binarySignal[i] = false;
 
+        m_pendingCandidateCount[i] = 0;
 
+        m_closeRequested[i] = false;
 
-    m_streamer = new ScreenStreamer(this);
+        m_joinStartMs[i] = -1;
 
-    // REMOVA: m_streamer->startMasterPipeline();  <-- NÃO INICIA MAIS AUTOMÁTICO
+        m_joinReads[i] = 0;
 
+        m_suspendedAtMs[i] = 0;
 
+        m_suspendSerial[i] = 0;
 
-    // Conecta mudança de estado do Streamer para avisar a UI (e clientes se quiser)
+    }
 
-    connect(m_streamer, &ScreenStreamer::streamStateChanged, this, [](bool active) {
+    m_clock.start();
 
-        qDebug() << "📡 Status do Stream mudou para:" << active;
 
-        });
 
+    m_streamer = new ScreenStreamer(this);
 
+    m_discovery = new DiscoveryService(this);
 
-    // Conecta o sinal roteado
+    // A ocupação anunciada inclui os jogadores de todos os transportes
 
-    connect(m_streamer, &ScreenStreamer::sendSignalingMessage, this,
+    connect(m_sessions, &SessionRegistry::sessionOpened, this, [this](int playerIndex) {
 
-        [this](int playerIndex, const QJsonObject& json) {
+        m_discovery->setPlayerOccupied(playerIndex, true);
 
-            qDebug() << "📨 [Sinalização] Enviando mensagem para Player" << playerIndex << "Tipo:" << json["type"].toString();
+        });
 
+    connect(m_sessions, &SessionRegistry::sessionClosed, this, [this](int playerIndex) {
 
+        m_discovery->setPlayerOccupied(playerIndex, false);
 
-            QJsonDocument doc(json);
+        });
 
-            QByteArray data = "JSON:" + doc.toJson(QJsonDocument::Compact);
+    // REMOVA: m_streamer->startMasterPipeline();  <-- NÃO INICIA MAIS AUTOMÁTICO
 
 
 
-            // Busca o socket específico deste jogador
+    // Conecta mudança de estado do Streamer para avisar a UI (e clientes se quiser)
 
-            QTcpSocket* targetSocket = nullptr;
+    connect(m_streamer, &ScreenStreamer::streamStateChanged, this, [this](bool active) {
 
-            for (auto it = m_socketPlayerMap.begin(); it != m_socketPlayerMap.end(); ++it) {
+        qDebug() << "📡 Status do Stream mudou para:" << active;
 
-                if (it.value() == playerIndex) {
+        updateDiscoveryStreaming();
 
-                    targetSocket = it.key();
+        });
 
-                    break;
 
-                }
 
-            }
+    // Conecta o sinal roteado
 
+    connect(m_streamer, &ScreenStreamer::sendSignalingMessage, this,
 
+        [this](int playerIndex, const SignalMessage& message) {
 
-            if (targetSocket) {
+            LOG_DEBUG("signal", "Enviando %s para o jogador %d", SignalCodec::typeName(message.type), playerIndex);
 
-                qDebug() << "📤 [Sinalização] Enviando" << data.length() << "bytes para Player" << playerIndex;
 
-                targetSocket->write(data);
 
-                bool flushed = targetSocket->flush();
+            if (playerSocket(playerIndex)) {
 
-                qDebug() << (flushed ? "✅" : "❌") << "[Sinalização] Dados" << (flushed ? "enviados" : "NÃO enviados") << "para Player" << playerIndex;
+                sendSignal(playerIndex, message);
 
             }
 
             else {
 
-                qWarning() << "⚠️ [Sinalização] Socket não encontrado para Player" << playerIndex;
+                LOG_WARNING("signal", "Socket não encontrado para o jogador %d", playerIndex);
 
             }
 
@@ -136,6 +168,24 @@ bool NetworkServer::isStreamingEnabled() const {
 
 
 
+void NetworkServer::setPorts(quint16 controlPort, quint16 dataPort, quint16 discoveryPort)
+
+{
+
+    m_controlPort = controlPort;
+
+    m_dataPort = dataPort;
+
+    m_discoveryPort = discoveryPort;
+
+}
+
+
+
+
+
+
+
 void NetworkServer::startServer()
 
 {
@@ -152,9 +202,9 @@ void NetworkServer::startServer()
 
 
 
-    if (!m_tcpServer->listen(QHostAddress::Any, CONTROL_PORT_TCP)) {
+    if (!m_tcpServer->listen(QHostAddress::Any, m_controlPort)) {
 
-        qCritical() << "❌ Falha ao iniciar servidor TCP na porta" << CONTROL_PORT_TCP;
+        qCritical() << "❌ Falha ao iniciar servidor TCP na porta" << m_controlPort;
 
         emit logMessage("Erro: Falha ao iniciar servidor TCP.");
 
@@ -166,7 +216,7 @@ void NetworkServer::startServer()
 
     }
 
-    qDebug() << "✅ Servidor TCP listening na porta" << CONTROL_PORT_TCP;
+    qDebug() << "✅ Servidor TCP listening na porta" << m_controlPort;
 
 
 
@@ -178,9 +228,9 @@ void NetworkServer::startServer()
 
 
 
-    if (!m_udpSocket->bind(QHostAddress::Any, DATA_PORT_UDP)) {
+    if (!m_udpSocket->bind(QHostAddress::Any, m_dataPort)) {
 
-        qCritical() << "❌ Falha ao iniciar servidor UDP na porta" << DATA_PORT_UDP;
+        qCritical() << "❌ Falha ao iniciar servidor UDP na porta" << m_dataPort;
 
         emit logMessage("Erro: Falha ao iniciar servidor UDP.");
 
@@ -190,21 +240,13 @@ void NetworkServer::startServer()
 
     }
 
-    qDebug() << "✅ Servidor UDP bound na porta" << DATA_PORT_UDP;
-
-
-
-    // Servidor de descoberta UDP
-
-    m_discoverySocket = new QUdpSocket(this);
+    qDebug() << "✅ Servidor UDP bound na porta" << m_dataPort;
 
-    connect(m_discoverySocket, &QUdpSocket::readyRead, this, &NetworkServer::readDiscoveryDatagrams);
 
 
+    // Servidor de descoberta UDP (consultas por broadcast + anúncios multicast)
 
-    if (!m_discoverySocket->bind(QHostAddress::AnyIPv4, DISCOVERY_PORT, QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint)) {
-
-        qCritical() << "❌ Falha ao iniciar servidor de Descoberta na porta" << DISCOVERY_PORT;
+    if (!m_discovery->start(m_discoveryPort, m_controlPort, m_dataPort)) {
 
         emit logMessage("Erro: Falha ao iniciar servidor de Descoberta.");
 
@@ -214,17 +256,21 @@ void NetworkServer::startServer()
 
     }
 
-    qDebug() << "✅ Servidor de Descoberta bound na porta" << DISCOVERY_PORT;
+    updateDiscoveryStreaming();
+
+    m_discovery->setCapacity(m_sessions->capacity());
+
+    qDebug() << "✅ Servidor de Descoberta bound na porta" << m_discoveryPort;
 
 
 
     emit logMessage(QString("Servidor de Rede iniciado (TCP: %1, UDP: %2, Descoberta: %3)")
 
-        .arg(CONTROL_PORT_TCP)
+        .arg(m_controlPort)
 
-        .arg(DATA_PORT_UDP)
+        .arg(m_dataPort)
 
-        .arg(DISCOVERY_PORT));
+        .arg(m_discoveryPort));
 
 
 
@@ -268,13 +314,9 @@ void NetworkServer::stopServer()
 
     }
 
-    if (m_discoverySocket) {
-
-        m_discoverySocket->close();
+    if (m_discovery) {
 
-        delete m_discoverySocket;
-
-        m_discoverySocket = nullptr;
+        m_discovery->stop();
 
         qDebug() << "✅ Servidor de Descoberta parado";
 
@@ -282,45 +324,63 @@ void NetworkServer::stopServer()
 
 
 
-    qDeleteAll(m_socketPlayerMap.keys());
+    for (auto it = m_pendingReaders.begin(); it != m_pendingReaders.end(); ++it) {
 
-    m_socketPlayerMap.clear();
+        it.key()->disconnect(this);
 
-    m_ipPlayerMap.clear();
+        delete it.key();
 
-    m_playerIpMap.clear();
+    }
 
-    m_playerUdpPortMap.clear();
+    m_pendingReaders.clear();
 
+    // Sessões suspensas também são encerradas (o período de carência não sobrevive ao servidor)
 
+    const quint32 players = m_sessions->playerMask(Session::Network);
 
     for (int i = 0; i < MAX_PLAYERS; ++i) {
 
-        m_playerSlots[i] = false;
+        if (!(players & (1u << i))) continue;
 
-    }
+        QTcpSocket* socket = playerSocket(i);
 
-    qDebug() << "✅ Servidor de Rede totalmente parado.";
+        m_suspendSerial[i]++;
 
-}
+        m_closeRequested[i] = false;
 
+        m_sessions->close(i);
 
+        if (socket) {
 
-int NetworkServer::findEmptySlot() const
+            socket->disconnect(this);
 
-{
+            delete socket;
 
-    for (int i = 0; i < MAX_PLAYERS; ++i) {
+        }
 
-        if (!m_playerSlots[i]) {
+        m_controlReaders[i].clear();
 
-            return i;
+        m_binarySignal[i] = false;
 
-        }
+        m_pendingCandidates[i].clear();
+
+        m_pendingCandidateCount[i] = 0;
 
     }
 
-    return -1;
+    m_suspendedMask = 0;
+
+    qDebug() << "✅ Servidor de Rede totalmente parado.";
+
+}
+
+
+
+QTcpSocket* NetworkServer::playerSocket(int playerIndex) const
+
+{
+
+    return static_cast<QTcpSocket*>(m_sessions->endpoint(playerIndex, Session::Network));
 
 }
 
@@ -342,79 +402,115 @@ void NetworkServer::newTcpConnection()
 
     }
 
+    socket->setParent(this);
 
+    connect(socket, &QTcpSocket::disconnected, this, &NetworkServer::tcpClientDisconnected);
 
-    socket->setParent(this);
+    connect(socket, &QTcpSocket::readyRead, this, &NetworkServer::readTcpSocket);
 
+    connect(socket, &QTcpSocket::errorOccurred, this, &NetworkServer::tcpSocketError);
 
+    qDebug() << "🔗 Nova conexão TCP de" << peerAddress(socket).toString() << ":" << socket->peerPort();
 
-    QHostAddress clientAddress = socket->peerAddress();
 
-    if (clientAddress.protocol() == QAbstractSocket::IPv6Protocol) {
 
-        clientAddress = QHostAddress(clientAddress.toIPv4Address());
+    // Com a retomada ligada, a primeira mensagem pode ser um pedido de retomada:
 
-    }
+    // espera um pouco antes de alocar um slot novo (e plugar outro controle).
 
+    // Vale também sem sessões suspensas: numa queda do Wi-Fi o servidor ainda
 
+    // pode ver a conexão antiga viva, e o token é o que separa a volta do mesmo
 
-    qDebug() << "🔗 Nova conexão TCP de" << clientAddress.toString() << ":" << socket->peerPort();
+    // aparelho de uma duplicata
 
+    if (m_resumeGraceMs > 0) {
 
+        m_pendingReaders.insert(socket, ControlFrameReader());
 
-    int playerIndex = findEmptySlot();
+        QTimer::singleShot(RESUME_WAIT_MS, socket, [this, socket]() {
 
-    if (playerIndex == -1) {
+            if (!m_pendingReaders.contains(socket)) return;
 
-        qWarning() << "❌ Servidor cheio! Rejeitando conexão de" << clientAddress.toString();
+            const int playerIndex = admitPending(socket);
 
-        socket->close();
+            if (playerIndex != -1) processControlFrames(socket, playerIndex);
 
-        socket->deleteLater();
+            });
 
         return;
 
     }
 
+    admitConnection(socket);
+
+}
+
+
+
+// Aloca um slot novo para o socket; -1 se a conexão foi recusada
+
+int NetworkServer::admitConnection(QTcpSocket* socket)
 
+{
+
+    const QHostAddress clientAddress = peerAddress(socket);
+
+    const int existing = m_sessions->playerForAddress(clientAddress);
+
+    if (existing != -1 && m_sessions->isSuspended(existing)) {
+
+        // Mesmo aparelho voltou sem token (cliente antigo): a sessão suspensa não será retomada
+
+        expireSession(existing);
+
+    }
 
-    if (m_ipPlayerMap.contains(clientAddress)) {
+    else if (existing != -1) {
 
         qWarning() << "⚠️ IP" << clientAddress.toString() << "já está conectado. Rejeitando duplicata.";
 
+        socket->disconnect(this);
+
         socket->close();
 
         socket->deleteLater();
 
-        return;
+        return -1;
 
     }
 
+    const SessionHandle session = m_sessions->open(Session::Network, socket);
 
+    if (session.isNull()) {
 
-    connect(socket, &QTcpSocket::disconnected, this, &NetworkServer::tcpClientDisconnected);
+        qWarning() << "❌ Servidor cheio! Rejeitando conexão de" << clientAddress.toString();
 
-    connect(socket, &QTcpSocket::readyRead, this, &NetworkServer::readTcpSocket);
+        socket->disconnect(this);
 
-    connect(socket, &QTcpSocket::errorOccurred, this, &NetworkServer::tcpSocketError);
+        socket->close();
 
+        socket->deleteLater();
 
+        return -1;
 
-    m_playerSlots[playerIndex] = true;
+    }
 
-    m_socketPlayerMap[socket] = playerIndex;
+    const int playerIndex = session.playerIndex;
 
-    m_ipPlayerMap[clientAddress] = playerIndex;
+    m_sessions->setAddress(playerIndex, clientAddress);
 
-    m_playerIpMap[playerIndex] = clientAddress;
+    m_controlReaders[playerIndex].clear();
 
+    m_binarySignal[playerIndex] = false;
 
+    m_closeRequested[playerIndex] = false;
 
     qDebug() << "👤 Novo jogador" << (playerIndex + 1) << "conectado via TCP/IP:" << clientAddress.toString();
 
     emit playerConnected(playerIndex, "Wi-Fi");
 
-
+    sendSessionInfo(playerIndex);
 
     // Informa o estado atual do streaming para o novo cliente
 
@@ -424,390 +520,865 @@ void NetworkServer::newTcpConnection()
 
     }
 
-
-
     // Log do estado atual dos slots
 
-    qDebug() << "📊 Slots ocupados:" << m_socketPlayerMap.size() << "/" << MAX_PLAYERS;
+    qDebug() << "📊 Slots ocupados:" << m_sessions->count(Session::Network) << "/" << MAX_PLAYERS;
+
+    return playerIndex;
 
 }
 
 
 
-void NetworkServer::tcpClientDisconnected()
+// Conexão em espera que não pediu retomada: vira uma sessão nova com o que já leu
+
+int NetworkServer::admitPending(QTcpSocket* socket)
 
 {
 
-    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+    ControlFrameReader reader = m_pendingReaders.take(socket);
 
-    if (!socket || !m_socketPlayerMap.contains(socket)) {
+    const int playerIndex = admitConnection(socket);
 
-        qWarning() << "⚠️ Socket desconectado não encontrado no mapa!";
+    if (playerIndex != -1) m_controlReaders[playerIndex] = std::move(reader);
 
-        return;
+    return playerIndex;
 
-    }
+}
 
 
 
-    int playerIndex = m_socketPlayerMap[socket];
+bool NetworkServer::resumeSession(QTcpSocket* socket, int playerIndex)
 
-    QHostAddress clientAddress = socket->peerAddress();
+{
 
-    if (clientAddress.protocol() == QAbstractSocket::IPv6Protocol) {
+    static CounterStat* resumedCounter = Metrics::instance().counter("session.resumed");
 
-        clientAddress = QHostAddress(clientAddress.toIPv4Address());
+    static CounterStat* takeoverCounter = Metrics::instance().counter("session.takeovers");
 
-    }
+    static LatencyStat* resumeTimeStat = Metrics::instance().latency("session.resume_ms");
 
+    if (m_sessions->transport(playerIndex) != Session::Network) {
 
+        return false;
 
-    qDebug() << "🔌 Jogador" << (playerIndex + 1) << "desconectado (TCP/IP):" << clientAddress.toString();
+    }
 
+    // Conexão antiga ainda parece viva (a queda do Wi-Fi não mandou FIN): o token
 
+    // prova que é o mesmo cliente, então a nova assume e a antiga é derrubada
 
-    m_playerSlots[playerIndex] = false;
+    const bool takeover = !m_sessions->isSuspended(playerIndex);
 
-    m_socketPlayerMap.remove(socket);
+    if (takeover) {
 
-    m_ipPlayerMap.remove(clientAddress);
+        QTcpSocket* stale = playerSocket(playerIndex);
 
-    m_playerIpMap.remove(playerIndex);
+        if (!stale || stale == socket) return false;
 
-    m_playerUdpPortMap.remove(playerIndex);
+        dropStaleSocket(playerIndex, stale);
 
+        takeoverCounter->add();
 
+    }
 
-    // Limpa o ramo do GStreamer para economizar RAM
+    m_controlReaders[playerIndex] = m_pendingReaders.take(socket);
 
-    qDebug() << "🗑️ Removendo cliente do ScreenStreamer...";
+    m_binarySignal[playerIndex] = false;
 
-    m_streamer->removeClient(playerIndex);
+    m_closeRequested[playerIndex] = false;
 
+    m_suspendSerial[playerIndex]++;   // Cancela a expiração agendada
 
+    m_suspendedMask &= ~(1u << playerIndex);
 
-    socket->deleteLater();
+    m_sessions->resume(playerIndex, socket);
 
+    m_sessions->setAddress(playerIndex, peerAddress(socket));
 
+    const qint64 elapsed = m_clock.elapsed() - m_suspendedAtMs[playerIndex];
 
-    qDebug() << "✅ Jogador" << (playerIndex + 1) << "totalmente removido.";
+    resumedCounter->add();
 
-    emit playerDisconnected(playerIndex);
+    if (!takeover) resumeTimeStat->record(elapsed);
 
+    qDebug() << "♻️ Jogador" << (playerIndex + 1) << "retomou a sessão após" << elapsed << "ms:" << peerAddress(socket).toString();
 
+    // Token novo a cada retomada
 
-    // Log do estado atual
+    sendSessionInfo(playerIndex);
 
-    qDebug() << "📊 Slots restantes:" << m_socketPlayerMap.size() << "/" << MAX_PLAYERS;
+    return true;
 
 }
 
 
 
-void NetworkServer::readTcpSocket()
+// Derruba a conexão antiga de uma sessão retomada por outra. Mesma limpeza da
 
-{
+// desconexão, mas sem os sinais do socket: a sessão fica suspensa só até o
 
-    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+// resumeSession() logo em seguida, sem carência nem entrada neutra
 
-    if (!socket) {
+void NetworkServer::dropStaleSocket(int playerIndex, QTcpSocket* stale)
 
-        qWarning() << "⚠️ Socket de leitura é nulo!";
+{
 
-        return;
+    qDebug() << "♻️ Jogador" << (playerIndex + 1) << "voltou por outra conexão. Derrubando a antiga:"
 
-    }
+             << peerAddress(stale).toString() << ":" << stale->peerPort();
 
+    m_controlReaders[playerIndex].clear();
 
+    m_joinStartMs[playerIndex] = -1;
 
-    int playerIndex = m_socketPlayerMap.value(socket, -1);
+    m_pendingCandidates[playerIndex].clear();
 
-    if (playerIndex == -1) {
+    m_pendingCandidateCount[playerIndex] = 0;
 
-        qWarning() << "⚠️ Socket não mapeado para nenhum player!";
+    m_streamer->removeClient(playerIndex);
 
-        return;
+    stale->disconnect(this);
 
-    }
+    stale->abort();
+
+    stale->deleteLater();
 
+    m_sessions->suspend(playerIndex);
 
+    m_suspendedAtMs[playerIndex] = m_clock.elapsed();
 
-    QByteArray data = socket->readAll();
+}
 
-    qDebug() << "📨 [TCP] Dados recebidos do Player" << playerIndex << "Tamanho:" << data.size() << "bytes";
 
 
+// Conexão caiu: mantém o slot e o controle virtual (com entrada neutra) pelo período de carência
 
-    if (data.startsWith("JSON:")) {
+void NetworkServer::suspendSession(int playerIndex)
 
-        QByteArray jsonData = data.mid(5);
+{
 
-        qDebug() << "📨 [TCP] JSON do Player" << playerIndex << "Tamanho:" << jsonData.size() << "bytes";
+    static CounterStat* suspendedCounter = Metrics::instance().counter("session.suspended");
 
+    m_sessions->suspend(playerIndex);
 
+    m_suspendedMask |= (1u << playerIndex);
 
-        QJsonDocument doc = QJsonDocument::fromJson(jsonData);
+    m_suspendedAtMs[playerIndex] = m_clock.elapsed();
 
-        if (doc.isNull()) {
+    suspendedCounter->add();
 
-            qWarning() << "❌ [TCP] JSON inválido do Player" << playerIndex;
+    emit packetReceived(playerIndex, GamepadPacket{});
 
-            return;
+    const quint32 serial = ++m_suspendSerial[playerIndex];
 
-        }
+    QTimer::singleShot(m_resumeGraceMs, this, [this, playerIndex, serial]() {
 
+        if (m_suspendSerial[playerIndex] == serial && m_sessions->isSuspended(playerIndex)) {
 
+            qDebug() << "⌛ Jogador" << (playerIndex + 1) << "não voltou no período de carência.";
 
-        QJsonObject obj = doc.object();
+            expireSession(playerIndex);
 
-        QString type = obj["type"].toString();
+        }
+
+        });
 
+    qDebug() << "⏸️ Jogador" << (playerIndex + 1) << "suspenso por até" << m_resumeGraceMs << "ms";
 
+}
 
-        qDebug() << "📨 [TCP] Processando mensagem do Player" << playerIndex << "Tipo:" << type;
 
 
+void NetworkServer::expireSession(int playerIndex)
 
-        if (obj["type"] == "request_stream") {
+{
 
-            if (isStreamingEnabled()) {
+    static CounterStat* expiredCounter = Metrics::instance().counter("session.expired");
 
-                qDebug() << "🎬 [TCP] Player" << playerIndex << "solicitou stream - adicionando cliente...";
+    if (!m_sessions->isSuspended(playerIndex)) return;
 
-                m_streamer->addClient(playerIndex);
+    expiredCounter->add();
 
-            }
+    m_suspendSerial[playerIndex]++;
 
-            else {
+    m_suspendedMask &= ~(1u << playerIndex);
 
-                // Opcional: Enviar mensagem de erro "Stream desligado pelo host"
+    m_sessions->close(playerIndex);
 
-                qDebug() << "⚠️ Cliente" << playerIndex << "pediu stream, mas está DESLIGADO.";
+    emit playerDisconnected(playerIndex);
 
+}
 
 
-                // Envia mensagem de erro para o cliente
 
-                QJsonObject errorMsg;
+// Informa ao cliente o jogador e o token de retomada (só quando a retomada está ligada)
 
-                errorMsg["type"] = "stream_error";
+void NetworkServer::sendSessionInfo(int playerIndex)
 
-                errorMsg["message"] = "Streaming está desligado pelo host";
+{
 
+    QTcpSocket* socket = playerSocket(playerIndex);
 
+    if (!socket || m_resumeGraceMs <= 0) return;
 
-                QJsonDocument errorDoc(errorMsg);
+    QJsonObject info;
 
-                QByteArray errorData = "JSON:" + errorDoc.toJson(QJsonDocument::Compact);
+    info["type"] = "session";
 
-                socket->write(errorData);
+    info["player"] = playerIndex;
 
-                socket->flush();
+    info["token"] = QString::fromLatin1(m_sessions->issueResumeToken(playerIndex));
 
-            }
+    info["resume_ms"] = m_resumeGraceMs;
 
-        }
+    m_sendBuffer.resize(0);
 
-        // --- NOVO COMANDO ---
+    appendJson(playerIndex, info);
 
-        else if (obj["type"] == "toggle_stream_master") {
+    socket->write(m_sendBuffer);
 
-            bool enabled = obj["enabled"].toBool();
+    socket->flush();
 
-            setStreamingEnabled(enabled);
+}
 
-            qDebug() << "📱 Comando remoto recebido: Stream" << (enabled ? "LIGADO" : "DESLIGADO");
 
-        }
 
-        // --------------------
+void NetworkServer::tcpClientDisconnected()
 
-        else {
+{
 
-            // Resposta SDP ou Candidate de um cliente específico
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
 
-            qDebug() << "📡 [TCP] Sinalização recebida do Player" << playerIndex << ":" << type;
+    if (socket && m_pendingReaders.remove(socket)) {
 
-            m_streamer->handleSignalingMessage(playerIndex, obj);
+        socket->deleteLater();
 
-        }
+        return;
 
     }
 
-    else {
+    const int playerIndex = socket ? m_sessions->playerForEndpoint(socket) : -1;
 
-        // Lógica antiga (Keep Alive 0x01, etc)
+    if (playerIndex == -1) {
 
-        qDebug() << "📨 [TCP] Dados não-JSON do Player" << playerIndex << "Primeiros bytes:" << data.left(10).toHex();
+        qWarning() << "⚠️ Socket desconectado não encontrado no mapa!";
 
-        // Processa outros tipos de dados TCP aqui se necessário
+        return;
 
     }
 
-}
+    qDebug() << "🔌 Jogador" << (playerIndex + 1) << "desconectado (TCP/IP):" << peerAddress(socket).toString();
 
+    m_controlReaders[playerIndex].clear();
 
+    m_binarySignal[playerIndex] = false;
 
-// CORREÇÃO: Implementação da função de erro
+    m_joinStartMs[playerIndex] = -1;
 
-void NetworkServer::tcpSocketError(QAbstractSocket::SocketError socketError)
+    m_pendingCandidates[playerIndex].clear();
 
-{
+    m_pendingCandidateCount[playerIndex] = 0;
 
-    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+    // Limpa o ramo do GStreamer para economizar RAM (o cliente pede o stream de novo ao voltar)
 
-    if (!socket) return;
+    qDebug() << "🗑️ Removendo cliente do ScreenStreamer...";
 
+    m_streamer->removeClient(playerIndex);
 
+    socket->deleteLater();
 
-    int playerIndex = m_socketPlayerMap.value(socket, -1);
 
-    qWarning() << "❌ [TCP] Erro de Socket (Jogador" << playerIndex << "):" << socket->errorString();
 
-    // A desconexão será tratada pelo slot tcpClientDisconnected, que é chamado automaticamente.
+    // Queda da rede (não pedida): a sessão espera o cliente voltar com o token
 
-}
+    if (m_resumeGraceMs > 0 && !m_closeRequested[playerIndex]) {
 
+        suspendSession(playerIndex);
 
+        return;
 
-// Canal de dados UDP
+    }
 
-void NetworkServer::readUdpDatagrams()
+    m_closeRequested[playerIndex] = false;
 
-{
+    m_sessions->close(playerIndex);
 
-    while (m_udpSocket->hasPendingDatagrams()) {
+    qDebug() << "✅ Jogador" << (playerIndex + 1) << "totalmente removido.";
 
-        QNetworkDatagram datagram = m_udpSocket->receiveDatagram();
+    emit playerDisconnected(playerIndex);
 
-        QByteArray data = datagram.data();
+    // Log do estado atual
 
+    qDebug() << "📊 Slots restantes:" << m_sessions->count(Session::Network) << "/" << MAX_PLAYERS;
 
+}
 
-        QHostAddress senderAddress = datagram.senderAddress();
 
-        if (senderAddress.protocol() == QAbstractSocket::IPv6Protocol) {
 
-            senderAddress = QHostAddress(senderAddress.toIPv4Address());
+void NetworkServer::readTcpSocket()
 
-        }
+{
 
+    static CounterStat* readsCounter = Metrics::instance().counter("control.reads");
 
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
 
-        quint16 senderPort = datagram.senderPort();
+    if (!socket) {
 
+        qWarning() << "⚠️ Socket de leitura é nulo!";
 
+        return;
 
-        //qDebug() << "📨 [UDP] Datagrama recebido de" << senderAddress.toString() << ":" << senderPort
+    }
 
-            //<< "Tamanho:" << data.size() << "bytes";
+    if (m_pendingReaders.contains(socket)) {
 
+        readPendingSocket(socket);
 
+        return;
 
-        if (!m_ipPlayerMap.contains(senderAddress)) {
+    }
 
-            //qDebug() << "⚠️ [UDP] IP não registrado:" << senderAddress.toString() << "- ignorando datagrama";
+    const int playerIndex = m_sessions->playerForEndpoint(socket);
 
-            continue;
+    if (playerIndex == -1) {
 
-        }
+        qWarning() << "⚠️ Socket não mapeado para nenhum player!";
 
+        return;
 
+    }
 
-        int playerIndex = m_ipPlayerMap[senderAddress];
+    // Acumula no buffer do jogador: uma leitura pode trazer várias mensagens ou só parte de uma
 
+    if (m_controlReaders[playerIndex].feed(socket) <= 0) return;
 
+    readsCounter->add();
 
-        if (!m_playerUdpPortMap.contains(playerIndex)) {
+    if (m_joinStartMs[playerIndex] >= 0) m_joinReads[playerIndex]++;
 
-            m_playerUdpPortMap.insert(playerIndex, senderPort);
+    processControlFrames(socket, playerIndex);
 
-            qDebug() << "📝 [UDP] Jogador" << (playerIndex + 1) << "registrou porta UDP:" << senderPort;
+}
 
-        }
 
 
+// Primeira mensagem de uma conexão em espera: retomada ou conexão nova
 
-        // --- LÓGICA DE DISCRIMINAÇÃO DE PACOTE ---
+void NetworkServer::readPendingSocket(QTcpSocket* socket)
 
+{
 
+    ControlFrameReader& reader = m_pendingReaders[socket];
 
-        // 1. Pacote de MOUSE (6 bytes)
+    if (reader.feed(socket) <= 0) return;
 
-        if (data.size() == 6 && (quint8)data[0] == 0x02) {
+    ControlFrameReader::Frame frame;
 
-            const char* ptr = data.constData();
+    const ControlFrameReader::Result result = reader.next(frame);
 
-            int16_t dx = *reinterpret_cast<const int16_t*>(ptr + 1);
-            int16_t dy = *reinterpret_cast<const int16_t*>(ptr + 3);
-            uint8_t btns = (uint8_t)ptr[5];
+    if (result == ControlFrameReader::NeedMore) return;
 
-            // 1. Movimento
-            if (dx != 0 || dy != 0) {
-                InputEmulator::moveMouse(dx, dy);
-            }
+    if (result == ControlFrameReader::Error) {
 
-            // 2. Cliques (Com verificação de estado para não travar o Windows)
-            bool currentLeft = (btns & 1);
-            bool currentRight = (btns & 2);
+        socket->abort();
 
-            // Lógica do Botão Esquerdo
-            if (currentLeft != m_lastLeftClick) {
-                // Estado mudou
-                InputEmulator::mouseClick(true, currentLeft); // true=left, currentLeft defines DOWN(true) or UP(false)
-                m_lastLeftClick = currentLeft;
-            }
+        return;
 
-            // Lógica do Botão Direito
-            if (currentRight != m_lastRightClick) {
-                InputEmulator::mouseClick(false, currentRight); // false=right
-                m_lastRightClick = currentRight;
-            }
-        }
+    }
 
+    if (frame.type == ControlFrame::TYPE_JSON) {
 
+        const QJsonObject obj = QJsonDocument::fromJson(QByteArray::fromRawData(frame.payload, frame.size)).object();
 
-        // 2. Pacote de GAMEPAD (Tamanho fixo 20 bytes)
+        if (obj["type"] == "resume_session") {
 
-        else if (data.size() == sizeof(GamepadPacket)) {
+            const int playerIndex = m_sessions->playerForResumeToken(obj["token"].toString().toLatin1());
 
-            //qDebug() << "🎮 [UDP] Pacote de gamepad do Player" << playerIndex;
+            if (resumeSession(socket, playerIndex)) {
 
-            const GamepadPacket* packet = reinterpret_cast<const GamepadPacket*>(data.constData());
+                processControlFrames(socket, playerIndex);
 
-            emit packetReceived(playerIndex, *packet);
+                return;
+
+            }
+
+            // Token desconhecido ou expirado: segue como conexão nova
+
+            qDebug() << "⚠️ [TCP] Token de retomada inválido de" << peerAddress(socket).toString();
+
+            const int newIndex = admitPending(socket);
+
+            if (newIndex != -1) processControlFrames(socket, newIndex);
+
+            return;
+
+        }
+
+    }
+
+    // Cliente sem retomada. O payload do quadro aponta para o buffer do leitor,
+
+    // que é movido (não copiado) para o jogador, então continua válido
+
+    const int playerIndex = admitPending(socket);
+
+    if (playerIndex == -1) return;
+
+    dispatchFrame(playerIndex, frame);
+
+    if (playerSocket(playerIndex) == socket) processControlFrames(socket, playerIndex);
+
+}
+
+
+
+// Entrega os quadros completos já acumulados no leitor do jogador
+
+void NetworkServer::processControlFrames(QTcpSocket* socket, int playerIndex)
+
+{
+
+    static CounterStat* framesCounter = Metrics::instance().counter("control.frames");
+
+    static CounterStat* coalescedCounter = Metrics::instance().counter("control.coalesced_reads");
+
+    ControlFrameReader& reader = m_controlReaders[playerIndex];
+
+    int frames = 0;
+
+    ControlFrameReader::Frame frame;
+
+    ControlFrameReader::Result result;
+
+    while ((result = reader.next(frame)) == ControlFrameReader::FrameReady) {
+
+        frames++;
+
+        dispatchFrame(playerIndex, frame);
+
+        // O handler pode ter desconectado o jogador
+
+        if (playerSocket(playerIndex) != socket) return;
+
+    }
+
+    framesCounter->add(frames);
+
+    if (frames > 1) coalescedCounter->add();
+
+    if (result == ControlFrameReader::Error) {
+
+        LOG_WARNING("tcp", "Quadro inválido do jogador %d - encerrando conexão", playerIndex);
+
+        socket->abort();
+
+    }
+
+}
+
+
+
+void NetworkServer::dispatchFrame(int playerIndex, const ControlFrameReader::Frame& frame)
+
+{
+
+    if (frame.type == ControlFrame::TYPE_KEEPALIVE) {
+
+        return;
+
+    }
+
+    if (frame.type == ControlFrame::TYPE_SIGNAL) {
+
+        SignalMessage message;
+
+        if (!SignalCodec::decodeBinary(frame.payload, frame.size, message)) {
+
+            LOG_WARNING("tcp", "Sinalização binária inválida do jogador %d", playerIndex);
+
+            return;
 
         }
 
+        m_binarySignal[playerIndex] = true;
+
+        handleSignal(playerIndex, message);
+
+        return;
+
+    }
+
+    if (frame.type != ControlFrame::TYPE_JSON) {
+
+        LOG_DEBUG("tcp", "Quadro de tipo desconhecido do jogador %d: tipo %u, %d bytes", playerIndex, unsigned(frame.type), frame.size);
+
+        return;
+
+    }
+
+    QJsonDocument doc = QJsonDocument::fromJson(QByteArray::fromRawData(frame.payload, frame.size));
+
+    if (!doc.isObject()) {
+
+        LOG_WARNING("tcp", "JSON inválido do jogador %d (%d bytes)", playerIndex, frame.size);
+
+        return;
+
+    }
+
+    handleControlMessage(playerIndex, doc.object());
+
+}
+
+
+
+void NetworkServer::handleControlMessage(int playerIndex, const QJsonObject& obj)
+
+{
+
+    // Perfil de turbo/macros executado no servidor (economiza banda do rádio)
+
+    if (obj["type"] == "macro_profile") {
+
+        LOG_DEBUG("tcp", "Perfil de macros recebido do jogador %d", playerIndex);
+
+        emit macroProfileReceived(playerIndex, obj);
+
+        return;
+
+    }
 
+    // Pedido de retomada que chegou depois da espera: a conexão já virou uma
 
-        // 3. Pacote não reconhecido
+    // sessão nova. Volta para a sessão do token e descarta a nova
+
+    if (obj["type"] == "resume_session") {
+
+        const int resumed = m_sessions->playerForResumeToken(obj["token"].toString().toLatin1());
+
+        QTcpSocket* socket = playerSocket(playerIndex);
+
+        if (resumed == -1 || resumed == playerIndex || !socket
+
+            || m_sessions->transport(resumed) != Session::Network) {
+
+            LOG_DEBUG("tcp", "Pedido de retomada tardio do jogador %d sem sessão válida - mantendo a sessão nova", playerIndex);
+
+            return;
+
+        }
+
+        LOG_INFO("tcp", "Retomada tardia: conexão do jogador %d volta para o jogador %d", playerIndex, resumed);
+
+        // O resto do buffer segue com a conexão (processado na próxima volta do event loop)
+
+        m_pendingReaders.insert(socket, std::move(m_controlReaders[playerIndex]));
+
+        m_controlReaders[playerIndex].clear();
+
+        m_binarySignal[playerIndex] = false;
+
+        m_joinStartMs[playerIndex] = -1;
+
+        m_streamer->removeClient(playerIndex);
+
+        m_sessions->close(playerIndex);
+
+        emit playerDisconnected(playerIndex);
+
+        if (resumeSession(socket, resumed)) {
+
+            QTimer::singleShot(0, socket, [this, socket, resumed]() {
+
+                if (playerSocket(resumed) == socket) processControlFrames(socket, resumed);
+
+                });
+
+        }
 
         else {
 
-            qDebug() << "⚠️ [UDP] Pacote não reconhecido de" << senderAddress.toString()
+            admitPending(socket);
+
+        }
+
+        return;
+
+    }
+
+
+
+    // Sinalização no formato JSON (clientes antigos)
+
+    SignalMessage message;
+
+    if (!SignalCodec::fromJson(obj, message)) {
+
+        LOG_DEBUG("tcp", "Mensagem desconhecida do jogador %d: %s", playerIndex, qPrintable(obj["type"].toString()));
+
+        return;
+
+    }
+
+    handleSignal(playerIndex, message);
+
+}
+
+
+
+void NetworkServer::handleSignal(int playerIndex, const SignalMessage& message)
+
+{
 
-                << "tamanho:" << data.size() << "bytes";
+    static LatencyStat* joinTimeStat = Metrics::instance().latency("control.stream_join_ms");
 
-            qDebug() << "   - Primeiros bytes:" << data.left(10).toHex();
+    static LatencyStat* joinReadsStat = Metrics::instance().latency("control.stream_join_reads");
+
+
+
+    LOG_DEBUG("signal", "Mensagem %s do jogador %d", SignalCodec::typeName(message.type), playerIndex);
+
+
+
+    if (message.type == Signal::RequestStream) {
+
+        if (isStreamingEnabled()) {
+
+            LOG_DEBUG("signal", "Jogador %d pediu o stream - adicionando cliente", playerIndex);
+
+            // Pedidos repetidos (cliente tentando de novo) contam na mesma entrada
+
+            if (m_joinStartMs[playerIndex] < 0) {
+
+                m_joinStartMs[playerIndex] = m_clock.elapsed();
+
+                m_joinReads[playerIndex] = 1;
+
+            }
+
+            // Endereço local do controle: o modo LAN pode coletar ICE só nessa interface
+
+            QTcpSocket* socket = playerSocket(playerIndex);
+
+            m_streamer->addClient(playerIndex, QSize(message.screenWidth, message.screenHeight),
+
+                socket ? socket->localAddress() : QHostAddress());
+
+        }
+
+        else {
+
+            qDebug() << "⚠️ Cliente" << playerIndex << "pediu stream, mas está DESLIGADO.";
+
+
+
+            // Envia mensagem de erro para o cliente
+
+            SignalMessage error;
+
+            error.type = Signal::StreamError;
+
+            error.text = "Streaming está desligado pelo host";
+
+            sendSignal(playerIndex, error);
+
+        }
+
+    }
+
+    else if (message.type == Signal::ToggleStreamMaster) {
+
+        setStreamingEnabled(message.enabled);
+
+        qDebug() << "📱 Comando remoto recebido: Stream" << (message.enabled ? "LIGADO" : "DESLIGADO");
+
+    }
+
+    else {
+
+        // Resposta SDP ou Candidate de um cliente específico
+
+        if (message.type == Signal::WebrtcAnswer && m_joinStartMs[playerIndex] >= 0) {
+
+            joinTimeStat->record(m_clock.elapsed() - m_joinStartMs[playerIndex]);
+
+            joinReadsStat->record(m_joinReads[playerIndex]);
+
+            m_joinStartMs[playerIndex] = -1;
 
         }
 
+        m_streamer->handleSignalingMessage(playerIndex, message);
+
     }
 
 }
 
 
 
-// Canal de descoberta UDP
+// Responde no formato que o cliente usa: binário, JSON enquadrado ou "JSON:" legado
 
-void NetworkServer::readDiscoveryDatagrams()
+void NetworkServer::sendSignal(int playerIndex, const SignalMessage& message)
 
 {
 
-    while (m_discoverySocket->hasPendingDatagrams()) {
+    static LatencyStat* encodeStat = Metrics::instance().latency("control.signal_encode_ns");
 
-        QNetworkDatagram datagram = m_discoverySocket->receiveDatagram();
+    QTcpSocket* socket = playerSocket(playerIndex);
+
+    if (!socket) return;
+
+    QElapsedTimer timer;
+
+    timer.start();
+
+
+
+    m_sendBuffer.resize(0);
+
+    if (m_binarySignal[playerIndex]) {
+
+        const int frameStart = ControlFrame::begin(m_sendBuffer, ControlFrame::TYPE_SIGNAL);
+
+        SignalCodec::encodeBinary(message, m_sendBuffer);
+
+        ControlFrame::end(m_sendBuffer, frameStart);
+
+    }
+
+    else {
+
+        appendJson(playerIndex, SignalCodec::toJson(message));
+
+    }
+
+    encodeStat->record(timer.nsecsElapsed());
+
+
+
+    // Candidato: espera ICE_BATCH_MS pelos próximos e manda todos num write só.
+
+    // Só com quadros: o "JSON:" legado não tem delimitador entre mensagens
+
+    const bool framed = m_binarySignal[playerIndex] || m_controlReaders[playerIndex].peerUsesFrames();
+
+    if (message.type == Signal::WebrtcCandidate && framed) {
+
+        m_pendingCandidates[playerIndex].append(m_sendBuffer);
+
+        if (m_pendingCandidateCount[playerIndex]++ == 0) {
+
+            QTimer::singleShot(ICE_BATCH_MS, this, [this, playerIndex]() { flushCandidates(playerIndex); });
+
+        }
+
+        return;
+
+    }
+
+
+
+    // Qualquer outra mensagem sai depois dos candidatos pendentes (mantém a ordem)
+
+    flushCandidates(playerIndex);
+
+    socket->write(m_sendBuffer);
+
+    socket->flush();
+
+}
+
+
+
+void NetworkServer::flushCandidates(int playerIndex)
+
+{
+
+    static LatencyStat* batchStat = Metrics::instance().latency("control.ice_batch_candidates");
+
+    if (m_pendingCandidateCount[playerIndex] == 0) return;
+
+
+
+    QTcpSocket* socket = playerSocket(playerIndex);
+
+    if (socket) {
+
+        socket->write(m_pendingCandidates[playerIndex]);
+
+        socket->flush();
+
+        batchStat->record(m_pendingCandidateCount[playerIndex]);
+
+    }
+
+    m_pendingCandidates[playerIndex].clear();
+
+    m_pendingCandidateCount[playerIndex] = 0;
+
+}
+
+// JSON no formato que o cliente entende: quadro, se ele já usa quadros, ou "JSON:" legado
+
+void NetworkServer::appendJson(int playerIndex, const QJsonObject& obj)
+
+{
+
+    const QByteArray payload = QJsonDocument(obj).toJson(QJsonDocument::Compact);
+
+    if (m_controlReaders[playerIndex].peerUsesFrames()) {
+
+        ControlFrame::append(m_sendBuffer, ControlFrame::TYPE_JSON, payload.constData(), payload.size());
+
+    }
+
+    else {
+
+        m_sendBuffer.append("JSON:");
+
+        m_sendBuffer.append(payload);
+
+    }
+
+}
+
+
+
+// CORREÇÃO: Implementação da função de erro
+
+void NetworkServer::tcpSocketError(QAbstractSocket::SocketError socketError)
+
+{
+
+    QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+
+    if (!socket) return;
+
+
+
+    int playerIndex = m_sessions->playerForEndpoint(socket);
+
+    qWarning() << "❌ [TCP] Erro de Socket (Jogador" << playerIndex << "):" << socket->errorString();
+
+    // A desconexão será tratada pelo slot tcpClientDisconnected, que é chamado automaticamente.
+
+}
+
+
+
+// Canal de dados UDP
+
+void NetworkServer::readUdpDatagrams()
+
+{
+
+    static CounterStat* suspendedDropCounter = Metrics::instance().counter("session.suspended_udp_dropped");
+
+    while (m_udpSocket->hasPendingDatagrams()) {
+
+        QNetworkDatagram datagram = m_udpSocket->receiveDatagram();
 
         QByteArray data = datagram.data();
 
@@ -815,65 +1386,106 @@ void NetworkServer::readDiscoveryDatagrams()
 
         QHostAddress senderAddress = datagram.senderAddress();
 
+        if (senderAddress.protocol() == QAbstractSocket::IPv6Protocol) {
+
+            senderAddress = QHostAddress(senderAddress.toIPv4Address());
+
+        }
+
+
+
         quint16 senderPort = datagram.senderPort();
 
 
 
-        qDebug() << "🔍 [Descoberta] Datagrama recebido de" << senderAddress.toString()
+        //qDebug() << "📨 [UDP] Datagrama recebido de" << senderAddress.toString() << ":" << senderPort
 
-            << "Tamanho:" << data.size() << "bytes"
+            //<< "Tamanho:" << data.size() << "bytes";
 
-            << "Conteúdo:" << data;
 
 
+        const int playerIndex = m_sessions->playerForAddress(senderAddress);
 
-        if (data == "DISCOVER_GAMEPAD_VIRTUAL_SERVER") {
+        if (playerIndex == -1) {
 
-            qDebug() << "🎯 [Descoberta] Pedido de descoberta recebido de" << senderAddress.toString();
+            //qDebug() << "⚠️ [UDP] IP não registrado:" << senderAddress.toString() << "- ignorando datagrama";
 
+            continue;
 
+        }
 
-            QString hostName = QHostInfo::localHostName();
 
-            if (hostName.isEmpty()) {
 
-                hostName = "Servidor-PC";
+        // Sessão suspensa mantém o IP até retomar ou expirar, mas o controle fica
 
-            }
+        // neutro: datagramas atrasados (ou de outro aparelho que herdou o IP) não passam
 
+        if (m_sessions->isSuspended(playerIndex)) {
 
+            suspendedDropCounter->add();
 
-            QByteArray response = "GAMEPAD_VIRTUAL_SERVER_ACK:" + hostName.toUtf8();
+            continue;
 
+        }
 
+        if (m_sessions->session(playerIndex)->udpPort == 0) {
 
-            qDebug() << "📤 [Descoberta] Enviando resposta para" << senderAddress.toString() << ":" << senderPort;
+            m_sessions->setUdpPort(playerIndex, senderPort);
 
-            qDebug() << "   - Resposta:" << response;
+            qDebug() << "📝 [UDP] Jogador" << (playerIndex + 1) << "registrou porta UDP:" << senderPort;
 
+        }
 
 
-            qint64 bytesSent = m_discoverySocket->writeDatagram(response, senderAddress, senderPort);
 
-            if (bytesSent == -1) {
+        // --- LÓGICA DE DISCRIMINAÇÃO DE PACOTE ---
 
-                qWarning() << "❌ [Descoberta] Falha ao enviar resposta de descoberta";
 
-            }
 
-            else {
+        // 1. Pacote de MOUSE (6 bytes)
 
-                qDebug() << "✅ [Descoberta] Resposta enviada -" << bytesSent << "bytes";
+        if (data.size() == 6 && (quint8)data[0] == 0x02) {
+
+            const char* ptr = data.constData();
+
+            int16_t dx = *reinterpret_cast<const int16_t*>(ptr + 1);
+            int16_t dy = *reinterpret_cast<const int16_t*>(ptr + 3);
+            uint8_t btns = (uint8_t)ptr[5];
 
+            // 1. Movimento
+            if (dx != 0 || dy != 0) {
+                InputEmulator::moveMouse(dx, dy);
             }
 
+            // 2. Cliques (Com verificação de estado para não travar o Windows)
+            bool currentLeft = (btns & 1);
+            bool currentRight = (btns & 2);
 
+            // Lógica do Botão Esquerdo
+            if (currentLeft != m_lastLeftClick) {
+                // Estado mudou
+                InputEmulator::mouseClick(true, currentLeft); // true=left, currentLeft defines DOWN(true) or UP(false)
+                m_lastLeftClick = currentLeft;
+            }
 
+            // Lógica do Botão Direito
+            if (currentRight != m_lastRightClick) {
+                InputEmulator::mouseClick(false, currentRight); // false=right
+                m_lastRightClick = currentRight;
+            }
         }
 
-        else {
 
-            qDebug() << "⚠️ [Descoberta] Mensagem de descoberta desconhecida:" << data;
+
+        // 2. Pacotes de controle (estado, estado com relógio do sensor, lote de movimento);
+
+        // o que não for reconhecido só é registrado
+
+        else if (!ingest(playerIndex, data.constData(), data.size())) {
+
+            LOG_DEBUG("udp", "Pacote não reconhecido de %s: %d bytes, início %s",
+
+                qPrintable(senderAddress.toString()), int(data.size()), data.left(10).toHex().constData());
 
         }
 
@@ -883,32 +1495,56 @@ void NetworkServer::readDiscoveryDatagrams()
 
 
 
-void NetworkServer::forceDisconnectPlayer(int playerIndex)
+// Estado de streaming anunciado na descoberta
+
+void NetworkServer::updateDiscoveryStreaming()
 
 {
 
-    qDebug() << "🔌 Forçando desconexão do Player" << playerIndex;
+    const QString codec = m_streamer->activeVideoCodec();
 
+    quint8 codecs = 0;
 
+    if (codec == "H264") codecs |= Discovery::CODEC_H264;
 
-    QTcpSocket* targetSocket = nullptr;
+    else if (codec == "VP8") codecs |= Discovery::CODEC_VP8;
 
-    for (auto it = m_socketPlayerMap.constBegin(); it != m_socketPlayerMap.constEnd(); ++it) {
+    if (!codec.isEmpty()) codecs |= Discovery::CODEC_OPUS;
 
-        if (it.value() == playerIndex) {
 
-            targetSocket = it.key();
 
-            break;
+    m_discovery->setStreamingState(isStreamingEnabled(), codecs);
+
+}
 
-        }
+
+
+void NetworkServer::forceDisconnectPlayer(int playerIndex)
+
+{
+
+    qDebug() << "🔌 Forçando desconexão do Player" << playerIndex;
+
+    // Sessão suspensa não tem socket: encerra direto
+
+    if (m_sessions->isSuspended(playerIndex) && m_sessions->transport(playerIndex) == Session::Network) {
+
+        expireSession(playerIndex);
+
+        return;
 
     }
 
+    QTcpSocket* targetSocket = playerSocket(playerIndex);
+
     if (targetSocket) {
 
         qDebug() << "📡 Fechando socket do Player" << playerIndex;
 
+        // Desconexão pedida: não entra no período de carência
+
+        m_closeRequested[playerIndex] = true;
+
         targetSocket->close();
 
     }
@@ -923,23 +1559,17 @@ void NetworkServer::forceDisconnectPlayer(int playerIndex)
 
 
 
-void NetworkServer::sendVibration(int playerIndex, const QByteArray& command)
+bool NetworkServer::sendToPlayer(int playerIndex, const QByteArray& command)
 
 {
 
-    qDebug() << "📳 Enviando vibração para Player" << playerIndex << "Tamanho:" << command.size() << "bytes";
-
-
-
-    if (m_playerIpMap.contains(playerIndex) && m_playerUdpPortMap.contains(playerIndex)) {
+    const SessionInfo* session = m_sessions->session(playerIndex);
 
-        QHostAddress address = m_playerIpMap.value(playerIndex);
+    if (m_udpSocket && session && session->transport == Session::Network && session->udpPort != 0) {
 
-        quint16 port = m_playerUdpPortMap.value(playerIndex);
+        const QHostAddress& address = session->address;
 
-
-
-        qDebug() << "   - Destino:" << address.toString() << ":" << port;
+        const quint16 port = session->udpPort;
 
 
 
@@ -947,13 +1577,17 @@ void NetworkServer::sendVibration(int playerIndex, const QByteArray& command)
 
         if (bytesSent == -1) {
 
-            qWarning() << "❌ Falha ao enviar comando de vibração";
+            LOG_WARNING("net", "Falha ao enviar vibração para o jogador %d", playerIndex);
 
         }
 
         else {
 
-            qDebug() << "✅ Comando de vibração enviado -" << bytesSent << "bytes";
+            LOG_TRACE("net", "Vibração para o jogador %d: %lld bytes para %s:%u", playerIndex,
+
+                static_cast<long long>(bytesSent), qPrintable(address.toString()), unsigned(port));
+
+            return true;
 
         }
 
@@ -961,12 +1595,12 @@ void NetworkServer::sendVibration(int playerIndex, const QByteArray& command)
 
     else {
 
-        qWarning() << "⚠️ Player" << playerIndex << "não encontrado para envio de vibração";
-
-        qDebug() << "   - IP registrado:" << m_playerIpMap.contains(playerIndex);
+        LOG_WARNING("net", "Jogador %d sem destino para vibração (IP registrado: %d, porta UDP registrada: %d)", playerIndex,
 
-        qDebug() << "   - Porta UDP registrada:" << m_playerUdpPortMap.contains(playerIndex);
+            int(session && !session->address.isNull()), int(session && session->udpPort != 0));
 
     }
 
+    return false;
+
 }
\ No newline at end of file
@@ -8,33 +8,53 @@
 #include <QTcpSocket>
 #include <QUdpSocket>
 #include <QHostAddress>
+#include <QElapsedTimer>
+#include <QJsonObject>
 #include "../controller_types.h"
 #include "../protocol/gamepad_packet.h"
 #include "../streaming/screen_streamer.h"
+#include "discovery_service.h"
+#include "input_transport.h"
+#include "../protocol/control_frame.h"
+#include "../protocol/signal_codec.h"
 
 // Substituir macros por constexpr
 constexpr int CONTROL_PORT_TCP = 42000;  // TCP para conexo/desconexo
 constexpr int DATA_PORT_UDP = 42001;     // UDP para pacotes de gamepad
 constexpr int DISCOVERY_PORT = 27016;    // UDP para descoberta de servidores
+constexpr int DEFAULT_RESUME_GRACE_MS = 5000;  // Tempo que uma sesso Wi-Fi espera o cliente voltar
 
-class NetworkServer : public QObject
+class NetworkServer : public InputTransport
 {
     Q_OBJECT
 
 public:
-    explicit NetworkServer(QObject* parent = nullptr);
+    explicit NetworkServer(SessionRegistry* sessions, QObject* parent = nullptr);
     ~NetworkServer();
 
     // --- NOVOS MTODOS ADICIONADOS AQUI ---
     void setStreamingEnabled(bool enabled);
     bool isStreamingEnabled() const;
+    ScreenStreamer* screenStreamer() const { return m_streamer; }
     // --------------------------------------
 
+    // Perodo de carncia aps uma queda: o slot e o controle virtual ficam
+    // (com entrada neutra) esperando o cliente voltar com o token. 0 desliga
+    void setResumeGracePeriod(int ms) { m_resumeGraceMs = ms > 0 ? ms : 0; }
+    int resumeGracePeriod() const { return m_resumeGraceMs; }
+
+    // Portas usadas no prximo startServer() (padro: constantes acima)
+    void setPorts(quint16 controlPort, quint16 dataPort, quint16 discoveryPort);
+    quint16 controlPort() const { return m_controlPort; }
+    quint16 dataPort() const { return m_dataPort; }
+    bool isListening() const { return m_tcpServer && m_tcpServer->isListening(); }
+
 public slots:
-    void startServer();
-    void stopServer();
-    void forceDisconnectPlayer(int playerIndex);
-    void sendVibration(int playerIndex, const QByteArray& command);
+    void startServer() override;
+    void stopServer() override;
+    void forceDisconnectPlayer(int playerIndex) override;
+    // Comandos (vibrao) vo por UDP para a porta de origem do jogador
+    bool sendToPlayer(int playerIndex, const QByteArray& command) override;
 
 private slots:
     // Canal de controle TCP
@@ -48,32 +68,65 @@ private slots:
     // Canal de dados UDP
     void readUdpDatagrams();
 
-    // Canal de descoberta UDP
-    void readDiscoveryDatagrams();
-
 signals:
-    void packetReceived(int playerIndex, const GamepadPacket& packet);
-    void playerConnected(int playerIndex, const QString& type);
-    void playerDisconnected(int playerIndex);
-    void logMessage(const QString& message);
+    void macroProfileReceived(int playerIndex, const QJsonObject& profile);
 
 private:
-    int findEmptySlot() const;
+    void handleControlMessage(int playerIndex, const QJsonObject& obj);
+    void handleSignal(int playerIndex, const SignalMessage& message);
+    void sendSignal(int playerIndex, const SignalMessage& message);
+    void flushCandidates(int playerIndex);
+    void appendJson(int playerIndex, const QJsonObject& obj);
+
+    // Entrada de conexes e leitura do canal de controle
+    int admitConnection(QTcpSocket* socket);
+    int admitPending(QTcpSocket* socket);
+    void readPendingSocket(QTcpSocket* socket);
+    void processControlFrames(QTcpSocket* socket, int playerIndex);
+    void dispatchFrame(int playerIndex, const ControlFrameReader::Frame& frame);
+
+    // Retomada de sesso
+    bool resumeSession(QTcpSocket* socket, int playerIndex);
+    void dropStaleSocket(int playerIndex, QTcpSocket* stale);
+    void suspendSession(int playerIndex);
+    void expireSession(int playerIndex);
+    void sendSessionInfo(int playerIndex);
+    QTcpSocket* playerSocket(int playerIndex) const;
+    void updateDiscoveryStreaming();
 
     // Streaming de tela
     ScreenStreamer* m_streamer;
 
     // Servidores de rede
     QTcpServer* m_tcpServer;
+    quint16 m_controlPort = CONTROL_PORT_TCP;
+    quint16 m_dataPort = DATA_PORT_UDP;
+    quint16 m_discoveryPort = DISCOVERY_PORT;
     QUdpSocket* m_udpSocket;
-    QUdpSocket* m_discoverySocket;
-
-    // Gerenciamento de jogadores
-    bool m_playerSlots[MAX_PLAYERS];
-    QHash<QTcpSocket*, int> m_socketPlayerMap;
-    QHash<QHostAddress, int> m_ipPlayerMap;
-    QHash<int, QHostAddress> m_playerIpMap;
-    QHash<int, quint16> m_playerUdpPortMap;
+    DiscoveryService* m_discovery;
+
+    // Canal de controle: um leitor incremental por jogador
+    ControlFrameReader m_controlReaders[MAX_PLAYERS];
+    bool m_binarySignal[MAX_PLAYERS];   // Cliente j mandou sinalizao binria
+    QByteArray m_sendBuffer;
+    // Candidatos ICE do servidor saem juntos: o GStreamer solta vrios em
+    // sequncia e cada um era um write + flush no socket
+    static const int ICE_BATCH_MS = 5;
+    QByteArray m_pendingCandidates[MAX_PLAYERS];
+    int m_pendingCandidateCount[MAX_PLAYERS];
+
+    // Retomada de sesso
+    int m_resumeGraceMs = DEFAULT_RESUME_GRACE_MS;
+    QHash<QTcpSocket*, ControlFrameReader> m_pendingReaders;   // Conexes esperando o pedido de retomada
+    quint32 m_suspendedMask = 0;                                // Bit i = jogador i suspenso
+    bool m_closeRequested[MAX_PLAYERS];                         // Desconexo pedida (sem carncia)
+    qint64 m_suspendedAtMs[MAX_PLAYERS];
+    quint32 m_suspendSerial[MAX_PLAYERS];                       // Invalida timers de expirao antigos
+
+    // Medio de entrada no stream (request_stream -> resposta SDP)
+    QElapsedTimer m_clock;
+    qint64 m_joinStartMs[MAX_PLAYERS];
+    int m_joinReads[MAX_PLAYERS];
 
     // --- CORREO DO MOUSE "PRESO" ---
     // Controle de estado do mouse para evitar spam e travamentos
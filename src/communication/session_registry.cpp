@@ -0,0 +1,190 @@
+﻿#include "session_registry.h"
+#include <QtAlgorithms>
+#include <QRandomGenerator>
+
+// 128 bits aleatórios do gerador do sistema, em hexadecimal
+static constexpr int RESUME_TOKEN_WORDS = 4;
+
+SessionRegistry::SessionRegistry(QObject* parent)
+    : QObject(parent)
+{
+}
+
+SessionHandle SessionRegistry::open(Session::Transport transport, QObject* endpoint)
+{
+    const quint32 occupied = occupiedMask();
+    for (int i = 0; i < m_capacity; ++i) {
+        if (!(occupied & (1u << i))) return openAt(i, transport, endpoint);
+    }
+    return SessionHandle();
+}
+
+SessionHandle SessionRegistry::openAt(int playerIndex, Session::Transport transport, QObject* endpoint)
+{
+    if (!isValidIndex(playerIndex) || playerIndex >= m_capacity || transport == Session::None || transport >= Session::TransportCount) {
+        return SessionHandle();
+    }
+    if (!isFree(playerIndex)) return SessionHandle();
+
+    SessionInfo& s = m_sessions[playerIndex];
+    s.transport = transport;
+    s.generation++;
+    s.endpoint = endpoint;
+    if (endpoint) m_byEndpoint.insert(endpoint, playerIndex);
+    m_transportMask[transport] |= (1u << playerIndex);
+
+    emit sessionOpened(playerIndex, transport);
+    return handle(playerIndex);
+}
+
+bool SessionRegistry::close(const SessionHandle& handle)
+{
+    if (!isCurrent(handle)) return false;
+    close(handle.playerIndex);
+    return true;
+}
+
+void SessionRegistry::close(int playerIndex)
+{
+    if (!isValidIndex(playerIndex) || isFree(playerIndex)) return;
+
+    SessionInfo& s = m_sessions[playerIndex];
+    const Session::Transport transport = s.transport;
+    if (s.endpoint) m_byEndpoint.remove(s.endpoint);
+    if (!s.address.isNull()) m_byAddress.remove(s.address);
+    if (s.bluetoothAddress) m_byBluetoothAddress.remove(bluetoothKey(transport, s.bluetoothAddress));
+    if (!s.resumeToken.isEmpty()) m_byResumeToken.remove(s.resumeToken);
+    m_transportMask[transport] &= ~(1u << playerIndex);
+
+    // A geração fica: é ela que invalida os handles antigos
+    const quint32 generation = s.generation;
+    s = SessionInfo();
+    s.generation = generation;
+
+    emit sessionClosed(playerIndex, transport);
+}
+
+void SessionRegistry::setAddress(int playerIndex, const QHostAddress& address)
+{
+    if (!isValidIndex(playerIndex) || isFree(playerIndex)) return;
+
+    SessionInfo& s = m_sessions[playerIndex];
+    if (!s.address.isNull()) m_byAddress.remove(s.address);
+    s.address = address;
+    if (!address.isNull()) m_byAddress.insert(address, playerIndex);
+}
+
+void SessionRegistry::setUdpPort(int playerIndex, quint16 port)
+{
+    if (!isValidIndex(playerIndex) || isFree(playerIndex)) return;
+    m_sessions[playerIndex].udpPort = port;
+}
+
+void SessionRegistry::setBluetoothAddress(int playerIndex, quint64 address)
+{
+    if (!isValidIndex(playerIndex) || isFree(playerIndex)) return;
+
+    SessionInfo& s = m_sessions[playerIndex];
+    if (s.bluetoothAddress) m_byBluetoothAddress.remove(bluetoothKey(s.transport, s.bluetoothAddress));
+    s.bluetoothAddress = address;
+    if (address) m_byBluetoothAddress.insert(bluetoothKey(s.transport, address), playerIndex);
+}
+
+QByteArray SessionRegistry::issueResumeToken(int playerIndex)
+{
+    if (!isValidIndex(playerIndex) || isFree(playerIndex)) return QByteArray();
+
+    quint32 words[RESUME_TOKEN_WORDS];
+    QRandomGenerator::system()->fillRange(words);
+    const QByteArray token = QByteArray(reinterpret_cast<const char*>(words), sizeof(words)).toHex();
+
+    SessionInfo& s = m_sessions[playerIndex];
+    if (!s.resumeToken.isEmpty()) m_byResumeToken.remove(s.resumeToken);
+    s.resumeToken = token;
+    m_byResumeToken.insert(token, playerIndex);
+    return token;
+}
+
+void SessionRegistry::suspend(int playerIndex)
+{
+    if (!isValidIndex(playerIndex) || isFree(playerIndex)) return;
+
+    SessionInfo& s = m_sessions[playerIndex];
+    if (s.endpoint) m_byEndpoint.remove(s.endpoint);
+    s.endpoint = nullptr;
+    s.udpPort = 0;
+    s.suspended = true;
+}
+
+bool SessionRegistry::resume(int playerIndex, QObject* endpoint)
+{
+    if (!isSuspended(playerIndex)) return false;
+
+    SessionInfo& s = m_sessions[playerIndex];
+    s.suspended = false;
+    s.endpoint = endpoint;
+    if (endpoint) m_byEndpoint.insert(endpoint, playerIndex);
+    return true;
+}
+
+bool SessionRegistry::isFree(int playerIndex) const
+{
+    return isValidIndex(playerIndex) && m_sessions[playerIndex].transport == Session::None;
+}
+
+bool SessionRegistry::isCurrent(const SessionHandle& handle) const
+{
+    if (!isValidIndex(handle.playerIndex)) return false;
+    const SessionInfo& s = m_sessions[handle.playerIndex];
+    return s.transport != Session::None && s.generation == handle.generation;
+}
+
+SessionHandle SessionRegistry::handle(int playerIndex) const
+{
+    SessionHandle h;
+    if (isValidIndex(playerIndex) && !isFree(playerIndex)) {
+        h.playerIndex = playerIndex;
+        h.generation = m_sessions[playerIndex].generation;
+    }
+    return h;
+}
+
+const SessionInfo* SessionRegistry::session(int playerIndex) const
+{
+    if (!isValidIndex(playerIndex) || isFree(playerIndex)) return nullptr;
+    return &m_sessions[playerIndex];
+}
+
+Session::Transport SessionRegistry::transport(int playerIndex) const
+{
+    return isValidIndex(playerIndex) ? m_sessions[playerIndex].transport : Session::None;
+}
+
+QObject* SessionRegistry::endpoint(int playerIndex, Session::Transport transport) const
+{
+    if (!isValidIndex(playerIndex) || m_sessions[playerIndex].transport != transport) return nullptr;
+    return m_sessions[playerIndex].endpoint;
+}
+
+quint32 SessionRegistry::occupiedMask() const
+{
+    quint32 mask = 0;
+    for (int t = Session::None + 1; t < Session::TransportCount; ++t) mask |= m_transportMask[t];
+    return mask;
+}
+
+int SessionRegistry::count(Session::Transport transport) const
+{
+    return qPopulationCount(m_transportMask[transport]);
+}
+
+const char* SessionRegistry::transportName(Session::Transport transport)
+{
+    switch (transport) {
+    case Session::Network: return "Wi-Fi";
+    case Session::Bluetooth: return "Bluetooth";
+    case Session::Ble: return "Bluetooth LE";
+    case Session::Synthetic: return "Simulado";
+    default: return "Nenhum";
+    }
+}
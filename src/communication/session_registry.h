@@ -0,0 +1,125 @@
+#ifndef SESSION_REGISTRY_H
+#define SESSION_REGISTRY_H
+
+#include <QObject>
+#include <QHash>
+#include <QHostAddress>
+#include <QByteArray>
+#include "../controller_types.h"
+
+namespace Session {
+// Transporte dono de uma sessão
+enum Transport : quint8 {
+    None = 0,
+    Network,      // TCP/UDP (Wi-Fi ou ancoragem USB)
+    Bluetooth,    // Bluetooth clássico (RFCOMM)
+    Ble,          // Bluetooth LE
+    Synthetic,    // Gerador de carga do diagnóstico
+    TransportCount
+};
+}
+
+// Referência a uma sessão: índice do jogador + geração do slot. Quando o slot
+// é reaproveitado por outro cliente a geração muda, então um handle guardado
+// (timer, operação assíncrona) deixa de valer sem precisar ser invalidado.
+struct SessionHandle {
+    int playerIndex = -1;
+    quint32 generation = 0;
+
+    bool isNull() const { return playerIndex < 0; }
+};
+
+struct SessionInfo {
+    Session::Transport transport = Session::None;
+    quint32 generation = 0;
+    QObject* endpoint = nullptr;     // QTcpSocket / QBluetoothSocket do cliente
+    QHostAddress address;            // IP do cliente (Network)
+    quint16 udpPort = 0;             // Porta UDP de origem, conhecida no primeiro datagrama
+    quint64 bluetoothAddress = 0;    // QBluetoothAddress::toUInt64() (Bluetooth/BLE)
+    QByteArray resumeToken;          // Apresentado pelo cliente para retomar a sessão
+    bool suspended = false;          // Conexão caiu; slot mantido até retomar ou expirar
+};
+
+// Tabela única de sessões compartilhada por todos os transportes. Os índices de
+// jogador são alocados aqui, então nunca se repetem entre Wi-Fi, Bluetooth e
+// BLE. Todas as buscas são O(1): por jogador (array), por socket, IP e endereço
+// Bluetooth (hashes) e por transporte (máscara de jogadores).
+// Só é usada na thread principal.
+class SessionRegistry : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SessionRegistry(QObject* parent = nullptr);
+
+    // Ocupa o primeiro slot livre (ou o slot pedido); retorna handle nulo se não houver
+    SessionHandle open(Session::Transport transport, QObject* endpoint = nullptr);
+    SessionHandle openAt(int playerIndex, Session::Transport transport, QObject* endpoint = nullptr);
+
+    // Libera o slot. A versão com handle ignora handles de sessões já encerradas
+    bool close(const SessionHandle& handle);
+    void close(int playerIndex);
+
+    // Limita os slots alocáveis a 0..players-1 (sessões já abertas não são afetadas)
+    void setCapacity(int players) { m_capacity = qBound(1, players, MAX_PLAYERS); }
+    int capacity() const { return m_capacity; }
+
+    void setAddress(int playerIndex, const QHostAddress& address);
+    void setUdpPort(int playerIndex, quint16 port);
+    void setBluetoothAddress(int playerIndex, quint64 address);
+
+    // --- RETOMADA DE SESSÃO ---
+    // Gera um token novo para o jogador (o anterior deixa de valer)
+    QByteArray issueResumeToken(int playerIndex);
+    // Conexão caiu: o slot, o endereço e o token ficam; o endpoint sai do índice
+    void suspend(int playerIndex);
+    // Reassocia uma sessão suspensa a um novo endpoint. A geração não muda:
+    // para o resto do sistema é a mesma sessão
+    bool resume(int playerIndex, QObject* endpoint);
+
+    // --- CONSULTAS ---
+    bool isFree(int playerIndex) const;
+    bool isCurrent(const SessionHandle& handle) const;
+    SessionHandle handle(int playerIndex) const;
+    const SessionInfo* session(int playerIndex) const;   // nullptr se o slot estiver livre
+    Session::Transport transport(int playerIndex) const;
+
+    // Endpoint do jogador se a sessão for do transporte indicado, senão nullptr
+    QObject* endpoint(int playerIndex, Session::Transport transport) const;
+
+    // -1 quando não há sessão
+    int playerForEndpoint(const QObject* endpoint) const { return m_byEndpoint.value(endpoint, -1); }
+    int playerForAddress(const QHostAddress& address) const { return m_byAddress.value(address, -1); }
+    // Bluetooth clássico e BLE têm índices separados: o mesmo aparelho pode
+    // estar nos dois transportes ao mesmo tempo
+    int playerForBluetoothAddress(Session::Transport transport, quint64 address) const { return m_byBluetoothAddress.value(bluetoothKey(transport, address), -1); }
+    int playerForResumeToken(const QByteArray& token) const { return m_byResumeToken.value(token, -1); }
+    bool isSuspended(int playerIndex) const { return isValidIndex(playerIndex) && m_sessions[playerIndex].suspended; }
+
+    // Bit i = jogador i
+    quint32 playerMask(Session::Transport transport) const { return m_transportMask[transport]; }
+    quint32 occupiedMask() const;
+    int count(Session::Transport transport) const;
+
+    static const char* transportName(Session::Transport transport);
+
+signals:
+    void sessionOpened(int playerIndex, Session::Transport transport);
+    void sessionClosed(int playerIndex, Session::Transport transport);
+
+private:
+    bool isValidIndex(int playerIndex) const { return playerIndex >= 0 && playerIndex < MAX_PLAYERS; }
+    // O endereço Bluetooth ocupa 48 bits; o transporte vai no byte de cima
+    static quint64 bluetoothKey(Session::Transport transport, quint64 address) { return (quint64(transport) << 56) | (address & 0xFFFFFFFFFFFFull); }
+
+    SessionInfo m_sessions[MAX_PLAYERS];
+    quint32 m_transportMask[Session::TransportCount] = {};
+    int m_capacity = MAX_PLAYERS;
+
+    QHash<const QObject*, int> m_byEndpoint;
+    QHash<QHostAddress, int> m_byAddress;
+    QHash<quint64, int> m_byBluetoothAddress;   // Chave: bluetoothKey(transporte, endereço)
+    QHash<QByteArray, int> m_byResumeToken;
+};
+
+#endif // SESSION_REGISTRY_H
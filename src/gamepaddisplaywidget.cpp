@@ -1,6 +1,32 @@
 #include "gamepaddisplaywidget.h"
 #include <QPainter>
 #include <QPaintEvent>
+#include <QResizeEvent>
+#include <QPixmap>
+#include <QImage>
+#include <QElapsedTimer>
+#include <QPainterPath>
+#include <QtMath>
+#include <memory>
+#include <vector>
+
+namespace {
+
+// Configurao de cores
+const QColor colorPressed("#4CAF50");
+const QColor colorReleased("#424242");
+const QColor colorTrigger(70, 70, 70);
+const QColor colorText = Qt::white;
+const QColor colorStickBase = Qt::lightGray;
+const QColor colorStickKnob = Qt::darkGray;
+
+QRect dirtyRect(const QRectF& rect)
+{
+    // Margem para a borda e o antialiasing
+    return rect.toAlignedRect().adjusted(-2, -2, 2, 2);
+}
+
+}
 
 // =============================================
 // CONSTRUTOR E INICIALIZAO
@@ -18,16 +44,20 @@ GamepadDisplayWidget::GamepadDisplayWidget(QWidget* parent)
 // ATUALIZAO DE ESTADO
 // =============================================
 
+// S as regies dos elementos que mudaram so redesenhadas
 void GamepadDisplayWidget::updateState(const GamepadPacket& packet)
 {
+    ensureLayout();
+    const QRegion dirty = changedRegion(m_currentState, packet);
     m_currentState = packet;
-    update();
+    if (!dirty.isEmpty()) update(dirty);
 }
 
 void GamepadDisplayWidget::resetState()
 {
-    memset(&m_currentState, 0, sizeof(GamepadPacket));
-    update();
+    GamepadPacket empty;
+    memset(&empty, 0, sizeof(GamepadPacket));
+    updateState(empty);
 }
 
 void GamepadDisplayWidget::setControllerType(int typeIndex)
@@ -35,61 +65,138 @@ void GamepadDisplayWidget::setControllerType(int typeIndex)
     ControllerType newType = static_cast<ControllerType>(typeIndex);
     if (m_controllerType != newType) {
         m_controllerType = newType;
+        m_body = QPixmap();
         update();
     }
 }
 
+QRegion GamepadDisplayWidget::changedRegion(const GamepadPacket& from, const GamepadPacket& to) const
+{
+    const Layout& l = m_layout;
+    const quint16 changed = from.buttons ^ to.buttons;
+    QRegion region;
+
+    // O centro do D-Pad acende com qualquer direo
+    if (changed & (DPAD_UP | DPAD_DOWN | DPAD_LEFT | DPAD_RIGHT)) {
+        region += dirtyRect(l.dpadUp | l.dpadDown | l.dpadLeft | l.dpadRight);
+    }
+    if (changed & Y) region += dirtyRect(l.yButton);
+    if (changed & B) region += dirtyRect(l.bButton);
+    if (changed & A) region += dirtyRect(l.aButton);
+    if (changed & X) region += dirtyRect(l.xButton);
+    if (changed & L1) region += dirtyRect(l.l1Button);
+    if (changed & R1) region += dirtyRect(l.r1Button);
+    if (changed & SELECT) region += dirtyRect(l.selectButton);
+    if (changed & START) region += dirtyRect(l.startButton);
+
+    if (from.leftTrigger != to.leftTrigger) region += dirtyRect(l.l2Button);
+    if (from.rightTrigger != to.rightTrigger) region += dirtyRect(l.r2Button);
+
+    if ((changed & L3) || from.leftStickX != to.leftStickX || from.leftStickY != to.leftStickY) {
+        region += dirtyRect(l.lsArea);
+    }
+    if ((changed & R3) || from.rightStickX != to.rightStickX || from.rightStickY != to.rightStickY) {
+        region += dirtyRect(l.rsArea);
+    }
+    return region;
+}
+
 // =============================================
 // RENDERIZAO DO CONTROLE
 // =============================================
 
-void GamepadDisplayWidget::paintEvent(QPaintEvent* event)
+void GamepadDisplayWidget::resizeEvent(QResizeEvent* event)
 {
-    Q_UNUSED(event);
+    QWidget::resizeEvent(event);
+    m_body = QPixmap();
+    ensureLayout();
+}
 
-    QPainter painter(this);
-    painter.setRenderHint(QPainter::Antialiasing);
+void GamepadDisplayWidget::ensureLayout()
+{
+    if (m_layout.size == size()) return;
 
-    // Configurao de cores e dimenses
-    const QColor colorPressed = QColor("#4CAF50");
-    const QColor colorReleased = QColor("#424242");
-    const QColor colorText = Qt::white;
-    const QColor colorStickBase = Qt::lightGray;
-    const QColor colorStickKnob = Qt::darkGray;
+    Layout& l = m_layout;
+    l.size = size();
 
     int width = this->width();
     int height = this->height();
     int buttonSize = qMin(width, height) / 10;
     int stickBaseSize = buttonSize * 2.5;
+    l.buttonSize = buttonSize;
+    l.knobSize = stickBaseSize / 2.5;
 
     // Posicionamento dos botes principais
-    QRectF yButton(width * 0.72, height * 0.31, buttonSize, buttonSize);
-    QRectF bButton(width * 0.78, height * 0.41, buttonSize, buttonSize);
-    QRectF aButton(width * 0.72, height * 0.51, buttonSize, buttonSize);
-    QRectF xButton(width * 0.66, height * 0.41, buttonSize, buttonSize);
-
-    // Posicionamento dos analgicos
-    QRectF lsBase(width * 0.18, height * 0.65, stickBaseSize, stickBaseSize);
-    QRectF rsBase(width * 0.72, height * 0.65, stickBaseSize, stickBaseSize);
+    l.yButton = QRectF(width * 0.72, height * 0.31, buttonSize, buttonSize);
+    l.bButton = QRectF(width * 0.78, height * 0.41, buttonSize, buttonSize);
+    l.aButton = QRectF(width * 0.72, height * 0.51, buttonSize, buttonSize);
+    l.xButton = QRectF(width * 0.66, height * 0.41, buttonSize, buttonSize);
+
+    // Posicionamento dos analgicos (o knob anda at base/2 - 10 do centro)
+    l.lsBase = QRectF(width * 0.18, height * 0.65, stickBaseSize, stickBaseSize);
+    l.rsBase = QRectF(width * 0.72, height * 0.65, stickBaseSize, stickBaseSize);
+    const qreal knobOverflow = qMax<qreal>(0.0, l.knobSize / 2.0 - 10.0) + 1.0;
+    l.lsArea = l.lsBase.adjusted(-knobOverflow, -knobOverflow, knobOverflow, knobOverflow);
+    l.rsArea = l.rsBase.adjusted(-knobOverflow, -knobOverflow, knobOverflow, knobOverflow);
 
     // Posicionamento do D-Pad
     int dpadCenterX = width * 0.3;
     int dpadCenterY = height * 0.45;
     int dpadArmWidth = buttonSize * 0.7;
     int dpadArmLength = buttonSize * 1.3;
-    QRectF dpadUp(dpadCenterX - dpadArmWidth / 2, dpadCenterY - dpadArmLength, dpadArmWidth, dpadArmLength);
-    QRectF dpadDown(dpadCenterX - dpadArmWidth / 2, dpadCenterY, dpadArmWidth, dpadArmLength);
-    QRectF dpadLeft(dpadCenterX - dpadArmLength, dpadCenterY - dpadArmWidth / 2, dpadArmLength, dpadArmWidth);
-    QRectF dpadRight(dpadCenterX, dpadCenterY - dpadArmWidth / 2, dpadArmLength, dpadArmWidth);
-    QRectF dpadCenter(dpadCenterX - dpadArmWidth / 2, dpadCenterY - dpadArmWidth / 2, dpadArmWidth, dpadArmWidth);
+    l.dpadUp = QRectF(dpadCenterX - dpadArmWidth / 2, dpadCenterY - dpadArmLength, dpadArmWidth, dpadArmLength);
+    l.dpadDown = QRectF(dpadCenterX - dpadArmWidth / 2, dpadCenterY, dpadArmWidth, dpadArmLength);
+    l.dpadLeft = QRectF(dpadCenterX - dpadArmLength, dpadCenterY - dpadArmWidth / 2, dpadArmLength, dpadArmWidth);
+    l.dpadRight = QRectF(dpadCenterX, dpadCenterY - dpadArmWidth / 2, dpadArmLength, dpadArmWidth);
+    l.dpadCenter = QRectF(dpadCenterX - dpadArmWidth / 2, dpadCenterY - dpadArmWidth / 2, dpadArmWidth, dpadArmWidth);
 
     // Posicionamento dos gatilhos e botes superiores
-    QRectF l1Button(width * 0.15, height * 0.12, width * 0.12, height * 0.07);
-    QRectF r1Button(width * 0.73, height * 0.12, width * 0.12, height * 0.07);
-    QRectF l2Button(width * 0.15, height * 0.20, width * 0.12, height * 0.05);
-    QRectF r2Button(width * 0.73, height * 0.20, width * 0.12, height * 0.05);
-    QRectF selectButton(width * 0.42, height * 0.18, width * 0.07, height * 0.04);
-    QRectF startButton(width * 0.51, height * 0.18, width * 0.07, height * 0.04);
+    l.l1Button = QRectF(width * 0.15, height * 0.12, width * 0.12, height * 0.07);
+    l.r1Button = QRectF(width * 0.73, height * 0.12, width * 0.12, height * 0.07);
+    l.l2Button = QRectF(width * 0.15, height * 0.20, width * 0.12, height * 0.05);
+    l.r2Button = QRectF(width * 0.73, height * 0.20, width * 0.12, height * 0.05);
+    l.selectButton = QRectF(width * 0.42, height * 0.18, width * 0.07, height * 0.04);
+    l.startButton = QRectF(width * 0.51, height * 0.18, width * 0.07, height * 0.04);
+
+    // Fontes dos labels
+    l.font = font();
+    l.font.setPointSize(qMax(1, int(buttonSize / 2.2)));
+    l.smallFont = font();
+    l.smallFont.setPointSize(qMax(1, int(buttonSize / 3.5)));
+}
+
+const QPixmap& GamepadDisplayWidget::bodyPixmap()
+{
+    // Tamanho e tipo invalidam em resizeEvent/setControllerType; o DPI muda ao
+    // arrastar a janela para outro monitor e  conferido aqui
+    const qreal dpr = devicePixelRatioF();
+    if (!m_body.isNull() && m_body.devicePixelRatio() == dpr) return m_body;
+
+    m_body = QPixmap(size() * dpr);
+    m_body.setDevicePixelRatio(dpr);
+    m_body.fill(Qt::transparent);
+    QPainter painter(&m_body);
+    painter.setRenderHint(QPainter::Antialiasing);
+    paintBody(painter);
+    return m_body;
+}
+
+void GamepadDisplayWidget::paintEvent(QPaintEvent* event)
+{
+    ensureLayout();
+
+    QPainter painter(this);
+    painter.setClipRegion(event->region());
+    painter.drawPixmap(0, 0, bodyPixmap());
+
+    painter.setRenderHint(QPainter::Antialiasing);
+    paintDynamic(painter);
+}
+
+// Tudo o que no depende do estado: botes soltos, labels, bases dos analgicos
+void GamepadDisplayWidget::paintBody(QPainter& painter) const
+{
+    const Layout& l = m_layout;
 
     // Sistema de labels dinmicos baseado no tipo de controle
     QString yLabel, bLabel, aLabel, xLabel;
@@ -106,116 +213,195 @@ void GamepadDisplayWidget::paintEvent(QPaintEvent* event)
         xLabel = "X";
     }
 
-    // Renderizao do D-Pad
-    QColor dpadColor = colorReleased;
-    painter.setBrush(dpadColor);
-    painter.drawRect(dpadUp);
-    painter.drawRect(dpadDown);
-    painter.drawRect(dpadLeft);
-    painter.drawRect(dpadRight);
-    painter.drawRect(dpadCenter);
+    // D-Pad
+    painter.setBrush(colorReleased);
+    painter.drawRect(l.dpadUp);
+    painter.drawRect(l.dpadDown);
+    painter.drawRect(l.dpadLeft);
+    painter.drawRect(l.dpadRight);
+    painter.drawRect(l.dpadCenter);
 
-    if (m_currentState.buttons & DPAD_UP) {
-        painter.setBrush(colorPressed);
-        painter.drawRect(dpadUp);
-        painter.drawRect(dpadCenter);
-    }
-    if (m_currentState.buttons & DPAD_DOWN) {
-        painter.setBrush(colorPressed);
-        painter.drawRect(dpadDown);
-        painter.drawRect(dpadCenter);
-    }
-    if (m_currentState.buttons & DPAD_LEFT) {
-        painter.setBrush(colorPressed);
-        painter.drawRect(dpadLeft);
-        painter.drawRect(dpadCenter);
-    }
-    if (m_currentState.buttons & DPAD_RIGHT) {
-        painter.setBrush(colorPressed);
-        painter.drawRect(dpadRight);
-        painter.drawRect(dpadCenter);
-    }
+    // Botes ABXY
+    painter.drawEllipse(l.yButton);
+    painter.drawEllipse(l.bButton);
+    painter.drawEllipse(l.aButton);
+    painter.drawEllipse(l.xButton);
 
-    // Renderizao dos botes ABXY
-    painter.setBrush((m_currentState.buttons & Y) ? colorPressed : colorReleased);
-    painter.drawEllipse(yButton);
-    painter.setBrush((m_currentState.buttons & B) ? colorPressed : colorReleased);
-    painter.drawEllipse(bButton);
-    painter.setBrush((m_currentState.buttons & A) ? colorPressed : colorReleased);
-    painter.drawEllipse(aButton);
-    painter.setBrush((m_currentState.buttons & X) ? colorPressed : colorReleased);
-    painter.drawEllipse(xButton);
-
-    // Renderizao dos labels dos botes
     painter.setPen(colorText);
-    QFont font = painter.font();
-    font.setPointSize(buttonSize / 2.2);
-    painter.setFont(font);
-
-    painter.drawText(yButton, Qt::AlignCenter, yLabel);
-    painter.drawText(bButton, Qt::AlignCenter, bLabel);
-    painter.drawText(aButton, Qt::AlignCenter, aLabel);
-    painter.drawText(xButton, Qt::AlignCenter, xLabel);
-
-    // Renderizao dos botes L1/R1
-    painter.setBrush((m_currentState.buttons & L1) ? colorPressed : colorReleased);
-    painter.drawRoundedRect(l1Button, 8, 8);
-    painter.drawText(l1Button, Qt::AlignCenter, "L1");
-
-    painter.setBrush((m_currentState.buttons & R1) ? colorPressed : colorReleased);
-    painter.drawRoundedRect(r1Button, 8, 8);
-    painter.drawText(r1Button, Qt::AlignCenter, "R1");
-
-    // Renderizao dos gatilhos L2/R2
-    painter.setBrush(QColor(70, 70, 70));
-    painter.drawRoundedRect(l2Button, 5, 5);
-    painter.drawRoundedRect(r2Button, 5, 5);
-
-    painter.setPen(colorText);
-    QFont smallFont = painter.font();
-    smallFont.setPointSize(buttonSize / 3.5);
-    painter.setFont(smallFont);
-
-    painter.drawText(l2Button, Qt::AlignCenter, QString("L2: %1").arg(m_currentState.leftTrigger));
-    painter.drawText(r2Button, Qt::AlignCenter, QString("R2: %1").arg(m_currentState.rightTrigger));
-
-    // Renderizao dos botes Select/Start
-    painter.setBrush((m_currentState.buttons & SELECT) ? colorPressed : colorReleased);
-    painter.drawRoundedRect(selectButton, 4, 4);
-    painter.drawText(selectButton, Qt::AlignCenter, "Select");
-
-    painter.setBrush((m_currentState.buttons & START) ? colorPressed : colorReleased);
-    painter.drawRoundedRect(startButton, 4, 4);
-    painter.drawText(startButton, Qt::AlignCenter, "Start");
-
-    // Renderizao dos analgicos
+    painter.setFont(l.font);
+    painter.drawText(l.yButton, Qt::AlignCenter, yLabel);
+    painter.drawText(l.bButton, Qt::AlignCenter, bLabel);
+    painter.drawText(l.aButton, Qt::AlignCenter, aLabel);
+    painter.drawText(l.xButton, Qt::AlignCenter, xLabel);
+
+    // Botes L1/R1
+    painter.drawRoundedRect(l.l1Button, 8, 8);
+    painter.drawText(l.l1Button, Qt::AlignCenter, "L1");
+    painter.drawRoundedRect(l.r1Button, 8, 8);
+    painter.drawText(l.r1Button, Qt::AlignCenter, "R1");
+
+    // Botes Select/Start
+    painter.setFont(l.smallFont);
+    painter.drawRoundedRect(l.selectButton, 4, 4);
+    painter.drawText(l.selectButton, Qt::AlignCenter, "Select");
+    painter.drawRoundedRect(l.startButton, 4, 4);
+    painter.drawText(l.startButton, Qt::AlignCenter, "Start");
+
+    // Bases dos analgicos
     painter.setPen(Qt::NoPen);
     painter.setBrush(colorStickBase);
-    painter.drawEllipse(lsBase);
-    painter.drawEllipse(rsBase);
+    painter.drawEllipse(l.lsBase);
+    painter.drawEllipse(l.rsBase);
+}
 
-    // Clculo da posio dos knobs dos analgicos
-    QPointF lsCenter = lsBase.center();
-    QPointF rsCenter = rsBase.center();
-    float lsKnobX = lsCenter.x() + (m_currentState.leftStickX / 127.0f) * (lsBase.width() / 2 - 10);
-    float lsKnobY = lsCenter.y() + (m_currentState.leftStickY / 127.0f) * (lsBase.height() / 2 - 10);
-    float rsKnobX = rsCenter.x() + (m_currentState.rightStickX / 127.0f) * (rsBase.width() / 2 - 10);
-    float rsKnobY = rsCenter.y() + (m_currentState.rightStickY / 127.0f) * (rsBase.height() / 2 - 10);
+// Elementos que dependem do estado, desenhados sobre o corpo em cache
+void GamepadDisplayWidget::paintDynamic(QPainter& painter) const
+{
+    const Layout& l = m_layout;
+    const GamepadPacket& state = m_currentState;
+    const QRectF clip = painter.clipBoundingRect();
 
-    int knobSize = stickBaseSize / 2.5;
-    QRectF lsKnobRect(lsKnobX - knobSize / 2, lsKnobY - knobSize / 2, knobSize, knobSize);
-    QRectF rsKnobRect(rsKnobX - knobSize / 2, rsKnobY - knobSize / 2, knobSize, knobSize);
+    // Boto pressionado: mesmo desenho do corpo com a cor de pressionado
+    auto pressedEllipse = [&](const QRectF& rect, const QString& label) {
+        painter.setPen(QPen());
+        painter.setBrush(colorPressed);
+        painter.drawEllipse(rect);
+        painter.setPen(colorText);
+        painter.setFont(l.font);
+        painter.drawText(rect, Qt::AlignCenter, label);
+    };
+    auto pressedRounded = [&](const QRectF& rect, qreal radius, const QFont& font, const QString& label) {
+        painter.setPen(colorText);
+        painter.setBrush(colorPressed);
+        painter.drawRoundedRect(rect, radius, radius);
+        painter.setFont(font);
+        painter.drawText(rect, Qt::AlignCenter, label);
+    };
+
+    // D-Pad
+    const quint16 dpad = state.buttons & (DPAD_UP | DPAD_DOWN | DPAD_LEFT | DPAD_RIGHT);
+    if (dpad) {
+        painter.setPen(QPen());
+        painter.setBrush(colorPressed);
+        if (dpad & DPAD_UP) painter.drawRect(l.dpadUp);
+        if (dpad & DPAD_DOWN) painter.drawRect(l.dpadDown);
+        if (dpad & DPAD_LEFT) painter.drawRect(l.dpadLeft);
+        if (dpad & DPAD_RIGHT) painter.drawRect(l.dpadRight);
+        painter.drawRect(l.dpadCenter);
+    }
 
-    // Renderizao dos knobs dos analgicos
-    painter.setBrush((m_currentState.buttons & L3) ? colorPressed : colorStickKnob);
-    painter.drawEllipse(lsKnobRect);
+    // Botes ABXY
+    const bool ds4 = (m_controllerType == ControllerType::DualShock4);
+    if (state.buttons & Y) pressedEllipse(l.yButton, ds4 ? "\u25B3" : "Y");
+    if (state.buttons & B) pressedEllipse(l.bButton, ds4 ? "\u25EF" : "B");
+    if (state.buttons & A) pressedEllipse(l.aButton, ds4 ? "\u2715" : "A");
+    if (state.buttons & X) pressedEllipse(l.xButton, ds4 ? "\u25A1" : "X");
+
+    // Botes L1/R1, Select/Start
+    if (state.buttons & L1) pressedRounded(l.l1Button, 8, l.font, "L1");
+    if (state.buttons & R1) pressedRounded(l.r1Button, 8, l.font, "R1");
+    if (state.buttons & SELECT) pressedRounded(l.selectButton, 4, l.smallFont, "Select");
+    if (state.buttons & START) pressedRounded(l.startButton, 4, l.smallFont, "Start");
+
+    // Gatilhos L2/R2: preenchimento proporcional + valor
+    auto trigger = [&](const QRectF& rect, quint8 value, const char* name) {
+        if (!clip.intersects(rect)) return;
+        QPainterPath shape;
+        shape.addRoundedRect(rect, 5, 5);
+        painter.setPen(colorText);
+        painter.setBrush(colorTrigger);
+        painter.drawPath(shape);
+        if (value > 0) {
+            painter.save();
+            painter.setClipPath(shape, Qt::IntersectClip);
+            painter.fillRect(QRectF(rect.left(), rect.top(), rect.width() * value / 255.0, rect.height()), colorPressed);
+            painter.restore();
+        }
+        painter.setFont(l.smallFont);
+        painter.drawText(rect, Qt::AlignCenter, QString("%1: %2").arg(QLatin1String(name)).arg(value));
+    };
+    trigger(l.l2Button, state.leftTrigger, "L2");
+    trigger(l.r2Button, state.rightTrigger, "R2");
+
+    // Knobs dos analgicos
+    auto stick = [&](const QRectF& base, const QRectF& area, qint8 x, qint8 y, bool pressed, const char* name) {
+        if (!clip.intersects(area)) return;
+        const QPointF center = base.center();
+        const qreal knobX = center.x() + (x / 127.0f) * (base.width() / 2 - 10);
+        const qreal knobY = center.y() + (y / 127.0f) * (base.height() / 2 - 10);
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(pressed ? colorPressed : colorStickKnob);
+        painter.drawEllipse(QRectF(knobX - l.knobSize / 2, knobY - l.knobSize / 2, l.knobSize, l.knobSize));
+        painter.setPen(colorText);
+        painter.setFont(l.smallFont);
+        painter.drawText(base, Qt::AlignCenter, QLatin1String(name));
+    };
+    stick(l.lsBase, l.lsArea, state.leftStickX, state.leftStickY, state.buttons & L3, "L3");
+    stick(l.rsBase, l.rsArea, state.rightStickX, state.rightStickY, state.buttons & R3, "R3");
+}
 
-    painter.setBrush((m_currentState.buttons & R3) ? colorPressed : colorStickKnob);
-    painter.drawEllipse(rsKnobRect);
+// =============================================
+// BENCHMARK
+// =============================================
 
-    // Labels dos analgicos
-    painter.setPen(colorText);
-    painter.setFont(smallFont);
-    painter.drawText(lsBase, Qt::AlignCenter, "L3");
-    painter.drawText(rsBase, Qt::AlignCenter, "R3");
-}
\ No newline at end of file
+QStringList GamepadDisplayWidget::runRenderBenchmark(int frames)
+{
+    const int widgetCount = 8;
+    frames = qMax(1, frames);
+
+    std::vector<std::unique_ptr<GamepadDisplayWidget>> widgets;
+    for (int i = 0; i < widgetCount; ++i) {
+        widgets.emplace_back(new GamepadDisplayWidget());
+        widgets.back()->setAttribute(Qt::WA_DontShowOnScreen);
+        widgets.back()->resize(400, 300);
+        widgets.back()->setControllerType(i % 2);
+        widgets.back()->ensureLayout();
+    }
+    QImage target(400, 300, QImage::Format_ARGB32_Premultiplied);
+
+    // Estado sinttico: analgicos girando, gatilhos em rampa, um boto alternando
+    auto stateFor = [](int frame, int widget) {
+        GamepadPacket packet;
+        memset(&packet, 0, sizeof(GamepadPacket));
+        const double angle = (frame + widget * 7) * 0.1;
+        packet.leftStickX = static_cast<int8_t>(127 * qCos(angle));
+        packet.leftStickY = static_cast<int8_t>(127 * qSin(angle));
+        packet.rightStickX = static_cast<int8_t>(127 * qSin(angle));
+        packet.leftTrigger = static_cast<uint8_t>((frame * 4) & 0xFF);
+        packet.buttons = ((frame / 15) % 2) ? A : 0;
+        return packet;
+    };
+
+    enum Mode { Uncached, FullFrame, DirtyRegions };
+    const char* modeNames[] = {
+        "sem cache (corpo redesenhado a cada quadro)",
+        "corpo em cache, quadro inteiro",
+        "corpo em cache, so regioes alteradas",
+    };
+
+    QStringList lines;
+    lines << QString("Renderizacao fora da tela: %1 widgets 400x300, %2 quadros").arg(widgetCount).arg(frames);
+    for (int mode = Uncached; mode <= DirtyRegions; ++mode) {
+        for (auto& w : widgets) w->updateState(stateFor(0, 0));
+
+        QElapsedTimer timer;
+        timer.start();
+        for (int frame = 1; frame <= frames; ++frame) {
+            for (int i = 0; i < widgetCount; ++i) {
+                GamepadDisplayWidget* w = widgets[i].get();
+                if (mode == Uncached) w->m_body = QPixmap();
+                const GamepadPacket next = stateFor(frame, i);
+                const QRegion region = (mode == DirtyRegions)
+                    ? w->changedRegion(w->m_currentState, next)
+                    : QRegion(w->rect());
+                w->m_currentState = next;
+                if (!region.isEmpty()) w->render(&target, region.boundingRect().topLeft(), region);
+            }
+        }
+        const double seconds = timer.nsecsElapsed() / 1e9;
+        lines << QString("  %1: %2 quadros/s (8 widgets por quadro)")
+            .arg(QLatin1String(modeNames[mode]))
+            .arg(seconds > 0 ? frames / seconds : 0.0, 0, 'f', 0);
+    }
+    return lines;
+}
@@ -2,9 +2,14 @@
 #define GAMEPADDISPLAYWIDGET_H
 
 #include <QWidget>
+#include <QFont>
+#include <QRegion>
+#include <QStringList>
 #include "src/protocol/gamepad_packet.h"
 #include "controller_types.h"
 
+class QPainter;
+
 class GamepadDisplayWidget : public QWidget
 {
     Q_OBJECT
@@ -12,6 +17,10 @@ class GamepadDisplayWidget : public QWidget
 public:
     explicit GamepadDisplayWidget(QWidget* parent = nullptr);
 
+    // Renderiza 8 widgets fora da tela e mede quadros por segundo: corpo
+    // redesenhado a cada quadro, corpo em cache e s as regies alteradas
+    static QStringList runRenderBenchmark(int frames);
+
 public slots:
     // Controle de estado e configurao
     void updateState(const GamepadPacket& packet);
@@ -21,13 +30,40 @@ public slots:
 protected:
     // Sistema de renderizao
     void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
 
 private:
+    // Geometria de todos os elementos, recalculada s quando o tamanho muda
+    struct Layout {
+        QSize size;
+        int buttonSize = 0;
+        int knobSize = 0;
+        QRectF yButton, bButton, aButton, xButton;
+        QRectF lsBase, rsBase;
+        QRectF lsArea, rsArea;          // Base + o quanto o knob pode passar dela
+        QRectF dpadUp, dpadDown, dpadLeft, dpadRight, dpadCenter;
+        QRectF l1Button, r1Button, l2Button, r2Button;
+        QRectF selectButton, startButton;
+        QFont font, smallFont;
+    };
+
+    void ensureLayout();
+    // Corpo do controle com tudo solto, guardado em m_body at mudar tamanho, tipo ou DPI
+    const QPixmap& bodyPixmap();
+    void paintBody(QPainter& painter) const;
+    void paintDynamic(QPainter& painter) const;
+    // rea da tela que muda de um estado para outro
+    QRegion changedRegion(const GamepadPacket& from, const GamepadPacket& to) const;
+
     // Dados do controle atual
     GamepadPacket m_currentState;
 
     // Tipo de controle para exibio visual
     ControllerType m_controllerType;
+
+    Layout m_layout;
+    // Fora do QPixmapCache: o limite global de 10 MB estoura com vrios widgets grandes em HiDPI
+    QPixmap m_body;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -1,15 +1,33 @@
 #include "mainwindow.h"
+#include "server_runtime.h"
+#include "utils/log.h"
+#include "streaming/bitrate_controller.h"
+#include "streaming/encoder_probe.h"
+#include "streaming/screen_streamer.h"
+#include "protocol/signal_codec.h"
+#include "protocol/dsu_encoder.h"
+#include "communication/dsu_server.h"
+#include "virtual_gamepad/motion_timeline.h"
+#include "virtual_gamepad/controller_pool.h"
 #include <QApplication>
 #include <QSettings>
 #include <QMessageBox>
 #include <QProcess>
 #include <QDir>
+#include <QFileInfo>
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QStandardPaths>
+#include <cstring>
+#ifdef Q_OS_WIN
 #include <Windows.h>
 #include <shellapi.h>
 #include <Shlobj.h>
+#endif
 #include <stdlib.h>
 
+#ifdef Q_OS_WIN
 // Verifica se o driver ViGEmBus est instalado
 bool isViGEmBusInstalled()
 {
@@ -39,10 +57,26 @@ void runAsAdmin(int argc, char* argv[])
         }
     }
 }
+#endif
+
+// --headless: servidor sem janela (servio, CI, benchmarks)
+static bool hasArgument(int argc, char* argv[], const char* name)
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], name) == 0) return true;
+    }
+    return false;
+}
 
 int main(int argc, char* argv[])
 {
+    // Partida a frio medida desde aqui no modo sem interface
+    QElapsedTimer launchClock;
+    launchClock.start();
+
     // --- MODO PORTTIL ADICIONADO ---
+    // S no Windows os plugins vm junto do executvel; no Linux ficam os do sistema
+#ifdef Q_OS_WIN
     QString appPath = QCoreApplication::applicationDirPath();
     QByteArray appPathBytes = appPath.toLocal8Bit();
 
@@ -50,8 +84,206 @@ int main(int argc, char* argv[])
     qputenv("GST_PLUGIN_SYSTEM_PATH", appPathBytes);
 
     qDebug() << "Iniciando em modo porttil. Plugins GStreamer buscados em:" << appPath;
+#endif
     // --- FIM MODO PORTTIL ---
 
+    // --bench-render [quadros]: mede a renderizao dos controles fora da tela
+    if (hasArgument(argc, argv, "--bench-render")) {
+        if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+        QApplication a(argc, argv);
+        const QStringList args = a.arguments();
+        const int at = args.indexOf("--bench-render");
+        const int frames = (at + 1 < args.size()) ? args.at(at + 1).toInt() : 0;
+        QTextStream out(stdout);
+        for (const QString& line : GamepadDisplayWidget::runRenderBenchmark(frames > 0 ? frames : 600)) {
+            out << line << '\n';
+        }
+        return 0;
+    }
+
+    // --bench-log [chamadas]: custo de uma chamada de log suprimida e emitida
+    if (hasArgument(argc, argv, "--bench-log")) {
+        QCoreApplication a(argc, argv);
+        const QStringList args = a.arguments();
+        const int at = args.indexOf("--bench-log");
+        const int calls = (at + 1 < args.size()) ? args.at(at + 1).toInt() : 0;
+        QTextStream out(stdout);
+        for (const QString& line : Log::runBenchmark(calls > 0 ? calls : 1000000)) {
+            out << line << '\n';
+        }
+        return 0;
+    }
+
+    // --bench-dsu [pacotes]: pacote DSU antigo (heap + CRC bit a bit) contra o DsuEncoder
+    if (hasArgument(argc, argv, "--bench-dsu")) {
+        QCoreApplication a(argc, argv);
+        const QStringList args = a.arguments();
+        const int at = args.indexOf("--bench-dsu");
+        const int packets = (at + 1 < args.size()) ? args.at(at + 1).toInt() : 0;
+        QTextStream out(stdout);
+        for (const QString& line : DsuEncoder::runBenchmark(packets > 0 ? packets : 1000000)) {
+            out << line << '\n';
+        }
+        return 0;
+    }
+
+    // --bench-dsu-fanout [pacotes]: publish() com 1, 4, 16 e 32 assinantes em loopback
+    if (hasArgument(argc, argv, "--bench-dsu-fanout")) {
+        QCoreApplication a(argc, argv);
+        const QStringList args = a.arguments();
+        const int at = args.indexOf("--bench-dsu-fanout");
+        const int packets = (at + 1 < args.size()) ? args.at(at + 1).toInt() : 0;
+        QTextStream out(stdout);
+        for (const QString& line : DsuServer::runFanoutBenchmark(packets > 0 ? packets : 100000)) {
+            out << line << '\n';
+        }
+        return 0;
+    }
+
+    // --bench-motion [segundos]: erro de integrao do giroscpio numa sesso sinttica
+    if (hasArgument(argc, argv, "--bench-motion")) {
+        QCoreApplication a(argc, argv);
+        const QStringList args = a.arguments();
+        const int at = args.indexOf("--bench-motion");
+        const int seconds = (at + 1 < args.size()) ? args.at(at + 1).toInt() : 0;
+        QTextStream out(stdout);
+        for (const QString& line : MotionTimeline::runReplayBenchmark(seconds > 0 ? seconds : 60)) {
+            out << line << '\n';
+        }
+        return 0;
+    }
+
+    // --bench-pool [atraso_ms]: espera pelo controle virtual sem reserva e com --warm-spares 1
+    if (hasArgument(argc, argv, "--bench-pool")) {
+        QCoreApplication a(argc, argv);
+        const QStringList args = a.arguments();
+        const int at = args.indexOf("--bench-pool");
+        const int delayMs = (at + 1 < args.size()) ? args.at(at + 1).toInt() : 0;
+        QTextStream out(stdout);
+        for (const QString& line : ControllerPool::runWarmBenchmark(delayMs > 0 ? delayMs : 40)) {
+            out << line << '\n';
+        }
+        return 0;
+    }
+
+    // --bench-signal [iteraes]: sinalizao do stream em JSON e no formato binrio
+    if (hasArgument(argc, argv, "--bench-signal")) {
+        QCoreApplication a(argc, argv);
+        const QStringList args = a.arguments();
+        const int at = args.indexOf("--bench-signal");
+        const int iterations = (at + 1 < args.size()) ? args.at(at + 1).toInt() : 0;
+        QTextStream out(stdout);
+        for (const QString& line : SignalCodec::runBenchmark(iterations > 0 ? iterations : 10000)) {
+            out << line << '\n';
+        }
+        return 0;
+    }
+
+    // --bench-ingest [pacotes]: pacote injetado -> controle virtual (backend null, sem rede)
+    if (hasArgument(argc, argv, "--bench-ingest")) {
+        QCoreApplication a(argc, argv);
+        const QStringList args = a.arguments();
+        const int at = args.indexOf("--bench-ingest");
+        const int packets = (at + 1 < args.size()) ? args.at(at + 1).toInt() : 0;
+        QTextStream out(stdout);
+        for (const QString& line : ServerRuntime::runIngestBenchmark(packets > 0 ? packets : 100000)) {
+            out << line << '\n';
+        }
+        return 0;
+    }
+
+    // --bench-bitrate: controle de bitrate adaptativo num enlace simulado com perda
+    if (hasArgument(argc, argv, "--bench-bitrate")) {
+        QTextStream out(stdout);
+        for (const QString& line : BitrateController::runSimulation()) {
+            out << line << '\n';
+        }
+        return 0;
+    }
+
+    // --bench-bitrate-loopback [segundos]: o mesmo controle no stream real (x264, receptor
+    // local com perda injetada), em fases de N segundos
+    if (hasArgument(argc, argv, "--bench-bitrate-loopback")) {
+        QCoreApplication a(argc, argv);
+        const QStringList args = a.arguments();
+        const int at = args.indexOf("--bench-bitrate-loopback");
+        const int seconds = (at + 1 < args.size()) ? args.at(at + 1).toInt() : 0;
+        QTextStream out(stdout);
+        for (const QString& line : ScreenStreamer::runBitrateLoopbackBenchmark(seconds > 0 ? seconds : 10)) {
+            out << line << '\n';
+        }
+        return 0;
+    }
+
+    // --bench-encoders: mede os encoders instalados na maior camada padro e refaz o cache.
+    // O ScreenStreamer roda este modo como processo filho com --probe-tier e --probe-cache
+    if (hasArgument(argc, argv, "--bench-encoders")) {
+        QCoreApplication a(argc, argv);
+        const QStringList args = a.arguments();
+        StreamTierSet tiers;
+        const int tierAt = args.indexOf("--probe-tier");
+        if (tierAt >= 0) {
+            QString error;
+            if (tierAt + 1 >= args.size() || !StreamTierSet::parse(args.at(tierAt + 1), tiers, error)) {
+                QTextStream(stderr) << (error.isEmpty() ? QString("--probe-tier sem valor") : error) << '\n';
+                return 1;
+            }
+        }
+        const int cacheAt = args.indexOf("--probe-cache");
+        const QString cachePath = (cacheAt >= 0 && cacheAt + 1 < args.size())
+            ? args.at(cacheAt + 1) : EncoderProbe::defaultCachePath();
+
+        const StreamTier tier = tiers.at(0);
+        const QVector<EncoderProbe::Result> results = EncoderProbe::run(tier);
+        const QVector<PipelineBuilder::Encoder> ranking = EncoderProbe::ranking(results, tier.framerate);
+        EncoderProbe::saveCache(cachePath, EncoderProbe::fingerprint(tier), results, ranking);
+        QTextStream out(stdout);
+        for (const QString& line : EncoderProbe::report(results, ranking)) {
+            out << line << '\n';
+        }
+        return 0;
+    }
+
+    // --bench-keyframes: tamanho dos quadros com keyframe a cada 1 s, s por PLI e com intra-refresh
+    if (hasArgument(argc, argv, "--bench-keyframes")) {
+        QCoreApplication a(argc, argv);
+        const StreamTier tier = StreamTierSet().at(0);
+        QTextStream out(stdout);
+        for (const QString& line : EncoderProbe::compareKeyframeModes(tier, tier.framerate * 5)) {
+            out << line << '\n';
+        }
+        return 0;
+    }
+
+    // --bench-join [entradas]: request_stream at o primeiro quadro decodificado num receptor local,
+    // com STUN e no modo LAN (s candidatos host)
+    if (hasArgument(argc, argv, "--bench-join")) {
+        QCoreApplication a(argc, argv);
+        const QStringList args = a.arguments();
+        const int at = args.indexOf("--bench-join");
+        const int joins = (at + 1 < args.size()) ? args.at(at + 1).toInt() : 0;
+        IceConfig lan;
+        lan.lanOnly = true;
+        QTextStream out(stdout);
+        for (const IceConfig& ice : { IceConfig(), lan }) {
+            for (const QString& line : ScreenStreamer::runJoinBenchmark(joins > 0 ? joins : 5, ice)) {
+                out << line << '\n';
+            }
+        }
+        return 0;
+    }
+
+    // --dsu-probe [assinantes] [ms]: diagnstico DSU sem janela, relatrio em JSON
+    if (hasArgument(argc, argv, "--dsu-probe")) {
+        return runDsuProbe(argc, argv);
+    }
+
+    // Sem janela no h dilogos: se o driver faltar, o backend falha e o processo sai com erro
+    if (hasArgument(argc, argv, "--headless")) {
+        return runHeadless(argc, argv, launchClock);
+    }
+
+#ifdef Q_OS_WIN
     // Verificao da instalao do driver ViGEmBus
     if (!isViGEmBusInstalled()) {
 
@@ -92,10 +324,36 @@ int main(int argc, char* argv[])
             return 0;
         }
     }
+#endif
 
     // Execuo normal do programa se o driver estiver instalado
     QApplication a(argc, argv);
-    MainWindow w;
+    const QString dataDir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+
+    // Mesma configurao do --headless (modo LAN, STUN, portas...): linha de
+    // comando e --config, ou gamepadvirtual.ini na pasta de dados se existir
+    QStringList arguments = a.arguments();
+    const QString defaultConfig = dataDir + "/gamepadvirtual.ini";
+    if (!arguments.contains("--config") && QFileInfo::exists(defaultConfig)) {
+        arguments << "--config" << defaultConfig;
+    }
+    ServerConfig config;
+    QString configError;
+    if (!ServerConfig::parse(arguments, config, configError)) {
+        if (configError.isEmpty()) return 0;   // --help
+        QMessageBox::warning(nullptr, "Configurao Invlida",
+            configError + "\n\nO servidor vai iniciar com a configurao padro.");
+        config = ServerConfig();
+    }
+
+    // Log assncrono: console e arquivo com rotao na pasta de dados do usurio
+    Log::setLevel(config.logLevel);
+    Log::start(config.logFile.isEmpty() ? dataDir + "/gamepadvirtual.log" : config.logFile);
+    Log::installQtMessageHandler();
+
+    MainWindow w(config);
     w.show();
-    return a.exec();
+    const int exitCode = a.exec();
+    Log::stop();
+    return exitCode;
 }
\ No newline at end of file
@@ -1,42 +1,48 @@
 #include "mainwindow.h"
+#include "server_runtime.h"
 #include "gamepaddisplaywidget.h"
 #include "communication/connection_manager.h"
 #include "virtual_gamepad/gamepad_manager.h"
+#include "virtual_gamepad/input_load_generator.h"
+#include "communication/dsu_probe_client.h"
+#include "utils/metrics.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QGridLayout>
 #include <QGroupBox>
 #include <QStatusBar>
 #include <QCloseEvent>
+#include <QShowEvent>
+#include <QHideEvent>
 #include <QDebug>
 #include <QNetworkInterface>
 #include <QPushButton>
 #include <QSpacerItem>
 #include <QMessageBox>
 #include <QComboBox>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QScreen>
+#include <QGuiApplication>
 
-MainWindow::MainWindow(QWidget* parent)
+MainWindow::MainWindow(const ServerConfig& config, QWidget* parent)
     : QMainWindow(parent)
 {
     for (int i = 0; i < MAX_PLAYERS; ++i) {
         m_playerConnectionTypes[i] = "Nenhum";
     }
 
-    m_gamepadManager = new GamepadManager(this);
-    m_connectionManager = new ConnectionManager(m_gamepadManager, this);
+    // Mesma configuração do modo --headless (main lê a linha de comando e o INI)
+    m_runtime = new ServerRuntime(config, this);
+    m_gamepadManager = m_runtime->gamepadManager();
+    m_connectionManager = m_runtime->connectionManager();
 
-    // Conexões de estado do gamepad
-    connect(m_gamepadManager, &GamepadManager::gamepadStateUpdated, this, &MainWindow::onGamepadStateUpdate);
+    // Estado do gamepad: a tela lê um snapshot no ritmo do monitor, em vez de
+    // redesenhar a cada pacote (até 125 Hz x 8 jogadores, mesmo em abas ocultas)
     connect(m_connectionManager, &ConnectionManager::logMessage, this, &MainWindow::onLogMessage);
     connect(m_gamepadManager, &GamepadManager::dsuClientConnected, this, &MainWindow::onDsuClientConnected);
     connect(m_gamepadManager, &GamepadManager::dsuClientDisconnected, this, &MainWindow::onDsuClientDisconnected);
 
-    // Conexões de jogadores - ConnectionManager para GamepadManager
-    connect(m_connectionManager, &ConnectionManager::playerConnected,
-        m_gamepadManager, &GamepadManager::playerConnected);
-    connect(m_connectionManager, &ConnectionManager::playerDisconnected,
-        m_gamepadManager, &GamepadManager::playerDisconnected);
-
     // Conexões de jogadores - ConnectionManager para Interface
     connect(m_connectionManager, &ConnectionManager::playerConnected,
         this, &MainWindow::onPlayerConnected);
@@ -45,9 +51,15 @@ MainWindow::MainWindow(QWidget* parent)
 
     setupUI();
 
-    if (m_gamepadManager->initialize()) {
-        m_connectionManager->startServices();
-    }
+    const QScreen* screen = QGuiApplication::primaryScreen();
+    const qreal refreshRate = screen ? qBound<qreal>(30.0, screen->refreshRate(), 240.0) : 60.0;
+    m_uiRefreshTimer = new QTimer(this);
+    m_uiRefreshTimer->setInterval(qRound(1000.0 / refreshRate));
+    connect(m_uiRefreshTimer, &QTimer::timeout, this, &MainWindow::refreshVisiblePlayer);
+    connect(m_playerTabs, &QTabWidget::currentChanged, this, &MainWindow::refreshVisiblePlayer);
+    // Parado até o primeiro jogador conectar (ver updateRefreshTimer)
+
+    m_runtime->start();
 }
 
 MainWindow::~MainWindow() {}
@@ -86,6 +98,10 @@ QWidget* MainWindow::createConnectionsTab()
     infoLabel->setWordWrap(true);
     infoLabel->setStyleSheet("color: #555;");
 
+    // ICE vem da configuração (ice-lan, stun-server, ice-bind-control no INI)
+    QLabel* iceLabel = new QLabel(QString("Rede do stream: %1").arg(m_runtime->config().streamIce.summary()));
+    iceLabel->setStyleSheet("color: #555;");
+
     // O BOTÃO MESTRE
     QPushButton* toggleStreamBtn = new QPushButton("Ativar Transmissão de Tela");
     toggleStreamBtn->setCheckable(true);
@@ -95,6 +111,13 @@ QWidget* MainWindow::createConnectionsTab()
         "QPushButton:checked { background-color: #F44336; }"
     );
 
+    // streaming=on na configuração: o runtime já liga ao iniciar
+    // (antes do connect: o clique ainda não pode mexer no ConnectionManager)
+    if (m_runtime->config().streaming) {
+        toggleStreamBtn->setChecked(true);
+        toggleStreamBtn->setText("Parar Transmissão");
+    }
+
     // Conexão do Botão
     connect(toggleStreamBtn, &QPushButton::toggled, this, [this, toggleStreamBtn](bool checked) {
         if (checked) {
@@ -108,6 +131,7 @@ QWidget* MainWindow::createConnectionsTab()
         });
 
     streamLayout->addWidget(infoLabel);
+    streamLayout->addWidget(iceLabel);
     streamLayout->addWidget(toggleStreamBtn);
 
     // Adiciona ao topo
@@ -141,11 +165,16 @@ QWidget* MainWindow::createConnectionsTab()
     QLabel* dsuInfo = new QLabel("Fornece dados de movimento para emuladores (ex: Cemu, Yuzu) quando o controle está no modo 'Xbox 360'.");
     dsuInfo->setWordWrap(true);
 
-    m_cemuhookStatusLabel = new QLabel("Status: Inativo. (Aguardando na porta 26760)");
+    m_cemuhookStatusLabel = new QLabel("Status: Inativo. (Aguardando nas portas 26760-26761)");
     m_cemuhookStatusLabel->setStyleSheet("color: #FF9800;");
 
+    m_dsuDiagnosticButton = new QPushButton("Executar diagnóstico DSU");
+    m_dsuDiagnosticButton->setToolTip("Simula um controle e dois emuladores por 5 segundos e mede taxa, jitter e perda.");
+    connect(m_dsuDiagnosticButton, &QPushButton::clicked, this, &MainWindow::onRunDsuDiagnosticClicked);
+
     dsuLayout->addWidget(dsuInfo);
     dsuLayout->addWidget(m_cemuhookStatusLabel);
+    dsuLayout->addWidget(m_dsuDiagnosticButton, 0, Qt::AlignLeft);
 
     mainLayout->addWidget(networkGroup);
     mainLayout->addWidget(btGroup);
@@ -235,10 +264,73 @@ QWidget* MainWindow::createTestTab()
     return mainTabContainer;
 }
 
-void MainWindow::onGamepadStateUpdate(int playerIndex, const GamepadPacket& packet)
+// Só o jogador da aba visível é redesenhado, e só quando o estado mudou
+void MainWindow::refreshVisiblePlayer()
 {
-    if (playerIndex < 0 || playerIndex >= MAX_PLAYERS) return;
+    static CounterStat* ticksCounter = Metrics::instance().counter("ui.refresh_ticks");
+    static CounterStat* framesCounter = Metrics::instance().counter("ui.frames_drawn");
+    static LatencyStat* refreshStat = Metrics::instance().latency("ui.refresh_us");
+
+    ticksCounter->add();
+
+    if (isMinimized()) return;
+    const int playerIndex = m_playerTabs->currentIndex();
+    if (playerIndex < 0 || playerIndex >= MAX_PLAYERS || !m_gamepadDisplays[playerIndex]->isVisible()) return;
+
+    QElapsedTimer clock;
+    clock.start();
+
+    quint32 sequence = 0;
+    const GamepadPacket packet = m_gamepadManager->stateSnapshot(playerIndex, &sequence);
+    if (sequence == m_shownSequence[playerIndex]) return;
+    m_shownSequence[playerIndex] = sequence;
 
+    showPlayerState(playerIndex, packet);
+    framesCounter->add();
+    refreshStat->record(clock.nsecsElapsed() / 1000);
+}
+
+// Sem jogadores, minimizada ou escondida na bandeja a janela não tem o que
+// redesenhar: o timer para e o processo deixa de acordar a cada quadro
+void MainWindow::updateRefreshTimer()
+{
+    if (!m_uiRefreshTimer) return;
+
+    bool anyPlayer = false;
+    for (int i = 0; i < MAX_PLAYERS && !anyPlayer; ++i) {
+        anyPlayer = m_playerConnectionTypes[i] != "Nenhum";
+    }
+
+    const bool wanted = anyPlayer && isVisible() && !isMinimized();
+    if (wanted && !m_uiRefreshTimer->isActive()) {
+        m_uiRefreshTimer->start();
+        refreshVisiblePlayer();
+    }
+    else if (!wanted && m_uiRefreshTimer->isActive()) {
+        m_uiRefreshTimer->stop();
+    }
+}
+
+void MainWindow::changeEvent(QEvent* event)
+{
+    QMainWindow::changeEvent(event);
+    if (event->type() == QEvent::WindowStateChange) updateRefreshTimer();
+}
+
+void MainWindow::showEvent(QShowEvent* event)
+{
+    QMainWindow::showEvent(event);
+    updateRefreshTimer();
+}
+
+void MainWindow::hideEvent(QHideEvent* event)
+{
+    QMainWindow::hideEvent(event);
+    updateRefreshTimer();
+}
+
+void MainWindow::showPlayerState(int playerIndex, const GamepadPacket& packet)
+{
     m_gamepadDisplays[playerIndex]->updateState(packet);
 
     m_gyroLabels[playerIndex]->setText(QString("Gyro Celular: (%1, %2, %3)")
@@ -270,6 +362,7 @@ void MainWindow::onPlayerConnected(int playerIndex, const QString& type)
     }
 
     updateConnectionStatus();
+    updateRefreshTimer();
 }
 
 void MainWindow::onPlayerDisconnected(int playerIndex)
@@ -281,6 +374,8 @@ void MainWindow::onPlayerDisconnected(int playerIndex)
 
     m_sensorWidgetWrappers[playerIndex]->setVisible(true);
     m_gamepadDisplays[playerIndex]->resetState();
+    // O último snapshot é do jogador que saiu: não volta para a tela
+    m_gamepadManager->stateSnapshot(playerIndex, &m_shownSequence[playerIndex]);
 
     m_gyroLabels[playerIndex]->setText("Gyro Celular: (0.00, 0.00, 0.00)");
     m_accelLabels[playerIndex]->setText("Accel Celular: (0.00, 0.00, 0.00)");
@@ -302,16 +397,14 @@ void MainWindow::onPlayerDisconnected(int playerIndex)
     }
 
     updateConnectionStatus();
+    updateRefreshTimer();
 }
 
 void MainWindow::onDisconnectPlayerClicked(int playerIndex)
 {
     if (playerIndex < 0 || playerIndex >= MAX_PLAYERS) return;
 
-    if (m_playerConnectionTypes[playerIndex] != "Nenhum") {
-        const QString& type = m_playerConnectionTypes[playerIndex];
-        m_connectionManager->forceDisconnectPlayer(playerIndex, type);
-    }
+    m_connectionManager->forceDisconnectPlayer(playerIndex);
 }
 
 void MainWindow::updateConnectionStatus()
@@ -330,29 +423,88 @@ void MainWindow::onLogMessage(const QString& message)
     statusBar()->showMessage(message, 5000);
 }
 
-void MainWindow::onDsuClientConnected(const QString& address, quint16 port)
+void MainWindow::onDsuClientConnected(const QString& address, quint16 port, int totalClients)
 {
     if (m_cemuhookStatusLabel) {
-        m_cemuhookStatusLabel->setText(QString("Status: Conectado ao cliente %1:%2").arg(address).arg(port));
+        m_cemuhookStatusLabel->setText(QString("Status: %1 cliente(s) conectado(s) (último: %2:%3)").arg(totalClients).arg(address).arg(port));
         m_cemuhookStatusLabel->setStyleSheet("color: #4CAF50;");
     }
 }
 
-void MainWindow::onDsuClientDisconnected()
+void MainWindow::onDsuClientDisconnected(const QString& address, quint16 port, int totalClients)
 {
-    if (m_cemuhookStatusLabel) {
-        m_cemuhookStatusLabel->setText("Status: Inativo. (Aguardando na porta 26760)");
+    Q_UNUSED(address); Q_UNUSED(port);
+    if (!m_cemuhookStatusLabel) return;
+
+    if (totalClients > 0) {
+        m_cemuhookStatusLabel->setText(QString("Status: %1 cliente(s) conectado(s)").arg(totalClients));
+    }
+    else {
+        m_cemuhookStatusLabel->setText("Status: Inativo. (Aguardando nas portas 26760-26761)");
         m_cemuhookStatusLabel->setStyleSheet("color: #FF9800;");
     }
 }
 
+void MainWindow::onRunDsuDiagnosticClicked()
+{
+    if (m_dsuProbe && m_dsuProbe->isRunning()) return;
+
+    // Reserva o último slot DSU livre para não interferir nos jogadores reais
+    // (enquanto durar o diagnóstico nenhum transporte recebe esse slot)
+    SessionRegistry* sessions = m_connectionManager->sessions();
+    for (int i = DSU_MAX_CONTROLLERS - 1; i >= 0 && m_dsuSession.isNull(); --i) {
+        m_dsuSession = sessions->openAt(i, Session::Synthetic);
+    }
+    if (m_dsuSession.isNull()) {
+        QMessageBox::information(this, "Diagnóstico DSU", "Todos os slots DSU estão ocupados. Desconecte um jogador e tente novamente.");
+        return;
+    }
+
+    if (!m_loadGenerator) {
+        m_loadGenerator = new InputLoadGenerator(this);
+        connect(m_loadGenerator, &InputLoadGenerator::playerConnected, m_gamepadManager, &GamepadManager::playerConnected);
+        connect(m_loadGenerator, &InputLoadGenerator::playerDisconnected, m_gamepadManager, &GamepadManager::playerDisconnected);
+        connect(m_loadGenerator, &InputLoadGenerator::packetReceived, m_gamepadManager, &GamepadManager::onPacketReceived);
+        connect(m_loadGenerator, &InputLoadGenerator::motionSampleReceived, m_gamepadManager, &GamepadManager::onMotionSample);
+    }
+    if (!m_dsuProbe) {
+        m_dsuProbe = new DsuProbeClient(this);
+        connect(m_dsuProbe, &DsuProbeClient::finished, this, &MainWindow::onDsuDiagnosticFinished);
+    }
+
+    const int slot = m_dsuSession.playerIndex;
+    m_dsuDiagnosticButton->setEnabled(false);
+    statusBar()->showMessage(QString("Diagnóstico DSU em andamento (jogador simulado %1)...").arg(slot + 1));
+
+    m_loadGenerator->start(1u << slot, 250, true);
+
+    DsuProbeConfig config;
+    config.subscribers = 2;
+    config.durationMs = 5000;
+    m_dsuProbe->start(config);
+}
+
+void MainWindow::onDsuDiagnosticFinished(const DsuProbeReport& report)
+{
+    if (m_loadGenerator) m_loadGenerator->stop();
+    m_connectionManager->sessions()->close(m_dsuSession);
+    m_dsuSession = SessionHandle();
+    m_dsuDiagnosticButton->setEnabled(true);
+    statusBar()->showMessage(report.passed() ? "Diagnóstico DSU concluído sem falhas." : "Diagnóstico DSU encontrou problemas.", 5000);
+
+    QMessageBox::information(this, "Diagnóstico DSU", report.summary().join("\n"));
+}
+
 void MainWindow::closeEvent(QCloseEvent* event)
 {
     qDebug() << "Fechando a aplicacao...";
 
-    // Desconecta sinais do GamepadManager
-    disconnect(m_gamepadManager, &GamepadManager::gamepadStateUpdated,
-        this, &MainWindow::onGamepadStateUpdate);
+    if (m_dsuProbe) m_dsuProbe->stop();
+    if (m_loadGenerator) m_loadGenerator->stop();
+    m_connectionManager->sessions()->close(m_dsuSession);
+
+    // Para a atualização da tela
+    m_uiRefreshTimer->stop();
 
     // Desconecta sinais do ConnectionManager
     disconnect(m_connectionManager, &ConnectionManager::playerConnected,
@@ -363,7 +515,7 @@ void MainWindow::closeEvent(QCloseEvent* event)
         this, &MainWindow::onLogMessage);
 
     // Para os serviços com segurança
-    m_connectionManager->stopServices();
+    m_runtime->stop();
 
     event->accept();
 }
\ No newline at end of file
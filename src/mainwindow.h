@@ -11,6 +11,13 @@
 #include "gamepaddisplaywidget.h"
 
 class GamepadManager;
+class ServerRuntime;
+struct ServerConfig;
+class InputLoadGenerator;
+class DsuProbeClient;
+struct DsuProbeReport;
+class QPushButton;
+class QTimer;
 
 
 class MainWindow : public QMainWindow
@@ -18,23 +25,28 @@ class MainWindow : public QMainWindow
     Q_OBJECT
 
 public:
-    MainWindow(QWidget* parent = nullptr);
+    MainWindow(const ServerConfig& config, QWidget* parent = nullptr);
     ~MainWindow();
 
 protected:
     void closeEvent(QCloseEvent* event) override;
+    void changeEvent(QEvent* event) override;
+    void showEvent(QShowEvent* event) override;
+    void hideEvent(QHideEvent* event) override;
 
 private slots:
     // Sistema de atualizao de estado
-    void onGamepadStateUpdate(int playerIndex, const GamepadPacket& packet);
+    void refreshVisiblePlayer();
     void onPlayerConnected(int playerIndex, const QString& type);
     void onPlayerDisconnected(int playerIndex);
     void onLogMessage(const QString& message);
     void onDisconnectPlayerClicked(int playerIndex);
 
     // Sistema de status Cemuhook DSU
-    void onDsuClientConnected(const QString& address, quint16 port);
-    void onDsuClientDisconnected();
+    void onDsuClientConnected(const QString& address, quint16 port, int totalClients);
+    void onDsuClientDisconnected(const QString& address, quint16 port, int totalClients);
+    void onRunDsuDiagnosticClicked();
+    void onDsuDiagnosticFinished(const DsuProbeReport& report);
 
 private:
     // Inicializao da interface grfica
@@ -42,14 +54,24 @@ private:
     QWidget* createConnectionsTab();
     QWidget* createTestTab();
     void updateConnectionStatus();
+    void showPlayerState(int playerIndex, const GamepadPacket& packet);
+    // Liga o timer da tela s com jogador conectado e janela visvel
+    void updateRefreshTimer();
 
     // Componentes principais do sistema
+    ServerRuntime* m_runtime;
     GamepadManager* m_gamepadManager;
     ConnectionManager* m_connectionManager;
 
     // Sistema de status e feedback
     QLabel* m_networkStatusLabel;
     QLabel* m_cemuhookStatusLabel;
+    QPushButton* m_dsuDiagnosticButton = nullptr;
+
+    // Diagnstico DSU (entrada sinttica + clientes simulados)
+    InputLoadGenerator* m_loadGenerator = nullptr;
+    DsuProbeClient* m_dsuProbe = nullptr;
+    SessionHandle m_dsuSession;   // Slot reservado para o jogador simulado
 
     // Sistema de exibio dos jogadores
     QTabWidget* m_playerTabs;
@@ -59,6 +81,10 @@ private:
     QWidget* m_sensorWidgetWrappers[MAX_PLAYERS];
     QComboBox* m_controllerTypeSelectors[MAX_PLAYERS];
 
+    // Atualizao da tela no ritmo do monitor, s para o jogador visvel
+    QTimer* m_uiRefreshTimer = nullptr;
+    quint32 m_shownSequence[MAX_PLAYERS] = {};
+
     // Estado interno da aplicao
     QString m_playerConnectionTypes[MAX_PLAYERS];
     bool m_warningShown = false;
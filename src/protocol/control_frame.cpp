@@ -0,0 +1,192 @@
+﻿#include "control_frame.h"
+#include <QtEndian>
+#include <cstring>
+
+static const char LEGACY_JSON_PREFIX[] = "JSON:";
+static constexpr int LEGACY_JSON_PREFIX_SIZE = 5;
+
+void ControlFrame::append(QByteArray& out, quint8 type, const char* payload, int size)
+{
+    const int offset = out.size();
+    out.resize(offset + HEADER_SIZE + size);
+    char* p = out.data() + offset;
+    p[0] = static_cast<char>(MARKER);
+    p[1] = static_cast<char>(type);
+    qToLittleEndian<quint32>(static_cast<quint32>(size), p + 2);
+    if (size > 0) std::memcpy(p + HEADER_SIZE, payload, size);
+}
+
+QByteArray ControlFrame::encode(quint8 type, const QByteArray& payload)
+{
+    QByteArray out;
+    out.reserve(HEADER_SIZE + payload.size());
+    append(out, type, payload.constData(), payload.size());
+    return out;
+}
+
+int ControlFrame::begin(QByteArray& out, quint8 type)
+{
+    const int frameStart = out.size();
+    out.resize(frameStart + HEADER_SIZE);
+    out[frameStart] = static_cast<char>(MARKER);
+    out[frameStart + 1] = static_cast<char>(type);
+    return frameStart;
+}
+
+void ControlFrame::end(QByteArray& out, int frameStart)
+{
+    const quint32 size = static_cast<quint32>(out.size() - frameStart - HEADER_SIZE);
+    qToLittleEndian<quint32>(size, out.data() + frameStart + 2);
+}
+
+qint64 ControlFrameReader::feed(QIODevice* device)
+{
+    const qint64 available = device->bytesAvailable();
+    if (available <= 0) return 0;
+
+    compact();
+    const int offset = m_buffer.size();
+    m_buffer.resize(offset + static_cast<int>(available));
+    const qint64 read = device->read(m_buffer.data() + offset, available);
+    m_buffer.resize(offset + static_cast<int>(qMax<qint64>(0, read)));
+    return qMax<qint64>(0, read);
+}
+
+void ControlFrameReader::feed(const char* data, int size)
+{
+    compact();
+    m_buffer.append(data, size);
+}
+
+void ControlFrameReader::clear()
+{
+    m_buffer.clear();
+    m_readPos = 0;
+    m_scanPos = -1;
+    m_depth = 0;
+    m_inString = m_escape = false;
+}
+
+// Descarta os bytes já consumidos sem liberar a capacidade do buffer
+void ControlFrameReader::compact()
+{
+    if (m_readPos == 0) return;
+
+    if (m_readPos >= m_buffer.size()) {
+        m_buffer.resize(0);
+    }
+    else {
+        m_buffer.remove(0, m_readPos);
+    }
+    if (m_scanPos >= 0) m_scanPos -= m_readPos;
+    m_readPos = 0;
+}
+
+ControlFrameReader::Result ControlFrameReader::next(Frame& frame)
+{
+    while (m_readPos < m_buffer.size()) {
+        const char* p = m_buffer.constData() + m_readPos;
+        const int available = m_buffer.size() - m_readPos;
+        const quint8 first = static_cast<quint8>(p[0]);
+
+        // Formato enquadrado
+        if (first == ControlFrame::MARKER) {
+            if (available < ControlFrame::HEADER_SIZE) return NeedMore;
+
+            const quint32 size = qFromLittleEndian<quint32>(p + 2);
+            if (size > static_cast<quint32>(ControlFrame::MAX_PAYLOAD_SIZE)) return Error;
+            if (available < ControlFrame::HEADER_SIZE + static_cast<int>(size)) return NeedMore;
+
+            frame.type = static_cast<quint8>(p[1]);
+            frame.payload = p + ControlFrame::HEADER_SIZE;
+            frame.size = static_cast<int>(size);
+            frame.legacy = false;
+            m_readPos += ControlFrame::HEADER_SIZE + static_cast<int>(size);
+            m_peerUsesFrames = true;
+            return FrameReady;
+        }
+
+        // Keep-alive legado
+        if (first == ControlFrame::LEGACY_KEEPALIVE) {
+            frame.type = ControlFrame::TYPE_KEEPALIVE;
+            frame.payload = nullptr;
+            frame.size = 0;
+            frame.legacy = true;
+            m_readPos++;
+            return FrameReady;
+        }
+
+        // "JSON:{...}" legado
+        if (first == 'J') {
+            const int prefix = qMin(available, LEGACY_JSON_PREFIX_SIZE);
+            if (std::memcmp(p, LEGACY_JSON_PREFIX, prefix) == 0) {
+                if (available < LEGACY_JSON_PREFIX_SIZE) return NeedMore;
+
+                const int start = m_readPos + LEGACY_JSON_PREFIX_SIZE;
+                int end = 0;
+                if (!scanLegacyJson(start, end)) {
+                    return (available > ControlFrame::MAX_PAYLOAD_SIZE) ? Error : NeedMore;
+                }
+
+                frame.type = ControlFrame::TYPE_JSON;
+                frame.payload = m_buffer.constData() + start;
+                frame.size = end - start;
+                frame.legacy = true;
+                m_readPos = end;
+                return FrameReady;
+            }
+        }
+
+        // Separadores entre mensagens legadas ou lixo: ressincroniza byte a byte
+        m_readPos++;
+    }
+    return NeedMore;
+}
+
+// Procura o fim do valor JSON iniciado em 'start'. A varredura continua de
+// onde parou no feed anterior, então um SDP grande dividido em vários
+// segmentos TCP é percorrido uma única vez.
+bool ControlFrameReader::scanLegacyJson(int start, int& end)
+{
+    int i = (m_scanPos >= start) ? m_scanPos : start;
+    if (i == start) {
+        m_depth = 0;
+        m_inString = m_escape = false;
+    }
+
+    const char* data = m_buffer.constData();
+    const int size = m_buffer.size();
+    for (; i < size; ++i) {
+        const char ch = data[i];
+        if (m_inString) {
+            if (m_escape) m_escape = false;
+            else if (ch == '\\') m_escape = true;
+            else if (ch == '"') m_inString = false;
+            continue;
+        }
+
+        if (ch == '"') {
+            m_inString = true;
+        }
+        else if (ch == '{' || ch == '[') {
+            m_depth++;
+        }
+        else if (ch == '}' || ch == ']') {
+            if (--m_depth <= 0) {
+                end = i + 1;
+                m_scanPos = -1;
+                m_depth = 0;
+                return true;
+            }
+        }
+        else if (m_depth == 0 && ch != ' ' && ch != '\t' && ch != '\r' && ch != '\n') {
+            // Não é um objeto: entrega o que houver até aqui e deixa o JSON inválido para quem trata
+            end = i;
+            m_scanPos = -1;
+            return true;
+        }
+    }
+
+    m_scanPos = i;
+    return false;
+}
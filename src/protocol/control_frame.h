@@ -0,0 +1,76 @@
+#ifndef CONTROL_FRAME_H
+#define CONTROL_FRAME_H
+
+#include <QByteArray>
+#include <QIODevice>
+
+// --- ENQUADRAMENTO DO CANAL DE CONTROLE TCP ---
+// Quadro: [0xFB][u8 tipo][u32 tamanho LE][payload]
+// Clientes antigos mandam "JSON:{...}" sem delimitador e o byte 0x01 como
+// keep-alive; os dois continuam aceitos. O fim do JSON legado é achado
+// contando chaves/colchetes fora de strings, então mensagens coladas ou
+// quebradas pelo TCP também funcionam no formato antigo.
+namespace ControlFrame {
+constexpr quint8 MARKER = 0xFB;
+constexpr int HEADER_SIZE = 6;
+constexpr int MAX_PAYLOAD_SIZE = 1024 * 1024;
+
+// Tipos de quadro
+constexpr quint8 TYPE_JSON = 0x01;       // Objeto JSON compacto (UTF-8)
+constexpr quint8 TYPE_KEEPALIVE = 0x02;  // Sem payload
+constexpr quint8 TYPE_SIGNAL = 0x03;     // Sinalização binária (SignalCodec)
+
+constexpr quint8 LEGACY_KEEPALIVE = 0x01;
+
+// Escreve um quadro completo no fim de 'out' (sem limpar o conteúdo anterior)
+void append(QByteArray& out, quint8 type, const char* payload, int size);
+QByteArray encode(quint8 type, const QByteArray& payload);
+
+// Para payloads escritos direto no buffer: begin() reserva o cabeçalho e
+// devolve sua posição; end() preenche o tamanho do que foi escrito depois dele
+int begin(QByteArray& out, quint8 type);
+void end(QByteArray& out, int frameStart);
+}
+
+// Leitor incremental: acumula os bytes do socket em um buffer reaproveitado e
+// entrega um quadro por chamada de next(). O payload aponta para dentro do
+// buffer e só é válido até o próximo feed(). Não é thread-safe.
+class ControlFrameReader
+{
+public:
+    enum Result { NeedMore, FrameReady, Error };
+
+    struct Frame {
+        quint8 type = 0;
+        const char* payload = nullptr;
+        int size = 0;
+        bool legacy = false;   // Veio como "JSON:" / 0x01
+    };
+
+    // Lê tudo o que está disponível no dispositivo; retorna os bytes lidos
+    qint64 feed(QIODevice* device);
+    void feed(const char* data, int size);
+
+    Result next(Frame& frame);
+
+    // O cliente já usou o formato enquadrado: as respostas também devem usá-lo
+    bool peerUsesFrames() const { return m_peerUsesFrames; }
+    int buffered() const { return m_buffer.size() - m_readPos; }
+    void clear();
+
+private:
+    void compact();
+    bool scanLegacyJson(int start, int& end);
+
+    QByteArray m_buffer;
+    int m_readPos = 0;
+    bool m_peerUsesFrames = false;
+
+    // Estado da varredura do JSON legado (retomada entre feeds)
+    int m_scanPos = -1;
+    int m_depth = 0;
+    bool m_inString = false;
+    bool m_escape = false;
+};
+
+#endif // CONTROL_FRAME_H
@@ -0,0 +1,310 @@
+﻿#include "dsu_encoder.h"
+#include "../utils/crc32.h"
+#include <QElapsedTimer>
+#include <cstring>
+
+// Escrita little-endian independente de alinhamento
+static inline void putLe16(unsigned char* p, uint16_t v)
+{
+    p[0] = static_cast<unsigned char>(v);
+    p[1] = static_cast<unsigned char>(v >> 8);
+}
+
+static inline void putLe32(unsigned char* p, uint32_t v)
+{
+    p[0] = static_cast<unsigned char>(v);
+    p[1] = static_cast<unsigned char>(v >> 8);
+    p[2] = static_cast<unsigned char>(v >> 16);
+    p[3] = static_cast<unsigned char>(v >> 24);
+}
+
+static inline void putLe64(unsigned char* p, uint64_t v)
+{
+    putLe32(p, static_cast<uint32_t>(v));
+    putLe32(p + 4, static_cast<uint32_t>(v >> 32));
+}
+
+static inline void putFloat(unsigned char* p, float v)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    putLe32(p, bits);
+}
+
+static inline unsigned char fullIf(uint16_t buttons, uint16_t mask)
+{
+    return (buttons & mask) ? 255 : 0;
+}
+
+DsuEncoder::DsuEncoder(uint32_t serverId, int firstPlayer)
+    : m_serverId(serverId), m_firstPlayer(firstPlayer)
+{
+    // Byte 36: Left, Down, Right, Up, Options(Start), R3, L3, Share(Select)
+    for (int low = 0; low < 256; ++low) {
+        uint8_t bits = 0;
+        if (low & DPAD_LEFT)  bits |= (1 << 7);
+        if (low & DPAD_DOWN)  bits |= (1 << 6);
+        if (low & DPAD_RIGHT) bits |= (1 << 5);
+        if (low & DPAD_UP)    bits |= (1 << 4);
+        if (low & START)      bits |= (1 << 3);
+        if (low & R3)         bits |= (1 << 2);
+        if (low & L3)         bits |= (1 << 1);
+        if (low & SELECT)     bits |= (1 << 0);
+        m_dpadSystemBits[low] = bits;
+    }
+
+    for (int slot = 0; slot < DSU_MAX_CONTROLLERS; ++slot) {
+        std::memset(m_padData[slot], 0, Dsu::DATA_PACKET_SIZE);
+        writeHeader(m_padData[slot], Dsu::DATA_PACKET_SIZE, Dsu::MSG_PAD_DATA);
+        writeSlotInfo(m_padData[slot], slot, true);
+        m_padData[slot][31] = 1;  // Controle ativo
+
+        std::memset(m_infoConnected[slot], 0, Dsu::INFO_PACKET_SIZE);
+        writeHeader(m_infoConnected[slot], Dsu::INFO_PACKET_SIZE, Dsu::MSG_PORT_INFO);
+        writeSlotInfo(m_infoConnected[slot], slot, true);
+        sealCrc(m_infoConnected[slot], Dsu::INFO_PACKET_SIZE);
+
+        std::memset(m_infoDisconnected[slot], 0, Dsu::INFO_PACKET_SIZE);
+        writeHeader(m_infoDisconnected[slot], Dsu::INFO_PACKET_SIZE, Dsu::MSG_PORT_INFO);
+        writeSlotInfo(m_infoDisconnected[slot], slot, false);
+        sealCrc(m_infoDisconnected[slot], Dsu::INFO_PACKET_SIZE);
+    }
+
+    std::memset(m_version, 0, Dsu::VERSION_PACKET_SIZE);
+    writeHeader(m_version, Dsu::VERSION_PACKET_SIZE, Dsu::MSG_VERSION);
+    putLe16(m_version + 20, Dsu::PROTOCOL_VERSION);
+    sealCrc(m_version, Dsu::VERSION_PACKET_SIZE);
+}
+
+void DsuEncoder::writeHeader(unsigned char* p, int size, uint32_t messageType) const
+{
+    p[0] = 'D'; p[1] = 'S'; p[2] = 'U'; p[3] = 'S';
+    putLe16(p + 4, Dsu::PROTOCOL_VERSION);
+    putLe16(p + 6, static_cast<uint16_t>(size - 16));  // Tamanho sem o cabeçalho de 16 bytes
+    putLe32(p + 8, 0);                                  // CRC
+    putLe32(p + 12, m_serverId);
+    putLe32(p + 16, messageType);
+}
+
+// Bytes 20-30 compartilhados por 0x100001 e 0x100002
+void DsuEncoder::writeSlotInfo(unsigned char* p, int slot, bool connected) const
+{
+    p[20] = static_cast<unsigned char>(slot);
+    if (!connected) return;
+
+    p[21] = 2;  // Estado: conectado
+    p[22] = 2;  // Modelo: DS4 completo (giroscópio)
+    p[23] = 1;  // Conexão: USB
+    p[24] = 0xAA; p[25] = 0xBB; p[26] = 0xCC;
+    p[27] = 0xDD; p[28] = 0xEE; p[29] = static_cast<unsigned char>(0xFF + m_firstPlayer + slot);
+    p[30] = 5;  // Bateria: cheia
+}
+
+void DsuEncoder::sealCrc(unsigned char* p, int size)
+{
+    putLe32(p + 8, 0);
+    putLe32(p + 8, Crc32::compute(p, static_cast<size_t>(size)));
+}
+
+const char* DsuEncoder::encodePadData(int slot, const GamepadPacket& packet, uint32_t counter, uint64_t timestampUs)
+{
+    unsigned char* p = m_padData[slot];
+    const uint16_t buttons = packet.buttons;
+
+    putLe32(p + 32, counter);
+
+    // Byte 36 (D-Pad digital + sistema) e 37 (apenas L2/R2 digitais; os botões
+    // de ação vão só pelos bytes analógicos, como antes)
+    p[36] = m_dpadSystemBits[buttons & 0xFF];
+    p[37] = static_cast<unsigned char>((packet.rightTrigger > 20 ? (1 << 1) : 0) | (packet.leftTrigger > 20 ? (1 << 0) : 0));
+
+    // Bytes 40-43: analógicos (-128..127 -> 0..255)
+    p[40] = static_cast<unsigned char>(packet.leftStickX + 128);
+    p[41] = static_cast<unsigned char>(packet.leftStickY + 128);
+    p[42] = static_cast<unsigned char>(packet.rightStickX + 128);
+    p[43] = static_cast<unsigned char>(packet.rightStickY + 128);
+
+    // Bytes 44-53: D-Pad e botões analógicos
+    p[44] = fullIf(buttons, DPAD_LEFT);
+    p[45] = fullIf(buttons, DPAD_DOWN);
+    p[46] = fullIf(buttons, DPAD_RIGHT);
+    p[47] = fullIf(buttons, DPAD_UP);
+    p[48] = fullIf(buttons, X);   // Square
+    p[49] = fullIf(buttons, A);   // Cross
+    p[50] = fullIf(buttons, B);   // Circle
+    p[51] = fullIf(buttons, Y);   // Triangle
+    p[52] = fullIf(buttons, R1);
+    p[53] = fullIf(buttons, L1);
+
+    // Bytes 54-55: gatilhos analógicos
+    p[54] = packet.rightTrigger;
+    p[55] = packet.leftTrigger;
+
+    // Timestamp e sensores
+    const float accelDivisor = 4096.0f;
+    const float gyroDivisor = 100.0f;
+    putLe64(p + 68, timestampUs);
+    putFloat(p + 76, packet.accelX / accelDivisor);
+    putFloat(p + 80, packet.accelY / accelDivisor);
+    putFloat(p + 84, packet.accelZ / accelDivisor);
+    putFloat(p + 88, packet.gyroX / gyroDivisor);
+    putFloat(p + 92, packet.gyroY / gyroDivisor);
+    putFloat(p + 96, packet.gyroZ / gyroDivisor);
+
+    sealCrc(p, Dsu::DATA_PACKET_SIZE);
+    return reinterpret_cast<const char*>(p);
+}
+
+const char* DsuEncoder::portInfo(int slot, bool connected) const
+{
+    return reinterpret_cast<const char*>(connected ? m_infoConnected[slot] : m_infoDisconnected[slot]);
+}
+
+const char* DsuEncoder::versionReply() const
+{
+    return reinterpret_cast<const char*>(m_version);
+}
+
+// --- BENCHMARK ---
+
+namespace {
+
+// Caminho de antes do DsuEncoder: 100 bytes alocados e zerados por pacote,
+// cabeçalho e corpo inteiros reescritos e CRC bit a bit
+uint32_t encodeLegacy(int slot, const GamepadPacket& packet, uint32_t counter, uint64_t timestampUs)
+{
+    unsigned char* p = new unsigned char[Dsu::DATA_PACKET_SIZE];
+    std::memset(p, 0, Dsu::DATA_PACKET_SIZE);
+
+    p[0] = 'D'; p[1] = 'S'; p[2] = 'U'; p[3] = 'S';
+    putLe16(p + 4, Dsu::PROTOCOL_VERSION);
+    putLe16(p + 6, Dsu::DATA_PACKET_SIZE - 16);
+    putLe32(p + 12, 0);
+    putLe32(p + 16, Dsu::MSG_PAD_DATA);
+    p[20] = static_cast<unsigned char>(slot);
+    p[21] = 2; p[22] = 2; p[23] = 1;
+    p[24] = 0xAA; p[25] = 0xBB; p[26] = 0xCC;
+    p[27] = 0xDD; p[28] = 0xEE; p[29] = static_cast<unsigned char>(0xFF + slot);
+    p[30] = 5; p[31] = 0;
+    putLe32(p + 32, counter);
+
+    const uint16_t buttons = packet.buttons;
+    uint8_t buttons1 = 0;
+    if (buttons & DPAD_LEFT)  buttons1 |= (1 << 7);
+    if (buttons & DPAD_DOWN)  buttons1 |= (1 << 6);
+    if (buttons & DPAD_RIGHT) buttons1 |= (1 << 5);
+    if (buttons & DPAD_UP)    buttons1 |= (1 << 4);
+    if (buttons & START)      buttons1 |= (1 << 3);
+    if (buttons & R3)         buttons1 |= (1 << 2);
+    if (buttons & L3)         buttons1 |= (1 << 1);
+    if (buttons & SELECT)     buttons1 |= (1 << 0);
+    p[36] = buttons1;
+    p[37] = static_cast<unsigned char>((packet.rightTrigger > 20 ? (1 << 1) : 0) | (packet.leftTrigger > 20 ? (1 << 0) : 0));
+
+    p[40] = static_cast<unsigned char>(packet.leftStickX + 128);
+    p[41] = static_cast<unsigned char>(packet.leftStickY + 128);
+    p[42] = static_cast<unsigned char>(packet.rightStickX + 128);
+    p[43] = static_cast<unsigned char>(packet.rightStickY + 128);
+    p[44] = fullIf(buttons, DPAD_LEFT);
+    p[45] = fullIf(buttons, DPAD_DOWN);
+    p[46] = fullIf(buttons, DPAD_RIGHT);
+    p[47] = fullIf(buttons, DPAD_UP);
+    p[48] = fullIf(buttons, X);
+    p[49] = fullIf(buttons, A);
+    p[50] = fullIf(buttons, B);
+    p[51] = fullIf(buttons, Y);
+    p[52] = fullIf(buttons, R1);
+    p[53] = fullIf(buttons, L1);
+    p[54] = packet.rightTrigger;
+    p[55] = packet.leftTrigger;
+
+    putLe64(p + 68, timestampUs);
+    putFloat(p + 76, packet.accelX / 4096.0f);
+    putFloat(p + 80, packet.accelY / 4096.0f);
+    putFloat(p + 84, packet.accelZ / 4096.0f);
+    putFloat(p + 88, packet.gyroX / 100.0f);
+    putFloat(p + 92, packet.gyroY / 100.0f);
+    putFloat(p + 96, packet.gyroZ / 100.0f);
+
+    putLe32(p + 8, 0);
+    const uint32_t crc = Crc32::computeBitwise(p, Dsu::DATA_PACKET_SIZE);
+    putLe32(p + 8, crc);
+    delete[] p;
+    return crc;
+}
+
+} // namespace
+
+QStringList DsuEncoder::runBenchmark(int packets)
+{
+    packets = packets > 0 ? packets : 1;
+
+    // Estado sintético variando a cada pacote (analógicos, botões e sensores)
+    auto stateFor = [](int i) {
+        GamepadPacket packet = {};
+        packet.buttons = static_cast<uint16_t>(i * 2654435761u >> 16);
+        packet.leftStickX = static_cast<int8_t>(i);
+        packet.leftStickY = static_cast<int8_t>(i >> 3);
+        packet.rightTrigger = static_cast<uint8_t>(i >> 1);
+        packet.accelX = static_cast<int16_t>(i * 7);
+        packet.gyroZ = static_cast<int16_t>(i * 13);
+        return packet;
+    };
+
+    DsuEncoder encoder;
+    QElapsedTimer timer;
+    uint32_t sink = 0;
+
+    // Mesmo conteúdo nos dois caminhos, exceto o byte 31 (controle ativo)
+    {
+        const GamepadPacket packet = stateFor(12345);
+        const uint32_t legacyCrc = encodeLegacy(0, packet, 7, 1000);
+        const unsigned char* current = reinterpret_cast<const unsigned char*>(encoder.encodePadData(0, packet, 7, 1000));
+        unsigned char copy[Dsu::DATA_PACKET_SIZE];
+        std::memcpy(copy, current, sizeof(copy));
+        copy[31] = 0;
+        putLe32(copy + 8, 0);
+        sink ^= legacyCrc ^ Crc32::computeBitwise(copy, sizeof(copy));
+    }
+    const bool sameBytes = sink == 0;
+
+    timer.start();
+    for (int i = 0; i < packets; ++i) {
+        sink += encodeLegacy(i & 3, stateFor(i), uint32_t(i), uint64_t(i) * 4000);
+    }
+    const double legacyNs = double(timer.nsecsElapsed()) / packets;
+
+    timer.restart();
+    for (int i = 0; i < packets; ++i) {
+        const char* data = encoder.encodePadData(i & 3, stateFor(i), uint32_t(i), uint64_t(i) * 4000);
+        sink += static_cast<unsigned char>(data[8]);
+    }
+    const double encoderNs = double(timer.nsecsElapsed()) / packets;
+
+    unsigned char block[Dsu::DATA_PACKET_SIZE];
+    std::memcpy(block, encoder.encodePadData(0, stateFor(1), 1, 1), sizeof(block));
+    timer.restart();
+    for (int i = 0; i < packets; ++i) {
+        block[32] = static_cast<unsigned char>(i);
+        sink += Crc32::computeBitwise(block, sizeof(block));
+    }
+    const double bitwiseCrcNs = double(timer.nsecsElapsed()) / packets;
+
+    timer.restart();
+    for (int i = 0; i < packets; ++i) {
+        block[32] = static_cast<unsigned char>(i);
+        sink += Crc32::compute(block, sizeof(block));
+    }
+    const double crcNs = double(timer.nsecsElapsed()) / packets;
+
+    QStringList lines;
+    lines << QString("DSU 0x100002: %1 pacotes de %2 bytes (CRC %3)")
+        .arg(packets).arg(Dsu::DATA_PACKET_SIZE).arg(QLatin1String(Crc32::implementationName()));
+    lines << QString("  antigo (heap + CRC bit a bit): %1 ns/pacote").arg(legacyNs, 0, 'f', 1);
+    lines << QString("  DsuEncoder:                    %1 ns/pacote").arg(encoderNs, 0, 'f', 1);
+    lines << QString("  só o CRC: bit a bit %1 ns, %2 %3 ns")
+        .arg(bitwiseCrcNs, 0, 'f', 1).arg(QLatin1String(Crc32::implementationName())).arg(crcNs, 0, 'f', 1);
+    lines << QString("  mesmos bytes do caminho antigo (fora o byte 31): %1 (soma %2)")
+        .arg(sameBytes ? "sim" : "NÃO").arg(sink & 0xFF);
+    return lines;
+}
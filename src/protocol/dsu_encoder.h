@@ -0,0 +1,62 @@
+#ifndef DSU_ENCODER_H
+#define DSU_ENCODER_H
+
+#include <cstdint>
+#include <QStringList>
+#include "gamepad_packet.h"
+#include "../controller_types.h"
+
+// Constantes do protocolo DSU (Cemuhook)
+namespace Dsu {
+constexpr uint16_t PROTOCOL_VERSION = 1001;
+
+constexpr uint32_t MSG_VERSION = 0x100000;
+constexpr uint32_t MSG_PORT_INFO = 0x100001;
+constexpr uint32_t MSG_PAD_DATA = 0x100002;
+
+// Cabeçalho (16 bytes) + tipo da mensagem (4 bytes)
+constexpr int HEADER_SIZE = 20;
+constexpr int VERSION_PACKET_SIZE = 22;
+constexpr int INFO_PACKET_SIZE = 32;
+constexpr int DATA_PACKET_SIZE = 100;
+}
+
+// --- ENCODER DSU SEM ALOCAÇÃO ---
+// Cada slot tem um pacote 0x100002 pré-montado: cabeçalho, MAC, modelo e
+// bateria são escritos uma única vez no construtor, e a cada envio só os
+// campos variáveis (contador, botões, eixos, timestamp e sensores) são
+// sobrescritos antes do CRC. As respostas de versão/informação são
+// totalmente estáticas e já saem com o CRC calculado.
+// Os ponteiros retornados continuam válidos até a próxima chamada do mesmo slot.
+// 'firstPlayer' é o jogador exposto no slot 0 (portas extras servem 4..7),
+// usado para que cada jogador tenha um MAC distinto.
+class DsuEncoder
+{
+public:
+    explicit DsuEncoder(uint32_t serverId = 0, int firstPlayer = 0);
+
+    const char* encodePadData(int slot, const GamepadPacket& packet, uint32_t counter, uint64_t timestampUs);
+    const char* portInfo(int slot, bool connected) const;
+    const char* versionReply() const;
+
+    // --bench-dsu: ns por pacote do caminho antigo (buffer no heap, pacote
+    // inteiro reescrito, CRC bit a bit via Crc32::computeBitwise) contra o
+    // encodePadData, e o CRC sozinho nas duas implementações
+    static QStringList runBenchmark(int packets);
+
+private:
+    void writeHeader(unsigned char* p, int size, uint32_t messageType) const;
+    void writeSlotInfo(unsigned char* p, int slot, bool connected) const;
+    static void sealCrc(unsigned char* p, int size);
+
+    uint32_t m_serverId;
+    int m_firstPlayer;
+    uint8_t m_dpadSystemBits[256];  // Byte baixo de GamepadPacket::buttons -> byte 36 do DSU
+
+    alignas(16) unsigned char m_padData[DSU_MAX_CONTROLLERS][Dsu::DATA_PACKET_SIZE];
+    unsigned char m_infoConnected[DSU_MAX_CONTROLLERS][Dsu::INFO_PACKET_SIZE];
+    unsigned char m_infoDisconnected[DSU_MAX_CONTROLLERS][Dsu::INFO_PACKET_SIZE];
+    unsigned char m_version[Dsu::VERSION_PACKET_SIZE];
+};
+
+#endif // DSU_ENCODER_H
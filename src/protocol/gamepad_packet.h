@@ -32,6 +32,31 @@ struct GamepadPacket {
     int16_t accelZ;
 };
 
+// Pacote de gamepad com o relógio do sensor (24 bytes total).
+// O timestamp vem do relógio do sensor do celular (µs, dá a volta em ~71 min)
+// e permite que o DSU integre o giroscópio pelos intervalos reais de amostragem.
+struct TimedGamepadPacket {
+    GamepadPacket state;
+    uint32_t sensorTimestampUs;
+};
+
+// Amostra de movimento na taxa nativa do sensor (16 bytes)
+struct MotionSample {
+    uint32_t sensorTimestampUs;
+    int16_t gyroX;
+    int16_t gyroY;
+    int16_t gyroZ;
+    int16_t accelX;
+    int16_t accelY;
+    int16_t accelZ;
+};
+
+// Lote de amostras de movimento (2 + 16 * count bytes):
+// [0x03][count][MotionSample x count]
+constexpr uint8_t MOTION_BATCH_TYPE = 0x03;
+constexpr int MOTION_BATCH_HEADER_SIZE = 2;
+constexpr int MOTION_BATCH_MAX_SAMPLES = 32;
+
 #pragma pack(pop)
 
 // Enumeração dos botões do gamepad com máscaras de bit
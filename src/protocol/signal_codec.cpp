@@ -0,0 +1,284 @@
+﻿#include "signal_codec.h"
+#include <QJsonDocument>
+#include <QElapsedTimer>
+#include <QVector>
+#include <cstring>
+
+namespace {
+
+// Chaves dos campos. Bit 0x40: o valor é uma sequência de bytes
+constexpr quint8 KEY_MLINE_INDEX = 0x01;
+constexpr quint8 KEY_ENABLED = 0x02;
+constexpr quint8 KEY_SCREEN_WIDTH = 0x03;
+constexpr quint8 KEY_SCREEN_HEIGHT = 0x04;
+constexpr quint8 KEY_SDP = 0x41;
+constexpr quint8 KEY_CANDIDATE = 0x42;
+constexpr quint8 KEY_SDP_MID = 0x43;
+constexpr quint8 KEY_TEXT = 0x44;
+constexpr quint8 KEY_BYTES_FLAG = 0x40;
+
+inline char* writeVarint(char* p, quint32 value)
+{
+    while (value >= 0x80) {
+        *p++ = static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    *p++ = static_cast<char>(value);
+    return p;
+}
+
+inline bool readVarint(const char*& p, const char* end, quint32& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 35 && p < end; shift += 7) {
+        const quint8 byte = static_cast<quint8>(*p++);
+        value |= static_cast<quint32>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+inline char* writeBytes(char* p, quint8 key, const QByteArray& bytes)
+{
+    *p++ = static_cast<char>(key);
+    p = writeVarint(p, static_cast<quint32>(bytes.size()));
+    std::memcpy(p, bytes.constData(), bytes.size());
+    return p + bytes.size();
+}
+
+struct TypeName {
+    Signal::Type type;
+    const char* name;
+};
+
+const TypeName TYPE_NAMES[] = {
+    { Signal::RequestStream, "request_stream" },
+    { Signal::WebrtcOffer, "webrtc_offer" },
+    { Signal::WebrtcAnswer, "webrtc_answer" },
+    { Signal::WebrtcCandidate, "webrtc_candidate" },
+    { Signal::StreamError, "stream_error" },
+    { Signal::ToggleStreamMaster, "toggle_stream_master" },
+};
+
+}
+
+const char* SignalCodec::typeName(Signal::Type type)
+{
+    for (const TypeName& entry : TYPE_NAMES) {
+        if (entry.type == type) return entry.name;
+    }
+    return "unknown";
+}
+
+void SignalCodec::encodeBinary(const SignalMessage& message, QByteArray& out)
+{
+    // Pior caso: 2 bytes de cabeçalho, 4 campos de bytes e 4 inteiros (chave + varint de 5 bytes)
+    const int maxSize = 2 + 4 * 6 + 4 * 6
+        + message.sdp.size() + message.candidate.size() + message.sdpMid.size() + message.text.size();
+    const int offset = out.size();
+    out.resize(offset + maxSize);
+
+    char* const begin = out.data() + offset;
+    char* p = begin;
+    *p++ = static_cast<char>(VERSION);
+    *p++ = static_cast<char>(message.type);
+
+    switch (message.type) {
+    case Signal::RequestStream:
+        if (message.screenWidth > 0 && message.screenHeight > 0) {
+            *p++ = static_cast<char>(KEY_SCREEN_WIDTH);
+            p = writeVarint(p, static_cast<quint32>(message.screenWidth));
+            *p++ = static_cast<char>(KEY_SCREEN_HEIGHT);
+            p = writeVarint(p, static_cast<quint32>(message.screenHeight));
+        }
+        break;
+    case Signal::WebrtcOffer:
+    case Signal::WebrtcAnswer:
+        p = writeBytes(p, KEY_SDP, message.sdp);
+        break;
+    case Signal::WebrtcCandidate:
+        p = writeBytes(p, KEY_CANDIDATE, message.candidate);
+        if (!message.sdpMid.isEmpty()) p = writeBytes(p, KEY_SDP_MID, message.sdpMid);
+        *p++ = static_cast<char>(KEY_MLINE_INDEX);
+        p = writeVarint(p, static_cast<quint32>(message.mlineIndex));
+        break;
+    case Signal::StreamError:
+        p = writeBytes(p, KEY_TEXT, message.text);
+        break;
+    case Signal::ToggleStreamMaster:
+        *p++ = static_cast<char>(KEY_ENABLED);
+        p = writeVarint(p, message.enabled ? 1 : 0);
+        break;
+    default:
+        break;
+    }
+
+    out.resize(offset + static_cast<int>(p - begin));
+}
+
+bool SignalCodec::decodeBinary(const char* data, int size, SignalMessage& message)
+{
+    if (size < 2 || static_cast<quint8>(data[0]) != VERSION) return false;
+
+    message = SignalMessage();
+    message.type = static_cast<Signal::Type>(static_cast<quint8>(data[1]));
+
+    const char* p = data + 2;
+    const char* const end = data + size;
+    while (p < end) {
+        const quint8 key = static_cast<quint8>(*p++);
+        quint32 value = 0;
+        if (!readVarint(p, end, value)) return false;
+
+        if (!(key & KEY_BYTES_FLAG)) {
+            if (key == KEY_MLINE_INDEX) message.mlineIndex = static_cast<int>(value);
+            else if (key == KEY_ENABLED) message.enabled = (value != 0);
+            else if (key == KEY_SCREEN_WIDTH) message.screenWidth = static_cast<int>(qMin<quint32>(value, 16384));
+            else if (key == KEY_SCREEN_HEIGHT) message.screenHeight = static_cast<int>(qMin<quint32>(value, 16384));
+            continue;
+        }
+
+        if (value > static_cast<quint32>(end - p)) return false;
+        const int length = static_cast<int>(value);
+        switch (key) {
+        case KEY_SDP: message.sdp = QByteArray(p, length); break;
+        case KEY_CANDIDATE: message.candidate = QByteArray(p, length); break;
+        case KEY_SDP_MID: message.sdpMid = QByteArray(p, length); break;
+        case KEY_TEXT: message.text = QByteArray(p, length); break;
+        default: break;
+        }
+        p += length;
+    }
+    return true;
+}
+
+QJsonObject SignalCodec::toJson(const SignalMessage& message)
+{
+    QJsonObject json;
+    json["type"] = QLatin1String(typeName(message.type));
+
+    switch (message.type) {
+    case Signal::RequestStream:
+        if (message.screenWidth > 0 && message.screenHeight > 0) {
+            json["screenWidth"] = message.screenWidth;
+            json["screenHeight"] = message.screenHeight;
+        }
+        break;
+    case Signal::WebrtcOffer:
+    case Signal::WebrtcAnswer:
+        json["sdp"] = QString::fromUtf8(message.sdp);
+        break;
+    case Signal::WebrtcCandidate:
+        json["candidate"] = QString::fromUtf8(message.candidate);
+        json["sdpMLineIndex"] = message.mlineIndex;
+        json["sdpMid"] = QString::fromUtf8(message.sdpMid);
+        break;
+    case Signal::StreamError:
+        json["message"] = QString::fromUtf8(message.text);
+        break;
+    case Signal::ToggleStreamMaster:
+        json["enabled"] = message.enabled;
+        break;
+    default:
+        break;
+    }
+    return json;
+}
+
+bool SignalCodec::fromJson(const QJsonObject& json, SignalMessage& message)
+{
+    message = SignalMessage();
+
+    const QString type = json["type"].toString();
+    for (const TypeName& entry : TYPE_NAMES) {
+        if (type == QLatin1String(entry.name)) {
+            message.type = entry.type;
+            break;
+        }
+    }
+    if (message.type == Signal::Unknown) return false;
+
+    message.sdp = json["sdp"].toString().toUtf8();
+    message.candidate = json["candidate"].toString().toUtf8();
+    message.sdpMid = json["sdpMid"].toString().toUtf8();
+    message.mlineIndex = json["sdpMLineIndex"].toInt();
+    message.text = json["message"].toString().toUtf8();
+    message.enabled = json["enabled"].toBool();
+    message.screenWidth = qBound(0, json["screenWidth"].toInt(), 16384);
+    message.screenHeight = qBound(0, json["screenHeight"].toInt(), 16384);
+    return true;
+}
+
+// --- BENCHMARK ---
+
+QStringList SignalCodec::runBenchmark(int iterations)
+{
+    // Uma entrada típica: pedido, oferta (~2.5 KB), resposta e 8 candidatos
+    QByteArray sdp = "v=0\r\no=- 4611731400430051336 2 IN IP4 127.0.0.1\r\ns=-\r\nt=0 0\r\n";
+    while (sdp.size() < 2500) {
+        sdp += "a=candidate:1 1 UDP 2013266431 192.168.0.10 50000 typ host\r\n"
+            "a=rtpmap:96 H264/90000\r\na=fmtp:96 packetization-mode=1;profile-level-id=42e01f\r\n";
+    }
+
+    QVector<SignalMessage> join;
+    SignalMessage message;
+    message.type = Signal::RequestStream;
+    join.append(message);
+    message.type = Signal::WebrtcOffer;
+    message.sdp = sdp;
+    join.append(message);
+    message.type = Signal::WebrtcAnswer;
+    join.append(message);
+    message = SignalMessage();
+    message.type = Signal::WebrtcCandidate;
+    message.sdpMid = "video0";
+    for (int i = 0; i < 8; ++i) {
+        message.candidate = "candidate:" + QByteArray::number(i) + " 1 UDP 2122260223 192.168.0." +
+            QByteArray::number(10 + i) + " " + QByteArray::number(50000 + i) + " typ host generation 0";
+        message.mlineIndex = i % 2;
+        join.append(message);
+    }
+
+    iterations = qMax(1, iterations);
+    QElapsedTimer timer;
+    qint64 jsonBytes = 0;
+    qint64 binaryBytes = 0;
+    int checksum = 0;
+
+    timer.start();
+    for (int it = 0; it < iterations; ++it) {
+        for (const SignalMessage& m : join) {
+            const QByteArray encoded = QJsonDocument(toJson(m)).toJson(QJsonDocument::Compact);
+            jsonBytes += encoded.size();
+            SignalMessage decoded;
+            fromJson(QJsonDocument::fromJson(encoded).object(), decoded);
+            checksum += decoded.sdp.size() + decoded.candidate.size();
+        }
+    }
+    const qint64 jsonNs = timer.nsecsElapsed();
+
+    QByteArray buffer;
+    timer.restart();
+    for (int it = 0; it < iterations; ++it) {
+        for (const SignalMessage& m : join) {
+            buffer.resize(0);
+            encodeBinary(m, buffer);
+            binaryBytes += buffer.size();
+            SignalMessage decoded;
+            decodeBinary(buffer.constData(), buffer.size(), decoded);
+            checksum -= decoded.sdp.size() + decoded.candidate.size();
+        }
+    }
+    const qint64 binaryNs = timer.nsecsElapsed();
+
+    const double joins = iterations;
+    QStringList report;
+    report << QString("Sinalização: %1 entradas de %2 mensagens (ida e volta: codificar + decodificar)")
+        .arg(iterations).arg(join.size());
+    report << QString("  JSON:    %1 us/entrada, %2 bytes/entrada")
+        .arg(jsonNs / joins / 1000.0, 0, 'f', 1).arg(jsonBytes / iterations);
+    report << QString("  binário: %1 us/entrada, %2 bytes/entrada")
+        .arg(binaryNs / joins / 1000.0, 0, 'f', 1).arg(binaryBytes / iterations);
+    if (checksum != 0) report << "  AVISO: os dois formatos decodificaram conteúdos diferentes";
+    return report;
+}
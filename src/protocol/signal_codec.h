@@ -0,0 +1,60 @@
+#ifndef SIGNAL_CODEC_H
+#define SIGNAL_CODEC_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QMetaType>
+#include <QStringList>
+
+// Mensagens de sinalização do stream e de controle do sistema.
+// Os textos (SDP, candidatos) ficam em UTF-8 do começo ao fim: saem do
+// GStreamer como gchar* e voltam para ele sem passar por QString.
+namespace Signal {
+enum Type : quint8 {
+    Unknown = 0,
+    RequestStream = 1,
+    WebrtcOffer = 2,
+    WebrtcAnswer = 3,
+    WebrtcCandidate = 4,
+    StreamError = 5,
+    ToggleStreamMaster = 6,
+};
+}
+
+struct SignalMessage {
+    Signal::Type type = Signal::Unknown;
+    QByteArray sdp;          // Offer/answer
+    QByteArray candidate;    // Candidato ICE
+    QByteArray sdpMid;
+    int mlineIndex = 0;
+    QByteArray text;         // Mensagem de erro
+    bool enabled = false;    // toggle_stream_master
+    int screenWidth = 0;     // request_stream: tela do cliente (0 = não informada)
+    int screenHeight = 0;
+};
+Q_DECLARE_METATYPE(SignalMessage)
+
+// --- CODIFICAÇÃO BINÁRIA (quadro ControlFrame::TYPE_SIGNAL) ---
+// [u8 versão][u8 tipo] seguido de campos [u8 chave][varint valor]; chaves com
+// o bit 0x40 levam bytes: [u8 chave][varint tamanho][bytes]. Chaves
+// desconhecidas são puladas, então campos novos não quebram clientes antigos.
+// O JSON ("JSON:" ou ControlFrame::TYPE_JSON) continua aceito como alternativa.
+namespace SignalCodec {
+constexpr quint8 VERSION = 1;
+
+// Acrescenta a mensagem codificada ao fim de 'out'
+void encodeBinary(const SignalMessage& message, QByteArray& out);
+bool decodeBinary(const char* data, int size, SignalMessage& message);
+
+// Formato legado
+QJsonObject toJson(const SignalMessage& message);
+bool fromJson(const QJsonObject& json, SignalMessage& message);
+
+const char* typeName(Signal::Type type);
+
+// Codifica/decodifica 'iterations' vezes uma entrada típica de stream
+// (oferta, resposta e candidatos) nos dois formatos e retorna o relatório
+QStringList runBenchmark(int iterations);
+}
+
+#endif // SIGNAL_CODEC_H
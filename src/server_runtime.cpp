@@ -0,0 +1,655 @@
+﻿#include "server_runtime.h"
+#include "communication/connection_manager.h"
+#include "virtual_gamepad/controller_backend.h"
+#include "virtual_gamepad/recording_backend.h"
+#include "virtual_gamepad/input_load_generator.h"
+#include "virtual_gamepad/null_backend.h"
+#include "virtual_gamepad/controller_pool.h"
+#include "communication/loopback_transport.h"
+#include "communication/dsu_probe_client.h"
+#include "utils/metrics.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QSettings>
+#include <QFileInfo>
+#include <QFile>
+#include <QJsonDocument>
+#include <QTextStream>
+#include <QTimer>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QMetaObject>
+#ifdef Q_OS_WIN
+#include <Windows.h>
+#else
+#include <QSocketNotifier>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// ============================================================================
+// CONFIGURAÇÃO
+// ============================================================================
+
+namespace {
+
+bool parseBool(const QString& value, bool& out)
+{
+    const QString v = value.trimmed().toLower();
+    if (v == "1" || v == "true" || v == "on" || v == "yes") { out = true; return true; }
+    if (v == "0" || v == "false" || v == "off" || v == "no") { out = false; return true; }
+    return false;
+}
+
+bool parseInt(const QString& value, int minimum, int maximum, int& out)
+{
+    bool ok = false;
+    const int parsed = value.trimmed().toInt(&ok);
+    if (!ok || parsed < minimum || parsed > maximum) return false;
+    out = parsed;
+    return true;
+}
+
+} // namespace
+
+bool ServerConfig::parse(const QStringList& arguments, ServerConfig& config, QString& error)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Servidor GamePadVirtual");
+    const QCommandLineOption helpOption = parser.addHelpOption();
+
+    const QCommandLineOption headlessOption("headless", "Roda sem interface gráfica.");
+    const QCommandLineOption configOption("config", "Arquivo INI com as opções abaixo (mesmos nomes).", "arquivo");
+    const QCommandLineOption controlPortOption("control-port", "Porta TCP de controle.", "porta");
+    const QCommandLineOption dataPortOption("data-port", "Porta UDP dos pacotes do controle.", "porta");
+    const QCommandLineOption discoveryPortOption("discovery-port", "Porta UDP de descoberta.", "porta");
+    const QCommandLineOption transportsOption("transports", "Transportes ativos: wifi,bluetooth,ble.", "lista");
+    const QCommandLineOption playersOption("players", "Número máximo de jogadores (1-8).", "n");
+    const QCommandLineOption resumeOption("resume-grace-ms", "Carência para retomar sessões Wi-Fi (0 desliga).", "ms");
+    const QCommandLineOption streamingOption("streaming", "Transmissão de tela (on/off).", "on|off");
+    const QCommandLineOption streamTiersOption("stream-tiers",
+        QString("Camadas do stream, ex: %1.").arg(StreamTierSet().toString()), "LxA@fps:kbps,...");
+    const QCommandLineOption streamSourceOption("stream-source", "Captura: auto, d3d11, pipewire, ximage ou test.", "fonte");
+    const QCommandLineOption pipewireNodeOption("stream-pipewire-node",
+        "Nó do PipeWire com a tela (ScreenCast do xdg-desktop-portal); exigido por --stream-source pipewire.", "nó");
+    const QCommandLineOption streamEncoderOption("stream-encoder", "Encoder: auto, nvenc, x264, openh264 ou vp8.", "encoder");
+    const QCommandLineOption streamAudioOption("stream-audio", "Áudio: auto, wasapi, pulse ou test.", "fonte");
+    const QCommandLineOption intraRefreshOption("intra-refresh",
+        "Renovação gradual no lugar do keyframe periódico (on/off, só x264).", "on|off");
+    const QCommandLineOption stunServerOption("stun-server",
+        QString("Servidor STUN do stream (off desliga). Padrão: %1.").arg(IceConfig().stunServer), "url|off");
+    const QCommandLineOption iceLanOption("ice-lan", "ICE só com candidatos host, sem STUN (on/off).", "on|off");
+    const QCommandLineOption iceBindOption("ice-bind-control",
+        "ICE só no endereço local em que o controle do jogador chegou (on/off).", "on|off");
+    const QCommandLineOption backendOption("backend",
+        QString("Driver de controles virtuais: %1.").arg(ControllerBackend::availableBackends().join(", ")), "nome");
+    const QCommandLineOption recordOption("record-file", "Salva os eventos do backend 'recording' neste arquivo.", "arquivo");
+    const QCommandLineOption tickOption("tick", "Envio ao controle virtual: fixed (no tick) ou immediate.", "modo");
+    const QCommandLineOption tickIntervalOption("tick-interval-ms", "Intervalo do tick.", "ms");
+    const QCommandLineOption warmSparesOption("warm-spares",
+        "Controles reservas já plugados por tipo (0 = plug quando o jogador conecta).", "n");
+    const QCommandLineOption metricsIntervalOption("metrics-interval", "Imprime as métricas a cada N segundos.", "s");
+    const QCommandLineOption metricsJsonOption("metrics-json", "Exporta as métricas em JSON ao sair.", "arquivo");
+    const QCommandLineOption durationOption("duration", "Encerra depois de N segundos.", "s");
+    const QCommandLineOption loadPlayersOption("load-players", "Jogadores sintéticos de carga.", "n");
+    const QCommandLineOption loadRateOption("load-rate", "Pacotes por segundo de cada jogador sintético.", "hz");
+    const QCommandLineOption logFileOption("log-file", "Arquivo de log (com rotação).", "arquivo");
+    const QCommandLineOption logLevelOption("log-level", "Nível mínimo: trace, debug, info, warning ou error.", "nível");
+
+    parser.addOptions({ headlessOption, configOption, controlPortOption, dataPortOption, discoveryPortOption,
+        transportsOption, playersOption, resumeOption, streamingOption, streamTiersOption, streamSourceOption, pipewireNodeOption,
+        streamEncoderOption, streamAudioOption, intraRefreshOption, stunServerOption, iceLanOption, iceBindOption, backendOption, recordOption, tickOption, tickIntervalOption, warmSparesOption,
+        metricsIntervalOption, metricsJsonOption, durationOption, loadPlayersOption, loadRateOption, logFileOption, logLevelOption });
+
+    if (!parser.parse(arguments)) {
+        error = parser.errorText();
+        return false;
+    }
+    if (parser.isSet(helpOption)) {
+        QTextStream(stdout) << parser.helpText();
+        error.clear();
+        return false;
+    }
+
+    // Arquivo de configuração primeiro; a linha de comando sobrescreve
+    QSettings* settings = nullptr;
+    if (parser.isSet(configOption)) {
+        const QString path = parser.value(configOption);
+        if (!QFileInfo::exists(path)) {
+            error = QString("Arquivo de configuração não encontrado: %1").arg(path);
+            return false;
+        }
+        settings = new QSettings(path, QSettings::IniFormat);
+    }
+
+    auto value = [&](const QCommandLineOption& option, QString& out) {
+        const QString name = option.names().first();
+        if (parser.isSet(option)) { out = parser.value(option); return true; }
+        if (settings && settings->contains(name)) { out = settings->value(name).toString(); return true; }
+        return false;
+    };
+    auto invalid = [&](const QCommandLineOption& option, const QString& text) {
+        error = QString("Valor inválido para --%1: %2").arg(option.names().first(), text);
+        delete settings;
+        return false;
+    };
+
+    QString text;
+    int number = 0;
+    if (value(controlPortOption, text)) {
+        if (!parseInt(text, 1, 65535, number)) return invalid(controlPortOption, text);
+        config.controlPort = static_cast<quint16>(number);
+    }
+    if (value(dataPortOption, text)) {
+        if (!parseInt(text, 1, 65535, number)) return invalid(dataPortOption, text);
+        config.dataPort = static_cast<quint16>(number);
+    }
+    if (value(discoveryPortOption, text)) {
+        if (!parseInt(text, 1, 65535, number)) return invalid(discoveryPortOption, text);
+        config.discoveryPort = static_cast<quint16>(number);
+    }
+    if (value(transportsOption, text)) {
+        config.wifi = config.bluetooth = config.ble = false;
+        for (const QString& name : text.split(',', Qt::SkipEmptyParts)) {
+            const QString transport = name.trimmed().toLower();
+            if (transport == "wifi") config.wifi = true;
+            else if (transport == "bluetooth") config.bluetooth = true;
+            else if (transport == "ble") config.ble = true;
+            else if (transport != "none") return invalid(transportsOption, text);
+        }
+    }
+    if (value(playersOption, text)) {
+        if (!parseInt(text, 1, MAX_PLAYERS, config.maxPlayers)) return invalid(playersOption, text);
+    }
+    if (value(resumeOption, text)) {
+        if (!parseInt(text, 0, 600000, config.resumeGraceMs)) return invalid(resumeOption, text);
+    }
+    if (value(streamingOption, text)) {
+        if (!parseBool(text, config.streaming)) return invalid(streamingOption, text);
+    }
+    if (value(streamTiersOption, text)) {
+        QString tierError;
+        if (!StreamTierSet::parse(text, config.streamTiers, tierError)) {
+            error = tierError;
+            delete settings;
+            return false;
+        }
+    }
+    if (value(streamSourceOption, text)) {
+        if (!PipelineBuilder::parseVideoSource(text, config.streamPipeline.video)) return invalid(streamSourceOption, text);
+    }
+    if (value(pipewireNodeOption, text)) {
+        // Id do nó; volta a texto pelo número (o valor entra na descrição do pipeline)
+        bool ok = false;
+        const qulonglong node = text.trimmed().toULongLong(&ok);
+        if (!ok) return invalid(pipewireNodeOption, text);
+        config.streamPipeline.pipewireNode = QString::number(node);
+    }
+    if (value(streamEncoderOption, text)) {
+        if (!PipelineBuilder::parseEncoder(text, config.streamPipeline.encoder)) return invalid(streamEncoderOption, text);
+    }
+    if (value(streamAudioOption, text)) {
+        if (!PipelineBuilder::parseAudioSource(text, config.streamPipeline.audio)) return invalid(streamAudioOption, text);
+    }
+    if (value(intraRefreshOption, text)) {
+        if (!parseBool(text, config.streamPipeline.intraRefresh)) return invalid(intraRefreshOption, text);
+    }
+    if (value(stunServerOption, text)) {
+        const QString url = text.trimmed();
+        if (url.compare("off", Qt::CaseInsensitive) == 0 || url.isEmpty()) config.streamIce.stunServer.clear();
+        else if (url.startsWith("stun://")) config.streamIce.stunServer = url;
+        else return invalid(stunServerOption, text);
+    }
+    if (value(iceLanOption, text)) {
+        if (!parseBool(text, config.streamIce.lanOnly)) return invalid(iceLanOption, text);
+    }
+    if (value(iceBindOption, text)) {
+        if (!parseBool(text, config.streamIce.bindControlInterface)) return invalid(iceBindOption, text);
+    }
+    if (value(backendOption, text)) {
+        config.backend = text.trimmed().toLower();
+    }
+    if (value(recordOption, text)) {
+        config.recordFile = text;
+    }
+    if (value(tickOption, text)) {
+        const QString mode = text.trimmed().toLower();
+        if (mode == "fixed") config.tickMode = GamepadManager::TickMode::Fixed;
+        else if (mode == "immediate") config.tickMode = GamepadManager::TickMode::Immediate;
+        else return invalid(tickOption, text);
+    }
+    if (value(tickIntervalOption, text)) {
+        if (!parseInt(text, 1, 1000, config.tickIntervalMs)) return invalid(tickIntervalOption, text);
+    }
+    if (value(warmSparesOption, text)) {
+        if (!parseInt(text, 0, MAX_PLAYERS, config.warmSpares)) return invalid(warmSparesOption, text);
+    }
+    if (value(metricsIntervalOption, text)) {
+        if (!parseInt(text, 0, 86400, config.metricsIntervalS)) return invalid(metricsIntervalOption, text);
+    }
+    if (value(metricsJsonOption, text)) {
+        config.metricsJsonFile = text;
+    }
+    if (value(durationOption, text)) {
+        if (!parseInt(text, 0, 31 * 86400, config.durationS)) return invalid(durationOption, text);
+    }
+    if (value(loadPlayersOption, text)) {
+        if (!parseInt(text, 0, MAX_PLAYERS, config.loadPlayers)) return invalid(loadPlayersOption, text);
+    }
+    if (value(loadRateOption, text)) {
+        if (!parseInt(text, 1, 2000, config.loadRateHz)) return invalid(loadRateOption, text);
+    }
+
+    if (value(logFileOption, text)) {
+        config.logFile = text;
+    }
+    if (value(logLevelOption, text)) {
+        const QStringList levels = { "trace", "debug", "info", "warning", "error" };
+        const int level = levels.indexOf(text.trimmed().toLower());
+        if (level < 0) return invalid(logLevelOption, text);
+        config.logLevel = static_cast<LogLevel>(level);
+    }
+
+    delete settings;
+
+    // Gravação sem o backend que grava não faz sentido: assume "recording"
+    if (!config.recordFile.isEmpty() && config.backend.isEmpty()) {
+        config.backend = "recording";
+    }
+    return true;
+}
+
+QStringList ServerConfig::summary() const
+{
+    QStringList transports;
+    if (wifi) transports << "wifi";
+    if (bluetooth) transports << "bluetooth";
+    if (ble) transports << "ble";
+
+    QStringList lines;
+    lines << QString("Portas: controle %1/TCP, dados %2/UDP, descoberta %3/UDP").arg(controlPort).arg(dataPort).arg(discoveryPort);
+    lines << QString("Transportes: %1 | jogadores: %2 | retomada: %3 ms | stream: %4")
+        .arg(transports.isEmpty() ? "nenhum" : transports.join(","))
+        .arg(maxPlayers).arg(resumeGraceMs).arg(streaming ? "on" : "off");
+    if (streaming) {
+        lines << QString("Camadas do stream: %1").arg(streamTiers.toString());
+        lines << QString("Pipeline do stream: fonte %1, encoder %2, áudio %3, intra-refresh %4")
+            .arg(QLatin1String(PipelineBuilder::videoSourceName(streamPipeline.video)),
+                QLatin1String(PipelineBuilder::encoderName(streamPipeline.encoder)),
+                QLatin1String(PipelineBuilder::audioSourceName(streamPipeline.audio)),
+                QLatin1String(streamPipeline.intraRefresh ? "on" : "off"));
+        lines << QString("ICE do stream: %1").arg(streamIce.summary());
+    }
+    lines << QString("Backend: %1 | tick: %2 (%3 ms) | reservas: %4")
+        .arg(backend.isEmpty() ? "auto" : backend)
+        .arg(tickMode == GamepadManager::TickMode::Immediate ? "immediate" : "fixed")
+        .arg(tickIntervalMs).arg(warmSpares);
+    if (loadPlayers > 0) {
+        lines << QString("Carga sintética: %1 jogador(es) a %2 Hz").arg(loadPlayers).arg(loadRateHz);
+    }
+    return lines;
+}
+
+// ============================================================================
+// PIPELINE
+// ============================================================================
+
+ServerRuntime::ServerRuntime(const ServerConfig& config, QObject* parent)
+    : QObject(parent), m_config(config)
+{
+    // Nome de backend inexistente: segue com o padrão e avisa (start() falha se nem esse existir)
+    m_backend = ControllerBackend::create(m_config.backend);
+    if (!m_backend && !m_config.backend.isEmpty()) {
+        qWarning() << "Backend de controles desconhecido ou indisponível:" << m_config.backend;
+    }
+
+    m_gamepadManager = new GamepadManager(m_backend, this);
+    m_connectionManager = new ConnectionManager(m_gamepadManager, this);
+
+    m_gamepadManager->setTickMode(m_config.tickMode, m_config.tickIntervalMs);
+    m_gamepadManager->setWarmSpares(m_config.warmSpares);
+
+    m_connectionManager->sessions()->setCapacity(m_config.maxPlayers);
+    m_connectionManager->networkServer()->setPorts(m_config.controlPort, m_config.dataPort, m_config.discoveryPort);
+    m_connectionManager->setResumeGracePeriod(m_config.resumeGraceMs);
+    m_connectionManager->networkServer()->screenStreamer()->setTiers(m_config.streamTiers);
+    m_connectionManager->networkServer()->screenStreamer()->setPipelineOptions(m_config.streamPipeline);
+    m_connectionManager->networkServer()->screenStreamer()->setIceConfig(m_config.streamIce);
+    m_connectionManager->setStreamingEnabled(m_config.streaming);
+    m_connectionManager->setTransportEnabled(Session::Network, m_config.wifi);
+    m_connectionManager->setTransportEnabled(Session::Bluetooth, m_config.bluetooth);
+    m_connectionManager->setTransportEnabled(Session::Ble, m_config.ble);
+
+    // Conexões de jogadores - ConnectionManager para GamepadManager
+    connect(m_connectionManager, &ConnectionManager::playerConnected,
+        m_gamepadManager, &GamepadManager::playerConnected);
+    connect(m_connectionManager, &ConnectionManager::playerDisconnected,
+        m_gamepadManager, &GamepadManager::playerDisconnected);
+}
+
+ServerRuntime::~ServerRuntime()
+{
+    stop();
+}
+
+bool ServerRuntime::start()
+{
+    if (m_running) return true;
+
+    static LatencyStat* startupStat = Metrics::instance().latency("runtime.startup_ms");
+
+    QElapsedTimer clock;
+    clock.start();
+
+    if (!m_backend && !m_config.backend.isEmpty()) return false;
+    if (!m_gamepadManager->initialize()) return false;
+
+    m_connectionManager->startServices();
+    m_running = true;
+    m_startupMs = clock.elapsed();
+    startupStat->record(m_startupMs);
+
+    if (m_config.wifi && !m_connectionManager->networkServer()->isListening()) {
+        qWarning() << "Servidor de rede não está escutando na porta" << m_config.controlPort;
+    }
+
+    startLoad();
+    return true;
+}
+
+void ServerRuntime::stop()
+{
+    if (!m_running) return;
+    m_running = false;
+
+    stopLoad();
+    m_connectionManager->stopServices();
+    m_gamepadManager->shutdown();
+
+    if (!m_config.recordFile.isEmpty()) {
+        RecordingBackend* recording = qobject_cast<RecordingBackend*>(m_backend);
+        if (!recording) {
+            qWarning() << "--record-file exige o backend 'recording'";
+        }
+        else if (!recording->saveTo(m_config.recordFile)) {
+            qWarning() << "Falha ao salvar a gravação em" << m_config.recordFile;
+        }
+    }
+}
+
+// Jogadores sintéticos ocupam sessões Synthetic, como no diagnóstico DSU da interface
+void ServerRuntime::startLoad()
+{
+    if (m_config.loadPlayers <= 0) return;
+
+    SessionRegistry* sessions = m_connectionManager->sessions();
+    for (int n = 0; n < m_config.loadPlayers; ++n) {
+        const SessionHandle session = sessions->open(Session::Synthetic);
+        if (session.isNull()) break;
+        m_loadMask |= 1u << session.playerIndex;
+    }
+    if (!m_loadMask) {
+        qWarning() << "Sem slots livres para a carga sintética";
+        return;
+    }
+
+    m_loadGenerator = new InputLoadGenerator(this);
+    connect(m_loadGenerator, &InputLoadGenerator::playerConnected, m_gamepadManager, &GamepadManager::playerConnected);
+    connect(m_loadGenerator, &InputLoadGenerator::playerDisconnected, m_gamepadManager, &GamepadManager::playerDisconnected);
+    connect(m_loadGenerator, &InputLoadGenerator::packetReceived, m_gamepadManager, &GamepadManager::onPacketReceived);
+    connect(m_loadGenerator, &InputLoadGenerator::motionSampleReceived, m_gamepadManager, &GamepadManager::onMotionSample);
+    m_loadGenerator->start(m_loadMask, m_config.loadRateHz, true);
+}
+
+void ServerRuntime::stopLoad()
+{
+    if (m_loadGenerator) m_loadGenerator->stop();
+
+    for (int i = 0; i < MAX_PLAYERS; ++i) {
+        if (m_loadMask & (1u << i)) m_connectionManager->sessions()->close(i);
+    }
+    m_loadMask = 0;
+}
+
+QStringList ServerRuntime::runIngestBenchmark(int packets)
+{
+    packets = qMax(1, packets);
+    const int rateHz = 1000;
+
+    ServerConfig config;
+    config.wifi = config.bluetooth = config.ble = false;
+    config.backend = "null";
+
+    ServerRuntime runtime(config);
+    if (!runtime.start()) return { "Ingestão: backend null indisponível" };
+    NullBackend* backend = qobject_cast<NullBackend*>(runtime.backend());
+
+    // Filho do runtime: sai depois do stopServices() do destrutor
+    LoopbackTransport* loopback = new LoopbackTransport(runtime.connectionManager()->sessions(), &runtime);
+    runtime.connectionManager()->addTransport(loopback);
+    const int player = loopback->connectPlayer();
+    if (player < 0) return { "Ingestão: nenhum slot livre" };
+
+    // O controle virtual fica pronto numa volta do event loop. Espera pelo
+    // controle do jogador, não por qualquer um: com --warm-spares há reservas
+    // plugadas antes dele
+    const ControllerPool* pool = runtime.gamepadManager()->controllerPool();
+    QElapsedTimer wait;
+    wait.start();
+    while (pool->padFor(player) == 0 && wait.elapsed() < 1000) {
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+    }
+    if (pool->padFor(player) == 0) return { "Ingestão: o controle virtual não foi plugado" };
+
+    GamepadPacket state = {};
+    state.buttons = A;
+    QStringList lines;
+    quint32 sensorUs = 0;
+    const GamepadManager::TickMode modes[] = { GamepadManager::TickMode::Immediate, GamepadManager::TickMode::Fixed };
+    for (GamepadManager::TickMode mode : modes) {
+        runtime.gamepadManager()->setTickMode(mode, config.tickIntervalMs);
+        const qint64 submittedBefore = backend->submissions();
+
+        QElapsedTimer timer;
+        timer.start();
+        const qint64 accepted = loopback->injectTimed(player, state, packets, rateHz, sensorUs);
+        const qint64 elapsedNs = timer.nsecsElapsed();
+        // No modo fixo os reports saem no próximo tick
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 2 * config.tickIntervalMs);
+
+        lines << QString("Ingestão %1: %2 ns/pacote, %3 de %4 aceitos, %5 reports ao driver")
+            .arg(QLatin1String(mode == GamepadManager::TickMode::Immediate ? "imediata" : "por tick"))
+            .arg(static_cast<double>(elapsedNs) / packets, 0, 'f', 0)
+            .arg(accepted).arg(packets)
+            .arg(backend->submissions() - submittedBefore);
+        sensorUs += static_cast<quint32>(packets * 1000000LL / rateHz);
+    }
+
+    loopback->disconnectPlayer(player);
+    runtime.stop();
+    return lines;
+}
+
+// ============================================================================
+// MODO SEM INTERFACE
+// ============================================================================
+
+namespace {
+
+// Ctrl+C/SIGTERM: o handler só avisa; quem encerra é o event loop
+#ifdef Q_OS_WIN
+// Roda numa thread criada pelo sistema: encerra por uma chamada enfileirada
+BOOL WINAPI consoleCtrlHandler(DWORD type)
+{
+    if (type != CTRL_C_EVENT && type != CTRL_BREAK_EVENT) return FALSE;
+    QMetaObject::invokeMethod(QCoreApplication::instance(), &QCoreApplication::quit, Qt::QueuedConnection);
+    return TRUE;
+}
+
+void installQuitHandler(QCoreApplication& app)
+{
+    Q_UNUSED(app);
+    SetConsoleCtrlHandler(consoleCtrlHandler, TRUE);
+}
+#else
+// Self-pipe: write() é async-signal-safe; o QSocketNotifier acorda o event loop
+int s_quitPipe[2] = { -1, -1 };
+
+void requestQuit(int)
+{
+    const char byte = 1;
+    const ssize_t written = ::write(s_quitPipe[1], &byte, 1);
+    (void)written;
+}
+
+void installQuitHandler(QCoreApplication& app)
+{
+    if (::pipe(s_quitPipe) != 0) {
+        qWarning() << "Falha ao criar o pipe de sinais; Ctrl+C encerra sem salvar as métricas";
+        return;
+    }
+    ::fcntl(s_quitPipe[0], F_SETFD, FD_CLOEXEC);
+    ::fcntl(s_quitPipe[1], F_SETFD, FD_CLOEXEC);
+    ::fcntl(s_quitPipe[1], F_SETFL, O_NONBLOCK);
+
+    QSocketNotifier* notifier = new QSocketNotifier(s_quitPipe[0], QSocketNotifier::Read, &app);
+    QObject::connect(notifier, &QSocketNotifier::activated, &app, [notifier]() {
+        notifier->setEnabled(false);
+        char byte;
+        const ssize_t got = ::read(s_quitPipe[0], &byte, 1);
+        (void)got;
+        QCoreApplication::quit();
+    });
+
+    struct sigaction action = {};
+    action.sa_handler = requestQuit;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+}
+#endif
+
+void printMetrics(QTextStream& out)
+{
+    for (const QString& line : Metrics::instance().report()) {
+        out << line << '\n';
+    }
+    out.flush();
+}
+
+} // namespace
+
+int runHeadless(int argc, char* argv[], const QElapsedTimer& launchClock)
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("GamePadVirtual-Desktop");
+
+    QTextStream out(stdout);
+    ServerConfig config;
+    QString error;
+    if (!ServerConfig::parse(app.arguments(), config, error)) {
+        if (error.isEmpty()) return 0;   // --help
+        QTextStream(stderr) << error << '\n';
+        return 2;
+    }
+
+    for (const QString& line : config.summary()) {
+        out << line << '\n';
+    }
+    out.flush();
+
+    Log::setLevel(config.logLevel);
+    Log::start(config.logFile);
+    Log::installQtMessageHandler();
+
+    ServerRuntime runtime(config);
+    if (!runtime.start()) {
+        QTextStream(stderr) << "Falha ao inicializar o driver de controles virtuais\n";
+        Log::stop();
+        return 1;
+    }
+
+    // Partida a frio: do início do main() até os transportes estarem escutando
+    static LatencyStat* coldStartStat = Metrics::instance().latency("runtime.cold_start_ms");
+    const qint64 coldStartMs = launchClock.elapsed();
+    coldStartStat->record(coldStartMs);
+    out << QString("Servidor pronto em %1 ms (pipeline %2 ms)").arg(coldStartMs).arg(runtime.startupMs()) << '\n';
+    out.flush();
+
+    installQuitHandler(app);
+
+    if (config.durationS > 0) {
+        QTimer::singleShot(config.durationS * 1000, &app, &QCoreApplication::quit);
+    }
+
+    QTimer metricsTimer;
+    if (config.metricsIntervalS > 0) {
+        QObject::connect(&metricsTimer, &QTimer::timeout, [&out]() { printMetrics(out); });
+        metricsTimer.start(config.metricsIntervalS * 1000);
+    }
+
+    const int exitCode = app.exec();
+
+    runtime.stop();
+    Log::stop();
+    printMetrics(out);
+
+    if (!config.metricsJsonFile.isEmpty()) {
+        QFile file(config.metricsJsonFile);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            QTextStream(stderr) << "Falha ao gravar " << config.metricsJsonFile << '\n';
+            return 1;
+        }
+        file.write(QJsonDocument(Metrics::instance().toJson()).toJson());
+    }
+    return exitCode;
+}
+
+int runDsuProbe(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("GamePadVirtual-Desktop");
+
+    // --dsu-probe [assinantes] [ms]: padrões do botão da interface
+    const QStringList args = app.arguments();
+    const int at = args.indexOf("--dsu-probe");
+    DsuProbeConfig probeConfig;
+    probeConfig.subscribers = 2;
+    probeConfig.durationMs = 5000;
+    if (at + 1 < args.size() && !parseInt(args.at(at + 1), 1, 64, probeConfig.subscribers)) {
+        QTextStream(stderr) << "Valor inválido para assinantes: " << args.at(at + 1) << '\n';
+        return 2;
+    }
+    if (at + 2 < args.size() && !parseInt(args.at(at + 2), 100, 600000, probeConfig.durationMs)) {
+        QTextStream(stderr) << "Valor inválido para a duração: " << args.at(at + 2) << '\n';
+        return 2;
+    }
+
+    // Sem transportes e sem driver: só o servidor DSU alimentado por um jogador sintético
+    ServerConfig config;
+    config.wifi = config.bluetooth = config.ble = false;
+    config.backend = "null";
+    config.loadPlayers = 1;
+    config.loadRateHz = 250;
+
+    ServerRuntime runtime(config);
+    if (!runtime.start()) {
+        QTextStream(stderr) << "Falha ao inicializar o backend null\n";
+        return 1;
+    }
+
+    DsuProbeReport report;
+    DsuProbeClient probe;
+    QObject::connect(&probe, &DsuProbeClient::finished, &app, [&report, &app](const DsuProbeReport& result) {
+        report = result;
+        app.quit();
+    });
+    probe.start(probeConfig);
+    app.exec();
+    runtime.stop();
+
+    QTextStream(stdout) << QJsonDocument(report.toJson()).toJson();
+    return report.passed() ? 0 : 1;
+}
@@ -0,0 +1,113 @@
+#ifndef SERVER_RUNTIME_H
+#define SERVER_RUNTIME_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QElapsedTimer>
+#include "controller_types.h"
+#include "communication/network_server.h"
+#include "communication/session_registry.h"
+#include "virtual_gamepad/gamepad_manager.h"
+#include "streaming/pipeline_builder.h"
+#include "utils/log.h"
+
+class ConnectionManager;
+class ControllerBackend;
+class InputLoadGenerator;
+
+// Configuração do servidor. Nos dois modos os valores vêm do arquivo INI
+// (--config; a interface gráfica também procura gamepadvirtual.ini na pasta de
+// dados) e da linha de comando, nessa ordem (a linha de comando vence).
+struct ServerConfig {
+    // Transportes
+    quint16 controlPort = CONTROL_PORT_TCP;
+    quint16 dataPort = DATA_PORT_UDP;
+    quint16 discoveryPort = DISCOVERY_PORT;
+    bool wifi = true;
+    bool bluetooth = true;
+    bool ble = true;
+    int maxPlayers = MAX_PLAYERS;
+    int resumeGraceMs = DEFAULT_RESUME_GRACE_MS;
+    bool streaming = false;
+    StreamTierSet streamTiers;        // Camadas de codificação do stream
+    PipelineBuilder::Options streamPipeline;  // Fonte/encoder/áudio (test = sintético, sem tela)
+    IceConfig streamIce;              // STUN ou só LAN (rede sem internet, tether USB)
+
+    // Controles virtuais
+    QString backend;                  // Vazio = padrão da plataforma
+    QString recordFile;               // Backend "recording": salva os eventos ao sair
+    GamepadManager::TickMode tickMode = GamepadManager::TickMode::Fixed;
+    int tickIntervalMs = GamepadManager::DEFAULT_TICK_INTERVAL_MS;
+    int warmSpares = 0;               // Controles reservas já plugados por tipo (0 = sob demanda)
+
+    // Métricas e execução sem interface
+    int metricsIntervalS = 0;         // 0 = só imprime ao sair
+    QString metricsJsonFile;          // Exporta Metrics::toJson() ao sair
+    int durationS = 0;                // 0 = roda até Ctrl+C
+    int loadPlayers = 0;              // Jogadores sintéticos (InputLoadGenerator)
+    int loadRateHz = 250;
+
+    // Log
+    QString logFile;                  // Vazio = só console
+    LogLevel logLevel = LogLevel::Info;
+
+    // Lê o arquivo de configuração e a linha de comando. Em erro preenche 'error'
+    // e retorna false; --help/--version também retornam false com 'error' vazio
+    // depois de imprimir o texto.
+    static bool parse(const QStringList& arguments, ServerConfig& config, QString& error);
+
+    QStringList summary() const;
+};
+
+// Monta o pipeline completo (GamepadManager + ConnectionManager) sem depender
+// de janela: usado pela MainWindow e pelo modo --headless.
+class ServerRuntime : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ServerRuntime(const ServerConfig& config, QObject* parent = nullptr);
+    ~ServerRuntime();
+
+    // Inicializa o driver de controles e os transportes; false se o backend falhar
+    bool start();
+    void stop();
+
+    bool isRunning() const { return m_running; }
+    // Tempo de start() até os transportes estarem escutando
+    qint64 startupMs() const { return m_startupMs; }
+
+    const ServerConfig& config() const { return m_config; }
+    GamepadManager* gamepadManager() const { return m_gamepadManager; }
+    ConnectionManager* connectionManager() const { return m_connectionManager; }
+    ControllerBackend* backend() const { return m_backend; }
+
+    // Caminho ingestão -> controle virtual sem rede: LoopbackTransport registrado
+    // no ConnectionManager e backend null, nos dois modos de tick. Exige uma
+    // QCoreApplication (o plug do controle termina no event loop)
+    static QStringList runIngestBenchmark(int packets);
+
+private:
+    void startLoad();
+    void stopLoad();
+
+    ServerConfig m_config;
+    ControllerBackend* m_backend;
+    GamepadManager* m_gamepadManager;
+    ConnectionManager* m_connectionManager;
+    InputLoadGenerator* m_loadGenerator = nullptr;
+    quint32 m_loadMask = 0;
+    bool m_running = false;
+    qint64 m_startupMs = 0;
+};
+
+// Ponto de entrada do modo sem interface (QCoreApplication + pipeline).
+// 'launchClock' foi iniciado no começo do main(): mede a partida a frio.
+int runHeadless(int argc, char* argv[], const QElapsedTimer& launchClock);
+
+// Diagnóstico DSU sem interface (CI): backend null, um jogador sintético e o
+// DsuProbeClient. Imprime o relatório em JSON; sai com 1 se não passar
+int runDsuProbe(int argc, char* argv[]);
+
+#endif // SERVER_RUNTIME_H
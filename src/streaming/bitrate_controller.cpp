@@ -0,0 +1,197 @@
+﻿#include "bitrate_controller.h"
+#include <QtGlobal>
+#include <cmath>
+
+BitrateController::BitrateController(const BitrateConfig& config)
+    : m_config(config), m_targetKbps(config.startKbps)
+{
+}
+
+void BitrateController::setConfig(const BitrateConfig& config)
+{
+    m_config = config;
+    m_targetKbps = qBound(m_config.minKbps, m_targetKbps, m_config.maxKbps);
+    for (ClientState& client : m_clients) {
+        client.rateKbps = qBound(double(m_config.minKbps), client.rateKbps, double(m_config.maxKbps));
+    }
+}
+
+void BitrateController::update(int clientId, const TransportSample& sample)
+{
+    auto it = m_clients.find(clientId);
+    if (it == m_clients.end()) {
+        ClientState client;
+        // Cliente novo entra no alvo atual: não derruba nem infla o encoder
+        client.rateKbps = m_clients.isEmpty() ? m_config.startKbps : m_targetKbps;
+        it = m_clients.insert(clientId, client);
+    }
+    it->sample = sample;
+    it->hasSample = true;
+}
+
+void BitrateController::removeClient(int clientId)
+{
+    m_clients.remove(clientId);
+}
+
+int BitrateController::clientRateKbps(int clientId) const
+{
+    auto it = m_clients.constFind(clientId);
+    return it == m_clients.cend() ? -1 : qRound(it->rateKbps);
+}
+
+void BitrateController::clear()
+{
+    m_clients.clear();
+    m_targetKbps = m_config.startKbps;
+    m_lastDecision = Decision::Hold;
+    m_lastReason.clear();
+}
+
+BitrateController::Decision BitrateController::step(ClientState& client, QString& reason) const
+{
+    if (!client.hasSample) {
+        reason = "sem estatísticas";
+        return Decision::Hold;
+    }
+    client.hasSample = false;
+
+    const TransportSample& s = client.sample;
+    const double before = client.rateKbps;
+
+    if (s.rttMs >= 0.0 && (client.minRttMs < 0.0 || s.rttMs < client.minRttMs)) {
+        client.minRttMs = s.rttMs;
+    }
+    const bool queueGrowing = s.rttMs >= 0.0 && client.minRttMs >= 0.0
+        && s.rttMs > client.minRttMs + m_config.rttGrowthMs;
+    const double loss = qMax(0.0, s.fractionLost);
+
+    if (loss > m_config.lossDecrease) {
+        // Corte proporcional à perda (mesma regra do GCC)
+        client.rateKbps *= 1.0 - 0.5 * loss;
+        reason = QString("perda %1%").arg(loss * 100.0, 0, 'f', 1);
+    }
+    else if (queueGrowing) {
+        client.rateKbps *= 0.85;
+        reason = QString("RTT %1 ms (mínimo %2 ms)").arg(qRound(s.rttMs)).arg(qRound(client.minRttMs));
+    }
+    else if (loss >= m_config.lossHold) {
+        reason = QString("perda %1%").arg(loss * 100.0, 0, 'f', 1);
+    }
+    else {
+        client.rateKbps += m_config.increaseKbps;
+        reason = "enlace limpo";
+    }
+
+    if (s.estimateKbps > 0) {
+        const double ceiling = s.estimateKbps * m_config.estimateMargin;
+        if (client.rateKbps > ceiling) {
+            client.rateKbps = ceiling;
+            reason = QString("estimativa TWCC %1 kbps").arg(s.estimateKbps);
+        }
+    }
+
+    client.rateKbps = qBound(double(m_config.minKbps), client.rateKbps, double(m_config.maxKbps));
+
+    if (client.rateKbps < before) return Decision::Decrease;
+    if (client.rateKbps > before) return Decision::Increase;
+    return Decision::Hold;
+}
+
+int BitrateController::decide()
+{
+    if (m_clients.isEmpty()) {
+        m_lastDecision = Decision::Hold;
+        m_lastReason = "sem clientes";
+        return m_targetKbps;
+    }
+
+    // O encoder é compartilhado: o cliente mais lento define o alvo
+    double lowest = m_config.maxKbps;
+    QString limitingReason;
+    for (auto it = m_clients.begin(); it != m_clients.end(); ++it) {
+        QString reason;
+        step(it.value(), reason);
+        if (limitingReason.isEmpty() || it->rateKbps < lowest) {
+            lowest = it->rateKbps;
+            limitingReason = QString("jogador %1: %2").arg(it.key()).arg(reason);
+        }
+    }
+
+    const int target = qRound(lowest);
+    if (target < m_targetKbps) m_lastDecision = Decision::Decrease;
+    else if (target > m_targetKbps) m_lastDecision = Decision::Increase;
+    else m_lastDecision = Decision::Hold;
+
+    m_targetKbps = target;
+    m_lastReason = limitingReason;
+    return m_targetKbps;
+}
+
+QStringList BitrateController::runSimulation()
+{
+    // Dois clientes: um numa rede boa e outro num enlace que cai de 12 para
+    // 3 Mbps, volta para 6 e depois para 12. O gargalo tem buffer de 200 ms;
+    // o que passa do buffer é perdido. Uma rodada = 1 s (intervalo do get-stats).
+    struct Phase { int untilS; int capacityKbps; };
+    const Phase phases[] = { { 15, 12000 }, { 30, 3000 }, { 45, 6000 }, { 60, 12000 } };
+    const double baseRttMs = 20.0;
+    const double bufferMs = 200.0;
+
+    BitrateController controller;
+    QStringList lines;
+    lines << "Simulação do controle de bitrate (1 rodada = 1 s)";
+
+    double queueKbit = 0.0;
+    double sentKbit = 0.0, capacityKbit = 0.0;
+    int lossyRounds = 0;
+    int phase = 0;
+    int changeAt = -1, settledAt = -1;
+
+    for (int t = 0; t < phases[3].untilS; ++t) {
+        while (t >= phases[phase].untilS) ++phase;
+        const double capacity = phases[phase].capacityKbps;
+        if (phase == 1 && changeAt < 0) changeAt = t;
+
+        const double rate = controller.targetKbps();
+        const double bufferKbit = capacity * bufferMs / 1000.0;
+        queueKbit += rate - capacity;
+        double dropped = 0.0;
+        if (queueKbit > bufferKbit) {
+            dropped = queueKbit - bufferKbit;
+            queueKbit = bufferKbit;
+        }
+        queueKbit = qMax(0.0, queueKbit);
+
+        TransportSample bad;
+        bad.fractionLost = rate > 0.0 ? dropped / rate : 0.0;
+        bad.rttMs = baseRttMs + queueKbit / capacity * 1000.0;
+        bad.jitterMs = 2.0;
+
+        TransportSample good;
+        good.fractionLost = 0.0;
+        good.rttMs = 8.0;
+        good.jitterMs = 1.0;
+
+        controller.update(1, bad);
+        controller.update(2, good);
+        const int target = controller.decide();
+
+        sentKbit += qMin(rate, capacity);
+        capacityKbit += capacity;
+        if (bad.fractionLost > 0.02) ++lossyRounds;
+        if (changeAt >= 0 && settledAt < 0 && target <= capacity) settledAt = t;
+
+        if (t % 3 == 0 || controller.lastDecision() == Decision::Decrease) {
+            lines << QString("t=%1s enlace %2 kbps, enviado %3 kbps, perda %4%, RTT %5 ms -> alvo %6 kbps (%7)")
+                .arg(t, 2).arg(int(capacity), 5).arg(int(rate), 5)
+                .arg(bad.fractionLost * 100.0, 0, 'f', 1).arg(qRound(bad.rttMs))
+                .arg(target).arg(controller.lastReason());
+        }
+    }
+
+    lines << QString("Uso do enlace: %1%").arg(sentKbit / capacityKbit * 100.0, 0, 'f', 1);
+    lines << QString("Rodadas com perda acima de 2%: %1").arg(lossyRounds);
+    if (settledAt >= 0) lines << QString("Adaptação à queda de banda: %1 s").arg(settledAt - changeAt + 1);
+    return lines;
+}
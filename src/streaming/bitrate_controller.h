@@ -0,0 +1,77 @@
+#ifndef BITRATE_CONTROLLER_H
+#define BITRATE_CONTROLLER_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+// Estatísticas de transporte de um cliente no último intervalo (get-stats do
+// webrtcbin). Campos negativos = não informados.
+struct TransportSample {
+    double fractionLost = -1.0;   // 0..1 (remote-inbound-rtp)
+    double rttMs = -1.0;
+    double jitterMs = -1.0;
+    int estimateKbps = -1;        // Estimativa de banda do TWCC (rtpgccbwe), se houver
+};
+
+struct BitrateConfig {
+    int minKbps = 1000;
+    int maxKbps = 8000;
+    int startKbps = 8000;         // Mesmo valor fixo de antes do controle adaptativo
+    int increaseKbps = 400;       // Aumento aditivo por rodada sem perda
+    double lossHold = 0.02;       // Abaixo disso pode subir
+    double lossDecrease = 0.08;   // Acima disso corta
+    double rttGrowthMs = 60.0;    // RTT acima do mínimo + isso = fila crescendo (corta)
+    double estimateMargin = 0.9;  // Fica abaixo da estimativa do TWCC
+};
+
+// Controle AIMD do bitrate do encoder compartilhado. Cada cliente tem a sua
+// taxa (sobe devagar sem perda, corta proporcional à perda ou ao RTT
+// crescendo) e o encoder usa a menor delas, já que todos recebem o mesmo
+// stream. Sem GStreamer: pode ser simulado fora do pipeline.
+class BitrateController
+{
+public:
+    enum class Decision { Hold, Increase, Decrease };
+
+    explicit BitrateController(const BitrateConfig& config = BitrateConfig());
+
+    void setConfig(const BitrateConfig& config);
+    const BitrateConfig& config() const { return m_config; }
+
+    // Uma amostra por cliente e rodada; clientes sem amostra mantêm a taxa
+    void update(int clientId, const TransportSample& sample);
+    void removeClient(int clientId);
+    void clear();
+    int clientCount() const { return m_clients.size(); }
+    // Taxa atual do cliente (kbps) ou -1 se ele ainda não mandou estatísticas
+    int clientRateKbps(int clientId) const;
+
+    // Fecha a rodada: retorna o novo alvo do encoder (kbps)
+    int decide();
+
+    int targetKbps() const { return m_targetKbps; }
+    Decision lastDecision() const { return m_lastDecision; }
+    const QString& lastReason() const { return m_lastReason; }
+
+    // Enlace simulado com capacidade variável e perda/RTT proporcionais ao excesso
+    static QStringList runSimulation();
+
+private:
+    struct ClientState {
+        double rateKbps = 0.0;
+        double minRttMs = -1.0;
+        TransportSample sample;
+        bool hasSample = false;
+    };
+
+    Decision step(ClientState& client, QString& reason) const;
+
+    BitrateConfig m_config;
+    QHash<int, ClientState> m_clients;
+    int m_targetKbps;
+    Decision m_lastDecision = Decision::Hold;
+    QString m_lastReason;
+};
+
+#endif // BITRATE_CONTROLLER_H
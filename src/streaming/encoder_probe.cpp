@@ -0,0 +1,411 @@
+﻿#include "encoder_probe.h"
+#include "../utils/log.h"
+#include "../utils/metrics.h"
+#include <QtGlobal>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QSettings>
+#include <QStandardPaths>
+#include <gst/video/video.h>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Mesma ordem de preferência do PipelineBuilder
+const PipelineBuilder::Encoder CANDIDATES[] = {
+    PipelineBuilder::Encoder::Nvenc,
+    PipelineBuilder::Encoder::X264,
+    PipelineBuilder::Encoder::OpenH264,
+    PipelineBuilder::Encoder::Vp8,
+};
+
+const char* factoryOf(PipelineBuilder::Encoder encoder)
+{
+    PipelineBuilder::Options options;
+    options.encoder = encoder;
+    return PipelineBuilder(options).encoderFactory();
+}
+
+// Muda quando o driver da NVIDIA é atualizado (o NVENC vem dele, não do plugin)
+QString videoDriverStamp()
+{
+#ifdef Q_OS_WIN
+    const QFileInfo dll(QDir(qEnvironmentVariable("SystemRoot")).filePath("System32/nvEncodeAPI64.dll"));
+    if (dll.exists()) return QString("%1 %2").arg(dll.lastModified().toString(Qt::ISODate)).arg(dll.size());
+#else
+    QFile version("/proc/driver/nvidia/version");
+    if (version.open(QIODevice::ReadOnly)) return QString::fromUtf8(version.readLine()).trimmed();
+#endif
+    return "none";
+}
+
+// Entrada e saída do encoder casadas pelo PTS (o NVENC entrega em outra thread)
+struct FrameTimes {
+    QMutex mutex;
+    QHash<GstClockTime, gint64> pending;
+    QVector<double> latenciesMs;
+    QVector<qint64> sizes;
+    int keyframes = 0;
+};
+
+GstPadProbeReturn encoder_in_cb(GstPad* pad, GstPadProbeInfo* info, gpointer user_data)
+{
+    Q_UNUSED(pad);
+    GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    if (!buffer || !GST_BUFFER_PTS_IS_VALID(buffer)) return GST_PAD_PROBE_OK;
+
+    FrameTimes* times = static_cast<FrameTimes*>(user_data);
+    QMutexLocker locker(&times->mutex);
+    times->pending.insert(GST_BUFFER_PTS(buffer), g_get_monotonic_time());
+    return GST_PAD_PROBE_OK;
+}
+
+GstPadProbeReturn encoder_out_cb(GstPad* pad, GstPadProbeInfo* info, gpointer user_data)
+{
+    Q_UNUSED(pad);
+    GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    if (!buffer || !GST_BUFFER_PTS_IS_VALID(buffer)) return GST_PAD_PROBE_OK;
+
+    const gint64 now = g_get_monotonic_time();
+    FrameTimes* times = static_cast<FrameTimes*>(user_data);
+    QMutexLocker locker(&times->mutex);
+    times->sizes.append(qint64(gst_buffer_get_size(buffer)));
+    if (!GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT)) times->keyframes++;
+    const auto it = times->pending.find(GST_BUFFER_PTS(buffer));
+    if (it != times->pending.end()) {
+        times->latenciesMs.append((now - it.value()) / 1000.0);
+        times->pending.erase(it);
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+} // namespace
+
+double EncoderProbe::Result::cost() const
+{
+    return p95Ms + CPU_WEIGHT_MS * cpuPercent / 100.0;
+}
+
+EncoderProbe::Result EncoderProbe::measure(const PipelineBuilder::Options& options, const StreamTier& tier, int frames,
+    int pliIntervalMs)
+{
+    Result result;
+    result.encoder = options.encoder;
+
+    PipelineBuilder::Options testOptions = options;
+    testOptions.video = PipelineBuilder::VideoSource::Test;
+    const PipelineBuilder builder(testOptions);
+
+    // Fonte ao vivo: o encoder recebe quadros no ritmo real, como no stream
+    const QString description = QString(
+        "videotestsrc is-live=true num-buffers=%1 pattern=ball ! "
+        "video/x-raw,format=I420,width=%2,height=%3,framerate=%4/1 ! "
+        "%5 ! fakesink sync=false async=false")
+        .arg(frames).arg(tier.width).arg(tier.height).arg(tier.framerate)
+        .arg(builder.encoderDescription(tier));
+
+    GError* error = nullptr;
+    GstElement* pipeline = gst_parse_launch(description.toUtf8().constData(), &error);
+    if (!pipeline) {
+        result.error = error ? QString::fromUtf8(error->message) : QString("falha ao montar o pipeline");
+        g_clear_error(&error);
+        return result;
+    }
+    g_clear_error(&error);
+
+    FrameTimes times;
+    GstElement* enc = gst_bin_get_by_name(GST_BIN(pipeline), "enc");
+    GstPad* sinkPad = gst_element_get_static_pad(enc, "sink");
+    GstPad* srcPad = gst_element_get_static_pad(enc, "src");
+    gst_pad_add_probe(sinkPad, GST_PAD_PROBE_TYPE_BUFFER, encoder_in_cb, &times, nullptr);
+    gst_pad_add_probe(srcPad, GST_PAD_PROBE_TYPE_BUFFER, encoder_out_cb, &times, nullptr);
+    gst_object_unref(sinkPad);
+    gst_object_unref(srcPad);
+
+    const double cpuStart = Metrics::processCpuMs();
+    const gint64 wallStart = g_get_monotonic_time();
+
+    if (gst_element_set_state(pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+        result.error = "o encoder não iniciou";
+    }
+    else {
+        // Folga para a abertura do encoder (a sessão do NVENC demora)
+        const gint64 deadlineUs = wallStart + (gint64(frames) * 1000 / qMax(1, tier.framerate) + 5000) * 1000;
+        gint64 nextPliUs = pliIntervalMs > 0 ? wallStart + gint64(pliIntervalMs) * 1000 : G_MAXINT64;
+        GstBus* bus = gst_element_get_bus(pipeline);
+        GstMessage* msg = nullptr;
+        for (gint64 nowUs = wallStart; !msg && nowUs < deadlineUs; nowUs = g_get_monotonic_time()) {
+            msg = gst_bus_timed_pop_filtered(bus, (qMin(deadlineUs, nextPliUs) - nowUs) * GST_USECOND,
+                GstMessageType(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+            // Mesmo evento do ScreenStreamer::forceKeyframe
+            if (!msg && g_get_monotonic_time() >= nextPliUs) {
+                gst_element_send_event(enc, gst_video_event_new_downstream_force_key_unit(
+                    GST_CLOCK_TIME_NONE, GST_CLOCK_TIME_NONE, GST_CLOCK_TIME_NONE, TRUE, 0));
+                result.plis++;
+                nextPliUs += gint64(pliIntervalMs) * 1000;
+            }
+        }
+        if (!msg) {
+            result.error = "tempo esgotado";
+        }
+        else if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR) {
+            GError* runError = nullptr;
+            gst_message_parse_error(msg, &runError, nullptr);
+            result.error = runError ? QString::fromUtf8(runError->message) : QString("erro ao codificar");
+            g_clear_error(&runError);
+        }
+        if (msg) gst_message_unref(msg);
+        gst_object_unref(bus);
+    }
+
+    const double wallMs = (g_get_monotonic_time() - wallStart) / 1000.0;
+    const double cpuMs = Metrics::processCpuMs() - cpuStart;
+
+    gst_object_unref(enc);
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(pipeline);
+
+    QVector<double> latencies = times.latenciesMs;
+    result.frames = latencies.size();
+    if (result.error.isEmpty() && latencies.isEmpty()) result.error = "nenhum quadro codificado";
+    if (!result.error.isEmpty()) return result;
+
+    std::sort(latencies.begin(), latencies.end());
+    double sum = 0.0;
+    for (double ms : latencies) sum += ms;
+    result.avgMs = sum / latencies.size();
+    result.p95Ms = latencies.at(qMax(0, int(std::ceil(latencies.size() * 0.95)) - 1));
+    result.cpuPercent = wallMs > 0.0 ? cpuMs * 100.0 / wallMs : 0.0;
+
+    if (!times.sizes.isEmpty()) {
+        double bytes = 0.0;
+        for (qint64 size : times.sizes) bytes += size;
+        result.avgBytes = bytes / times.sizes.size();
+        double variance = 0.0;
+        for (qint64 size : times.sizes) variance += (size - result.avgBytes) * (size - result.avgBytes);
+        result.stddevBytes = std::sqrt(variance / times.sizes.size());
+        result.maxBytes = *std::max_element(times.sizes.begin(), times.sizes.end());
+    }
+    result.keyframes = times.keyframes;
+    result.works = true;
+    return result;
+}
+
+QVector<EncoderProbe::Result> EncoderProbe::run(const StreamTier& tier, int frames)
+{
+    if (!gst_is_initialized()) gst_init(nullptr, nullptr);
+
+    QVector<Result> results;
+    for (PipelineBuilder::Encoder encoder : CANDIDATES) {
+        if (!PipelineBuilder::hasElement(factoryOf(encoder))) continue;
+        PipelineBuilder::Options options;
+        options.encoder = encoder;
+        const Result result = measure(options, tier, frames);
+        if (result.works) {
+            LOG_INFO("stream", "Encoder %s em %s: p95 %.2f ms, CPU %.0f%%", factoryOf(encoder),
+                tier.name().toUtf8().constData(), result.p95Ms, result.cpuPercent);
+        }
+        else {
+            LOG_WARNING("stream", "Encoder %s falhou na medição: %s", factoryOf(encoder), result.error.toUtf8().constData());
+        }
+        results.append(result);
+    }
+    return results;
+}
+
+QVector<PipelineBuilder::Encoder> EncoderProbe::ranking(const QVector<Result>& results, int framerate)
+{
+    QVector<Result> working;
+    for (const Result& result : results) {
+        if (result.works) working.append(result);
+    }
+
+    const double frameBudgetMs = 1000.0 / qMax(1, framerate);
+    std::stable_sort(working.begin(), working.end(), [frameBudgetMs](const Result& a, const Result& b) {
+        const bool aKeepsUp = a.p95Ms <= frameBudgetMs;
+        const bool bKeepsUp = b.p95Ms <= frameBudgetMs;
+        if (aKeepsUp != bKeepsUp) return aKeepsUp;
+        return a.cost() < b.cost();
+    });
+
+    QVector<PipelineBuilder::Encoder> order;
+    for (const Result& result : working) order.append(result.encoder);
+    return order;
+}
+
+QString EncoderProbe::fingerprint(const StreamTier& tier)
+{
+    if (!gst_is_initialized()) gst_init(nullptr, nullptr);
+
+    gchar* gstVersion = gst_version_string();
+    QStringList parts;
+    parts << QString::fromUtf8(gstVersion);
+    g_free(gstVersion);
+
+    for (PipelineBuilder::Encoder encoder : CANDIDATES) {
+        GstElementFactory* factory = gst_element_factory_find(factoryOf(encoder));
+        if (!factory) continue;
+        GstPlugin* plugin = gst_plugin_feature_get_plugin(GST_PLUGIN_FEATURE(factory));
+        parts << QString("%1 %2").arg(QLatin1String(factoryOf(encoder)),
+            QLatin1String(plugin ? gst_plugin_get_version(plugin) : "?"));
+        if (plugin) gst_object_unref(plugin);
+        gst_object_unref(factory);
+    }
+
+    parts << videoDriverStamp() << tier.name();
+    return parts.join(';');
+}
+
+QString EncoderProbe::defaultCachePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/encoder_probe.ini";
+}
+
+bool EncoderProbe::loadCache(const QString& path, const QString& fingerprint, QVector<PipelineBuilder::Encoder>& ranking)
+{
+    if (!QFile::exists(path)) return false;
+
+    QSettings settings(path, QSettings::IniFormat);
+    if (settings.value("fingerprint").toString() != fingerprint) return false;
+
+    ranking.clear();
+    for (const QString& name : settings.value("ranking").toStringList()) {
+        PipelineBuilder::Encoder encoder;
+        if (!PipelineBuilder::parseEncoder(name, encoder) || encoder == PipelineBuilder::Encoder::Auto) return false;
+        ranking.append(encoder);
+    }
+    // Nada funcionou da última vez: mede de novo
+    return !ranking.isEmpty();
+}
+
+void EncoderProbe::saveCache(const QString& path, const QString& fingerprint,
+    const QVector<Result>& results, const QVector<PipelineBuilder::Encoder>& ranking)
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QSettings settings(path, QSettings::IniFormat);
+    settings.clear();
+    settings.setValue("fingerprint", fingerprint);
+    settings.setValue("measured_at", QDateTime::currentDateTime().toString(Qt::ISODate));
+
+    QStringList names;
+    for (PipelineBuilder::Encoder encoder : ranking) names << PipelineBuilder::encoderName(encoder);
+    settings.setValue("ranking", names);
+
+    // Medições só para consulta (a escolha usa 'ranking')
+    for (const Result& result : results) {
+        settings.beginGroup(PipelineBuilder::encoderName(result.encoder));
+        settings.setValue("works", result.works);
+        if (result.works) {
+            settings.setValue("avg_ms", result.avgMs);
+            settings.setValue("p95_ms", result.p95Ms);
+            settings.setValue("cpu_percent", result.cpuPercent);
+        }
+        else {
+            settings.setValue("error", result.error);
+        }
+        settings.endGroup();
+    }
+    settings.sync();
+}
+
+QStringList EncoderProbe::report(const QVector<Result>& results, const QVector<PipelineBuilder::Encoder>& ranking)
+{
+    QStringList lines;
+    if (results.isEmpty()) {
+        lines << "Nenhum encoder de vídeo instalado";
+        return lines;
+    }
+
+    for (const Result& result : results) {
+        if (result.works) {
+            lines << QString("%1: média %2 ms, p95 %3 ms, CPU %4% (%5 quadros)")
+                .arg(QLatin1String(factoryOf(result.encoder)))
+                .arg(result.avgMs, 0, 'f', 2)
+                .arg(result.p95Ms, 0, 'f', 2)
+                .arg(result.cpuPercent, 0, 'f', 0)
+                .arg(result.frames);
+        }
+        else {
+            lines << QString("%1: falhou (%2)").arg(QLatin1String(factoryOf(result.encoder)), result.error);
+        }
+    }
+
+    QStringList names;
+    for (PipelineBuilder::Encoder encoder : ranking) names << PipelineBuilder::encoderName(encoder);
+    lines << QString("Ordem: %1").arg(names.isEmpty() ? QString("padrão (nenhum funcionou)") : names.join(" > "));
+    return lines;
+}
+
+QStringList EncoderProbe::compareKeyframeModes(const StreamTier& tier, int frames)
+{
+    if (!gst_is_initialized()) gst_init(nullptr, nullptr);
+
+    QStringList lines;
+    PipelineBuilder::Encoder encoder = PipelineBuilder::Encoder::Auto;
+    if (PipelineBuilder::hasElement(factoryOf(PipelineBuilder::Encoder::X264))) {
+        encoder = PipelineBuilder::Encoder::X264;
+    }
+    else {
+        for (PipelineBuilder::Encoder candidate : CANDIDATES) {
+            if (PipelineBuilder::hasElement(factoryOf(candidate))) { encoder = candidate; break; }
+        }
+    }
+    if (encoder == PipelineBuilder::Encoder::Auto) {
+        lines << "Nenhum encoder de vídeo instalado";
+        return lines;
+    }
+
+    struct Mode { const char* label; int intervalS; bool intraRefresh; };
+    const Mode modes[] = {
+        { "keyframe a cada 1 s", 1, false },
+        { "só PLI", PipelineBuilder::KEYFRAME_SAFETY_S, false },
+        { "intra-refresh", 0, true },
+    };
+
+    lines << QString("%1 em %2, %3 quadros, PLI a cada %4 ms")
+        .arg(QLatin1String(factoryOf(encoder)), tier.name()).arg(frames).arg(BENCH_PLI_INTERVAL_MS);
+    // O primeiro modo é o de antes (keyframe fixo a cada 1 s): os outros são
+    // comparados com ele no desvio e no maior quadro
+    Result before;
+    for (const Mode& mode : modes) {
+        PipelineBuilder::Options options;
+        options.encoder = encoder;
+        options.keyframeIntervalS = mode.intervalS;
+        options.intraRefresh = mode.intraRefresh;
+        if (mode.intraRefresh && !PipelineBuilder(options).intraRefreshActive()) {
+            lines << QString("%1: não suportado por %2").arg(QLatin1String(mode.label), QLatin1String(factoryOf(encoder)));
+            continue;
+        }
+
+        const Result result = measure(options, tier, frames, mode.intraRefresh ? 0 : BENCH_PLI_INTERVAL_MS);
+        if (!result.works) {
+            lines << QString("%1: falhou (%2)").arg(QLatin1String(mode.label), result.error);
+            continue;
+        }
+        lines << QString("%1: média %2 B, desvio %3 B, máx %4 B, %5 keyframes (%6 PLIs), p95 %7 ms")
+            .arg(QLatin1String(mode.label))
+            .arg(result.avgBytes, 0, 'f', 0)
+            .arg(result.stddevBytes, 0, 'f', 0)
+            .arg(result.maxBytes)
+            .arg(result.keyframes)
+            .arg(result.plis)
+            .arg(result.p95Ms, 0, 'f', 2);
+        if (&mode == &modes[0]) {
+            before = result;
+        }
+        else if (before.works && before.stddevBytes > 0.0 && before.maxBytes > 0) {
+            lines << QString("  contra %1: desvio %2x (variância %3x), máx %4x")
+                .arg(QLatin1String(modes[0].label))
+                .arg(result.stddevBytes / before.stddevBytes, 0, 'f', 2)
+                .arg((result.stddevBytes * result.stddevBytes) / (before.stddevBytes * before.stddevBytes), 0, 'f', 2)
+                .arg(double(result.maxBytes) / before.maxBytes, 0, 'f', 2);
+        }
+    }
+    return lines;
+}
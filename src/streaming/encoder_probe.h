@@ -0,0 +1,74 @@
+#ifndef ENCODER_PROBE_H
+#define ENCODER_PROBE_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "pipeline_builder.h"
+#include "stream_tiers.h"
+
+// Mede cada encoder instalado codificando um trecho sintético na resolução da
+// maior camada: latência por quadro (entrada -> saída do encoder) e CPU do
+// processo. Pega o NVENC que abre mas falha ao rodar (driver velho, sem GPU).
+// O resultado fica em cache por máquina e só é refeito quando o GStreamer,
+// os plugins, o driver de vídeo ou a camada mudam.
+// A CPU é a do processo inteiro: rode num processo que não faz mais nada
+// (--bench-encoders, que o ScreenStreamer dispara como filho).
+class EncoderProbe
+{
+public:
+    struct Result {
+        PipelineBuilder::Encoder encoder = PipelineBuilder::Encoder::Auto;
+        bool works = false;
+        QString error;
+        int frames = 0;             // Quadros que saíram do encoder
+        double avgMs = 0.0;
+        double p95Ms = 0.0;
+        double cpuPercent = 0.0;    // 100 = um núcleo inteiro
+        // Tamanho dos quadros codificados: o desvio mostra os picos de keyframe
+        double avgBytes = 0.0;
+        double stddevBytes = 0.0;
+        qint64 maxBytes = 0;
+        int keyframes = 0;
+        int plis = 0;               // Pedidos de keyframe injetados durante a medição
+
+        // Menor é melhor: p95 mais o peso da CPU (o jogo divide a máquina)
+        double cost() const;
+    };
+
+    // Quadros por encoder (a fonte é ao vivo: ~1,5 s a 60 fps)
+    static const int DEFAULT_FRAMES = 90;
+    // Um núcleo inteiro ocupado pesa como esta latência extra
+    static constexpr double CPU_WEIGHT_MS = 5.0;
+
+    static QVector<Result> run(const StreamTier& tier, int frames = DEFAULT_FRAMES);
+
+    // Encoders que funcionaram, do melhor para o pior. Quem não acompanha a
+    // taxa da camada (p95 acima do intervalo entre quadros) vai para o fim
+    static QVector<PipelineBuilder::Encoder> ranking(const QVector<Result>& results, int framerate);
+
+    // Versão do GStreamer + plugins dos encoders + driver de vídeo + camada
+    static QString fingerprint(const StreamTier& tier);
+    static QString defaultCachePath();
+    static bool loadCache(const QString& path, const QString& fingerprint, QVector<PipelineBuilder::Encoder>& ranking);
+    static void saveCache(const QString& path, const QString& fingerprint,
+        const QVector<Result>& results, const QVector<PipelineBuilder::Encoder>& ranking);
+
+    static QStringList report(const QVector<Result>& results, const QVector<PipelineBuilder::Encoder>& ranking);
+
+    // Mesmo trecho com keyframe a cada 1 s (como era), só o de segurança
+    // (KEYFRAME_SAFETY_S, recuperação por PLI) e intra-refresh (se o encoder
+    // suportar). Usa o x264 quando instalado. Simula um cliente em Wi-Fi com
+    // perda: um PLI a cada BENCH_PLI_INTERVAL_MS vira keyframe nos dois
+    // primeiros modos; no intra-refresh o streamer descarta o PLI (a renovação
+    // cobre) e a medição também
+    static const int BENCH_PLI_INTERVAL_MS = 2000;
+    static QStringList compareKeyframeModes(const StreamTier& tier, int frames);
+
+private:
+    // 'pliIntervalMs' > 0: force-key-unit no encoder nesse ritmo, como o requestKeyframe do streamer
+    static Result measure(const PipelineBuilder::Options& options, const StreamTier& tier, int frames,
+        int pliIntervalMs = 0);
+};
+
+#endif // ENCODER_PROBE_H
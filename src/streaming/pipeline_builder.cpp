@@ -0,0 +1,398 @@
+﻿#include "pipeline_builder.h"
+#include "../utils/log.h"
+#include <QtGlobal>
+
+namespace {
+
+struct VideoSourceEntry {
+    PipelineBuilder::VideoSource source;
+    const char* name;
+    const char* factory;
+};
+
+struct EncoderEntry {
+    PipelineBuilder::Encoder encoder;
+    const char* name;
+    const char* factory;
+};
+
+struct AudioSourceEntry {
+    PipelineBuilder::AudioSource source;
+    const char* name;
+    const char* factory;
+};
+
+// Ordem = preferência do modo automático
+const VideoSourceEntry VIDEO_SOURCES[] = {
+    { PipelineBuilder::VideoSource::D3D11, "d3d11", "d3d11screencapturesrc" },
+    { PipelineBuilder::VideoSource::PipeWire, "pipewire", "pipewiresrc" },
+    { PipelineBuilder::VideoSource::XImage, "ximage", "ximagesrc" },
+    { PipelineBuilder::VideoSource::Test, "test", "videotestsrc" },
+};
+
+const EncoderEntry ENCODERS[] = {
+    { PipelineBuilder::Encoder::Nvenc, "nvenc", "nvh264enc" },
+    { PipelineBuilder::Encoder::X264, "x264", "x264enc" },
+    { PipelineBuilder::Encoder::OpenH264, "openh264", "openh264enc" },
+    { PipelineBuilder::Encoder::Vp8, "vp8", "vp8enc" },
+};
+
+const AudioSourceEntry AUDIO_SOURCES[] = {
+    { PipelineBuilder::AudioSource::Wasapi, "wasapi", "wasapisrc" },
+    { PipelineBuilder::AudioSource::Pulse, "pulse", "pulsesrc" },
+    { PipelineBuilder::AudioSource::Test, "test", "audiotestsrc" },
+};
+
+const char* videoFactory(PipelineBuilder::VideoSource source)
+{
+    for (const VideoSourceEntry& entry : VIDEO_SOURCES) {
+        if (entry.source == source) return entry.factory;
+    }
+    return "";
+}
+
+const char* encoderFactoryOf(PipelineBuilder::Encoder encoder)
+{
+    for (const EncoderEntry& entry : ENCODERS) {
+        if (entry.encoder == encoder) return entry.factory;
+    }
+    return "";
+}
+
+const char* audioFactory(PipelineBuilder::AudioSource source)
+{
+    for (const AudioSourceEntry& entry : AUDIO_SOURCES) {
+        if (entry.source == source) return entry.factory;
+    }
+    return "";
+}
+
+// Caps (Mantém compatibilidade Android)
+const char* H264_CAPS = "video/x-h264,profile=baseline,stream-format=byte-stream,alignment=au";
+
+} // namespace
+
+PipelineBuilder::PipelineBuilder(const Options& options)
+    : m_options(options), m_video(options.video), m_encoder(options.encoder), m_audio(options.audio)
+{
+}
+
+bool PipelineBuilder::hasElement(const char* factory)
+{
+    GstElementFactory* found = gst_element_factory_find(factory);
+    if (found) gst_object_unref(found);
+    return found != nullptr;
+}
+
+bool PipelineBuilder::encoderAvailable(Encoder encoder) const
+{
+    return hasElement(encoderFactoryOf(encoder));
+}
+
+QVector<PipelineBuilder::Encoder> PipelineBuilder::encoderOrder() const
+{
+    if (!m_options.ranking.isEmpty()) return m_options.ranking;
+
+    QVector<Encoder> order;
+    for (const EncoderEntry& entry : ENCODERS) order.append(entry.encoder);
+    return order;
+}
+
+bool PipelineBuilder::probe(QString& error)
+{
+    if (!hasElement("webrtcbin") || !hasElement("opusenc")) {
+        error = "Plugins do GStreamer para WebRTC/Opus não encontrados (webrtcbin, opusenc).";
+        return false;
+    }
+
+    // Captura: explícita ou a primeira que existe e tem sessão gráfica. O
+    // PipeWire fica de fora do automático: sem o nó vindo do portal ele não
+    // captura a tela
+    m_video = m_options.video;
+    if (m_video == VideoSource::Auto) {
+        if (qEnvironmentVariableIsSet("WAYLAND_DISPLAY") && !hasElement("d3d11screencapturesrc")) {
+            LOG_WARNING("gst", "Sessão Wayland: o X11 só vê as janelas do XWayland. Para a tela inteira use "
+                "--stream-source pipewire com --stream-pipewire-node");
+        }
+        if (hasElement("d3d11screencapturesrc")) m_video = VideoSource::D3D11;
+        else if (qEnvironmentVariableIsSet("DISPLAY") && hasElement("ximagesrc")) m_video = VideoSource::XImage;
+        else if (hasElement("videotestsrc")) {
+            m_video = VideoSource::Test;
+            LOG_WARNING("gst", "Nenhuma captura de tela disponível: usando a fonte sintética");
+        }
+        else {
+            error = "Nenhuma fonte de vídeo disponível.";
+            return false;
+        }
+    }
+    else if (!hasElement(videoFactory(m_video))) {
+        error = QString("Fonte de vídeo '%1' indisponível (%2).").arg(QLatin1String(videoSourceName(m_video)), QLatin1String(videoFactory(m_video)));
+        return false;
+    }
+    else if (m_video == VideoSource::PipeWire && m_options.pipewireNode.isEmpty()) {
+        error = "A captura PipeWire precisa do nó da tela (--stream-pipewire-node, do ScreenCast do portal).";
+        return false;
+    }
+
+    m_encoder = m_options.encoder;
+    if (m_encoder == Encoder::Auto) {
+        for (Encoder candidate : encoderOrder()) {
+            if (encoderAvailable(candidate)) {
+                m_encoder = candidate;
+                break;
+            }
+        }
+        if (m_encoder == Encoder::Auto) {
+            error = "Nenhum encoder de vídeo disponível (nvh264enc, x264enc, openh264enc, vp8enc).";
+            return false;
+        }
+    }
+    else if (!encoderAvailable(m_encoder)) {
+        error = QString("Encoder '%1' indisponível (%2).").arg(QLatin1String(encoderName(m_encoder)), QLatin1String(encoderFactoryOf(m_encoder)));
+        return false;
+    }
+
+    m_audio = m_options.audio;
+    if (m_audio == AudioSource::Auto) {
+        for (const AudioSourceEntry& entry : AUDIO_SOURCES) {
+            if (hasElement(entry.factory)) {
+                m_audio = entry.source;
+                break;
+            }
+        }
+        if (m_audio == AudioSource::Auto) {
+            error = "Nenhuma fonte de áudio disponível.";
+            return false;
+        }
+    }
+    else if (!hasElement(audioFactory(m_audio))) {
+        error = QString("Fonte de áudio '%1' indisponível (%2).").arg(QLatin1String(audioSourceName(m_audio)), QLatin1String(audioFactory(m_audio)));
+        return false;
+    }
+
+    return true;
+}
+
+bool PipelineBuilder::fallbackEncoder()
+{
+    // Encoder escolhido pelo usuário não troca sozinho
+    if (m_options.encoder != Encoder::Auto) return false;
+
+    bool passed = false;
+    for (Encoder candidate : encoderOrder()) {
+        if (candidate == m_encoder) {
+            passed = true;
+            continue;
+        }
+        if (passed && encoderAvailable(candidate)) {
+            m_encoder = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+QString PipelineBuilder::captureDescription(int framerate, int width, int height) const
+{
+    switch (m_video) {
+    case VideoSource::D3D11:
+        return QString("d3d11screencapturesrc show-cursor=true ! "
+            "video/x-raw(memory:D3D11Memory),framerate=%1/1").arg(framerate);
+    case VideoSource::PipeWire:
+        // Taxa variável (só manda quadro quando a tela muda): as camadas fixam a delas
+        return QString("pipewiresrc path=%1 do-timestamp=true ! videoconvert").arg(m_options.pipewireNode);
+    case VideoSource::XImage:
+        return QString("ximagesrc use-damage=false show-pointer=true ! "
+            "video/x-raw,framerate=%1/1 ! videoconvert").arg(framerate);
+    case VideoSource::Test:
+    default:
+        return QString("videotestsrc is-live=true pattern=ball ! "
+            "video/x-raw,width=%1,height=%2,framerate=%3/1").arg(width).arg(height).arg(framerate);
+    }
+}
+
+QString PipelineBuilder::audioSourceDescription() const
+{
+    switch (m_audio) {
+    case AudioSource::Wasapi:
+        return "wasapisrc loopback=true buffer-time=10000"; // ⚡ buffer-time=10ms (padrão é 200ms)
+    case AudioSource::Pulse:
+        // Monitor da saída padrão = o que está tocando (equivale ao loopback do WASAPI)
+        return "pulsesrc device=@DEFAULT_MONITOR@ buffer-time=10000";
+    case AudioSource::Test:
+    default:
+        return "audiotestsrc is-live=true wave=ticks volume=0.3";
+    }
+}
+
+QString PipelineBuilder::tierDescription(const StreamTier& tier) const
+{
+    QString scale;
+    if (m_video == VideoSource::D3D11) {
+        // Escala na GPU e descarta quadros até a taxa da camada
+        scale = QString(
+            "queue leaky=2 max-size-buffers=1 ! "
+            "d3d11convert ! video/x-raw(memory:D3D11Memory),width=%1,height=%2 ! "
+            "videorate drop-only=true ! video/x-raw(memory:D3D11Memory),framerate=%3/1")
+            .arg(tier.width).arg(tier.height).arg(tier.framerate);
+        // Só o NVENC lê direto da memória D3D11
+        if (m_encoder != Encoder::Nvenc) scale += " ! d3d11download ! queue max-size-buffers=1 ! videoconvert";
+    }
+    else {
+        scale = QString(
+            "queue leaky=2 max-size-buffers=1 ! "
+            "videoconvert ! videoscale ! video/x-raw,width=%1,height=%2 ! "
+            "videorate drop-only=true ! video/x-raw,framerate=%3/1")
+            .arg(tier.width).arg(tier.height).arg(tier.framerate);
+    }
+
+    return scale + " ! " + encoderDescription(tier);
+}
+
+QString PipelineBuilder::encoderDescription(const StreamTier& tier) const
+{
+    // Todos começam no teto da camada (o BitrateController ajusta depois).
+    // Keyframe periódico só como rede de segurança (KEYFRAME_SAFETY_S): os
+    // clientes pedem o seu por PLI/FIR. Com intra-refresh o período é de 1 s,
+    // mas em faixas de macroblocos, sem quadro I inteiro
+    const bool refresh = intraRefreshActive();
+    const int intervalS = m_options.keyframeIntervalS > 0 ? m_options.keyframeIntervalS : KEYFRAME_SAFETY_S;
+    const int gop = refresh ? tier.framerate : tier.framerate * intervalS;
+    QString encoder;
+    switch (m_encoder) {
+    case Encoder::Nvenc:
+        // rc-mode=cbr: Taxa constante evita picos de lag.
+        // preset=low-latency: Prioriza tempo de resposta sobre qualidade de compressão.
+        encoder = QString(
+            "nvh264enc name=enc preset=low-latency zerolatency=true "
+            "bitrate=%1 rc-mode=cbr qp-min=15 qp-max=40 gop-size=%2 aud=false ! %3")
+            .arg(tier.kbps).arg(gop).arg(H264_CAPS);
+        break;
+    case Encoder::X264:
+        // zerolatency + sliced-threads: sem fila de quadros, cada quadro dividido entre threads
+        encoder = QString(
+            "x264enc name=enc tune=zerolatency speed-preset=ultrafast sliced-threads=true "
+            "bitrate=%1 vbv-buf-capacity=100 key-int-max=%2 bframes=0%3 ! %4")
+            .arg(tier.kbps).arg(gop).arg(QLatin1String(refresh ? " intra-refresh=true" : "")).arg(H264_CAPS);
+        break;
+    case Encoder::OpenH264:
+        encoder = QString(
+            "openh264enc name=enc usage-type=screen complexity=low rate-control=bitrate "
+            "bitrate=%1 gop-size=%2 ! %3")
+            .arg(tier.kbps * 1000).arg(gop).arg(H264_CAPS);
+        break;
+    case Encoder::Vp8:
+    default:
+        // Fallback VP8 também otimizado para baixa latência (cpu-used=16 é o mais rápido)
+        encoder = QString(
+            "vp8enc name=enc deadline=1 cpu-used=16 target-bitrate=%1 keyframe-max-dist=%2")
+            .arg(tier.kbps * 1000).arg(gop);
+        break;
+    }
+
+    return encoder;
+}
+
+QString PipelineBuilder::payloaderDescription() const
+{
+    // 1. Otimização de Rede (MTU)
+    // mtu=1200: Evita fragmentação de pacotes em roteadores comuns, reduzindo jitter.
+    if (videoCodec() == "H264") return "rtph264pay config-interval=1 pt=96 aggregate-mode=1 mtu=1200";
+    return "rtpvp8pay pt=96";
+}
+
+bool PipelineBuilder::intraRefreshActive() const
+{
+    // Só o x264 expõe intra-refresh entre os encoders usados aqui
+    return m_options.intraRefresh && m_encoder == Encoder::X264;
+}
+
+QString PipelineBuilder::videoCodec() const
+{
+    return m_encoder == Encoder::Vp8 ? "VP8" : "H264";
+}
+
+const char* PipelineBuilder::encoderFactory() const
+{
+    return encoderFactoryOf(m_encoder);
+}
+
+QString PipelineBuilder::summary() const
+{
+    return QString("%1 + %2 + %3").arg(QLatin1String(videoFactory(m_video)), QLatin1String(encoderFactory()), QLatin1String(audioFactory(m_audio)));
+}
+
+bool PipelineBuilder::setEncoderBitrate(GstElement* encoder, int kbps)
+{
+    if (!encoder) return false;
+
+    // Cada encoder tem a sua unidade; todos aceitam a mudança com o pipeline rodando
+    const gchar* factory = GST_OBJECT_NAME(gst_element_get_factory(encoder));
+    if (g_str_equal(factory, "nvh264enc") || g_str_equal(factory, "x264enc")) {
+        g_object_set(encoder, "bitrate", guint(kbps), nullptr);
+    }
+    else if (g_str_equal(factory, "openh264enc")) {
+        g_object_set(encoder, "bitrate", guint(kbps) * 1000u, nullptr);
+    }
+    else if (g_str_equal(factory, "vp8enc")) {
+        g_object_set(encoder, "target-bitrate", gint(kbps) * 1000, nullptr);
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+bool PipelineBuilder::parseVideoSource(const QString& name, VideoSource& out)
+{
+    const QString v = name.trimmed().toLower();
+    if (v == "auto") { out = VideoSource::Auto; return true; }
+    for (const VideoSourceEntry& entry : VIDEO_SOURCES) {
+        if (v == QLatin1String(entry.name)) { out = entry.source; return true; }
+    }
+    return false;
+}
+
+bool PipelineBuilder::parseEncoder(const QString& name, Encoder& out)
+{
+    const QString v = name.trimmed().toLower();
+    if (v == "auto") { out = Encoder::Auto; return true; }
+    for (const EncoderEntry& entry : ENCODERS) {
+        if (v == QLatin1String(entry.name)) { out = entry.encoder; return true; }
+    }
+    return false;
+}
+
+bool PipelineBuilder::parseAudioSource(const QString& name, AudioSource& out)
+{
+    const QString v = name.trimmed().toLower();
+    if (v == "auto") { out = AudioSource::Auto; return true; }
+    for (const AudioSourceEntry& entry : AUDIO_SOURCES) {
+        if (v == QLatin1String(entry.name)) { out = entry.source; return true; }
+    }
+    return false;
+}
+
+const char* PipelineBuilder::videoSourceName(VideoSource source)
+{
+    for (const VideoSourceEntry& entry : VIDEO_SOURCES) {
+        if (entry.source == source) return entry.name;
+    }
+    return "auto";
+}
+
+const char* PipelineBuilder::encoderName(Encoder encoder)
+{
+    for (const EncoderEntry& entry : ENCODERS) {
+        if (entry.encoder == encoder) return entry.name;
+    }
+    return "auto";
+}
+
+const char* PipelineBuilder::audioSourceName(AudioSource source)
+{
+    for (const AudioSourceEntry& entry : AUDIO_SOURCES) {
+        if (entry.source == source) return entry.name;
+    }
+    return "auto";
+}
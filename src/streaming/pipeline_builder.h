@@ -0,0 +1,95 @@
+#ifndef PIPELINE_BUILDER_H
+#define PIPELINE_BUILDER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <gst/gst.h>
+#include "stream_tiers.h"
+
+// Monta as descrições gst-launch do stream a partir do que está instalado:
+// captura (D3D11, PipeWire, X11 ou sintética), encoder (NVENC, x264, VP8,
+// openh264) e áudio (WASAPI, PulseAudio ou sintético). O ScreenStreamer só
+// junta as peças; a fonte sintética permite rodar o stream sem tela (CI, Linux).
+class PipelineBuilder
+{
+public:
+    enum class VideoSource { Auto, D3D11, PipeWire, XImage, Test };
+    enum class Encoder { Auto, Nvenc, X264, Vp8, OpenH264 };
+    enum class AudioSource { Auto, Wasapi, Pulse, Test };
+
+    struct Options {
+        VideoSource video = VideoSource::Auto;
+        Encoder encoder = Encoder::Auto;
+        AudioSource audio = AudioSource::Auto;
+        // Ordem medida pelo EncoderProbe para o modo automático (vazio = ordem
+        // padrão). Encoders que falharam na medição ficam de fora
+        QVector<Encoder> ranking;
+        // Renovação gradual (faixas intra) no lugar dos quadros I periódicos
+        bool intraRefresh = false;
+        // Segundos entre keyframes periódicos (0 = KEYFRAME_SAFETY_S). Só para
+        // as medições: o stream usa o padrão
+        int keyframeIntervalS = 0;
+        // Nó do PipeWire com a tela (o que o ScreenCast do xdg-desktop-portal
+        // devolve). Sem ele o pipewiresrc pega o nó padrão, que não é a tela;
+        // como a negociação com o portal ainda não existe, a fonte PipeWire só
+        // vale pedida explicitamente e com o nó
+        QString pipewireNode;
+    };
+
+    // Intervalo do keyframe periódico fora do intra-refresh (os pedidos dos
+    // clientes cobrem perdas e entradas)
+    static const int KEYFRAME_SAFETY_S = 10;
+
+    explicit PipelineBuilder(const Options& options = Options());
+
+    // Resolve os "Auto" pelos elementos disponíveis. False (com 'error') se a
+    // peça pedida explicitamente não existir ou se não houver nenhuma opção
+    bool probe(QString& error);
+
+    // Captura até quadros brutos na taxa pedida (memória D3D11 ou de sistema).
+    // O tamanho só vale para a fonte sintética; as reais usam o da tela
+    QString captureDescription(int framerate, int width, int height) const;
+    QString audioSourceDescription() const;
+    // queue -> escala -> taxa -> encoder (name=enc) -> caps codificadas
+    QString tierDescription(const StreamTier& tier) const;
+    // Só o encoder (name=enc) -> caps codificadas, entrada em memória de sistema
+    QString encoderDescription(const StreamTier& tier) const;
+    QString payloaderDescription() const;
+
+    // Próximo encoder disponível na ordem de preferência (o ramo falhou ao subir)
+    bool fallbackEncoder();
+
+    VideoSource videoSource() const { return m_video; }
+    Encoder encoder() const { return m_encoder; }
+    AudioSource audioSource() const { return m_audio; }
+    // Intra-refresh pedido e suportado pelo encoder escolhido (só x264)
+    bool intraRefreshActive() const;
+    QString videoCodec() const;       // "H264" ou "VP8"
+    const char* encoderFactory() const;
+    QString summary() const;          // "d3d11 + nvh264enc + wasapi"
+
+    // Ajusta o bitrate de um encoder rodando, na unidade de cada um
+    static bool setEncoderBitrate(GstElement* encoder, int kbps);
+
+    static bool hasElement(const char* factory);
+
+    // Nomes usados na linha de comando ("auto", "d3d11", "x264"...)
+    static bool parseVideoSource(const QString& name, VideoSource& out);
+    static bool parseEncoder(const QString& name, Encoder& out);
+    static bool parseAudioSource(const QString& name, AudioSource& out);
+    static const char* videoSourceName(VideoSource source);
+    static const char* encoderName(Encoder encoder);
+    static const char* audioSourceName(AudioSource source);
+
+private:
+    bool encoderAvailable(Encoder encoder) const;
+    QVector<Encoder> encoderOrder() const;
+
+    Options m_options;
+    VideoSource m_video;
+    Encoder m_encoder;
+    AudioSource m_audio;
+};
+
+#endif // PIPELINE_BUILDER_H
@@ -1,14 +1,120 @@
 ﻿#include "screen_streamer.h"
 #include <QDebug>
-#include <QJsonDocument>
+#include "../utils/log.h"
+#include "../utils/metrics.h"
 #include <QTimer>
+#include <QProcess>
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QElapsedTimer>
+#include <algorithm>
+#include "encoder_probe.h"
 #include <gst/video/video.h>
+#include <gst/rtp/rtp.h>
+
+// Fim de cada ramo com tee: os clientes penduram aqui (Fakesink para manter vivo)
+static const char* TEE_SINK = "queue leaky=1 max-size-buffers=1 ! fakesink sync=true async=false";
+
+// Extensão RTP do TWCC (números de sequência de transporte para o rtpgccbwe)
+static const char* TWCC_EXTENSION_URI = "http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01";
 
 static void free_callback_data(gpointer data, GClosure* closure) {
     Q_UNUSED(closure);
     if (data) delete static_cast<CallbackData*>(data);
 }
 
+// Estimador de banda do TWCC (gst-plugins-rs); sem ele o controle usa só perda e RTT
+static bool hasBandwidthEstimator()
+{
+    static const bool available = PipelineBuilder::hasElement("rtpgccbwe");
+    return available;
+}
+
+// O dtlsdec sem 'pem' usa um certificado gerado uma vez por processo e
+// compartilhado por todos os webrtcbin. Gerar aqui tira a chave RSA da
+// entrada do primeiro cliente
+static void warmUpDtlsCertificate()
+{
+    static bool done = false;
+    if (done) return;
+    done = true;
+
+    QElapsedTimer timer;
+    timer.start();
+    GstElement* dtls = gst_element_factory_make("dtlsdec", nullptr);
+    if (!dtls) return;
+    gst_object_ref_sink(dtls);
+    gchar* pem = nullptr;
+    g_object_get(dtls, "pem", &pem, nullptr);
+    g_free(pem);
+    gst_object_unref(dtls);
+
+    static LatencyStat* warmUpStat = Metrics::instance().latency("stream.dtls_warmup_ms");
+    warmUpStat->record(timer.elapsed());
+    LOG_DEBUG("stream", "Certificado DTLS gerado em %lld ms", static_cast<long long>(timer.elapsed()));
+}
+
+QString IceConfig::summary() const
+{
+    QString text = lanOnly ? QString("LAN (só host)") : (stunServer.isEmpty() ? QString("sem STUN") : stunServer);
+    if (bindControlInterface) text += ", interface do controle";
+    return text;
+}
+
+// Aplica o modo de ICE no agente do webrtcbin (antes da primeira coleta).
+// O agente só é exposto a partir do GStreamer 1.22
+static void configureIceAgent(GstElement* webrtcbin, const IceConfig& config, const QHostAddress& controlAddress)
+{
+#if GST_CHECK_VERSION(1, 22, 0)
+    GstWebRTCICE* ice = nullptr;
+    g_object_get(webrtcbin, "ice-agent", &ice, nullptr);
+    if (!ice) return;
+
+    // Na LAN o UDP sempre passa: candidatos TCP só somam tempo na coleta
+    if (config.lanOnly && g_object_class_find_property(G_OBJECT_GET_CLASS(ice), "ice-tcp")) {
+        g_object_set(ice, "ice-tcp", FALSE, nullptr);
+    }
+
+    if (config.bindControlInterface && !controlAddress.isNull()) {
+        // Socket de pilha dupla entrega IPv4 mapeado (::ffff:a.b.c.d)
+        bool isV4 = false;
+        const quint32 v4 = controlAddress.toIPv4Address(&isV4);
+        QHostAddress address = isV4 ? QHostAddress(v4) : controlAddress;
+        address.setScopeId(QString());
+
+        // Também libera o loopback (tether USB com adb reverse)
+        if (!gst_webrtc_ice_add_local_ip_address(ice, address.toString().toUtf8().constData())) {
+            LOG_WARNING("stream", "Endereço %s recusado pelo agente ICE", address.toString().toUtf8().constData());
+        }
+    }
+    gst_object_unref(ice);
+#else
+    Q_UNUSED(webrtcbin);
+    if (config.bindControlInterface && !controlAddress.isNull()) {
+        LOG_WARNING("stream", "GStreamer < 1.22: coleta ICE sem restrição de interface");
+    }
+#endif
+}
+
+// Junta as entradas remote-inbound-rtp do get-stats (vídeo e áudio: fica o pior)
+static gboolean collect_remote_inbound_stats(GQuark field_id, const GValue* value, gpointer user_data)
+{
+    Q_UNUSED(field_id);
+    if (!GST_VALUE_HOLDS_STRUCTURE(value)) return TRUE;
+
+    const GstStructure* stats = gst_value_get_structure(value);
+    GstWebRTCStatsType type;
+    if (!gst_structure_get(stats, "type", GST_TYPE_WEBRTC_STATS_TYPE, &type, nullptr)) return TRUE;
+    if (type != GST_WEBRTC_STATS_REMOTE_INBOUND_RTP) return TRUE;
+
+    TransportSample* sample = static_cast<TransportSample*>(user_data);
+    double v = 0.0;
+    if (gst_structure_get_double(stats, "fraction-lost", &v)) sample->fractionLost = qMax(sample->fractionLost, v);
+    if (gst_structure_get_double(stats, "round-trip-time", &v)) sample->rttMs = qMax(sample->rttMs, v * 1000.0);
+    if (gst_structure_get_double(stats, "jitter", &v)) sample->jitterMs = qMax(sample->jitterMs, v * 1000.0);
+    return TRUE;
+}
+
 // Função de callback para linkar com segurança
 static GstPadProbeReturn link_client_pad_cb(GstPad* pad, GstPadProbeInfo* info, gpointer user_data) {
     Q_UNUSED(info);
@@ -31,13 +137,43 @@ static GstPadProbeReturn link_client_pad_cb(GstPad* pad, GstPadProbeInfo* info,
     return GST_PAD_PROBE_REMOVE;
 }
 
+// Descarta quadros delta até o primeiro keyframe (cliente novo ou trocando de
+// camada). Com intra-refresh o x264 marca como keyframe o quadro que abre cada
+// volta da renovação (ponto de recuperação, com SPS/PPS repetidos)
+static GstPadProbeReturn wait_keyframe_cb(GstPad* pad, GstPadProbeInfo* info, gpointer user_data) {
+    Q_UNUSED(pad);
+    GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    if (buffer && GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT)) return GST_PAD_PROBE_DROP;
+    static_cast<ClientStreamContext*>(user_data)->waiting_keyframe.storeRelease(0);
+    return GST_PAD_PROBE_REMOVE;
+}
+
 ScreenStreamer::ScreenStreamer(QObject* parent) : QObject(parent)
 {
     if (!gst_is_initialized()) gst_init(nullptr, nullptr);
+    qRegisterMetaType<SignalMessage>();
+
+    m_statsTimer = new QTimer(this);
+    m_statsTimer->setInterval(STATS_INTERVAL_MS);
+    connect(m_statsTimer, &QTimer::timeout, this, &ScreenStreamer::pollTransportStats);
+
+    m_idleTimer = new QTimer(this);
+    m_idleTimer->setSingleShot(true);
+    m_idleTimer->setInterval(IDLE_PAUSE_MS);
+    connect(m_idleTimer, &QTimer::timeout, this, &ScreenStreamer::pausePipeline);
+
+    // Depois do construtor: camadas e opções já configuradas por quem criou
+    QTimer::singleShot(0, this, &ScreenStreamer::startEncoderProbe);
 }
 
 ScreenStreamer::~ScreenStreamer()
 {
+    if (m_probeProcess) {
+        // Medição pela metade não grava o cache: a próxima execução mede de novo
+        m_probeProcess->disconnect(this);
+        m_probeProcess->kill();
+        m_probeProcess->waitForFinished(1000);
+    }
     stopMasterPipeline();
 }
 
@@ -57,6 +193,88 @@ void ScreenStreamer::setStreamingEnabled(bool enabled)
     emit streamStateChanged(enabled);
 }
 
+QString ScreenStreamer::activeVideoCodec() const
+{
+    if (!pipeline) return QString();
+    return m_builder.videoCodec();
+}
+
+void ScreenStreamer::setTiers(const StreamTierSet& tiers)
+{
+    m_tierConfig = tiers;
+}
+
+void ScreenStreamer::setPipelineOptions(const PipelineBuilder::Options& options)
+{
+    const QVector<PipelineBuilder::Encoder> ranking = m_pipelineOptions.ranking;
+    m_pipelineOptions = options;
+    if (m_pipelineOptions.ranking.isEmpty()) m_pipelineOptions.ranking = ranking;
+}
+
+void ScreenStreamer::startEncoderProbe()
+{
+    // Encoder escolhido na linha de comando ou ordem já dada: não há o que medir
+    if (m_probeProcess || m_pipelineOptions.encoder != PipelineBuilder::Encoder::Auto
+        || !m_pipelineOptions.ranking.isEmpty()) return;
+
+    const StreamTier tier = m_tierConfig.at(0);
+    const QString path = EncoderProbe::defaultCachePath();
+    const QString fingerprint = EncoderProbe::fingerprint(tier);
+
+    QVector<PipelineBuilder::Encoder> ranking;
+    if (EncoderProbe::loadCache(path, fingerprint, ranking)) {
+        applyEncoderRanking(ranking);
+        return;
+    }
+
+    // Primeira execução, driver ou plugins novos: mede em segundo plano. Se o
+    // stream subir antes de terminar, usa a ordem padrão desta vez. Roda num
+    // processo filho: a CPU do EncoderProbe é a do processo inteiro, e aqui ela
+    // somaria a janela, a entrada dos controles e um stream já no ar
+    LOG_INFO("stream", "Medindo os encoders em %s...", tier.name().toUtf8().constData());
+    m_probeProcess = new QProcess(this);
+    m_probeProcess->setProcessChannelMode(QProcess::MergedChannels);
+    connect(m_probeProcess, &QProcess::finished, this,
+        [this, path, fingerprint](int exitCode, QProcess::ExitStatus status) {
+            const QString output = QString::fromUtf8(m_probeProcess->readAll()).trimmed();
+            m_probeProcess->deleteLater();
+            m_probeProcess = nullptr;
+
+            QVector<PipelineBuilder::Encoder> ranking;
+            if (status != QProcess::NormalExit || exitCode != 0 || !EncoderProbe::loadCache(path, fingerprint, ranking)) {
+                LOG_WARNING("stream", "Medição dos encoders falhou (código %d): %s", exitCode,
+                    output.toUtf8().constData());
+                return;
+            }
+            for (const QString& line : output.split('\n', Qt::SkipEmptyParts)) {
+                LOG_INFO("stream", "%s", line.toUtf8().constData());
+            }
+            applyEncoderRanking(ranking);
+        });
+    connect(m_probeProcess, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+        if (error != QProcess::FailedToStart) return;
+        LOG_WARNING("stream", "Medição dos encoders não iniciou: %s", m_probeProcess->errorString().toUtf8().constData());
+        m_probeProcess->deleteLater();
+        m_probeProcess = nullptr;
+    });
+    m_probeProcess->start(QCoreApplication::applicationFilePath(), {
+        "--bench-encoders",
+        "--probe-tier", QString("%1:%2").arg(tier.name()).arg(tier.kbps),
+        "--probe-cache", path,
+    });
+}
+
+void ScreenStreamer::applyEncoderRanking(const QVector<PipelineBuilder::Encoder>& ranking)
+{
+    if (ranking.isEmpty()) return;
+
+    // Vale no próximo início: o pipeline no ar não troca de encoder
+    m_pipelineOptions.ranking = ranking;
+    QStringList names;
+    for (PipelineBuilder::Encoder encoder : ranking) names << PipelineBuilder::encoderName(encoder);
+    LOG_INFO("stream", "Ordem dos encoders: %s", names.join(" > ").toUtf8().constData());
+}
+
 void ScreenStreamer::startMasterPipeline()
 {
     if (pipeline) return;
@@ -67,17 +285,41 @@ void ScreenStreamer::stopMasterPipeline()
 {
     if (pipeline) {
         QMutexLocker locker(&m_clientsMutex);
+        m_statsTimer->stop();
+        m_idleTimer->stop();
+
         // Remove clientes antes de matar o mestre
-        for (auto ctx : m_clients) delete ctx;
+        for (auto ctx : m_clients) {
+            if (ctx->tee_pad) gst_object_unref(ctx->tee_pad);
+            if (GstElement* bwe = ctx->bandwidth_estimator.loadAcquire()) gst_object_unref(bwe);
+            delete ctx;
+        }
         m_clients.clear();
 
         gst_element_set_state(pipeline, GST_STATE_NULL);
+
+        // Os ramos das camadas morrem com o pipeline; aqui só as referências
+        for (TierBranch* branch : m_branches) {
+            if (branch->encoder) gst_object_unref(branch->encoder);
+            if (branch->tee) gst_object_unref(branch->tee);
+            if (branch->raw_pad) gst_object_unref(branch->raw_pad);
+            delete branch;
+        }
+        m_branches.clear();
+        if (tee_raw) gst_object_unref(tee_raw);
+        if (tee_audio) gst_object_unref(tee_audio);
+
         gst_object_unref(pipeline);
 
         pipeline = nullptr;
-        tee_video = nullptr;
+        tee_raw = nullptr;
         tee_audio = nullptr;
-        encoder_element = nullptr;
+        closePhase();
+        m_paused = false;
+        m_phaseStartMs = 0;
+        m_resumeStartUs.storeRelease(0);
+        Metrics::instance().counter("stream.tiers_active")->set(0);
+        Metrics::instance().counter("stream.paused")->set(0);
         qDebug() << "🛑 Pipeline Mestre parado e memória liberada.";
     }
 }
@@ -87,93 +329,64 @@ void ScreenStreamer::setupMasterPipeline()
     GError* error = nullptr;
 
     // --- CONFIGURAÇÃO ULTRA LOW LATENCY (COMPETITIVA) ---
+    // O mestre só captura: cada camada tem o seu ramo de escala + encoder,
+    // criado quando o primeiro cliente entra nela. Fonte, encoder e áudio
+    // vêm do PipelineBuilder conforme o que está instalado.
+    m_tiers = m_tierConfig;
+    m_builder = PipelineBuilder(m_pipelineOptions);
+    warmUpDtlsCertificate();
+
+    QString probeError;
+    if (!m_builder.probe(probeError)) {
+        qCritical() << "❌ FALHA TOTAL NO PIPELINE:" << probeError;
+        emit streamError(probeError);
+        return;
+    }
 
-    // 1. Otimização de Rede (MTU)
-    // mtu=1200: Evita fragmentação de pacotes em roteadores comuns, reduzindo jitter.
-    QString payloader = "rtph264pay config-interval=1 pt=96 aggregate-mode=1 mtu=1200";
-
-    // 2. Configuração do Encoder NVIDIA (Foco: VELOCIDADE)
-    // bitrate=8000: 8Mbps é suficiente para celular e muito mais leve para o Wi-Fi.
-    // rc-mode=cbr: Taxa constante evita picos de lag.
-    // preset=low-latency: Prioriza tempo de resposta sobre qualidade de compressão.
-    // gop-size=60: Keyframes regulares para resiliência (1 por segundo a 60fps)
-    QString videoEncoder =
-        "nvh264enc name=enc preset=low-latency zerolatency=true "
-        "bitrate=8000 rc-mode=cbr qp-min=15 qp-max=40 gop-size=60 aud=false";
-
-    // Caps (Mantém compatibilidade Android)
-    QString capsVideo = "video/x-h264,profile=baseline,stream-format=byte-stream,alignment=au";
+    // A captura roda na maior taxa entre as camadas; as outras descartam quadros
+    // (a fonte sintética usa o tamanho da maior camada)
+    int captureFps = 1;
+    for (int i = 0; i < m_tiers.count(); ++i) captureFps = qMax(captureFps, m_tiers.at(i).framerate);
+    const StreamTier& largest = m_tiers.at(0);
 
     // 3. Configuração de Áudio (Buffer mínimo = Latência mínima)
-    // buffer-time=10000: Reduz buffer de captura para ~10ms (padrão: 200ms)
     QString audioEncoder =
         "opusenc bitrate=96000 frame-size=10 audio-type=restricted-lowdelay inband-fec=true";
 
-    // Ramos do Tee (Fakesink para manter vivo)
-    QString masterEnd =
-        "tee name=t_vid allow-not-linked=true ! "
-        "queue leaky=1 max-size-buffers=1 ! fakesink sync=true async=false";
-
-    QString audioEnd =
-        "tee name=t_aud allow-not-linked=true ! "
-        "queue leaky=1 max-size-buffers=1 ! fakesink sync=true async=false";
-
     // --- MONTAGEM ---
 
-    QString videoBranch = QString(
-        "d3d11screencapturesrc show-cursor=true ! "
-        "video/x-raw(memory:D3D11Memory),framerate=60/1 ! "
-        "d3d11convert ! "
-        "%1 ! %2 ! " // Encoder + Caps
-        "%3 ! "      // Payloader
-        "%4").arg(videoEncoder, capsVideo, payloader, masterEnd);
+    QString videoBranch = QString("%1 ! tee name=t_raw allow-not-linked=true ! %2")
+        .arg(m_builder.captureDescription(captureFps, largest.width, largest.height), QLatin1String(TEE_SINK));
 
     QString audioBranch = QString(
-        "wasapisrc loopback=true buffer-time=10000 ! " // ⚡ buffer-time=10ms (padrão é 200ms)
+        "%1 ! "
         "audioconvert ! audioresample ! "
-        "%1 ! " // Opus Enc
+        "%2 ! " // Opus Enc
         "rtpopuspay pt=111 ! "
-        "%2").arg(audioEncoder, audioEnd);
+        "tee name=t_aud allow-not-linked=true ! %3")
+        .arg(m_builder.audioSourceDescription(), audioEncoder, QLatin1String(TEE_SINK));
 
     QString fullPipeline = videoBranch + " " + audioBranch;
 
-    qDebug() << "🔧 Inicializando Pipeline ULTRA LOW LATENCY (CBR 8Mbps)...";
+    qDebug() << "🔧 Inicializando Pipeline ULTRA LOW LATENCY (" << m_builder.summary() << ", camadas" << m_tiers.toString() << ")...";
     pipeline = gst_parse_launch(fullPipeline.toUtf8().constData(), &error);
 
-    if (error) {
-        // Fallback para Software (VP8) se NVENC falhar, mas mantendo Áudio otimizado
-        qWarning() << "⚠️ Hardware falhou:" << error->message << ". Usando VP8...";
-        g_error_free(error); error = nullptr;
-
-        // Fallback VP8 também otimizado para baixa latência
-        QString vp8Branch =
-            "d3d11screencapturesrc show-cursor=true ! "
-            "video/x-raw(memory:D3D11Memory),framerate=60/1 ! "
-            "d3d11download ! queue max-size-buffers=1 ! videoconvert ! "
-            "vp8enc deadline=1 cpu-used=16 target-bitrate=8000000 keyframe-max-dist=60 ! " // cpu-used=16 é o mais rápido
-            "rtpvp8pay pt=96 ! "
-            "tee name=t_vid allow-not-linked=true ! "
-            "queue leaky=1 ! fakesink sync=true async=false";
-
-        pipeline = gst_parse_launch((vp8Branch + " " + audioBranch).toUtf8().constData(), &error);
-    }
-
     if (!pipeline) {
         qCritical() << "❌ FALHA TOTAL NO PIPELINE:" << (error ? error->message : "");
-        if (error) {
-            qCritical() << "🔧 Erro GStreamer: " << error->message;
-            g_error_free(error);
-        }
+        if (error) g_error_free(error);
         emit streamError("Falha ao iniciar captura de tela e áudio.");
         return;
     }
+    if (error) {
+        qWarning() << "⚠️ Pipeline criado com aviso:" << error->message;
+        g_error_free(error);
+    }
 
-    tee_video = gst_bin_get_by_name(GST_BIN(pipeline), "t_vid");
+    tee_raw = gst_bin_get_by_name(GST_BIN(pipeline), "t_raw");
     tee_audio = gst_bin_get_by_name(GST_BIN(pipeline), "t_aud");
-    encoder_element = gst_bin_get_by_name(GST_BIN(pipeline), "enc"); // Pode ser nulo se for VP8
 
-    if (!tee_video) {
-        qCritical() << "❌ Elemento 't_vid' (tee vídeo) não encontrado no pipeline!";
+    if (!tee_raw) {
+        qCritical() << "❌ Elemento 't_raw' (tee da captura) não encontrado no pipeline!";
         stopMasterPipeline();
         return;
     }
@@ -189,11 +402,223 @@ void ScreenStreamer::setupMasterPipeline()
     gst_bus_set_sync_handler(bus, onBusMessage, this, nullptr);
     gst_object_unref(bus);
 
+    // Montado e pausado: captura e áudio só rodam com o primeiro cliente (resumePipeline)
+    gst_element_set_state(pipeline, GST_STATE_PAUSED);
+    m_paused = true;
+    closePhase();
+    Metrics::instance().counter("stream.paused")->set(1);
+    qDebug() << "✅ Servidor de Streaming A/V PRONTO (pausado até o primeiro cliente).";
+}
+
+void ScreenStreamer::pausePipeline()
+{
+    QMutexLocker locker(&m_clientsMutex);
+    if (!pipeline || m_paused || !m_clients.isEmpty()) return;
+
+    // Os ramos das camadas já saíram com o último cliente; sobra a captura e o áudio
+    closePhase();
+    gst_element_set_state(pipeline, GST_STATE_PAUSED);
+    m_paused = true;
+    m_resumeStartUs.storeRelease(0);
+    Metrics::instance().counter("stream.paused")->set(1);
+    LOG_INFO("stream", "Sem clientes há %d ms: captura e codificação pausadas", IDLE_PAUSE_MS);
+}
+
+void ScreenStreamer::resumePipeline()
+{
+    m_idleTimer->stop();
+    if (!pipeline || !m_paused) return;
+
+    closePhase();
+    m_paused = false;
+
+    // Tempo até o primeiro quadro capturado: o custo da pausa para quem entra.
+    // O keyframe sai sozinho (a camada nasce com o cliente) e a oferta força outro
+    m_resumeStartUs.storeRelease(g_get_monotonic_time());
+    GstPad* sink_pad = gst_element_get_static_pad(tee_raw, "sink");
+    gst_pad_add_probe(sink_pad, GST_PAD_PROBE_TYPE_BUFFER, onFirstFrameAfterResume, this, nullptr);
+    gst_object_unref(sink_pad);
+
     gst_element_set_state(pipeline, GST_STATE_PLAYING);
-    qDebug() << "✅ Servidor de Streaming A/V RODANDO (Modo Ultra Low Latency).";
+    Metrics::instance().counter("stream.paused")->set(0);
+    LOG_INFO("stream", "Cliente novo: retomando captura e codificação");
 }
 
-void ScreenStreamer::addClient(int playerIndex)
+void ScreenStreamer::closePhase()
+{
+    const qint64 nowMs = g_get_monotonic_time() / 1000;
+    const double cpuMs = Metrics::processCpuMs();
+    const qint64 elapsedMs = nowMs - m_phaseStartMs;
+
+    // CPU do processo em cada fase (1000 = um núcleo): a diferença entre
+    // rodando e pausado é o que a pausa economiza
+    if (m_phaseStartMs > 0 && elapsedMs > 0) {
+        static CounterStat* idleCpu = Metrics::instance().counter("stream.idle_cpu_permille");
+        static CounterStat* activeCpu = Metrics::instance().counter("stream.active_cpu_permille");
+        static CounterStat* idleTime = Metrics::instance().counter("stream.idle_ms");
+        const qint64 permille = qint64((cpuMs - m_phaseStartCpuMs) * 1000.0 / elapsedMs);
+        if (m_paused) {
+            idleCpu->set(permille);
+            idleTime->add(elapsedMs);
+        }
+        else {
+            activeCpu->set(permille);
+        }
+    }
+    m_phaseStartMs = nowMs;
+    m_phaseStartCpuMs = cpuMs;
+}
+
+TierBranch* ScreenStreamer::acquireTier(int index)
+{
+    if (TierBranch* branch = m_branches.value(index)) {
+        ++branch->clients;
+        return branch;
+    }
+
+    const StreamTier& tier = m_tiers.at(index);
+    auto describe = [this, &tier]() {
+        return QString("%1 ! tee name=t_vid allow-not-linked=true ! %2")
+            .arg(m_builder.tierDescription(tier), QLatin1String(TEE_SINK)).toUtf8();
+    };
+
+    GError* error = nullptr;
+    GstElement* bin = gst_parse_bin_from_description(describe().constData(), TRUE, &error);
+
+    // Fallback para o próximo encoder (NVENC -> x264 -> openh264 -> VP8) se o
+    // ramo não subir. Só sem outras camadas no ar: todas usam o mesmo encoder
+    while (!bin && m_branches.isEmpty() && m_builder.fallbackEncoder()) {
+        qWarning() << "⚠️ Encoder falhou:" << (error ? error->message : "") << ". Usando" << m_builder.encoderFactory() << "...";
+        g_clear_error(&error);
+        bin = gst_parse_bin_from_description(describe().constData(), TRUE, &error);
+    }
+
+    if (!bin) {
+        LOG_ERROR("stream", "Falha ao criar a camada %s: %s", tier.name().toUtf8().constData(), error ? error->message : "");
+        g_clear_error(&error);
+        return nullptr;
+    }
+    g_clear_error(&error);
+
+    TierBranch* branch = new TierBranch();
+    branch->index = index;
+    branch->bin = bin;
+    branch->encoder = gst_bin_get_by_name(GST_BIN(bin), "enc");
+    branch->tee = gst_bin_get_by_name(GST_BIN(bin), "t_vid");
+    branch->bitrate = BitrateController(m_tiers.bitrateConfig(index));
+    branch->clients = 1;
+    branch->owner = this;
+    branch->intra_refresh = m_builder.intraRefreshActive();
+
+    // PLI/FIR dos clientes sobem pelo tee até o encoder: passam pelo limitador.
+    // O tamanho de cada quadro mostra os picos de keyframe
+    if (branch->encoder) {
+        GstPad* enc_src = gst_element_get_static_pad(branch->encoder, "src");
+        gst_pad_add_probe(enc_src, GST_PAD_PROBE_TYPE_EVENT_UPSTREAM, onUpstreamKeyUnit, branch, nullptr);
+        gst_pad_add_probe(enc_src, GST_PAD_PROBE_TYPE_BUFFER, onEncodedFrame, branch, nullptr);
+        gst_object_unref(enc_src);
+    }
+
+    gst_bin_add(GST_BIN(pipeline), bin);
+
+    branch->raw_pad = gst_element_request_pad_simple(tee_raw, "src_%u");
+    GstPad* sink_pad = gst_element_get_static_pad(bin, "sink");
+    if (gst_pad_link(branch->raw_pad, sink_pad) != GST_PAD_LINK_OK) {
+        LOG_ERROR("stream", "Falha ao ligar a captura na camada %s", tier.name().toUtf8().constData());
+    }
+    gst_object_unref(sink_pad);
+
+    gst_element_sync_state_with_parent(bin);
+    m_branches.insert(index, branch);
+
+    static CounterStat* active = Metrics::instance().counter("stream.tiers_active");
+    active->set(m_branches.size());
+    LOG_INFO("stream", "Camada %s criada (%s, %d kbps)", tier.name().toUtf8().constData(),
+        m_builder.encoderFactory(), tier.kbps);
+    return branch;
+}
+
+void ScreenStreamer::releaseTier(int index)
+{
+    TierBranch* branch = m_branches.value(index);
+    if (!branch || --branch->clients > 0) return;
+
+    m_branches.remove(index);
+
+    // Mesmo procedimento da saída de um cliente: solta do tee e para o ramo
+    GstPad* sink_pad = gst_element_get_static_pad(branch->bin, "sink");
+    if (sink_pad) {
+        gst_pad_unlink(branch->raw_pad, sink_pad);
+        gst_object_unref(sink_pad);
+    }
+    gst_element_release_request_pad(tee_raw, branch->raw_pad);
+    gst_object_unref(branch->raw_pad);
+
+    gst_element_set_state(branch->bin, GST_STATE_NULL);
+    if (branch->encoder) gst_object_unref(branch->encoder);
+    if (branch->tee) gst_object_unref(branch->tee);
+    gst_bin_remove(GST_BIN(pipeline), branch->bin);
+
+    LOG_INFO("stream", "Camada %s encerrada (sem clientes)", m_tiers.at(index).name().toUtf8().constData());
+    delete branch;
+
+    Metrics::instance().counter("stream.tiers_active")->set(m_branches.size());
+}
+
+void ScreenStreamer::attachClientVideo(ClientStreamContext* ctx, TierBranch* branch)
+{
+    ctx->tier = branch->index;
+    ctx->downRounds = 0;
+    ctx->upRounds = 0;
+
+    // --- LINK TEE VÍDEO (Usando Probe para segurança) ---
+    ctx->tee_pad = gst_element_request_pad_simple(branch->tee, "src_%u");
+    gst_pad_add_probe(ctx->tee_pad, GST_PAD_PROBE_TYPE_IDLE, (GstPadProbeCallback)link_client_pad_cb, ctx, NULL);
+    // Entrando no meio do GOP: segura os quadros até o próximo keyframe
+    ctx->waiting_keyframe.storeRelease(1);
+    gst_pad_add_probe(ctx->tee_pad, GST_PAD_PROBE_TYPE_BUFFER, (GstPadProbeCallback)wait_keyframe_cb, ctx, nullptr);
+}
+
+void ScreenStreamer::detachClientVideo(ClientStreamContext* ctx)
+{
+    TierBranch* branch = m_branches.value(ctx->tier);
+
+    if (ctx->tee_pad && branch) {
+        GstPad* queue_pad = gst_element_get_static_pad(ctx->rtp_queue, "sink");
+        if (queue_pad) {
+            gst_pad_unlink(ctx->tee_pad, queue_pad);
+            gst_object_unref(queue_pad);
+        }
+        // Libera o pad do Tee de vídeo da camada
+        gst_element_release_request_pad(branch->tee, ctx->tee_pad);
+    }
+    if (ctx->tee_pad) gst_object_unref(ctx->tee_pad);
+    ctx->tee_pad = nullptr;
+
+    if (branch) {
+        branch->bitrate.removeClient(ctx->playerId);
+        releaseTier(ctx->tier);
+    }
+    ctx->tier = -1;
+}
+
+void ScreenStreamer::migrateClient(ClientStreamContext* ctx, int tier)
+{
+    const int from = ctx->tier;
+
+    // A camada nova sobe antes de soltar a antiga (que pode morrer com esta saída)
+    TierBranch* target = acquireTier(tier);
+    if (!target) return;
+
+    detachClientVideo(ctx);
+    attachClientVideo(ctx, target);
+    requestJoinKeyframe(ctx, target);
+
+    LOG_INFO("stream", "Jogador %d: camada %s -> %s", ctx->playerId,
+        m_tiers.at(from).name().toUtf8().constData(), m_tiers.at(tier).name().toUtf8().constData());
+}
+
+void ScreenStreamer::addClient(int playerIndex, const QSize& screen, const QHostAddress& controlAddress)
 {
     // Se o botão mestre estiver desligado, rejeita
     if (!m_isStreamingEnabled) {
@@ -201,21 +626,43 @@ void ScreenStreamer::addClient(int playerIndex)
         return;
     }
 
-    if (!pipeline || !tee_video || !tee_audio) {
+    if (!pipeline || !tee_raw || !tee_audio) {
         startMasterPipeline();
         if (!pipeline) return;
     }
 
+    // Pedido repetido: recomeça do zero (removeClient trava o mutex sozinho)
+    m_clientsMutex.lock();
+    const bool existing = m_clients.contains(playerIndex);
+    m_clientsMutex.unlock();
+    if (existing) removeClient(playerIndex);
+
     QMutexLocker locker(&m_clientsMutex);
-    if (m_clients.contains(playerIndex)) removeClient(playerIndex);
+    resumePipeline();
+
+    // Camada inicial: tela informada e última taxa medida deste jogador
+    const int tier = m_tiers.initialTier(screen, m_lastRateKbps.value(playerIndex, -1));
+    TierBranch* branch = acquireTier(tier);
+    if (!branch) {
+        if (m_clients.isEmpty()) m_idleTimer->start();
+        emit streamError("Falha ao iniciar a codificação do vídeo.");
+        return;
+    }
 
-    qDebug() << "👤 Conectando Cliente A/V:" << playerIndex;
+    qDebug() << "👤 Conectando Cliente A/V:" << playerIndex << "camada" << m_tiers.at(tier).name()
+             << "tela" << screen.width() << "x" << screen.height();
     ClientStreamContext* ctx = new ClientStreamContext();
     ctx->playerId = playerIndex;
+    ctx->owner = this;
+    ctx->join_start_us.storeRelaxed(g_get_monotonic_time());
+    ctx->gather_start_us.storeRelaxed(g_get_monotonic_time());
+    ctx->stun = m_iceConfig.usesStun();
+    ctx->screen = screen;
 
     // --- ELEMENTOS DE VÍDEO ---
     ctx->rtp_queue = gst_element_factory_make("queue", NULL); // Fila de vídeo
     g_object_set(ctx->rtp_queue, "leaky", 2, "max-size-buffers", 1, NULL);
+    ctx->payloader = gst_parse_launch(m_builder.payloaderDescription().toUtf8().constData(), NULL);
 
     // --- ELEMENTOS DE ÁUDIO (NOVO) ---
     // Guardamos na struct para limpar depois
@@ -224,27 +671,50 @@ void ScreenStreamer::addClient(int playerIndex)
 
     // ⚡ WEBRTC COM LATÊNCIA ZERO
     ctx->webrtcbin = gst_element_factory_make("webrtcbin", NULL);
-    g_object_set(ctx->webrtcbin,
-        "bundle-policy", 3,
-        "stun-server", "stun://stun.l.google.com:19302",
-        "latency", 0, // ⚡ LATÊNCIA ZERO PARA CLIENTES TAMBÉM
-        NULL);
+    if (ctx->webrtcbin) {
+        g_object_set(ctx->webrtcbin,
+            "bundle-policy", 3,
+            "latency", 0, // ⚡ LATÊNCIA ZERO PARA CLIENTES TAMBÉM
+            NULL);
+        // Sem STUN a coleta termina assim que as interfaces locais respondem
+        if (ctx->stun) g_object_set(ctx->webrtcbin, "stun-server", m_iceConfig.stunServer.toUtf8().constData(), NULL);
+        configureIceAgent(ctx->webrtcbin, m_iceConfig, controlAddress);
+    }
 
     // Verifica nulidade
-    if (!ctx->rtp_queue || !ctx->audio_queue || !ctx->webrtcbin) {
+    if (!ctx->rtp_queue || !ctx->payloader || !ctx->audio_queue || !ctx->webrtcbin) {
+        releaseTier(tier);
+        if (m_clients.isEmpty()) m_idleTimer->start();
         delete ctx; return;
     }
 
-    gst_bin_add_many(GST_BIN(pipeline), ctx->rtp_queue, ctx->audio_queue, ctx->webrtcbin, NULL);
+    // TWCC no payloader: o webrtcbin negocia a extensão e o rtpgccbwe estima a banda
+    if (hasBandwidthEstimator()) {
+        GstRTPHeaderExtension* twcc = gst_rtp_header_extension_create_from_uri(TWCC_EXTENSION_URI);
+        if (twcc) {
+            gst_rtp_header_extension_set_id(twcc, 1);
+            g_signal_emit_by_name(ctx->payloader, "add-extension", twcc);
+            gst_object_unref(twcc);
+        }
+    }
+
+    // Antes de qualquer link: o webrtcbin só avisa a negociação uma vez, e um
+    // aviso perdido deixaria o cliente sem oferta. O contexto vive até o
+    // webrtcbin ir para NULL (removeClient)
+    g_signal_connect(ctx->webrtcbin, "on-negotiation-needed", G_CALLBACK(onNegotiationNeeded), ctx);
+
+    gst_bin_add_many(GST_BIN(pipeline), ctx->rtp_queue, ctx->payloader, ctx->audio_queue, ctx->webrtcbin, NULL);
 
     // Sync state
     gst_element_sync_state_with_parent(ctx->rtp_queue);
+    gst_element_sync_state_with_parent(ctx->payloader);
     gst_element_sync_state_with_parent(ctx->audio_queue);
     gst_element_sync_state_with_parent(ctx->webrtcbin);
 
-    // Link Interno (Queue Video -> WebRTC)
+    // Link Interno (Queue Video -> Payloader -> WebRTC)
     // O webrtcbin cria pads dinamicamente quando linkamos
-    if (!gst_element_link_pads(ctx->rtp_queue, "src", ctx->webrtcbin, "sink_%u")) {
+    if (!gst_element_link(ctx->rtp_queue, ctx->payloader) ||
+        !gst_element_link_pads(ctx->payloader, "src", ctx->webrtcbin, "sink_%u")) {
         qCritical() << "❌ Erro link Queue Video -> WebRTC";
     }
 
@@ -253,9 +723,7 @@ void ScreenStreamer::addClient(int playerIndex)
         qCritical() << "❌ Erro link Queue Audio -> WebRTC";
     }
 
-    // --- LINK TEE VÍDEO (Usando Probe para segurança) ---
-    ctx->tee_pad = gst_element_request_pad_simple(tee_video, "src_%u");
-    gst_pad_add_probe(ctx->tee_pad, GST_PAD_PROBE_TYPE_IDLE, (GstPadProbeCallback)link_client_pad_cb, ctx, NULL);
+    attachClientVideo(ctx, branch);
 
     // --- LINK TEE ÁUDIO ---
     // Salva o pad na struct
@@ -267,15 +735,18 @@ void ScreenStreamer::addClient(int playerIndex)
     }
     gst_object_unref(queue_audio_pad);
 
-    // Sinais WebRTC
-    CallbackData* cbData = new CallbackData{ this, playerIndex };
-    g_signal_connect_data(ctx->webrtcbin, "on-negotiation-needed",
-        G_CALLBACK(onNegotiationNeeded), cbData, (GClosureNotify)free_callback_data, (GConnectFlags)0);
+    // Demais sinais WebRTC
+    g_signal_connect(ctx->webrtcbin, "notify::connection-state", G_CALLBACK(onConnectionStateChanged), ctx);
+    g_signal_connect(ctx->webrtcbin, "notify::ice-gathering-state", G_CALLBACK(onIceGatheringStateChanged), ctx);
 
-    cbData = new CallbackData{ this, playerIndex };
+    CallbackData* cbData = new CallbackData{ this, playerIndex };
     g_signal_connect_data(ctx->webrtcbin, "on-ice-candidate",
         G_CALLBACK(onIceCandidate), cbData, (GClosureNotify)free_callback_data, (GConnectFlags)0);
 
+    if (hasBandwidthEstimator()) {
+        g_signal_connect(ctx->webrtcbin, "request-aux-sender", G_CALLBACK(onRequestAuxSender), ctx);
+    }
+
     // Transceivers (Vídeo e Áudio)
     GstWebRTCRTPTransceiver* trans = nullptr;
 
@@ -288,22 +759,12 @@ void ScreenStreamer::addClient(int playerIndex)
     if (trans) gst_object_unref(trans);
 
     m_clients.insert(playerIndex, ctx);
+    if (!m_statsTimer->isActive()) m_statsTimer->start();
 
-    // Gatilho de Oferta
-    QTimer::singleShot(50, this, [this, playerIndex]() {
-        QMutexLocker locker(&m_clientsMutex);
-        if (m_clients.contains(playerIndex)) {
-            qDebug() << "🎯 Disparando oferta A/V (Delayed)...";
-            ClientStreamContext* c = m_clients[playerIndex];
-
-            CallbackData* pData = new CallbackData{ this, playerIndex };
-            static auto pFree = [](gpointer data) { delete static_cast<CallbackData*>(data); };
-            GstPromise* promise = gst_promise_new_with_change_func(onOfferCreated, pData, pFree);
-            g_signal_emit_by_name(c->webrtcbin, "create-offer", nullptr, promise);
-
-            forceKeyframe();
-        }
-        });
+    // O on-negotiation-needed pode disparar já no primeiro link, antes do áudio
+    // e dos transceivers: a oferta sai de quem chegar por último
+    const int state = ctx->offer_state.fetchAndOrOrdered(ClientStreamContext::ClientReady);
+    if (state & ClientStreamContext::NegotiationNeeded) createOffer(ctx);
 }
 
 void ScreenStreamer::removeClient(int playerIndex)
@@ -313,18 +774,14 @@ void ScreenStreamer::removeClient(int playerIndex)
 
     qDebug() << "🗑️ Removendo cliente:" << playerIndex;
     ClientStreamContext* ctx = m_clients.take(playerIndex);
-
-    // 1. Limpeza VÍDEO
-    if (ctx->tee_pad && tee_video) { // Use tee_video aqui se renomeou no header, ou tee_element
-        GstPad* queue_pad = gst_element_get_static_pad(ctx->rtp_queue, "sink");
-        if (queue_pad) {
-            gst_pad_unlink(ctx->tee_pad, queue_pad);
-            gst_object_unref(queue_pad);
-        }
-        // Libera o pad do Tee de vídeo
-        gst_element_release_request_pad(tee_video, ctx->tee_pad); // ou tee_element
+    if (m_clients.isEmpty()) {
+        m_statsTimer->stop();
+        m_idleTimer->start();
     }
 
+    // 1. Limpeza VÍDEO (solta o tee da camada; a camada morre se ficou vazia)
+    detachClientVideo(ctx);
+
     // 2. Limpeza ÁUDIO (NOVO)
     if (ctx->tee_audio_pad && tee_audio) {
         if (ctx->audio_queue) {
@@ -340,79 +797,223 @@ void ScreenStreamer::removeClient(int playerIndex)
 
     // Para elementos
     if (ctx->webrtcbin) gst_element_set_state(ctx->webrtcbin, GST_STATE_NULL);
+    if (ctx->payloader) gst_element_set_state(ctx->payloader, GST_STATE_NULL);
     if (ctx->rtp_queue) gst_element_set_state(ctx->rtp_queue, GST_STATE_NULL);
     if (ctx->audio_queue) gst_element_set_state(ctx->audio_queue, GST_STATE_NULL);
 
     if (pipeline) {
         if (ctx->webrtcbin) gst_bin_remove(GST_BIN(pipeline), ctx->webrtcbin);
+        if (ctx->payloader) gst_bin_remove(GST_BIN(pipeline), ctx->payloader);
         if (ctx->rtp_queue) gst_bin_remove(GST_BIN(pipeline), ctx->rtp_queue);
         if (ctx->audio_queue) gst_bin_remove(GST_BIN(pipeline), ctx->audio_queue);
     }
 
     // Limpa os pads
-    if (ctx->tee_pad) gst_object_unref(ctx->tee_pad);
     if (ctx->tee_audio_pad) gst_object_unref(ctx->tee_audio_pad);
+    if (GstElement* bwe = ctx->bandwidth_estimator.loadAcquire()) gst_object_unref(bwe);
 
     delete ctx;
     qDebug() << "✅ Cliente removido e recursos limpos.";
 }
 
-void ScreenStreamer::forceKeyframe() {
-    if (encoder_element) {
-        GstEvent* event = gst_video_event_new_downstream_force_key_unit(GST_CLOCK_TIME_NONE, GST_CLOCK_TIME_NONE, GST_CLOCK_TIME_NONE, TRUE, 0);
-        gst_element_send_event(encoder_element, event);
+void ScreenStreamer::forceKeyframe(TierBranch* branch) {
+    if (!branch || !branch->encoder) return;
+    static CounterStat* sent = Metrics::instance().counter("stream.keyframes_sent");
+    sent->add();
+    GstEvent* event = gst_video_event_new_downstream_force_key_unit(GST_CLOCK_TIME_NONE, GST_CLOCK_TIME_NONE, GST_CLOCK_TIME_NONE, TRUE, 0);
+    gst_element_send_event(branch->encoder, event);
+}
+
+void ScreenStreamer::requestKeyframe(TierBranch* branch)
+{
+    static CounterStat* requests = Metrics::instance().counter("stream.keyframe_requests");
+    static CounterStat* coalesced = Metrics::instance().counter("stream.keyframe_coalesced");
+    if (!branch || !branch->encoder) return;
+    requests->add();
+
+    // Já há um keyframe agendado: este pedido vai junto
+    if (branch->keyframe_pending.loadAcquire()) {
+        coalesced->add();
+        return;
     }
-    else {
-        // Fallback: tenta encontrar o encoder pelo tipo
-        GstElement* enc = gst_bin_get_by_name(GST_BIN(pipeline), "vp8enc0"); // Nome padrão
-        if (!enc) {
-            // Tenta encontrar qualquer elemento vp8enc no pipeline
-            GstIterator* it = gst_bin_iterate_elements(GST_BIN(pipeline));
-            GValue value = G_VALUE_INIT;
-            while (gst_iterator_next(it, &value) == GST_ITERATOR_OK) {
-                GstElement* element = GST_ELEMENT(g_value_get_object(&value));
-                if (GST_OBJECT_NAME(element) && g_strrstr(GST_OBJECT_NAME(element), "vp8enc")) {
-                    enc = element;
-                    gst_object_ref(enc);
-                    break;
-                }
-                g_value_unset(&value);
+
+    const qint64 nowUs = g_get_monotonic_time();
+    const qint64 lastUs = branch->last_keyframe_us.loadAcquire();
+    const qint64 waitUs = lastUs + qint64(KEYFRAME_MIN_INTERVAL_MS) * 1000 - nowUs;
+    if (waitUs <= 0) {
+        // Dois pedidos ao mesmo tempo: só um envia
+        if (branch->last_keyframe_us.testAndSetOrdered(lastUs, nowUs)) forceKeyframe(branch);
+        else coalesced->add();
+        return;
+    }
+
+    // Dentro do intervalo: um keyframe no fim dele atende todos os pedidos.
+    // Quem agenda não conta como juntado, só quem chega depois
+    if (!branch->keyframe_pending.testAndSetOrdered(0, 1)) {
+        coalesced->add();
+        return;
+    }
+
+    // O ramo pode morrer antes: o timer procura a camada pelo índice
+    const int index = branch->index;
+    const int delayMs = int((waitUs + 999) / 1000);
+    QMetaObject::invokeMethod(this, [this, index, delayMs]() {
+        QTimer::singleShot(delayMs, this, [this, index]() {
+            QMutexLocker locker(&m_clientsMutex);
+            TierBranch* target = m_branches.value(index);
+            if (!target || !target->keyframe_pending.loadAcquire()) return;
+            target->last_keyframe_us.storeRelease(g_get_monotonic_time());
+            target->keyframe_pending.storeRelease(0);
+            forceKeyframe(target);
+            });
+        }, Qt::QueuedConnection);
+}
+
+void ScreenStreamer::requestJoinKeyframe(ClientStreamContext* ctx, TierBranch* branch)
+{
+    if (!branch) return;
+    if (!branch->intra_refresh) {
+        requestKeyframe(branch);
+        return;
+    }
+
+    // Um IDR aqui seria o pico que o intra-refresh evita, para todos da camada:
+    // o wait_keyframe_cb solta o cliente no próximo ponto de recuperação
+    static CounterStat* refreshJoins = Metrics::instance().counter("stream.join_refresh_cycle");
+    refreshJoins->add();
+
+    const int playerId = ctx->playerId;
+    const int index = branch->index;
+    QMetaObject::invokeMethod(this, [this, playerId, index]() {
+        QTimer::singleShot(INTRA_REFRESH_JOIN_WAIT_MS, this, [this, playerId, index]() {
+            QMutexLocker locker(&m_clientsMutex);
+            ClientStreamContext* client = m_clients.value(playerId);
+            if (!client || client->tier != index || !client->waiting_keyframe.loadAcquire()) return;
+            // Nenhum ponto de recuperação no prazo (encoder sem a marcação): IDR
+            static CounterStat* timeouts = Metrics::instance().counter("stream.join_refresh_timeout");
+            timeouts->add();
+            requestKeyframe(m_branches.value(index));
+            });
+        }, Qt::QueuedConnection);
+}
+
+void ScreenStreamer::pollTransportStats()
+{
+    QMutexLocker locker(&m_clientsMutex);
+    if (!pipeline || m_clients.isEmpty()) {
+        m_statsTimer->stop();
+        return;
+    }
+
+    static CounterStat* increases = Metrics::instance().counter("stream.bitrate_increase");
+    static CounterStat* decreases = Metrics::instance().counter("stream.bitrate_decrease");
+    static CounterStat* holds = Metrics::instance().counter("stream.bitrate_hold");
+    static LatencyStat* targets = Metrics::instance().latency("stream.target_kbps_history");
+    static CounterStat* upgrades = Metrics::instance().counter("stream.tier_upgrade");
+    static CounterStat* downgrades = Metrics::instance().counter("stream.tier_downgrade");
+
+    // Fecha a rodada anterior de cada camada com as amostras que chegaram
+    for (TierBranch* branch : m_branches) {
+        if (branch->bitrate.clientCount() == 0) continue;
+
+        const int previous = branch->bitrate.targetKbps();
+        const int target = branch->bitrate.decide();
+        switch (branch->bitrate.lastDecision()) {
+        case BitrateController::Decision::Increase: increases->add(); break;
+        case BitrateController::Decision::Decrease: decreases->add(); break;
+        case BitrateController::Decision::Hold: holds->add(); break;
+        }
+        targets->record(target);
+        const QString name = m_tiers.at(branch->index).name();
+        Metrics::instance().counter(QString("stream.tier_%1_kbps").arg(name))->set(target);
+
+        if (target != previous) {
+            LOG_DEBUG("stream", "Camada %s: bitrate %d -> %d kbps (%s)", name.toUtf8().constData(),
+                previous, target, branch->bitrate.lastReason().toUtf8().constData());
+            if (!PipelineBuilder::setEncoderBitrate(branch->encoder, target)) {
+                LOG_WARNING("stream", "Encoder %s sem ajuste de bitrate", m_builder.encoderFactory());
             }
-            gst_iterator_free(it);
         }
+    }
+
+    // Troca de camada pela taxa a que o controle chegou para cada cliente
+    for (ClientStreamContext* ctx : m_clients) {
+        TierBranch* branch = m_branches.value(ctx->tier);
+        if (!branch) continue;
 
-        if (enc) {
-            GstEvent* event = gst_video_event_new_downstream_force_key_unit(GST_CLOCK_TIME_NONE, GST_CLOCK_TIME_NONE, GST_CLOCK_TIME_NONE, TRUE, 0);
-            gst_element_send_event(enc, event);
-            gst_object_unref(enc);
+        const int rate = branch->bitrate.clientRateKbps(ctx->playerId);
+        if (rate >= 0) m_lastRateKbps[ctx->playerId] = rate;
+
+        const int next = m_tiers.nextTier(ctx->tier, ctx->screen, rate, ctx->estimateKbps, ctx->downRounds, ctx->upRounds);
+        if (next != ctx->tier) {
+            (next > ctx->tier ? downgrades : upgrades)->add();
+            migrateClient(ctx, next);
         }
     }
+
+    static auto pFree = [](gpointer data) { delete static_cast<CallbackData*>(data); };
+    for (auto it = m_clients.cbegin(); it != m_clients.cend(); ++it) {
+        CallbackData* pData = new CallbackData{ this, it.key() };
+        GstPromise* promise = gst_promise_new_with_change_func(onStatsReady, pData, pFree);
+        g_signal_emit_by_name(it.value()->webrtcbin, "get-stats", nullptr, promise);
+    }
+}
+
+void ScreenStreamer::onTransportStats(int playerIndex, const TransportSample& sample)
+{
+    QMutexLocker locker(&m_clientsMutex);
+    auto it = m_clients.constFind(playerIndex);
+    if (it == m_clients.cend()) return;
+
+    ClientStreamContext* ctx = it.value();
+    TierBranch* branch = m_branches.value(ctx->tier);
+    if (!branch) return;
+
+    TransportSample s = sample;
+    if (GstElement* bwe = ctx->bandwidth_estimator.loadAcquire()) {
+        guint bps = 0;
+        g_object_get(bwe, "estimated-bitrate", &bps, nullptr);
+        if (bps > 0) s.estimateKbps = int(bps / 1000);
+    }
+    ctx->estimateKbps = s.estimateKbps;
+
+    static LatencyStat* rtt = Metrics::instance().latency("stream.rtt_ms");
+    static LatencyStat* loss = Metrics::instance().latency("stream.loss_permille");
+    static LatencyStat* jitter = Metrics::instance().latency("stream.jitter_ms");
+    static LatencyStat* estimate = Metrics::instance().latency("stream.twcc_estimate_kbps");
+    if (s.rttMs >= 0.0) rtt->record(qRound(s.rttMs));
+    if (s.fractionLost >= 0.0) loss->record(qRound(s.fractionLost * 1000.0));
+    if (s.jitterMs >= 0.0) jitter->record(qRound(s.jitterMs));
+    if (s.estimateKbps > 0) estimate->record(s.estimateKbps);
+
+    LOG_TRACE("stream", "Jogador %d: RTT %.1f ms, perda %.3f, jitter %.1f ms, TWCC %d kbps",
+        playerIndex, s.rttMs, s.fractionLost, s.jitterMs, s.estimateKbps);
+    branch->bitrate.update(playerIndex, s);
 }
 
-void ScreenStreamer::handleSignalingMessage(int playerIndex, const QJsonObject& json)
+void ScreenStreamer::handleSignalingMessage(int playerIndex, const SignalMessage& message)
 {
     QMutexLocker locker(&m_clientsMutex);
     if (!m_clients.contains(playerIndex)) {
-        qDebug() << "⚠️ Cliente" << playerIndex << "não encontrado para processar mensagem de sinalização";
+        LOG_DEBUG("signal", "Cliente %d não encontrado para processar sinalização", playerIndex);
         return;
     }
 
     ClientStreamContext* ctx = m_clients[playerIndex];
-    QString type = json["type"].toString();
-    qDebug() << "📨 Processando sinalização para Player" << playerIndex << ":" << type;
+    LOG_DEBUG("signal", "Processando %s do jogador %d", SignalCodec::typeName(message.type), playerIndex);
 
-    if (type == "webrtc_answer") {
-        QString sdp = json["sdp"].toString();
-        qDebug() << "📝 Recebida resposta SDP do Player" << playerIndex << "Tamanho:" << sdp.length();
+    if (message.type == Signal::WebrtcAnswer) {
+        const QByteArray& sdp = message.sdp;
+        LOG_DEBUG("signal", "Resposta SDP do jogador %d (%d bytes)", playerIndex, int(sdp.size()));
 
         GstSDPMessage* sdpMsg = nullptr;
         if (gst_sdp_message_new(&sdpMsg) != GST_SDP_OK) {
-            qCritical() << "❌ Falha ao criar mensagem SDP";
+            LOG_ERROR("signal", "Falha ao criar mensagem SDP");
             return;
         }
 
-        if (gst_sdp_message_parse_buffer((guint8*)sdp.toUtf8().constData(), sdp.toUtf8().size(), sdpMsg) != GST_SDP_OK) {
-            qCritical() << "❌ Falha ao parsear SDP da resposta";
+        if (gst_sdp_message_parse_buffer(reinterpret_cast<const guint8*>(sdp.constData()), sdp.size(), sdpMsg) != GST_SDP_OK) {
+            LOG_ERROR("signal", "Falha ao interpretar o SDP da resposta");
             gst_sdp_message_free(sdpMsg);
             return;
         }
@@ -420,24 +1021,78 @@ void ScreenStreamer::handleSignalingMessage(int playerIndex, const QJsonObject&
         GstWebRTCSessionDescription* answer = gst_webrtc_session_description_new(GST_WEBRTC_SDP_TYPE_ANSWER, sdpMsg);
         g_signal_emit_by_name(ctx->webrtcbin, "set-remote-description", answer, nullptr);
         gst_webrtc_session_description_free(answer);
-        qDebug() << "✅ Resposta SDP aplicada para Player" << playerIndex;
+        LOG_DEBUG("signal", "Resposta SDP aplicada para o jogador %d", playerIndex);
     }
-    else if (type == "webrtc_candidate") {
-        QString candidate = json["candidate"].toString();
-        int mlineIndex = json["sdpMLineIndex"].toInt();
-        qDebug() << "🧊 Adicionando candidato ICE remoto para Player" << playerIndex << "MLine:" << mlineIndex;
-        g_signal_emit_by_name(ctx->webrtcbin, "add-ice-candidate", mlineIndex, candidate.toUtf8().constData());
+    else if (message.type == Signal::WebrtcCandidate) {
+        LOG_TRACE("signal", "Candidato ICE remoto do jogador %d (mline %d)", playerIndex, message.mlineIndex);
+        g_signal_emit_by_name(ctx->webrtcbin, "add-ice-candidate", message.mlineIndex, message.candidate.constData());
     }
     else {
-        qDebug() << "⚠️ Tipo de mensagem de sinalização desconhecido para Player" << playerIndex << ":" << type;
+        LOG_DEBUG("signal", "Mensagem de sinalização inesperada do jogador %d: %s", playerIndex, SignalCodec::typeName(message.type));
     }
 }
 
 void ScreenStreamer::onNegotiationNeeded(GstElement* webrtc, gpointer user_data)
 {
-    // Pode deixar vazio ou logar, pois já chamamos create-offer manualmente no addClient
-    // Se deixarmos aqui, pode gerar ofertas duplicadas.
-    qDebug() << "📡 Negociação solicitada pelo GStreamer (ignorando para evitar loop)";
+    Q_UNUSED(webrtc);
+    ClientStreamContext* ctx = static_cast<ClientStreamContext*>(user_data);
+
+    // Só a primeira: o cliente espera uma oferta por entrada (sem renegociação)
+    const int state = ctx->offer_state.fetchAndOrOrdered(ClientStreamContext::NegotiationNeeded);
+    if (state & ClientStreamContext::NegotiationNeeded) {
+        LOG_DEBUG("signal", "Negociação repetida do jogador %d ignorada", ctx->playerId);
+        return;
+    }
+    // addClient ainda montando o cliente: ele cria a oferta ao terminar
+    if (!(state & ClientStreamContext::ClientReady)) return;
+
+    createOffer(ctx);
+}
+
+void ScreenStreamer::createOffer(ClientStreamContext* ctx)
+{
+    LOG_DEBUG("signal", "webrtcbin pronto: criando oferta para o jogador %d", ctx->playerId);
+    CallbackData* pData = new CallbackData{ ctx->owner, ctx->playerId };
+    static auto pFree = [](gpointer data) { delete static_cast<CallbackData*>(data); };
+    GstPromise* promise = gst_promise_new_with_change_func(onOfferCreated, pData, pFree);
+    g_signal_emit_by_name(ctx->webrtcbin, "create-offer", nullptr, promise);
+}
+
+void ScreenStreamer::onConnectionStateChanged(GstElement* webrtc, GParamSpec* pspec, gpointer user_data)
+{
+    Q_UNUSED(pspec);
+    ClientStreamContext* ctx = static_cast<ClientStreamContext*>(user_data);
+
+    GstWebRTCPeerConnectionState state = GST_WEBRTC_PEER_CONNECTION_STATE_NEW;
+    g_object_get(webrtc, "connection-state", &state, nullptr);
+    if (state != GST_WEBRTC_PEER_CONNECTION_STATE_CONNECTED) return;
+
+    // ICE + DTLS prontos: daqui em diante só falta o primeiro keyframe chegar
+    const qint64 startUs = ctx->join_start_us.fetchAndStoreRelaxed(0);
+    if (startUs > 0) {
+        static LatencyStat* connectedStat = Metrics::instance().latency("stream.join_connected_ms");
+        connectedStat->record((g_get_monotonic_time() - startUs) / 1000);
+    }
+    LOG_DEBUG("signal", "Jogador %d conectado (ICE + DTLS)", ctx->playerId);
+}
+
+void ScreenStreamer::onIceGatheringStateChanged(GstElement* webrtc, GParamSpec* pspec, gpointer user_data)
+{
+    Q_UNUSED(pspec);
+    ClientStreamContext* ctx = static_cast<ClientStreamContext*>(user_data);
+
+    GstWebRTCICEGatheringState state = GST_WEBRTC_ICE_GATHERING_STATE_NEW;
+    g_object_get(webrtc, "ice-gathering-state", &state, nullptr);
+    if (state != GST_WEBRTC_ICE_GATHERING_STATE_COMPLETE) return;
+
+    // Separado por modo: com STUN inclui a espera pelo servidor (ou o timeout sem internet)
+    const qint64 startUs = ctx->gather_start_us.fetchAndStoreRelaxed(0);
+    if (startUs <= 0) return;
+    static LatencyStat* stunStat = Metrics::instance().latency("stream.ice_gathering_stun_ms");
+    static LatencyStat* hostStat = Metrics::instance().latency("stream.ice_gathering_host_ms");
+    const qint64 elapsedMs = (g_get_monotonic_time() - startUs) / 1000;
+    (ctx->stun ? stunStat : hostStat)->record(elapsedMs);
+    LOG_DEBUG("signal", "Coleta ICE do jogador %d completa em %lld ms", ctx->playerId, static_cast<long long>(elapsedMs));
 }
 
 void ScreenStreamer::onOfferCreated(GstPromise* promise, gpointer user_data)
@@ -446,18 +1101,18 @@ void ScreenStreamer::onOfferCreated(GstPromise* promise, gpointer user_data)
     ScreenStreamer* self = cbData->self;
     int playerId = cbData->playerId;
 
-    qDebug() << "🎯 onOfferCreated chamado para player" << playerId;
+    LOG_TRACE("signal", "Oferta criada para o jogador %d", playerId);
 
     const GstStructure* reply = gst_promise_get_reply(promise);
     if (!reply) {
-        qCritical() << "❌ PROMISE SEM RESPOSTA para player" << playerId;
+        LOG_ERROR("signal", "Promise da oferta sem resposta para o jogador %d", playerId);
         gst_promise_unref(promise);
         return;
     }
 
     GstWebRTCSessionDescription* offer = nullptr;
     if (!gst_structure_get(reply, "offer", GST_TYPE_WEBRTC_SESSION_DESCRIPTION, &offer, nullptr)) {
-        qCritical() << "❌ FALHA ao obter oferta do promise para player" << playerId;
+        LOG_ERROR("signal", "Falha ao obter a oferta do promise para o jogador %d", playerId);
         gst_promise_unref(promise);
         return;
     }
@@ -466,53 +1121,141 @@ void ScreenStreamer::onOfferCreated(GstPromise* promise, gpointer user_data)
 
     self->m_clientsMutex.lock();
     if (self->m_clients.contains(playerId)) {
-        GstElement* webrtc = self->m_clients[playerId]->webrtcbin;
+        ClientStreamContext* ctx = self->m_clients[playerId];
+        GstElement* webrtc = ctx->webrtcbin;
 
-        qDebug() << "📝 Configurando oferta local...";
+        LOG_TRACE("signal", "Configurando oferta local");
         g_signal_emit_by_name(webrtc, "set-local-description", offer, nullptr);
 
         // Converte SDP para string
         gchar* sdp_string = gst_sdp_message_as_text(offer->sdp);
-        QString sdp_qstr = QString::fromUtf8(sdp_string);
-        qDebug() << "📨 Enviando oferta SDP para player" << playerId << "Tamanho:" << sdp_qstr.length();
 
-        // Log das primeiras linhas do SDP para debug
-        QStringList sdpLines = sdp_qstr.split('\n');
-        for (int i = 0; i < qMin(5, sdpLines.size()); i++) {
-            qDebug() << "   SDP Line" << i << ":" << sdpLines[i];
-        }
+        SignalMessage message;
+        message.type = Signal::WebrtcOffer;
+        message.sdp = QByteArray(sdp_string);
+        g_free(sdp_string);
+        LOG_DEBUG("signal", "Enviando oferta SDP para o jogador %d (%d bytes)", playerId, int(message.sdp.size()));
 
-        QJsonObject json;
-        json["type"] = "webrtc_offer";
-        json["sdp"] = sdp_qstr;
+        emit self->sendSignalingMessage(playerId, message);
 
-        emit self->sendSignalingMessage(playerId, json);
-        g_free(sdp_string);
+        // Keyframe já na saída da oferta (chega junto com a conexão). Entradas
+        // próximas dividem o mesmo keyframe
+        self->requestJoinKeyframe(ctx, self->m_branches.value(ctx->tier));
 
-        qDebug() << "✅ Oferta enviada para player" << playerId;
+        const qint64 startUs = ctx->join_start_us.loadRelaxed();
+        if (startUs > 0) {
+            static LatencyStat* offerStat = Metrics::instance().latency("stream.join_offer_ms");
+            offerStat->record((g_get_monotonic_time() - startUs) / 1000);
+        }
+        LOG_TRACE("signal", "Oferta enviada para o jogador %d", playerId);
     }
     else {
-        qWarning() << "⚠️ Cliente" << playerId << "não encontrado ao enviar oferta";
+        LOG_WARNING("signal", "Cliente %d não encontrado ao enviar oferta", playerId);
     }
     self->m_clientsMutex.unlock();
 
     gst_webrtc_session_description_free(offer);
 }
 
+void ScreenStreamer::onStatsReady(GstPromise* promise, gpointer user_data)
+{
+    CallbackData* cbData = static_cast<CallbackData*>(user_data);
+    ScreenStreamer* self = cbData->self;
+    const int playerId = cbData->playerId;
+
+    const GstStructure* reply = (gst_promise_wait(promise) == GST_PROMISE_RESULT_REPLIED) ? gst_promise_get_reply(promise) : nullptr;
+    if (!reply) {
+        gst_promise_unref(promise);
+        return;
+    }
+
+    TransportSample sample;
+    gst_structure_foreach(reply, collect_remote_inbound_stats, &sample);
+    gst_promise_unref(promise);
+
+    // Roda na thread do webrtcbin: o controle fica na thread principal
+    QMetaObject::invokeMethod(self, [self, playerId, sample]() {
+        self->onTransportStats(playerId, sample);
+        }, Qt::QueuedConnection);
+}
+
+GstElement* ScreenStreamer::onRequestAuxSender(GstElement* webrtc, GstWebRTCDTLSTransport* dtls_transport, gpointer user_data)
+{
+    Q_UNUSED(webrtc);
+    Q_UNUSED(dtls_transport);
+    ClientStreamContext* ctx = static_cast<ClientStreamContext*>(user_data);
+
+    // Com bundle há um transporte por cliente; o webrtcbin fica com a referência flutuante
+    GstElement* bwe = gst_element_factory_make("rtpgccbwe", nullptr);
+    if (!bwe) return nullptr;
+
+    GstElement* previous = ctx->bandwidth_estimator.fetchAndStoreOrdered(GST_ELEMENT(gst_object_ref(bwe)));
+    if (previous) gst_object_unref(previous);
+    LOG_DEBUG("stream", "Estimador TWCC criado para o jogador %d", ctx->playerId);
+    return bwe;
+}
+
 void ScreenStreamer::onIceCandidate(GstElement* webrtc, guint mline_index, gchar* candidate, gpointer user_data)
 {
     Q_UNUSED(webrtc);
     CallbackData* cbData = static_cast<CallbackData*>(user_data);
 
-    qDebug() << "🧊 Gerando ICE candidate para player" << cbData->playerId << "MLine:" << mline_index;
+    LOG_TRACE("signal", "Candidato ICE local para o jogador %d (mline %u)", cbData->playerId, unsigned(mline_index));
+
+    SignalMessage message;
+    message.type = Signal::WebrtcCandidate;
+    message.candidate = QByteArray(candidate);
+    message.mlineIndex = static_cast<int>(mline_index);
+    message.sdpMid = "video0";
+
+    emit cbData->self->sendSignalingMessage(cbData->playerId, message);
+}
+
+GstPadProbeReturn ScreenStreamer::onUpstreamKeyUnit(GstPad* pad, GstPadProbeInfo* info, gpointer user_data)
+{
+    Q_UNUSED(pad);
+    GstEvent* event = GST_PAD_PROBE_INFO_EVENT(info);
+    if (!event || !gst_video_event_is_force_key_unit(event)) return GST_PAD_PROBE_OK;
+
+    // O pedido do cliente não chega direto no encoder (seria um IDR para todos)
+    TierBranch* branch = static_cast<TierBranch*>(user_data);
+    if (branch->intra_refresh) {
+        // A próxima volta da renovação (1 s) recupera o cliente sem quadro I
+        static CounterStat* covered = Metrics::instance().counter("stream.keyframe_refresh_covered");
+        covered->add();
+    }
+    else {
+        branch->owner->requestKeyframe(branch);
+    }
+    return GST_PAD_PROBE_DROP;
+}
 
-    QJsonObject json;
-    json["type"] = "webrtc_candidate";
-    json["candidate"] = QString::fromUtf8(candidate);
-    json["sdpMLineIndex"] = (int)mline_index;
-    json["sdpMid"] = "video0";
+GstPadProbeReturn ScreenStreamer::onEncodedFrame(GstPad* pad, GstPadProbeInfo* info, gpointer user_data)
+{
+    Q_UNUSED(pad);
+    Q_UNUSED(user_data);
+    static LatencyStat* frameBytes = Metrics::instance().latency("stream.frame_bytes");
+    static LatencyStat* keyframeBytes = Metrics::instance().latency("stream.keyframe_bytes");
+
+    GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    if (!buffer) return GST_PAD_PROBE_OK;
+    const qint64 size = qint64(gst_buffer_get_size(buffer));
+    frameBytes->record(size);
+    if (!GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT)) keyframeBytes->record(size);
+    return GST_PAD_PROBE_OK;
+}
 
-    emit cbData->self->sendSignalingMessage(cbData->playerId, json);
+GstPadProbeReturn ScreenStreamer::onFirstFrameAfterResume(GstPad* pad, GstPadProbeInfo* info, gpointer user_data)
+{
+    Q_UNUSED(pad);
+    Q_UNUSED(info);
+    ScreenStreamer* self = static_cast<ScreenStreamer*>(user_data);
+    const qint64 startUs = self->m_resumeStartUs.fetchAndStoreAcquire(0);
+    if (startUs > 0) {
+        static LatencyStat* resumeStat = Metrics::instance().latency("stream.resume_ms");
+        resumeStat->record((g_get_monotonic_time() - startUs) / 1000);
+    }
+    return GST_PAD_PROBE_REMOVE;
 }
 
 GstBusSyncReply ScreenStreamer::onBusMessage(GstBus* bus, GstMessage* msg, gpointer user_data)
@@ -525,16 +1268,16 @@ GstBusSyncReply ScreenStreamer::onBusMessage(GstBus* bus, GstMessage* msg, gpoin
         GError* error;
         gchar* debug;
         gst_message_parse_error(msg, &error, &debug);
-        qCritical() << "❌ ERRO no Pipeline:" << error->message;
+        LOG_ERROR("gst", "Erro no pipeline: %s", error->message);
         if (debug) {
-            qCritical() << "Debug info:" << debug;
+            LOG_DEBUG("gst", "Detalhes: %s", debug);
             g_free(debug);
         }
         g_error_free(error);
 
         QMetaObject::invokeMethod(self, [self]() {
             if (self->m_isStreamingEnabled) { // <--- CHECAGEM IMPORTANTE
-                qDebug() << "🔄 Reiniciando pipeline (Erro detectado)...";
+                LOG_INFO("gst", "Reiniciando o pipeline após erro");
                 self->stopMasterPipeline();
                 QTimer::singleShot(1000, self, &ScreenStreamer::startMasterPipeline);
             }
@@ -545,22 +1288,23 @@ GstBusSyncReply ScreenStreamer::onBusMessage(GstBus* bus, GstMessage* msg, gpoin
         GError* warning;
         gchar* debug;
         gst_message_parse_warning(msg, &warning, &debug);
-        qWarning() << "⚠️ WARNING no Pipeline:" << warning->message;
+        LOG_WARNING("gst", "Aviso do pipeline: %s", warning->message);
         if (debug) {
-            qWarning() << "Debug info:" << debug;
+            LOG_DEBUG("gst", "Detalhes: %s", debug);
             g_free(debug);
         }
         g_error_free(warning);
         break;
     }
     case GST_MESSAGE_EOS:
-        qDebug() << "🔚 Fim do stream (EOS) recebido";
+        LOG_DEBUG("gst", "Fim do stream (EOS)");
         break;
     case GST_MESSAGE_STATE_CHANGED: {
         if (GST_MESSAGE_SRC(msg) == GST_OBJECT(self->pipeline)) {
             GstState old_state, new_state, pending_state;
             gst_message_parse_state_changed(msg, &old_state, &new_state, &pending_state);
-            qDebug() << "🔄 Mudança de estado do Pipeline:" << old_state << "->" << new_state << "(pending:" << pending_state << ")";
+            LOG_DEBUG("gst", "Pipeline: %s -> %s (pendente: %s)", gst_element_state_get_name(old_state),
+                gst_element_state_get_name(new_state), gst_element_state_get_name(pending_state));
         }
         break;
     }
@@ -569,4 +1313,462 @@ GstBusSyncReply ScreenStreamer::onBusMessage(GstBus* bus, GstMessage* msg, gpoin
     }
 
     return GST_BUS_PASS;
-}
\ No newline at end of file
+}
+// ============================================================================
+// BENCHMARK DE ENTRADA
+// ============================================================================
+
+namespace {
+
+// Receptor do benchmark: outro webrtcbin no mesmo processo, no lugar do celular
+struct JoinReceiver {
+    ScreenStreamer* streamer = nullptr;
+    int playerIndex = 0;
+    GstElement* pipeline = nullptr;
+    GstElement* webrtc = nullptr;
+    QEventLoop* loop = nullptr;
+    QAtomicInteger<qint64> firstFrameUs;
+};
+
+void sendToStreamer(JoinReceiver* receiver, const SignalMessage& message)
+{
+    ScreenStreamer* streamer = receiver->streamer;
+    const int playerIndex = receiver->playerIndex;
+    QMetaObject::invokeMethod(streamer, [streamer, playerIndex, message]() {
+        streamer->handleSignalingMessage(playerIndex, message);
+        }, Qt::QueuedConnection);
+}
+
+GstPadProbeReturn join_first_frame_cb(GstPad* pad, GstPadProbeInfo* info, gpointer user_data)
+{
+    Q_UNUSED(pad);
+    Q_UNUSED(info);
+    JoinReceiver* receiver = static_cast<JoinReceiver*>(user_data);
+    if (receiver->firstFrameUs.testAndSetOrdered(0, g_get_monotonic_time())) {
+        QMetaObject::invokeMethod(receiver->loop, "quit", Qt::QueuedConnection);
+    }
+    return GST_PAD_PROBE_REMOVE;
+}
+
+void join_decoded_pad_cb(GstElement* decodebin, GstPad* pad, gpointer user_data)
+{
+    Q_UNUSED(decodebin);
+    JoinReceiver* receiver = static_cast<JoinReceiver*>(user_data);
+
+    GstElement* sink = gst_element_factory_make("fakesink", nullptr);
+    g_object_set(sink, "sync", FALSE, "async", FALSE, nullptr);
+    gst_bin_add(GST_BIN(receiver->pipeline), sink);
+    gst_element_sync_state_with_parent(sink);
+
+    GstPad* sink_pad = gst_element_get_static_pad(sink, "sink");
+    gst_pad_link(pad, sink_pad);
+
+    GstCaps* caps = gst_pad_get_current_caps(pad);
+    const bool video = caps && g_str_has_prefix(gst_structure_get_name(gst_caps_get_structure(caps, 0)), "video/");
+    if (caps) gst_caps_unref(caps);
+    if (video) gst_pad_add_probe(sink_pad, GST_PAD_PROBE_TYPE_BUFFER, join_first_frame_cb, receiver, nullptr);
+    gst_object_unref(sink_pad);
+}
+
+void join_receiver_pad_cb(GstElement* webrtc, GstPad* pad, gpointer user_data)
+{
+    Q_UNUSED(webrtc);
+    if (GST_PAD_DIRECTION(pad) != GST_PAD_SRC) return;
+    JoinReceiver* receiver = static_cast<JoinReceiver*>(user_data);
+
+    GstElement* decodebin = gst_element_factory_make("decodebin", nullptr);
+    g_signal_connect(decodebin, "pad-added", G_CALLBACK(join_decoded_pad_cb), receiver);
+    gst_bin_add(GST_BIN(receiver->pipeline), decodebin);
+    gst_element_sync_state_with_parent(decodebin);
+
+    GstPad* sink_pad = gst_element_get_static_pad(decodebin, "sink");
+    gst_pad_link(pad, sink_pad);
+    gst_object_unref(sink_pad);
+}
+
+void join_receiver_candidate_cb(GstElement* webrtc, guint mline_index, gchar* candidate, gpointer user_data)
+{
+    Q_UNUSED(webrtc);
+    SignalMessage message;
+    message.type = Signal::WebrtcCandidate;
+    message.candidate = QByteArray(candidate);
+    message.mlineIndex = static_cast<int>(mline_index);
+    sendToStreamer(static_cast<JoinReceiver*>(user_data), message);
+}
+
+void join_answer_created_cb(GstPromise* promise, gpointer user_data)
+{
+    JoinReceiver* receiver = static_cast<JoinReceiver*>(user_data);
+
+    const GstStructure* reply = gst_promise_get_reply(promise);
+    GstWebRTCSessionDescription* answer = nullptr;
+    if (reply) gst_structure_get(reply, "answer", GST_TYPE_WEBRTC_SESSION_DESCRIPTION, &answer, nullptr);
+    gst_promise_unref(promise);
+    if (!answer) return;
+
+    g_signal_emit_by_name(receiver->webrtc, "set-local-description", answer, nullptr);
+
+    gchar* sdp_string = gst_sdp_message_as_text(answer->sdp);
+    SignalMessage message;
+    message.type = Signal::WebrtcAnswer;
+    message.sdp = QByteArray(sdp_string);
+    g_free(sdp_string);
+    gst_webrtc_session_description_free(answer);
+    sendToStreamer(receiver, message);
+}
+
+void join_receiver_offer(JoinReceiver* receiver, const QByteArray& sdp)
+{
+    GstSDPMessage* sdpMsg = nullptr;
+    if (gst_sdp_message_new(&sdpMsg) != GST_SDP_OK) return;
+    if (gst_sdp_message_parse_buffer(reinterpret_cast<const guint8*>(sdp.constData()), sdp.size(), sdpMsg) != GST_SDP_OK) {
+        gst_sdp_message_free(sdpMsg);
+        return;
+    }
+
+    GstWebRTCSessionDescription* offer = gst_webrtc_session_description_new(GST_WEBRTC_SDP_TYPE_OFFER, sdpMsg);
+    g_signal_emit_by_name(receiver->webrtc, "set-remote-description", offer, nullptr);
+    gst_webrtc_session_description_free(offer);
+
+    GstPromise* promise = gst_promise_new_with_change_func(join_answer_created_cb, receiver, nullptr);
+    g_signal_emit_by_name(receiver->webrtc, "create-answer", nullptr, promise);
+}
+
+} // namespace
+
+QStringList ScreenStreamer::runJoinBenchmark(int joins, const IceConfig& ice)
+{
+    static const int PLAYER = 0;
+    static const int JOIN_TIMEOUT_MS = 10000;
+
+    ScreenStreamer streamer;
+    PipelineBuilder::Options options;
+    options.video = PipelineBuilder::VideoSource::Test;
+    options.audio = PipelineBuilder::AudioSource::Test;
+    // Ordem padrão dos encoders, sem esperar a medição
+    options.ranking = { PipelineBuilder::Encoder::Nvenc, PipelineBuilder::Encoder::X264,
+        PipelineBuilder::Encoder::OpenH264, PipelineBuilder::Encoder::Vp8 };
+    streamer.setPipelineOptions(options);
+    streamer.setIceConfig(ice);
+    streamer.setStreamingEnabled(true);
+    if (!streamer.pipeline) {
+        return { "Entrada no stream: pipeline não montado (plugins do GStreamer ausentes?)" };
+    }
+
+    static LatencyStat* firstFrameStat = Metrics::instance().latency("stream.join_first_frame_ms");
+    // Cada chamada (um modo de ICE) começa das médias zeradas
+    for (const char* name : { "stream.join_first_frame_ms", "stream.join_offer_ms", "stream.join_connected_ms",
+        "stream.ice_gathering_stun_ms", "stream.ice_gathering_host_ms" }) {
+        Metrics::instance().latency(name)->reset();
+    }
+    QVector<double> times;
+    int failures = 0;
+
+    for (int i = 0; i < qMax(1, joins); ++i) {
+        QEventLoop loop;
+        JoinReceiver receiver;
+        receiver.streamer = &streamer;
+        receiver.playerIndex = PLAYER;
+        receiver.loop = &loop;
+        receiver.pipeline = gst_pipeline_new(nullptr);
+        receiver.webrtc = gst_element_factory_make("webrtcbin", nullptr);
+        g_object_set(receiver.webrtc, "bundle-policy", 3, "latency", 0, nullptr);
+        gst_bin_add(GST_BIN(receiver.pipeline), receiver.webrtc);
+        g_signal_connect(receiver.webrtc, "pad-added", G_CALLBACK(join_receiver_pad_cb), &receiver);
+        g_signal_connect(receiver.webrtc, "on-ice-candidate", G_CALLBACK(join_receiver_candidate_cb), &receiver);
+        gst_element_set_state(receiver.pipeline, GST_STATE_PLAYING);
+
+        // Sinalização do servidor direto para o receptor (sem TCP)
+        const QMetaObject::Connection connection = connect(&streamer, &ScreenStreamer::sendSignalingMessage, &loop,
+            [&receiver](int playerIndex, const SignalMessage& message) {
+                Q_UNUSED(playerIndex);
+                if (message.type == Signal::WebrtcOffer) {
+                    join_receiver_offer(&receiver, message.sdp);
+                }
+                else if (message.type == Signal::WebrtcCandidate) {
+                    g_signal_emit_by_name(receiver.webrtc, "add-ice-candidate", message.mlineIndex, message.candidate.constData());
+                }
+            });
+
+        QTimer::singleShot(JOIN_TIMEOUT_MS, &loop, &QEventLoop::quit);
+        const qint64 startUs = g_get_monotonic_time();
+        streamer.addClient(PLAYER, QSize(), QHostAddress(QHostAddress::LocalHost));
+        loop.exec();
+
+        disconnect(connection);
+        streamer.removeClient(PLAYER);
+        gst_element_set_state(receiver.pipeline, GST_STATE_NULL);
+        gst_object_unref(receiver.pipeline);
+
+        const qint64 firstUs = receiver.firstFrameUs.loadAcquire();
+        if (firstUs > 0) {
+            times.append((firstUs - startUs) / 1000.0);
+            firstFrameStat->record((firstUs - startUs) / 1000);
+        }
+        else {
+            ++failures;
+        }
+    }
+    streamer.setStreamingEnabled(false);
+
+    QStringList report;
+    report << QString("Entrada no stream: %1 entrada(s), %2, ICE %3 (request_stream -> primeiro quadro decodificado)")
+        .arg(qMax(1, joins)).arg(streamer.m_builder.summary(), ice.summary());
+    if (!times.isEmpty()) {
+        double sum = 0.0;
+        for (double ms : times) sum += ms;
+        report << QString("  primeiro quadro: média %1 ms, mín %2 ms, máx %3 ms")
+            .arg(sum / times.size(), 0, 'f', 1)
+            .arg(*std::min_element(times.begin(), times.end()), 0, 'f', 1)
+            .arg(*std::max_element(times.begin(), times.end()), 0, 'f', 1);
+    }
+    report << QString("  oferta: média %1 ms; coleta ICE: média %2 ms; conectado (ICE + DTLS): média %3 ms")
+        .arg(Metrics::instance().latency("stream.join_offer_ms")->mean(), 0, 'f', 1)
+        .arg(Metrics::instance().latency(ice.usesStun() ? "stream.ice_gathering_stun_ms" : "stream.ice_gathering_host_ms")->mean(), 0, 'f', 1)
+        .arg(Metrics::instance().latency("stream.join_connected_ms")->mean(), 0, 'f', 1);
+    if (failures > 0) report << QString("  %1 entrada(s) sem quadro em %2 ms").arg(failures).arg(JOIN_TIMEOUT_MS);
+    return report;
+}
+
+// ============================================================================
+// BENCHMARK DE BITRATE EM LOOPBACK
+// ============================================================================
+
+namespace {
+
+// Perda no lado do receptor: o RTP que chega ao rtpbin do webrtcbin receptor é
+// descartado com a probabilidade pedida (o que um identity drop-probability
+// faria no caminho, sem precisar de um elemento dentro do webrtcbin). O
+// receptor então informa a perda no RTCP como faria um celular numa rede ruim.
+struct LoopbackLink {
+    QAtomicInt dropPermille;
+    QAtomicInteger<qint64> received;
+    QAtomicInteger<qint64> dropped;
+    QAtomicInteger<qint64> encodedBytes;   // Saída do encoder da camada do cliente
+};
+
+bool link_drops(LoopbackLink* link)
+{
+    const int permille = link->dropPermille.loadRelaxed();
+    if (permille > 0 && g_random_int_range(0, 1000) < permille) {
+        link->dropped.fetchAndAddRelaxed(1);
+        return true;
+    }
+    link->received.fetchAndAddRelaxed(1);
+    return false;
+}
+
+gboolean link_list_cb(GstBuffer** buffer, guint idx, gpointer user_data)
+{
+    Q_UNUSED(idx);
+    if (link_drops(static_cast<LoopbackLink*>(user_data))) {
+        gst_buffer_unref(*buffer);
+        *buffer = nullptr;
+    }
+    return TRUE;
+}
+
+GstPadProbeReturn link_rtp_cb(GstPad* pad, GstPadProbeInfo* info, gpointer user_data)
+{
+    Q_UNUSED(pad);
+    LoopbackLink* link = static_cast<LoopbackLink*>(user_data);
+    if (info->type & GST_PAD_PROBE_TYPE_BUFFER) {
+        return link_drops(link) ? GST_PAD_PROBE_DROP : GST_PAD_PROBE_OK;
+    }
+    if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+        GstBufferList* list = gst_buffer_list_make_writable(gst_pad_probe_info_get_buffer_list(info));
+        gst_buffer_list_foreach(list, link_list_cb, link);
+        GST_PAD_PROBE_INFO_DATA(info) = list;
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+void link_rtpbin_pad_cb(GstElement* rtpbin, GstPad* pad, gpointer user_data)
+{
+    Q_UNUSED(rtpbin);
+    if (!g_str_has_prefix(GST_PAD_NAME(pad), "recv_rtp_sink_")) return;
+    gst_pad_add_probe(pad, GstPadProbeType(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST),
+        link_rtp_cb, user_data, nullptr);
+}
+
+GstPadProbeReturn link_encoded_cb(GstPad* pad, GstPadProbeInfo* info, gpointer user_data)
+{
+    Q_UNUSED(pad);
+    if (GstBuffer* buffer = gst_pad_probe_info_get_buffer(info)) {
+        static_cast<LoopbackLink*>(user_data)->encodedBytes.fetchAndAddRelaxed(gst_buffer_get_size(buffer));
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+// O rtpbin é criado junto com o webrtcbin; os pads de recepção só aparecem na negociação
+GstElement* find_rtpbin(GstElement* webrtc)
+{
+    GstElement* found = nullptr;
+    GstIterator* it = gst_bin_iterate_elements(GST_BIN(webrtc));
+    GValue item = G_VALUE_INIT;
+    while (!found && gst_iterator_next(it, &item) == GST_ITERATOR_OK) {
+        GstElement* element = GST_ELEMENT(g_value_get_object(&item));
+        GstElementFactory* factory = gst_element_get_factory(element);
+        if (factory && g_strcmp0(GST_OBJECT_NAME(factory), "rtpbin") == 0) {
+            found = GST_ELEMENT(gst_object_ref(element));
+        }
+        g_value_reset(&item);
+    }
+    g_value_unset(&item);
+    gst_iterator_free(it);
+    return found;
+}
+
+} // namespace
+
+QStringList ScreenStreamer::runBitrateLoopbackBenchmark(int phaseSeconds)
+{
+    static const int PLAYER = 0;
+    static const int CONNECT_TIMEOUT_MS = 10000;
+    struct Phase { int dropPermille; };
+    // Limpo, abaixo do corte (lossHold..lossDecrease), acima do corte e limpo de novo
+    const Phase phases[] = { { 0 }, { 40 }, { 150 }, { 0 } };
+    phaseSeconds = qMax(3, phaseSeconds);
+
+    // Antes do streamer: os probes usam o enlace até o pipeline parar
+    LoopbackLink link;
+
+    ScreenStreamer streamer;
+    PipelineBuilder::Options options;
+    options.video = PipelineBuilder::VideoSource::Test;
+    options.audio = PipelineBuilder::AudioSource::Test;
+    options.encoder = PipelineBuilder::Encoder::X264;
+    options.ranking = { PipelineBuilder::Encoder::X264 };
+    streamer.setPipelineOptions(options);
+    IceConfig ice;
+    ice.lanOnly = true;
+    streamer.setIceConfig(ice);
+    streamer.setStreamingEnabled(true);
+    if (!streamer.pipeline) {
+        return { "Bitrate em loopback: pipeline não montado (x264enc ou plugins do GStreamer ausentes?)" };
+    }
+
+    QEventLoop connectLoop;
+    JoinReceiver receiver;
+    receiver.streamer = &streamer;
+    receiver.playerIndex = PLAYER;
+    receiver.loop = &connectLoop;
+    receiver.pipeline = gst_pipeline_new(nullptr);
+    receiver.webrtc = gst_element_factory_make("webrtcbin", nullptr);
+    g_object_set(receiver.webrtc, "bundle-policy", 3, "latency", 0, nullptr);
+    gst_bin_add(GST_BIN(receiver.pipeline), receiver.webrtc);
+    g_signal_connect(receiver.webrtc, "pad-added", G_CALLBACK(join_receiver_pad_cb), &receiver);
+    g_signal_connect(receiver.webrtc, "on-ice-candidate", G_CALLBACK(join_receiver_candidate_cb), &receiver);
+    GstElement* rtpbin = find_rtpbin(receiver.webrtc);
+    if (!rtpbin) {
+        gst_object_unref(receiver.pipeline);
+        return { "Bitrate em loopback: rtpbin do webrtcbin receptor não encontrado" };
+    }
+    g_signal_connect(rtpbin, "pad-added", G_CALLBACK(link_rtpbin_pad_cb), &link);
+    gst_object_unref(rtpbin);
+    gst_element_set_state(receiver.pipeline, GST_STATE_PLAYING);
+
+    // Sinalização direta; continua ligada para as renegociações da troca de camada
+    const QMetaObject::Connection connection = connect(&streamer, &ScreenStreamer::sendSignalingMessage, &connectLoop,
+        [&receiver](int playerIndex, const SignalMessage& message) {
+            Q_UNUSED(playerIndex);
+            if (message.type == Signal::WebrtcOffer) {
+                join_receiver_offer(&receiver, message.sdp);
+            }
+            else if (message.type == Signal::WebrtcCandidate) {
+                g_signal_emit_by_name(receiver.webrtc, "add-ice-candidate", message.mlineIndex, message.candidate.constData());
+            }
+        });
+
+    QTimer::singleShot(CONNECT_TIMEOUT_MS, &connectLoop, &QEventLoop::quit);
+    streamer.addClient(PLAYER, QSize(), QHostAddress(QHostAddress::LocalHost));
+    connectLoop.exec();
+
+    QStringList report;
+    report << QString("Bitrate em loopback: %1, webrtcbin receptor local, perda no receptor, %2 s por fase")
+        .arg(streamer.m_builder.summary()).arg(phaseSeconds);
+
+    if (receiver.firstFrameUs.loadAcquire() == 0) {
+        report << QString("  nenhum quadro em %1 ms").arg(CONNECT_TIMEOUT_MS);
+    }
+    else {
+        CounterStat* increases = Metrics::instance().counter("stream.bitrate_increase");
+        CounterStat* decreases = Metrics::instance().counter("stream.bitrate_decrease");
+        CounterStat* holds = Metrics::instance().counter("stream.bitrate_hold");
+        LatencyStat* reportedLoss = Metrics::instance().latency("stream.loss_permille");
+
+        GstPad* meteredPad = nullptr;
+        gulong meterProbe = 0;
+        for (const Phase& phase : phases) {
+            link.dropPermille.storeRelaxed(phase.dropPermille);
+            reportedLoss->reset();
+            const qint64 increasesBefore = increases->value();
+            const qint64 decreasesBefore = decreases->value();
+            const qint64 holdsBefore = holds->value();
+            const qint64 receivedBefore = link.received.loadRelaxed();
+            const qint64 droppedBefore = link.dropped.loadRelaxed();
+            const qint64 bytesBefore = link.encodedBytes.loadRelaxed();
+            QElapsedTimer phaseTimer;
+            phaseTimer.start();
+
+            int target = 0;
+            int minTarget = 0;
+            int tier = -1;
+            for (int s = 0; s < phaseSeconds; ++s) {
+                // O get-stats e o controle rodam no timer do próprio streamer
+                QEventLoop tick;
+                QTimer::singleShot(1000, &tick, &QEventLoop::quit);
+                tick.exec();
+
+                QMutexLocker locker(&streamer.m_clientsMutex);
+                ClientStreamContext* ctx = streamer.m_clients.value(PLAYER);
+                TierBranch* branch = ctx ? streamer.m_branches.value(ctx->tier) : nullptr;
+                if (!branch) continue;
+                tier = ctx->tier;
+                target = branch->bitrate.targetKbps();
+                minTarget = (minTarget == 0) ? target : qMin(minTarget, target);
+
+                // Mede o encoder da camada em que o cliente está agora
+                GstPad* encoderPad = gst_element_get_static_pad(branch->encoder, "src");
+                if (encoderPad != meteredPad) {
+                    if (meteredPad) {
+                        gst_pad_remove_probe(meteredPad, meterProbe);
+                        gst_object_unref(meteredPad);
+                    }
+                    meteredPad = encoderPad;
+                    meterProbe = gst_pad_add_probe(meteredPad, GST_PAD_PROBE_TYPE_BUFFER, link_encoded_cb, &link, nullptr);
+                }
+                else if (encoderPad) {
+                    gst_object_unref(encoderPad);
+                }
+            }
+
+            const double elapsedS = phaseTimer.elapsed() / 1000.0;
+            const qint64 received = link.received.loadRelaxed() - receivedBefore;
+            const qint64 dropped = link.dropped.loadRelaxed() - droppedBefore;
+            const double encodedKbps = (link.encodedBytes.loadRelaxed() - bytesBefore) * 8.0 / 1000.0 / elapsedS;
+            report << QString("  perda %1% no receptor (%2 de %3 RTP), informada %4%: alvo %5 kbps (mín. %6), "
+                "encoder %7 kbps, camada %8, rodadas +%9/-%10/=%11")
+                .arg(phase.dropPermille / 10.0, 0, 'f', 1)
+                .arg(dropped).arg(received + dropped)
+                .arg(reportedLoss->count() > 0 ? reportedLoss->mean() / 10.0 : -1.0, 0, 'f', 1)
+                .arg(target).arg(minTarget)
+                .arg(encodedKbps, 0, 'f', 0)
+                .arg(tier)
+                .arg(increases->value() - increasesBefore)
+                .arg(decreases->value() - decreasesBefore)
+                .arg(holds->value() - holdsBefore);
+        }
+        if (meteredPad) {
+            gst_pad_remove_probe(meteredPad, meterProbe);
+            gst_object_unref(meteredPad);
+        }
+    }
+
+    disconnect(connection);
+    streamer.removeClient(PLAYER);
+    gst_element_set_state(receiver.pipeline, GST_STATE_NULL);
+    gst_object_unref(receiver.pipeline);
+    streamer.setStreamingEnabled(false);
+    return report;
+}
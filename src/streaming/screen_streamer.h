@@ -3,20 +3,81 @@
 
 #include <QObject>
 #include <QMap>
+#include <QHash>
 #include <QMutex>
+#include <QSize>
+#include <QHostAddress>
+#include <QAtomicPointer>
 #include <gst/gst.h>
 #include <gst/webrtc/webrtc.h>
 #include <QJsonObject>
+#include "../protocol/signal_codec.h"
+#include "bitrate_controller.h"
+#include "stream_tiers.h"
+#include "pipeline_builder.h"
+
+class QTimer;
+class QProcess;
+class ScreenStreamer;
+
+// ICE dos clientes. Os celulares ficam na mesma LAN ou num tether USB: o modo
+// LAN junta s candidatos host (sem STUN e sem ICE-TCP), o que tambm
+// funciona em rede sem internet, onde o STUN s atrasa a negociao
+struct IceConfig {
+    QString stunServer = "stun://stun.l.google.com:19302";  // Vazio = sem STUN
+    bool lanOnly = false;
+    // S o endereo local em que o socket de controle do jogador chegou
+    bool bindControlInterface = false;
+
+    bool usesStun() const { return !lanOnly && !stunServer.isEmpty(); }
+    QString summary() const;
+};
 
 struct ClientStreamContext {
     int playerId;
+    ScreenStreamer* owner = nullptr;
     GstElement* webrtcbin = nullptr;
     GstElement* rtp_queue = nullptr;
+    // Payloader prprio: a troca de camada no muda SSRC nem sequncia RTP
+    GstElement* payloader = nullptr;
     //Video
-    GstPad* tee_pad = nullptr;
+    GstPad* tee_pad = nullptr;          // Pad no tee da camada atual
+    int tier = -1;
+    QSize screen;                       // Tela informada pelo cliente (vazio = no informada)
+    int downRounds = 0;                 // Histerese da troca de camada
+    int upRounds = 0;
+    int estimateKbps = -1;              // ltima estimativa TWCC
     // udio
     GstElement* audio_queue = nullptr;
     GstPad* tee_audio_pad = nullptr;
+    // Estimador TWCC (rtpgccbwe) criado pelo webrtcbin; nulo se o plugin no existir
+    QAtomicPointer<GstElement> bandwidth_estimator;
+    // Entrada: uma oferta s por cliente, quando o webrtcbin pediu negociao E
+    // o addClient terminou (transceivers e udio no lugar); sai de quem chegar por ltimo
+    enum OfferState { NegotiationNeeded = 1, ClientReady = 2 };
+    QAtomicInt offer_state;
+    QAtomicInt waiting_keyframe;            // Vdeo segurado at o primeiro keyframe da camada
+    QAtomicInteger<qint64> join_start_us;   // addClient -> conectado (0 = j medido)
+    QAtomicInteger<qint64> gather_start_us; // addClient -> coleta ICE completa (0 = j medido)
+    bool stun = false;                      // Coleta com STUN (mtrica separada por modo)
+};
+
+// Ramo de uma camada (criado com o primeiro cliente, destrudo com o ltimo):
+// tee da captura -> escala/taxa -> encoder -> tee da camada
+struct TierBranch {
+    int index = -1;
+    GstElement* bin = nullptr;
+    GstElement* encoder = nullptr;
+    GstElement* tee = nullptr;
+    GstPad* raw_pad = nullptr;          // Pad pedido no tee da captura
+    BitrateController bitrate;
+    int clients = 0;
+    // Keyframes sob demanda (PLI/FIR, entrada, troca de camada): no mximo um
+    // a cada KEYFRAME_MIN_INTERVAL_MS; pedidos no intervalo saem juntos no fim dele
+    ScreenStreamer* owner = nullptr;
+    bool intra_refresh = false;         // PLI coberto pela renovao gradual
+    QAtomicInteger<qint64> last_keyframe_us;
+    QAtomicInt keyframe_pending;
 };
 
 class ScreenStreamer : public QObject
@@ -30,14 +91,41 @@ public:
     // Controle Mestre (Boto da UI)
     void setStreamingEnabled(bool enabled);
     bool isStreamingEnabled() const { return m_isStreamingEnabled; }
+    // "H264" (NVENC, x264, openh264), "VP8" ou vazio se o pipeline no est rodando
+    QString activeVideoCodec() const;
+
+    // Camadas de codificao (vale a partir do prximo incio do pipeline)
+    void setTiers(const StreamTierSet& tiers);
+    const StreamTierSet& tiers() const { return m_tierConfig; }
+    int activeTierCount() const { return m_branches.size(); }
+
+    // Fonte, encoder e udio (Auto = o que estiver instalado); vale no prximo incio.
+    // Sem 'ranking' nas opes, mantm a ordem medida pelo EncoderProbe
+    void setPipelineOptions(const PipelineBuilder::Options& options);
+    const PipelineBuilder::Options& pipelineOptions() const { return m_pipelineOptions; }
+
+    // ICE dos prximos clientes
+    void setIceConfig(const IceConfig& config) { m_iceConfig = config; }
+    const IceConfig& iceConfig() const { return m_iceConfig; }
 
     // Gerenciamento de Clientes
-    void addClient(int playerIndex);
+    // 'screen' = resoluo informada pelo cliente; escolhe a camada inicial.
+    // 'controlAddress' = endereo local do socket de controle (bindControlInterface)
+    void addClient(int playerIndex, const QSize& screen = QSize(), const QHostAddress& controlAddress = QHostAddress());
     void removeClient(int playerIndex);
-    void handleSignalingMessage(int playerIndex, const QJsonObject& json);
+    void handleSignalingMessage(int playerIndex, const SignalMessage& message);
+
+    // Entrada de 'joins' clientes com um webrtcbin receptor no mesmo processo
+    // (fonte sinttica): request_stream -> primeiro quadro decodificado
+    static QStringList runJoinBenchmark(int joins, const IceConfig& ice = IceConfig());
+    // Controle de bitrate de verdade (get-stats -> BitrateController -> encoder)
+    // com x264, receptor local e perda injetada no receptor, em fases de
+    // 'phaseSeconds': sem perda, 4%, 15% e sem perda de novo
+    static QStringList runBitrateLoopbackBenchmark(int phaseSeconds);
 
 signals:
-    void sendSignalingMessage(int playerIndex, const QJsonObject& json);
+    // Emitido tambm das threads do GStreamer (conexo enfileirada)
+    void sendSignalingMessage(int playerIndex, const SignalMessage& message);
     void streamError(const QString& errorMsg);
     void streamStateChanged(bool active); // Avisa a UI se o stream caiu ou iniciou
 
@@ -45,9 +133,34 @@ private:
     bool m_isStreamingEnabled = false;
 
     GstElement* pipeline = nullptr;
-    GstElement* tee_video = nullptr;
+    GstElement* tee_raw = nullptr;      // Captura bruta, compartilhada pelas camadas
     GstElement* tee_audio = nullptr;
-    GstElement* encoder_element = nullptr;
+    PipelineBuilder::Options m_pipelineOptions;
+    PipelineBuilder m_builder;  // Peas escolhidas no incio do pipeline atual
+    IceConfig m_iceConfig;
+
+    StreamTierSet m_tierConfig;
+    StreamTierSet m_tiers;      // Cpia usada pelo pipeline atual
+    QMap<int, TierBranch*> m_branches;
+    // ltima taxa de cada jogador: escolhe a camada quando ele pede o stream de novo
+    QHash<int, int> m_lastRateKbps;
+
+    // Bitrate adaptativo: get-stats de cada webrtcbin a cada STATS_INTERVAL_MS
+    static const int STATS_INTERVAL_MS = 1000;
+    QTimer* m_statsTimer = nullptr;
+
+    // Sem clientes o mestre fica montado mas pausado (captura e udio parados).
+    // Espera IDLE_PAUSE_MS antes de pausar: reconexes rpidas no pagam a retomada
+    static const int IDLE_PAUSE_MS = 5000;
+    QTimer* m_idleTimer = nullptr;
+    bool m_paused = false;
+    qint64 m_phaseStartMs = 0;          // Incio da fase atual (pausado ou rodando)
+    double m_phaseStartCpuMs = 0.0;
+    QAtomicInteger<qint64> m_resumeStartUs; // Retomada esperando o primeiro quadro (0 = nenhuma)
+
+    // Medio dos encoders (s sem cache vlido); roda uma vez, num processo filho
+    // (--bench-encoders) para a CPU medida ser s a do encoder
+    QProcess* m_probeProcess = nullptr;
 
     QMap<int, ClientStreamContext*> m_clients;
     QMutex m_clientsMutex;
@@ -55,12 +168,45 @@ private:
     void startMasterPipeline();
     void stopMasterPipeline();
     void setupMasterPipeline();
-    void forceKeyframe();
+    void pausePipeline();
+    void resumePipeline();
+    void closePhase();
+    void forceKeyframe(TierBranch* branch);
+    // Qualquer thread: limita e junta os pedidos de keyframe de uma camada
+    void requestKeyframe(TierBranch* branch);
+    static const int KEYFRAME_MIN_INTERVAL_MS = 500;
+    // Cliente entrando ou trocando de camada. Com intra-refresh no fora IDR:
+    // espera a prxima volta da renovao e s pede o keyframe depois de
+    // INTRA_REFRESH_JOIN_WAIT_MS (volta de 1 s do PipelineBuilder + folga)
+    void requestJoinKeyframe(ClientStreamContext* ctx, TierBranch* branch);
+    static const int INTRA_REFRESH_JOIN_WAIT_MS = 1500;
+
+    // Camadas (com m_clientsMutex travado)
+    TierBranch* acquireTier(int index);
+    void releaseTier(int index);
+    void attachClientVideo(ClientStreamContext* ctx, TierBranch* branch);
+    void detachClientVideo(ClientStreamContext* ctx);
+    void migrateClient(ClientStreamContext* ctx, int tier);
+
+    void startEncoderProbe();
+    void applyEncoderRanking(const QVector<PipelineBuilder::Encoder>& ranking);
+
+    void pollTransportStats();
+    void onTransportStats(int playerIndex, const TransportSample& sample);
+
+    static void createOffer(ClientStreamContext* ctx);
 
     // Callbacks GStreamer
     static void onNegotiationNeeded(GstElement* webrtc, gpointer user_data);
+    static void onConnectionStateChanged(GstElement* webrtc, GParamSpec* pspec, gpointer user_data);
+    static void onIceGatheringStateChanged(GstElement* webrtc, GParamSpec* pspec, gpointer user_data);
     static void onIceCandidate(GstElement* webrtc, guint mline_index, gchar* candidate, gpointer user_data);
     static void onOfferCreated(GstPromise* promise, gpointer user_data);
+    static void onStatsReady(GstPromise* promise, gpointer user_data);
+    static GstElement* onRequestAuxSender(GstElement* webrtc, GstWebRTCDTLSTransport* dtls_transport, gpointer user_data);
+    static GstPadProbeReturn onUpstreamKeyUnit(GstPad* pad, GstPadProbeInfo* info, gpointer user_data);
+    static GstPadProbeReturn onEncodedFrame(GstPad* pad, GstPadProbeInfo* info, gpointer user_data);
+    static GstPadProbeReturn onFirstFrameAfterResume(GstPad* pad, GstPadProbeInfo* info, gpointer user_data);
     static GstBusSyncReply onBusMessage(GstBus* bus, GstMessage* msg, gpointer user_data);
 };
 
@@ -69,4 +215,4 @@ struct CallbackData {
     int playerId;
 };
 
-#endif // SCREEN_STREAMER_H
\ No newline at end of file
+#endif // SCREEN_STREAMER_H
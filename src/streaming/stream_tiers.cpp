@@ -0,0 +1,136 @@
+﻿#include "stream_tiers.h"
+#include <QRegularExpression>
+#include <algorithm>
+
+QString StreamTier::name() const
+{
+    return QString("%1x%2@%3").arg(width).arg(height).arg(framerate);
+}
+
+StreamTierSet::StreamTierSet()
+{
+    m_tiers = {
+        { 1920, 1080, 60, 8000 },
+        { 1280, 720, 60, 4000 },
+        { 854, 480, 30, 1500 },
+    };
+}
+
+bool StreamTierSet::parse(const QString& spec, StreamTierSet& tiers, QString& error)
+{
+    static const QRegularExpression pattern("^(\\d+)x(\\d+)@(\\d+):(\\d+)$");
+
+    QVector<StreamTier> parsed;
+    for (const QString& entry : spec.split(',', Qt::SkipEmptyParts)) {
+        const QRegularExpressionMatch match = pattern.match(entry.trimmed());
+        if (!match.hasMatch()) {
+            error = QString("Camada inválida: %1 (formato LxA@fps:kbps)").arg(entry.trimmed());
+            return false;
+        }
+
+        StreamTier tier;
+        tier.width = match.captured(1).toInt();
+        tier.height = match.captured(2).toInt();
+        tier.framerate = match.captured(3).toInt();
+        tier.kbps = match.captured(4).toInt();
+        if (tier.width < 160 || tier.height < 120 || tier.framerate < 1 || tier.framerate > 240
+            || tier.kbps < MIN_KBPS || tier.kbps > 100000) {
+            error = QString("Camada fora dos limites: %1").arg(entry.trimmed());
+            return false;
+        }
+        parsed.append(tier);
+    }
+
+    if (parsed.isEmpty()) {
+        error = "Nenhuma camada de stream informada";
+        return false;
+    }
+
+    std::sort(parsed.begin(), parsed.end(), [](const StreamTier& a, const StreamTier& b) {
+        return a.height != b.height ? a.height > b.height : a.kbps > b.kbps;
+    });
+    tiers.m_tiers = parsed;
+    return true;
+}
+
+QString StreamTierSet::toString() const
+{
+    QStringList entries;
+    for (const StreamTier& tier : m_tiers) {
+        entries << QString("%1:%2").arg(tier.name()).arg(tier.kbps);
+    }
+    return entries.join(',');
+}
+
+BitrateConfig StreamTierSet::bitrateConfig(int index) const
+{
+    BitrateConfig config;
+    config.minKbps = MIN_KBPS;
+    config.maxKbps = m_tiers.at(index).kbps;
+    config.startKbps = m_tiers.at(index).kbps;
+    config.increaseKbps = qMax(50, config.maxKbps / 20);
+    return config;
+}
+
+bool StreamTierSet::fitsScreen(int index, const QSize& screen) const
+{
+    // Tela não informada: qualquer camada serve. A menor camada sempre serve
+    if (screen.width() <= 0 || screen.height() <= 0) return true;
+    if (index == m_tiers.size() - 1) return true;
+
+    // Celular em pé ou deitado: compara o lado menor com o lado menor
+    const int screenShort = qMin(screen.width(), screen.height());
+    const StreamTier& tier = m_tiers.at(index);
+    return qMin(tier.width, tier.height) <= screenShort;
+}
+
+int StreamTierSet::downgradeKbps(int index) const
+{
+    return (index + 1 < m_tiers.size()) ? m_tiers.at(index + 1).kbps : 0;
+}
+
+int StreamTierSet::initialTier(const QSize& screen, int bandwidthKbps) const
+{
+    for (int i = 0; i < m_tiers.size(); ++i) {
+        if (!fitsScreen(i, screen)) continue;
+        if (bandwidthKbps >= 0 && bandwidthKbps < downgradeKbps(i)) continue;
+        return i;
+    }
+    return m_tiers.size() - 1;
+}
+
+int StreamTierSet::nextTier(int current, const QSize& screen, int rateKbps, int estimateKbps,
+    int& downRounds, int& upRounds) const
+{
+    if (current < 0 || current >= m_tiers.size()) return initialTier(screen, -1);
+
+    if (rateKbps >= 0 && rateKbps < downgradeKbps(current)) {
+        upRounds = 0;
+        if (++downRounds >= DOWNGRADE_ROUNDS) {
+            downRounds = 0;
+            return current + 1;
+        }
+        return current;
+    }
+    downRounds = 0;
+
+    const int up = current - 1;
+    if (up < 0 || !fitsScreen(up, screen)) {
+        upRounds = 0;
+        return current;
+    }
+
+    // Com TWCC a estimativa diz direto se cabe; sem ela, só tempo no teto sem perda
+    const bool estimateFits = estimateKbps > 0 && estimateKbps >= m_tiers.at(up).kbps;
+    const bool atCeiling = rateKbps >= m_tiers.at(current).kbps;
+    if (estimateFits || atCeiling) {
+        if (++upRounds >= (estimateFits ? DOWNGRADE_ROUNDS : UPGRADE_ROUNDS)) {
+            upRounds = 0;
+            return up;
+        }
+    }
+    else {
+        upRounds = 0;
+    }
+    return current;
+}
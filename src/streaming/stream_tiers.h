@@ -0,0 +1,62 @@
+#ifndef STREAM_TIERS_H
+#define STREAM_TIERS_H
+
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "bitrate_controller.h"
+
+// Uma camada de codificação: todas saem da mesma captura, cada uma com o seu
+// encoder. Os clientes são distribuídos pela tela que informam e pela banda medida.
+struct StreamTier {
+    int width = 1920;
+    int height = 1080;
+    int framerate = 60;
+    int kbps = 8000;        // Bitrate inicial e teto do controle adaptativo
+
+    QString name() const;   // "1280x720@60"
+};
+
+// Conjunto ordenado da maior para a menor camada
+class StreamTierSet
+{
+public:
+    // Rodadas do controle de bitrate (1 s cada) antes de trocar de camada
+    static const int DOWNGRADE_ROUNDS = 3;
+    static const int UPGRADE_ROUNDS = 10;
+    // Piso do controle de bitrate em qualquer camada
+    static const int MIN_KBPS = 300;
+
+    // 1080p60 8 Mbps, 720p60 4 Mbps, 480p30 1.5 Mbps
+    StreamTierSet();
+
+    // "1920x1080@60:8000,1280x720@60:4000" (a ordem da lista não importa)
+    static bool parse(const QString& spec, StreamTierSet& tiers, QString& error);
+    QString toString() const;
+
+    int count() const { return m_tiers.size(); }
+    const StreamTier& at(int index) const { return m_tiers.at(index); }
+
+    // Controle de bitrate de uma camada: começa e tem teto no bitrate dela
+    BitrateConfig bitrateConfig(int index) const;
+
+    // Camada inicial: a maior que cabe na tela e na banda conhecida (-1 = não medida)
+    int initialTier(const QSize& screen, int bandwidthKbps) const;
+
+    // Reavaliação a cada rodada do controle. Desce se a taxa do cliente ficar
+    // abaixo do bitrate da camada de baixo; sobe depois de um tempo no teto sem
+    // perda ou se a estimativa do TWCC comportar a camada de cima.
+    // 'downRounds'/'upRounds' guardam a histerese do cliente.
+    int nextTier(int current, const QSize& screen, int rateKbps, int estimateKbps,
+        int& downRounds, int& upRounds) const;
+
+private:
+    bool fitsScreen(int index, const QSize& screen) const;
+    // Abaixo disso a camada de baixo entrega mais qualidade
+    int downgradeKbps(int index) const;
+
+    QVector<StreamTier> m_tiers;
+};
+
+#endif // STREAM_TIERS_H
@@ -0,0 +1,28 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32 (IEEE 802.3, polinômio refletido 0xEDB88320), o mesmo usado pelo
+// protocolo DSU/Cemuhook e pelo zlib.
+// A implementação é escolhida uma única vez em tempo de execução:
+//   - PCLMULQDQ + SSE4.1 (folding de 128 bits) quando a CPU suporta;
+//   - slicing-by-8 (tabelas de 8 KB) nos demais casos.
+namespace Crc32 {
+
+// CRC de um bloco completo (valor final, já invertido)
+uint32_t compute(const void* data, size_t length);
+
+// Continua um CRC anterior: update(update(0, a), b) == compute(a + b)
+uint32_t update(uint32_t crc, const void* data, size_t length);
+
+// Implementação de referência bit a bit (usada só para validação/benchmark)
+uint32_t computeBitwise(const void* data, size_t length);
+
+// Nome da implementação selecionada ("pclmul" ou "slicing-by-8")
+const char* implementationName();
+
+}
+
+#endif // CRC32_H
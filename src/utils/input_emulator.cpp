@@ -1,5 +1,7 @@
 #include "input_emulator.h"
 
+#ifdef Q_OS_WIN
+
 void InputEmulator::moveMouse(int dx, int dy)
 {
     INPUT input = { 0 };
@@ -21,4 +23,20 @@ void InputEmulator::mouseClick(bool left, bool down)
         input.mi.dwFlags = down ? MOUSEEVENTF_RIGHTDOWN : MOUSEEVENTF_RIGHTUP;
     }
     SendInput(1, &input, sizeof(INPUT));
-}
\ No newline at end of file
+}
+
+#else
+
+void InputEmulator::moveMouse(int dx, int dy)
+{
+    Q_UNUSED(dx);
+    Q_UNUSED(dy);
+}
+
+void InputEmulator::mouseClick(bool left, bool down)
+{
+    Q_UNUSED(left);
+    Q_UNUSED(down);
+}
+
+#endif
\ No newline at end of file
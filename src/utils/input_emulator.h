@@ -1,8 +1,13 @@
 #ifndef INPUT_EMULATOR_H
 #define INPUT_EMULATOR_H
 
+#include <QtGlobal>
+#ifdef Q_OS_WIN
 #include <Windows.h>
+#endif
 
+// Mouse do PC controlado pelo celular (SendInput). Fora do Windows as
+// chamadas não fazem nada
 class InputEmulator
 {
 public:
@@ -0,0 +1,417 @@
+﻿#include "log.h"
+#include <QThread>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+constexpr int RECORD_TEXT = 232;     // Registro inteiro com 256 bytes
+constexpr quint32 RING_CAPACITY = 512;   // Potência de 2
+
+struct LogRecord {
+    qint64 timeUs;                   // Relógio de parede (µs desde a época)
+    const char* category;
+    quint8 level;
+    quint16 length;
+    char text[RECORD_TEXT];
+};
+
+// Anel de uma thread: só ela escreve (head), só a thread de escrita lê (tail)
+struct LogRing {
+    LogRecord records[RING_CAPACITY];
+    alignas(64) QAtomicInteger<quint32> head{ 0 };
+    alignas(64) QAtomicInteger<quint32> tail{ 0 };
+    QAtomicInteger<quint64> dropped{ 0 };
+    QAtomicInt owned{ 1 };           // 0 = thread dona terminou, anel pode ser reaproveitado
+    LogRing* next = nullptr;
+};
+
+// Os anéis nunca são liberados: quando a thread termina, o anel volta para
+// reaproveitamento (a memória fica limitada ao pico de threads que logaram)
+QAtomicPointer<LogRing> s_rings;
+QAtomicPointer<LogSite> s_sites;
+
+struct RingHolder {
+    LogRing* ring = nullptr;
+    ~RingHolder() { if (ring) ring->owned.storeRelease(0); }
+};
+thread_local RingHolder t_ring;
+
+LogRing* localRing()
+{
+    if (t_ring.ring) return t_ring.ring;
+
+    for (LogRing* ring = s_rings.loadAcquire(); ring; ring = ring->next) {
+        if (ring->owned.testAndSetAcquire(0, 1)) {
+            t_ring.ring = ring;
+            return ring;
+        }
+    }
+
+    LogRing* ring = new LogRing;
+    LogRing* head = s_rings.loadAcquire();
+    do {
+        ring->next = head;
+    } while (!s_rings.testAndSetOrdered(head, ring, head));
+    t_ring.ring = ring;
+    return ring;
+}
+
+qint64 wallClockUs()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+const char levelLetter[] = { 'T', 'D', 'I', 'W', 'E' };
+
+// --- THREAD DE ESCRITA ---
+
+struct Writer {
+    QMutex mutex;                    // Só protege início/parada e o arquivo
+    QThread* thread = nullptr;
+    QAtomicInt running{ 0 };
+    QFile file;
+    QString filePath;
+    qint64 maxBytes = 0;
+    int maxFiles = 0;
+    QVector<LogRecord> batch;
+};
+
+Writer& writer()
+{
+    static Writer w;
+    return w;
+}
+
+QByteArray formatRecord(const LogRecord& record)
+{
+    const QDateTime time = QDateTime::fromMSecsSinceEpoch(record.timeUs / 1000);
+    QByteArray line = time.toString("yyyy-MM-dd HH:mm:ss.zzz").toLatin1();
+    line += ' ';
+    line += levelLetter[qBound(0, int(record.level), 4)];
+    line += " [";
+    line += record.category;
+    line += "] ";
+    line.append(record.text, record.length);
+    line += '\n';
+    return line;
+}
+
+void rotateIfNeeded(Writer& w)
+{
+    if (!w.file.isOpen() || w.maxBytes <= 0 || w.file.size() < w.maxBytes) return;
+
+    w.file.close();
+    QFile::remove(QString("%1.%2").arg(w.filePath).arg(w.maxFiles));
+    for (int i = w.maxFiles - 1; i >= 1; --i) {
+        QFile::rename(QString("%1.%2").arg(w.filePath).arg(i), QString("%1.%2").arg(w.filePath).arg(i + 1));
+    }
+    QFile::rename(w.filePath, w.filePath + ".1");
+    w.file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text);
+}
+
+// Esvazia todos os anéis; retorna quantos registros foram escritos
+int drainRings(Writer& w)
+{
+    w.batch.clear();
+    quint64 dropped = 0;
+
+    for (LogRing* ring = s_rings.loadAcquire(); ring; ring = ring->next) {
+        const quint32 head = ring->head.loadAcquire();
+        quint32 tail = ring->tail.loadRelaxed();
+        while (tail != head) {
+            w.batch.append(ring->records[tail & (RING_CAPACITY - 1)]);
+            ++tail;
+        }
+        ring->tail.storeRelease(tail);
+        dropped += ring->dropped.fetchAndStoreRelaxed(0);
+    }
+    if (w.batch.isEmpty() && dropped == 0) return 0;
+
+    // Ordem global aproximada entre threads
+    std::stable_sort(w.batch.begin(), w.batch.end(),
+        [](const LogRecord& a, const LogRecord& b) { return a.timeUs < b.timeUs; });
+
+    QByteArray out;
+    for (const LogRecord& record : w.batch) out += formatRecord(record);
+    if (dropped > 0) {
+        out += QByteArray("--- ") + QByteArray::number(dropped) + " mensagens de log descartadas (anel cheio) ---\n";
+    }
+
+    QMutexLocker locker(&w.mutex);
+    if (w.file.isOpen()) {
+        w.file.write(out);
+        w.file.flush();
+        rotateIfNeeded(w);
+    }
+    locker.unlock();
+
+    if (Log::consoleOutput()) {
+        fwrite(out.constData(), 1, out.size(), stderr);
+        fflush(stderr);
+    }
+    return w.batch.size();
+}
+
+void pushRecord(LogLevel level, const char* category, const char* text, int length)
+{
+    LogRing* ring = localRing();
+    const quint32 head = ring->head.loadRelaxed();
+    if (head - ring->tail.loadAcquire() >= RING_CAPACITY) {
+        ring->dropped.fetchAndAddRelaxed(1);
+        return;
+    }
+
+    LogRecord& record = ring->records[head & (RING_CAPACITY - 1)];
+    record.timeUs = wallClockUs();
+    record.category = category;
+    record.level = static_cast<quint8>(level);
+    record.length = static_cast<quint16>(qBound(0, length, RECORD_TEXT));
+    memcpy(record.text, text, record.length);
+    ring->head.storeRelease(head + 1);
+}
+
+void qtMessageHandler(QtMsgType type, const QMessageLogContext& context, const QString& message)
+{
+    LogLevel level = LogLevel::Debug;
+    switch (type) {
+    case QtDebugMsg: level = LogLevel::Debug; break;
+    case QtInfoMsg: level = LogLevel::Info; break;
+    case QtWarningMsg: level = LogLevel::Warning; break;
+    case QtCriticalMsg:
+    case QtFatalMsg: level = LogLevel::Error; break;
+    }
+    if (static_cast<int>(level) < static_cast<int>(Log::level())) return;
+
+    const char* category = (context.category && strcmp(context.category, "default") != 0) ? context.category : "qt";
+    const QByteArray text = message.toUtf8();
+    if (writer().running.loadAcquire()) {
+        pushRecord(level, category, text.constData(), text.size());
+    }
+    else if (Log::consoleOutput()) {
+        fprintf(stderr, "%c [%s] %s\n", levelLetter[static_cast<int>(level)], category, text.constData());
+    }
+
+    if (type == QtFatalMsg) {
+        Log::stop();
+        abort();
+    }
+}
+
+} // namespace
+
+// --- LOGSITE ---
+
+LogSite::LogSite(LogLevel level, const char* category, const char* file, int line)
+    : level(level), category(category), file(file), line(line),
+    m_windowStartMs(Log::nowMs()), m_emitted(0), m_suppressed(0)
+{
+    Log::registerSite(this);
+}
+
+bool LogSite::admit()
+{
+    if (static_cast<int>(level) < Log::s_level.loadRelaxed()) return false;
+
+    const int limit = Log::s_rateLimit.loadRelaxed();
+    if (limit <= 0) return true;
+
+    // Janela nova: quem ganhar o CAS publica o resumo da anterior
+    const qint64 now = Log::nowMs();
+    qint64 start = m_windowStartMs.loadRelaxed();
+    if (now - start >= Log::RATE_WINDOW_MS && m_windowStartMs.testAndSetRelaxed(start, now)) {
+        m_emitted.storeRelaxed(0);
+        const int suppressed = m_suppressed.fetchAndStoreRelaxed(0);
+        if (suppressed > 0) Log::writeSuppressed(*this, suppressed);
+    }
+
+    if (m_emitted.fetchAndAddRelaxed(1) < limit) return true;
+    m_suppressed.fetchAndAddRelaxed(1);
+    return false;
+}
+
+// --- LOG ---
+
+// Trace só quando pedido (setLevel), mesmo se compilado
+QAtomicInt Log::s_level(GPV_LOG_MIN_LEVEL > 1 ? GPV_LOG_MIN_LEVEL : 1);
+QAtomicInt Log::s_rateLimit(Log::DEFAULT_RATE_LIMIT);
+QAtomicInt Log::s_console(1);
+
+qint64 Log::nowMs()
+{
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void Log::registerSite(LogSite* site)
+{
+    LogSite* head = s_sites.loadAcquire();
+    do {
+        site->m_next = head;
+    } while (!s_sites.testAndSetOrdered(head, site, head));
+}
+
+void Log::write(LogSite& site, const char* format, ...)
+{
+    char text[RECORD_TEXT];
+    va_list args;
+    va_start(args, format);
+    const int length = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (length < 0) return;
+
+    // Sem a thread de escrita (antes de start() ou depois de stop()) escreve direto
+    if (!writer().running.loadAcquire()) {
+        if (consoleOutput()) fprintf(stderr, "%c [%s] %s\n", levelLetter[static_cast<int>(site.level)], site.category, text);
+        return;
+    }
+    pushRecord(site.level, site.category, text, qMin(length, RECORD_TEXT - 1));
+}
+
+void Log::writeSuppressed(LogSite& site, int count)
+{
+    const char* file = strrchr(site.file, '/');
+    if (!file) file = strrchr(site.file, '\\');
+    file = file ? file + 1 : site.file;
+
+    char text[RECORD_TEXT];
+    const int length = snprintf(text, sizeof(text), "(%d mensagens semelhantes suprimidas em %s:%d)", count, file, site.line);
+    if (length < 0) return;
+
+    if (!writer().running.loadAcquire()) {
+        if (consoleOutput()) fprintf(stderr, "%c [%s] %s\n", levelLetter[static_cast<int>(site.level)], site.category, text);
+        return;
+    }
+    pushRecord(site.level, site.category, text, qMin(length, RECORD_TEXT - 1));
+}
+
+bool Log::consoleOutput()
+{
+    return s_console.loadRelaxed() != 0;
+}
+
+void Log::start(const QString& filePath, qint64 maxBytes, int maxFiles)
+{
+    Writer& w = writer();
+    QMutexLocker locker(&w.mutex);
+    if (w.running.loadAcquire()) return;
+
+    w.filePath = filePath;
+    w.maxBytes = maxBytes;
+    w.maxFiles = qMax(1, maxFiles);
+    if (!filePath.isEmpty()) {
+        QDir().mkpath(QFileInfo(filePath).absolutePath());
+        w.file.setFileName(filePath);
+        if (!w.file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+            fprintf(stderr, "Nao foi possivel abrir o arquivo de log %s\n", qPrintable(filePath));
+        }
+    }
+
+    w.running.storeRelease(1);
+    w.thread = QThread::create([&w]() {
+        while (w.running.loadAcquire()) {
+            if (drainRings(w) == 0) QThread::msleep(10);
+        }
+    });
+    w.thread->setObjectName("log-writer");
+    w.thread->start(QThread::LowPriority);
+}
+
+void Log::stop()
+{
+    Writer& w = writer();
+    QMutexLocker locker(&w.mutex);
+    if (!w.running.loadAcquire()) return;
+
+    // Resumo dos pontos que ainda tinham mensagens suprimidas
+    for (LogSite* site = s_sites.loadAcquire(); site; site = site->m_next) {
+        const int suppressed = site->m_suppressed.fetchAndStoreRelaxed(0);
+        if (suppressed > 0) writeSuppressed(*site, suppressed);
+    }
+
+    w.running.storeRelease(0);
+    QThread* thread = w.thread;
+    w.thread = nullptr;
+    locker.unlock();
+
+    thread->wait();
+    delete thread;
+    drainRings(w);
+
+    locker.relock();
+    w.file.close();
+}
+
+void Log::installQtMessageHandler()
+{
+    qInstallMessageHandler(qtMessageHandler);
+}
+
+// --- BENCHMARK ---
+
+QStringList Log::runBenchmark(int iterations)
+{
+    iterations = qMax(1, iterations);
+
+    const int savedLevel = s_level.loadRelaxed();
+    const int savedLimit = s_rateLimit.loadRelaxed();
+    const int savedConsole = s_console.loadRelaxed();
+    const bool wasRunning = writer().running.loadAcquire();
+    s_level.storeRelaxed(static_cast<int>(LogLevel::Trace));
+    s_console.storeRelaxed(0);
+    if (!wasRunning) start();
+
+    QStringList lines;
+    QElapsedTimer timer;
+
+    // 1. Chamadas suprimidas pelo limite da janela
+    static LogSite suppressedSite(LogLevel::Debug, "bench", __FILE__, __LINE__);
+    s_rateLimit.storeRelaxed(1);
+    timer.start();
+    for (int i = 0; i < iterations; ++i) {
+        if (suppressedSite.admit()) write(suppressedSite, "mensagem %d", i);
+    }
+    const double suppressedNs = static_cast<double>(timer.nsecsElapsed()) / iterations;
+    suppressedSite.m_suppressed.storeRelaxed(0);
+
+    // 2. Chamadas emitidas (formatação + anel); espera a escrita entre lotes,
+    //    fora da medição, para não medir descarte por anel cheio
+    static LogSite emittedSite(LogLevel::Debug, "bench", __FILE__, __LINE__);
+    s_rateLimit.storeRelaxed(0);
+    const int batch = RING_CAPACITY / 2;
+    qint64 emittedTotalNs = 0;
+    for (int done = 0; done < iterations; done += batch) {
+        const int count = qMin(batch, iterations - done);
+        timer.restart();
+        for (int i = 0; i < count; ++i) {
+            if (emittedSite.admit()) write(emittedSite, "jogador %d pacote %d estado 0x%04x", i % 8, done + i, i & 0xFFFF);
+        }
+        emittedTotalNs += timer.nsecsElapsed();
+
+        LogRing* ring = localRing();
+        while (ring->tail.loadAcquire() != ring->head.loadRelaxed()) QThread::usleep(100);
+    }
+    const double emittedNs = static_cast<double>(emittedTotalNs) / iterations;
+
+    lines << QString("Log: %1 chamadas por caso").arg(iterations);
+    lines << QString("  suprimida (limite da janela): %1 ns/chamada").arg(suppressedNs, 0, 'f', 1);
+    lines << QString("  emitida (formatação + anel): %1 ns/chamada").arg(emittedNs, 0, 'f', 1);
+
+    if (!wasRunning) stop();
+    s_level.storeRelaxed(savedLevel);
+    s_rateLimit.storeRelaxed(savedLimit);
+    s_console.storeRelaxed(savedConsole);
+    return lines;
+}
@@ -0,0 +1,109 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <QAtomicInteger>
+#include <QString>
+#include <QStringList>
+
+// Log assíncrono para os caminhos quentes (vibração, leitura TCP, sinalização,
+// bus do GStreamer, datagramas UDP).
+// - Níveis abaixo de GPV_LOG_MIN_LEVEL são removidos na compilação (o Release
+//   define QT_NO_DEBUG e fica só com Info para cima).
+// - Cada thread escreve num anel próprio (produtor único, sem locks); uma
+//   thread de fundo esvazia os anéis no console e num arquivo com rotação.
+// - Cada ponto de log tem limite de mensagens por janela; o excesso vira uma
+//   linha "N mensagens semelhantes suprimidas" na janela seguinte.
+// Uso (formato printf, argumentos só avaliados se a mensagem passar):
+//   LOG_DEBUG("net", "Vibração para o jogador %d (%d bytes)", player, size);
+
+enum class LogLevel : int { Trace = 0, Debug, Info, Warning, Error };
+
+#ifndef GPV_LOG_MIN_LEVEL
+#ifdef QT_NO_DEBUG
+#define GPV_LOG_MIN_LEVEL 2
+#else
+#define GPV_LOG_MIN_LEVEL 0
+#endif
+#endif
+
+// Ponto de log (uma instância estática por chamada do macro)
+class LogSite
+{
+public:
+    LogSite(LogLevel level, const char* category, const char* file, int line);
+
+    // Nível ligado em tempo de execução e dentro do limite da janela
+    bool admit();
+
+    const LogLevel level;
+    const char* const category;
+    const char* const file;
+    const int line;
+
+private:
+    friend class Log;
+
+    QAtomicInteger<qint64> m_windowStartMs;
+    QAtomicInt m_emitted;
+    QAtomicInt m_suppressed;
+    LogSite* m_next = nullptr;   // Lista de todos os pontos (para o resumo final)
+};
+
+class Log
+{
+public:
+    // Janela e limite padrão da agregação por ponto de log
+    static constexpr int RATE_WINDOW_MS = 1000;
+    static constexpr int DEFAULT_RATE_LIMIT = 20;
+
+    // Inicia a thread de escrita. 'filePath' vazio = só console.
+    // O arquivo vira .1, .2... ao passar de 'maxBytes' (mantém 'maxFiles')
+    static void start(const QString& filePath = QString(), qint64 maxBytes = 5 * 1024 * 1024, int maxFiles = 3);
+    // Esvazia os anéis, escreve os resumos de supressão pendentes e para a thread
+    static void stop();
+
+    static void setLevel(LogLevel level) { s_level.storeRelaxed(static_cast<int>(level)); }
+    static LogLevel level() { return static_cast<LogLevel>(s_level.loadRelaxed()); }
+    // Mensagens por ponto de log a cada RATE_WINDOW_MS (0 = sem limite)
+    static void setRateLimit(int messages) { s_rateLimit.storeRelaxed(messages); }
+    static void setConsoleOutput(bool enabled) { s_console.storeRelaxed(enabled ? 1 : 0); }
+    static bool consoleOutput();
+
+    // Encaminha qDebug/qWarning/... para o mesmo anel (sem limite por ponto)
+    static void installQtMessageHandler();
+
+    static void write(LogSite& site, const char* format, ...)
+#if defined(__GNUC__) || defined(__clang__)
+        __attribute__((format(printf, 2, 3)))
+#endif
+        ;
+
+    // ns por chamada suprimida e por chamada emitida
+    static QStringList runBenchmark(int iterations);
+
+private:
+    friend class LogSite;
+    static qint64 nowMs();
+    static void registerSite(LogSite* site);
+    static void writeSuppressed(LogSite& site, int count);
+
+    static QAtomicInt s_level;
+    static QAtomicInt s_rateLimit;
+    static QAtomicInt s_console;
+};
+
+#define GPV_LOG(lvl, category, ...) \
+    do { \
+        if constexpr (static_cast<int>(lvl) >= GPV_LOG_MIN_LEVEL) { \
+            static LogSite gpvLogSite_(lvl, category, __FILE__, __LINE__); \
+            if (gpvLogSite_.admit()) Log::write(gpvLogSite_, __VA_ARGS__); \
+        } \
+    } while (0)
+
+#define LOG_TRACE(category, ...) GPV_LOG(LogLevel::Trace, category, __VA_ARGS__)
+#define LOG_DEBUG(category, ...) GPV_LOG(LogLevel::Debug, category, __VA_ARGS__)
+#define LOG_INFO(category, ...) GPV_LOG(LogLevel::Info, category, __VA_ARGS__)
+#define LOG_WARNING(category, ...) GPV_LOG(LogLevel::Warning, category, __VA_ARGS__)
+#define LOG_ERROR(category, ...) GPV_LOG(LogLevel::Error, category, __VA_ARGS__)
+
+#endif // LOG_H
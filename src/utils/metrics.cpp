@@ -0,0 +1,195 @@
+﻿#include "metrics.h"
+#include <QDebug>
+#include <QMutexLocker>
+#include <limits>
+#ifdef Q_OS_WIN
+#include <Windows.h>
+#else
+#include <ctime>
+#endif
+
+// --- LATENCYSTAT ---
+
+LatencyStat::LatencyStat(const QString& name)
+    : m_name(name), m_count(0), m_sum(0),
+    m_min(std::numeric_limits<qint64>::max()), m_max(0)
+{
+    for (int i = 0; i < BUCKETS; ++i) m_buckets[i].storeRelaxed(0);
+}
+
+void LatencyStat::record(qint64 value)
+{
+    if (value < 0) value = 0;
+
+    m_count.fetchAndAddRelaxed(1);
+    m_sum.fetchAndAddRelaxed(value);
+
+    // Mínimo/máximo com CAS (raramente disputado)
+    qint64 current = m_max.loadRelaxed();
+    while (value > current && !m_max.testAndSetRelaxed(current, value, current)) {}
+    current = m_min.loadRelaxed();
+    while (value < current && !m_min.testAndSetRelaxed(current, value, current)) {}
+
+    // Bucket = posição do bit mais significativo (0 -> bucket 0)
+    int bucket = 0;
+    quint64 v = static_cast<quint64>(value);
+    while (v > 0 && bucket < BUCKETS - 1) {
+        v >>= 1;
+        ++bucket;
+    }
+    m_buckets[bucket].fetchAndAddRelaxed(1);
+}
+
+void LatencyStat::reset()
+{
+    m_count.storeRelaxed(0);
+    m_sum.storeRelaxed(0);
+    m_min.storeRelaxed(std::numeric_limits<qint64>::max());
+    m_max.storeRelaxed(0);
+    for (int i = 0; i < BUCKETS; ++i) m_buckets[i].storeRelaxed(0);
+}
+
+qint64 LatencyStat::min() const
+{
+    return count() > 0 ? m_min.loadRelaxed() : 0;
+}
+
+double LatencyStat::mean() const
+{
+    const qint64 n = count();
+    return n > 0 ? static_cast<double>(sum()) / n : 0.0;
+}
+
+qint64 LatencyStat::percentile(double p) const
+{
+    const qint64 n = count();
+    if (n == 0) return 0;
+
+    const qint64 target = static_cast<qint64>(p * n);
+    qint64 accumulated = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+        accumulated += m_buckets[i].loadRelaxed();
+        if (accumulated > target) {
+            // Limite superior do bucket, sem passar do máximo observado
+            const qint64 upper = (i == 0) ? 0 : ((qint64(1) << i) - 1);
+            return qMin(upper, max());
+        }
+    }
+    return max();
+}
+
+QString LatencyStat::summary() const
+{
+    return QString("%1: n=%2 min=%3 avg=%4 p50=%5 p99=%6 max=%7")
+        .arg(m_name)
+        .arg(count())
+        .arg(min())
+        .arg(mean(), 0, 'f', 1)
+        .arg(percentile(0.50))
+        .arg(percentile(0.99))
+        .arg(max());
+}
+
+QJsonObject LatencyStat::toJson() const
+{
+    QJsonObject obj;
+    obj["count"] = count();
+    obj["min"] = min();
+    obj["avg"] = mean();
+    obj["p50"] = percentile(0.50);
+    obj["p99"] = percentile(0.99);
+    obj["max"] = max();
+    return obj;
+}
+
+// --- METRICS ---
+
+Metrics& Metrics::instance()
+{
+    static Metrics metrics;
+    return metrics;
+}
+
+double Metrics::processCpuMs()
+{
+#ifdef Q_OS_WIN
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) return 0.0;
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+    return double(k.QuadPart + u.QuadPart) / 10000.0; // Unidades de 100 ns
+#else
+    timespec ts;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0) return 0.0;
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+#endif
+}
+
+Metrics::~Metrics()
+{
+    qDeleteAll(m_latencies);
+    qDeleteAll(m_counters);
+}
+
+LatencyStat* Metrics::latency(const QString& name)
+{
+    QMutexLocker locker(&m_mutex);
+    for (LatencyStat* stat : m_latencies) {
+        if (stat->name() == name) return stat;
+    }
+    LatencyStat* stat = new LatencyStat(name);
+    m_latencies.append(stat);
+    return stat;
+}
+
+CounterStat* Metrics::counter(const QString& name)
+{
+    QMutexLocker locker(&m_mutex);
+    for (CounterStat* stat : m_counters) {
+        if (stat->name() == name) return stat;
+    }
+    CounterStat* stat = new CounterStat(name);
+    m_counters.append(stat);
+    return stat;
+}
+
+QStringList Metrics::report() const
+{
+    QMutexLocker locker(&m_mutex);
+    QStringList lines;
+    for (const CounterStat* stat : m_counters) {
+        lines << QString("%1: %2").arg(stat->name()).arg(stat->value());
+    }
+    for (const LatencyStat* stat : m_latencies) {
+        if (stat->count() > 0) lines << stat->summary();
+    }
+    // CPU acumulada junto dos contadores: duas leituras dão o custo do intervalo
+    lines << QString("process.cpu_ms: %1").arg(processCpuMs(), 0, 'f', 1);
+    return lines;
+}
+
+QJsonObject Metrics::toJson() const
+{
+    QMutexLocker locker(&m_mutex);
+    QJsonObject obj;
+    for (const CounterStat* stat : m_counters) {
+        obj[stat->name()] = stat->value();
+    }
+    for (const LatencyStat* stat : m_latencies) {
+        obj[stat->name()] = stat->toJson();
+    }
+    obj["process.cpu_ms"] = processCpuMs();
+    return obj;
+}
+
+void Metrics::dump() const
+{
+    qDebug() << "=== MÉTRICAS ===";
+    for (const QString& line : report()) {
+        qDebug().noquote() << line;
+    }
+    qDebug() << "================";
+}
@@ -0,0 +1,90 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QAtomicInteger>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QJsonObject>
+#include <QVector>
+
+// Estatística de latência/valor com histograma log2 (sem locks no caminho quente)
+class LatencyStat
+{
+public:
+    static constexpr int BUCKETS = 48;
+
+    explicit LatencyStat(const QString& name);
+
+    // Registra uma amostra (unidade definida pelo nome, ex: "_us", "_ns")
+    void record(qint64 value);
+    void reset();
+
+    const QString& name() const { return m_name; }
+    qint64 count() const { return m_count.loadRelaxed(); }
+    qint64 sum() const { return m_sum.loadRelaxed(); }
+    qint64 max() const { return m_max.loadRelaxed(); }
+    qint64 min() const;
+    double mean() const;
+
+    // Percentil aproximado pelo histograma (limite superior do bucket)
+    qint64 percentile(double p) const;
+
+    QString summary() const;
+    QJsonObject toJson() const;
+
+private:
+    QString m_name;
+    QAtomicInteger<qint64> m_count;
+    QAtomicInteger<qint64> m_sum;
+    QAtomicInteger<qint64> m_min;
+    QAtomicInteger<qint64> m_max;
+    QAtomicInteger<qint64> m_buckets[BUCKETS];
+};
+
+// Contador monotônico simples
+class CounterStat
+{
+public:
+    explicit CounterStat(const QString& name) : m_name(name), m_value(0) {}
+
+    void add(qint64 delta = 1) { m_value.fetchAndAddRelaxed(delta); }
+    void set(qint64 value) { m_value.storeRelaxed(value); }
+    qint64 value() const { return m_value.loadRelaxed(); }
+    const QString& name() const { return m_name; }
+
+private:
+    QString m_name;
+    QAtomicInteger<qint64> m_value;
+};
+
+// Registro global de métricas. Os ponteiros retornados são estáveis durante
+// toda a execução, então o uso típico é guardar em uma variável estática:
+//   static LatencyStat* s = Metrics::instance().latency("dsu.encode_ns");
+class Metrics
+{
+public:
+    static Metrics& instance();
+
+    LatencyStat* latency(const QString& name);
+    CounterStat* counter(const QString& name);
+
+    // Linhas legíveis para log/status e exportação em JSON
+    QStringList report() const;
+    QJsonObject toJson() const;
+    void dump() const;
+
+    // Tempo de CPU do processo (todas as threads), em ms
+    static double processCpuMs();
+
+private:
+    Metrics() = default;
+    ~Metrics();
+    Q_DISABLE_COPY(Metrics)
+
+    mutable QMutex m_mutex;
+    QVector<LatencyStat*> m_latencies;
+    QVector<CounterStat*> m_counters;
+};
+
+#endif // METRICS_H
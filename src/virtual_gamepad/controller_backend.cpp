@@ -0,0 +1,39 @@
+﻿#include "controller_backend.h"
+#include "null_backend.h"
+#include "recording_backend.h"
+#ifdef Q_OS_WIN
+#include "vigem_backend.h"
+#endif
+#ifdef Q_OS_LINUX
+#include "uinput_backend.h"
+#endif
+
+ControllerBackend* ControllerBackend::create(const QString& name, QObject* parent)
+{
+    const QString key = name.trimmed().toLower();
+
+    if (key == "null") return new NullBackend(parent);
+    if (key == "recording") return new RecordingBackend(parent);
+#ifdef Q_OS_WIN
+    if (key.isEmpty() || key == "auto" || key == "vigem") return new VigemBackend(parent);
+#endif
+#ifdef Q_OS_LINUX
+    if (key.isEmpty() || key == "auto" || key == "uinput") return new UinputBackend(parent);
+#endif
+    // Plataforma sem driver de controle virtual
+    if (key.isEmpty() || key == "auto") return new NullBackend(parent);
+    return nullptr;
+}
+
+QStringList ControllerBackend::availableBackends()
+{
+    QStringList names;
+#ifdef Q_OS_WIN
+    names << "vigem";
+#endif
+#ifdef Q_OS_LINUX
+    names << "uinput";
+#endif
+    names << "null" << "recording";
+    return names;
+}
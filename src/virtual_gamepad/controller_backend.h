@@ -0,0 +1,48 @@
+#ifndef CONTROLLER_BACKEND_H
+#define CONTROLLER_BACKEND_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include "../controller_types.h"
+#include "../protocol/gamepad_packet.h"
+
+// Driver de controles virtuais (ViGEm no Windows, uinput no Linux, simulado
+// nos testes). O GamepadManager só fala com esta interface: a conversão do
+// estado para o report nativo de cada driver fica no backend.
+// Plugar um controle pode levar centenas de ms (enumeração PnP), então o
+// plug é assíncrono: beginPlug() retorna na hora um id e plugFinished() chega
+// depois, sempre na thread principal. Os ids nunca são reaproveitados.
+class ControllerBackend : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ControllerBackend(QObject* parent = nullptr) : QObject(parent) {}
+
+    // "vigem", "uinput", "null" ou "recording"; vazio/"auto" = padrão da plataforma.
+    // nullptr se o nome não existir ou o backend não estiver disponível aqui
+    static ControllerBackend* create(const QString& name, QObject* parent = nullptr);
+    static QStringList availableBackends();
+
+    virtual const char* name() const = 0;
+
+    virtual bool initialize() = 0;
+    virtual void shutdown() = 0;
+
+    // Começa a plugar um controle do tipo pedido; 0 se nem foi possível começar
+    virtual quint32 beginPlug(ControllerType type) = 0;
+    // Remove o controle (também serve para cancelar um plug em andamento;
+    // depois disso o id não recebe mais plugFinished)
+    virtual void unplug(quint32 padId) = 0;
+
+    // Envia o estado do jogador (já com turbo/macros) para um controle plugado
+    virtual void submit(quint32 padId, const GamepadPacket& packet) = 0;
+
+signals:
+    void plugFinished(quint32 padId, bool ok);
+    // Pode ser emitido de outra thread (callback do driver)
+    void vibrationRequested(quint32 padId, quint8 largeMotor, quint8 smallMotor);
+};
+
+#endif // CONTROLLER_BACKEND_H
@@ -0,0 +1,316 @@
+﻿#include "controller_pool.h"
+#include "null_backend.h"
+#include "../utils/metrics.h"
+#include <QCoreApplication>
+#include <QDebug>
+
+ControllerPool::ControllerPool(ControllerBackend* backend, QObject* parent)
+    : QObject(parent), m_backend(backend)
+{
+    for (int i = 0; i < MAX_PLAYERS; ++i) {
+        m_wants[i] = false;
+        m_wantedType[i] = ControllerType::DualShock4;
+        m_requestedMs[i] = 0;
+    }
+    m_clock.start();
+    connect(m_backend, &ControllerBackend::plugFinished, this, &ControllerPool::onPlugFinished);
+}
+
+ControllerPool::~ControllerPool()
+{
+    clear();
+}
+
+void ControllerPool::setWarmSpares(ControllerType type, int count)
+{
+    m_warmSpares[typeSlot(type)] = qBound(0, count, MAX_PLAYERS);
+}
+
+void ControllerPool::prewarm()
+{
+    const ControllerType types[] = { ControllerType::DualShock4, ControllerType::Xbox360 };
+    for (ControllerType type : types) {
+        int spares = 0;
+        for (const Pad& pad : std::as_const(m_pads)) {
+            if (pad.player < 0 && pad.type == type) spares++;
+        }
+        for (int i = spares; i < m_warmSpares[typeSlot(type)]; ++i) {
+            beginPlug(type, -1);
+        }
+    }
+}
+
+void ControllerPool::acquire(int playerIndex, ControllerType type)
+{
+    static CounterStat* warmHitsCounter = Metrics::instance().counter("pool.warm_hits");
+    static CounterStat* coldPlugsCounter = Metrics::instance().counter("pool.cold_plugs");
+    if (playerIndex < 0 || playerIndex >= MAX_PLAYERS) return;
+
+    m_wants[playerIndex] = true;
+    m_wantedType[playerIndex] = type;
+    m_requestedMs[playerIndex] = m_clock.elapsed();
+
+    // Plugs em andamento para outro tipo viram reservas; um do tipo certo basta esperar
+    bool pluggingSameType = false;
+    for (Pad& pad : m_pads) {
+        if (pad.player != playerIndex) continue;
+        if (pad.ready && pad.type == type) return;
+        if (!pad.ready) {
+            if (pad.type == type) pluggingSameType = true;
+            else pad.player = -1;
+        }
+    }
+    if (pluggingSameType) return;
+
+    const int readySpare = findSpare(type, true);
+    if (readySpare != -1) {
+        warmHitsCounter->add();
+        assign(readySpare, playerIndex);
+        prewarm();
+        return;
+    }
+
+    // Reserva ainda plugando: fica para este jogador
+    const int pendingSpare = findSpare(type, false);
+    if (pendingSpare != -1) {
+        m_pads[pendingSpare].player = playerIndex;
+        prewarm();
+        return;
+    }
+
+    coldPlugsCounter->add();
+    beginPlug(type, playerIndex);
+}
+
+void ControllerPool::release(int playerIndex)
+{
+    if (playerIndex < 0 || playerIndex >= MAX_PLAYERS) return;
+
+    m_wants[playerIndex] = false;
+    for (int i = m_pads.size() - 1; i >= 0; --i) {
+        Pad& pad = m_pads[i];
+        if (pad.player != playerIndex) continue;
+        // Plug em andamento segue como reserva (o excesso é removido quando terminar)
+        if (!pad.ready) pad.player = -1;
+        else dropPad(i);
+    }
+    prewarm();
+}
+
+void ControllerPool::clear()
+{
+    for (const Pad& pad : std::as_const(m_pads)) {
+        m_backend->unplug(pad.id);
+    }
+    m_pads.clear();
+    for (int i = 0; i < MAX_PLAYERS; ++i) {
+        m_wants[i] = false;
+    }
+}
+
+quint32 ControllerPool::padFor(int playerIndex) const
+{
+    if (playerIndex < 0) return 0;
+    for (const Pad& pad : m_pads) {
+        if (pad.player == playerIndex && pad.ready) return pad.id;
+    }
+    return 0;
+}
+
+int ControllerPool::playerForPad(quint32 padId) const
+{
+    const int pos = findPad(padId);
+    return (pos != -1 && m_pads[pos].ready) ? m_pads[pos].player : -1;
+}
+
+ControllerType ControllerPool::padType(quint32 padId) const
+{
+    const int pos = findPad(padId);
+    return pos != -1 ? m_pads[pos].type : ControllerType::DualShock4;
+}
+
+bool ControllerPool::hasReadyPad(int playerIndex, ControllerType type) const
+{
+    for (const Pad& pad : m_pads) {
+        if (pad.player == playerIndex && pad.ready && pad.type == type) return true;
+    }
+    return false;
+}
+
+int ControllerPool::readySpares(ControllerType type) const
+{
+    int count = 0;
+    for (const Pad& pad : m_pads) {
+        if (pad.player < 0 && pad.ready && pad.type == type) count++;
+    }
+    return count;
+}
+
+void ControllerPool::onPlugFinished(quint32 padId, bool ok)
+{
+    static LatencyStat* plugStat = Metrics::instance().latency("pool.plug_ms");
+    static CounterStat* failuresCounter = Metrics::instance().counter("pool.plug_failures");
+
+    const int pos = findPad(padId);
+    if (pos == -1) {
+        // Pool já limpo: o controle não tem mais dono
+        if (ok) m_backend->unplug(padId);
+        return;
+    }
+
+    Pad& pad = m_pads[pos];
+    plugStat->record(m_clock.elapsed() - pad.startedMs);
+
+    if (!ok) {
+        failuresCounter->add();
+        const int playerIndex = pad.player;
+        const ControllerType type = pad.type;
+        m_pads.remove(pos);
+        if (playerIndex >= 0) {
+            qWarning() << "Falha ao plugar controle virtual para jogador" << (playerIndex + 1);
+            emit controllerFailed(playerIndex, type);
+        }
+        return;
+    }
+
+    pad.ready = true;
+    if (pad.player >= 0 && !(m_wants[pad.player] && m_wantedType[pad.player] == pad.type)) {
+        pad.player = -1;
+    }
+
+    // Reserva pronta: atende primeiro quem está esperando por este tipo
+    if (pad.player < 0) {
+        for (int i = 0; i < MAX_PLAYERS; ++i) {
+            if (m_wants[i] && m_wantedType[i] == pad.type && !hasReadyPad(i, pad.type)) {
+                for (Pad& other : m_pads) {
+                    if (other.player == i && !other.ready) other.player = -1;
+                }
+                pad.player = i;
+                break;
+            }
+        }
+    }
+
+    if (pad.player >= 0) {
+        assign(pos, pad.player);
+        return;
+    }
+
+    // Reserva que sobrou (o jogador desistiu ou trocou de tipo de novo)
+    int spares = 0;
+    for (const Pad& other : std::as_const(m_pads)) {
+        if (other.player < 0 && other.type == pad.type) spares++;
+    }
+    if (spares > m_warmSpares[typeSlot(pad.type)]) dropPad(pos);
+}
+
+int ControllerPool::findPad(quint32 padId) const
+{
+    for (int i = 0; i < m_pads.size(); ++i) {
+        if (m_pads[i].id == padId) return i;
+    }
+    return -1;
+}
+
+int ControllerPool::findSpare(ControllerType type, bool ready) const
+{
+    for (int i = 0; i < m_pads.size(); ++i) {
+        const Pad& pad = m_pads[i];
+        if (pad.player < 0 && pad.type == type && pad.ready == ready) return i;
+    }
+    return -1;
+}
+
+void ControllerPool::beginPlug(ControllerType type, int playerIndex)
+{
+    static CounterStat* failuresCounter = Metrics::instance().counter("pool.plug_failures");
+
+    Pad pad;
+    pad.id = m_backend->beginPlug(type);
+    pad.type = type;
+    pad.player = playerIndex;
+    pad.startedMs = m_clock.elapsed();
+    if (pad.id == 0) {
+        failuresCounter->add();
+        if (playerIndex >= 0) emit controllerFailed(playerIndex, type);
+        return;
+    }
+    m_pads.append(pad);
+}
+
+// Entrega o controle pronto ao jogador; o controle anterior dele é removido
+void ControllerPool::assign(int padPos, int playerIndex)
+{
+    static LatencyStat* waitStat = Metrics::instance().latency("pool.acquire_wait_ms");
+
+    const quint32 padId = m_pads[padPos].id;
+    const ControllerType type = m_pads[padPos].type;
+    m_pads[padPos].player = playerIndex;
+
+    for (int i = m_pads.size() - 1; i >= 0; --i) {
+        if (m_pads[i].player == playerIndex && m_pads[i].ready && m_pads[i].id != padId) dropPad(i);
+    }
+
+    waitStat->record(m_clock.elapsed() - m_requestedMs[playerIndex]);
+    emit controllerReady(playerIndex, type);
+}
+
+void ControllerPool::dropPad(int padPos)
+{
+    m_backend->unplug(m_pads[padPos].id);
+    m_pads.remove(padPos);
+}
+
+// --- BENCHMARK ---
+
+QStringList ControllerPool::runWarmBenchmark(int plugDelayMs)
+{
+    const int rounds = 20;
+    plugDelayMs = qMax(0, plugDelayMs);
+
+    QStringList lines;
+    lines << QString("Pool de controles: plug simulado de %1 ms (NullBackend), %2 conexões por modo")
+        .arg(plugDelayMs).arg(rounds);
+
+    for (int spares = 0; spares <= 1; ++spares) {
+        NullBackend backend;
+        backend.setPlugDelay(plugDelayMs);
+        ControllerPool pool(&backend);
+        pool.setWarmSpares(ControllerType::DualShock4, spares);
+        pool.prewarm();
+
+        qint64 totalUs = 0;
+        qint64 worstUs = 0;
+        int idlePads = 0;
+        for (int r = 0; r < rounds; ++r) {
+            // Jogador que chega depois da reposição: a reserva (se houver) já está pronta
+            QElapsedTimer refill;
+            refill.start();
+            while (pool.readySpares(ControllerType::DualShock4) < spares && refill.elapsed() < plugDelayMs + 1000) {
+                QCoreApplication::processEvents(QEventLoop::AllEvents, 1);
+            }
+            idlePads = backend.pluggedCount();
+
+            QElapsedTimer timer;
+            timer.start();
+            pool.acquire(0, ControllerType::DualShock4);
+            while (pool.padFor(0) == 0 && timer.elapsed() < plugDelayMs + 1000) {
+                QCoreApplication::processEvents(QEventLoop::AllEvents, 1);
+            }
+            if (pool.padFor(0) == 0) return lines << QString("  reservas %1: o controle não ficou pronto").arg(spares);
+
+            const qint64 waitUs = timer.nsecsElapsed() / 1000;
+            totalUs += waitUs;
+            worstUs = qMax(worstUs, waitUs);
+            pool.release(0);
+        }
+        pool.clear();
+
+        lines << QString("  reservas %1: espera média %2 ms, pior %3 ms, %4 controle(s) parado(s) no sistema sem jogador")
+            .arg(spares)
+            .arg(totalUs / 1000.0 / rounds, 0, 'f', 2)
+            .arg(worstUs / 1000.0, 0, 'f', 2)
+            .arg(idlePads);
+    }
+    return lines;
+}
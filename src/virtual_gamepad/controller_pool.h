@@ -0,0 +1,91 @@
+#ifndef CONTROLLER_POOL_H
+#define CONTROLLER_POOL_H
+
+#include <QObject>
+#include <QVector>
+#include <QStringList>
+#include <QElapsedTimer>
+#include "controller_backend.h"
+
+// Pool de controles virtuais sobre um ControllerBackend.
+// - Nada bloqueia: os plugs são assíncronos e o jogador recebe o controle
+//   quando controllerReady() chega.
+// - Opcionalmente (--warm-spares) mantém reservas "quentes" já plugadas de cada
+//   tipo; um jogador que conecta (ou troca de tipo) pega uma reserva na hora, e a
+//   reposição acontece em segundo plano. As reservas aparecem no sistema como
+//   controles parados (e a de Xbox 360 pode ocupar o slot 0 do XInput), por isso
+//   o padrão é plugar sob demanda.
+// - Na troca de tipo o controle antigo continua recebendo a entrada até o
+//   novo estar pronto, então não há intervalo sem controle.
+class ControllerPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ControllerPool(ControllerBackend* backend, QObject* parent = nullptr);
+    ~ControllerPool();
+
+    ControllerBackend* backend() const { return m_backend; }
+
+    // Reservas mantidas por tipo (padrão 0 = plug sob demanda)
+    void setWarmSpares(ControllerType type, int count);
+    int warmSpares(ControllerType type) const { return m_warmSpares[typeSlot(type)]; }
+
+    // Completa as reservas (chamar depois de inicializar o backend)
+    void prewarm();
+
+    // Pede um controle do tipo para o jogador (também usado para trocar o tipo)
+    void acquire(int playerIndex, ControllerType type);
+    // Devolve o controle do jogador (é removido; as reservas são repostas)
+    void release(int playerIndex);
+    // Remove tudo, inclusive as reservas
+    void clear();
+
+    // Controle pronto do jogador (0 se nenhum)
+    quint32 padFor(int playerIndex) const;
+    int playerForPad(quint32 padId) const;
+    // Na troca de tipo o controle atual ainda é do tipo antigo até o novo ficar pronto
+    ControllerType padType(quint32 padId) const;
+
+    int readySpares(ControllerType type) const;
+
+    // --bench-pool: espera do jogador até o controle ficar pronto, sem reserva e
+    // com uma, sobre o NullBackend com o atraso de plug dado. Exige uma
+    // QCoreApplication (o plug termina no event loop)
+    static QStringList runWarmBenchmark(int plugDelayMs);
+
+signals:
+    void controllerReady(int playerIndex, ControllerType type);
+    void controllerFailed(int playerIndex, ControllerType type);
+
+private slots:
+    void onPlugFinished(quint32 padId, bool ok);
+
+private:
+    struct Pad {
+        quint32 id = 0;
+        ControllerType type = ControllerType::DualShock4;
+        int player = -1;       // Dono (ou destino do plug em andamento); -1 = reserva
+        bool ready = false;
+        qint64 startedMs = 0;
+    };
+
+    static int typeSlot(ControllerType type) { return type == ControllerType::Xbox360 ? 1 : 0; }
+
+    int findPad(quint32 padId) const;
+    int findSpare(ControllerType type, bool ready) const;
+    bool hasReadyPad(int playerIndex, ControllerType type) const;
+    void beginPlug(ControllerType type, int playerIndex);
+    void assign(int padPos, int playerIndex);
+    void dropPad(int padPos);
+
+    ControllerBackend* m_backend;
+    QVector<Pad> m_pads;
+    bool m_wants[MAX_PLAYERS];
+    ControllerType m_wantedType[MAX_PLAYERS];
+    qint64 m_requestedMs[MAX_PLAYERS];
+    int m_warmSpares[2] = { 0, 0 };
+    QElapsedTimer m_clock;
+};
+
+#endif // CONTROLLER_POOL_H
@@ -6,83 +6,97 @@
 #include <QObject>
 #include <QTimer>
 #include <QAtomicInt>
-#include <QUdpSocket>
-#include <QHostAddress>
 #include <QElapsedTimer>
+#include <QJsonObject>
 #include "../protocol/gamepad_packet.h"
 #include "../controller_types.h"
+#include "macro_engine.h"
+#include "motion_timeline.h"
 
-// CORREO: Use includes padro do Windows
-#include <Windows.h>
-#include <ViGEm/Client.h>
-
-// CORREO: Use os tipos ViGEm diretamente
-using VigemClient = PVIGEM_CLIENT;
-using VigemTarget = PVIGEM_TARGET;
+class DsuServer;
+class ControllerBackend;
+class ControllerPool;
 
 class GamepadManager : public QObject
 {
     Q_OBJECT
 
 public:
+    // Quando o estado recebido vai para o controle virtual
+    enum class TickMode {
+        Fixed,      // No tick do timer (padro, 8 ms): junta rajadas de pacotes
+        Immediate   // Assim que o pacote chega: menor latncia, mais reports
+    };
+
     explicit GamepadManager(QObject* parent = nullptr);
+    // Usa o backend dado (null, recording, uinput...) em vez do padro da plataforma
+    explicit GamepadManager(ControllerBackend* backend, QObject* parent = nullptr);
     ~GamepadManager();
 
     bool initialize();
     void shutdown();
     void printServerStatus();
 
+    void setTickMode(TickMode mode, int intervalMs = DEFAULT_TICK_INTERVAL_MS);
+    TickMode tickMode() const { return m_tickMode; }
+
+    // Reservas j plugadas por tipo (0 = plug sob demanda). Chamar antes de initialize()
+    void setWarmSpares(int count);
+    ControllerPool* controllerPool() const { return m_pool; }
+
+    static const int DEFAULT_TICK_INTERVAL_MS = 8;
+
+    // ltimo estado enviado ao controle virtual do jogador (j com turbo/macros),
+    // para a interface ler no prprio ritmo em vez de reagir a cada pacote.
+    // 'sequence' muda a cada envio (0 = nada enviado ainda). S na thread principal.
+    GamepadPacket stateSnapshot(int playerIndex, quint32* sequence = nullptr) const;
+
 public slots:
     void onPacketReceived(int playerIndex, const GamepadPacket& packet);
+    void onMotionSample(int playerIndex, const MotionSample& sample);
     void playerConnected(int playerIndex, const QString& type);
     void playerDisconnected(int playerIndex);
     void testVibration(int playerIndex);
     void onControllerTypeChanged(int playerIndex, int typeIndex);
+    void setMacroProfile(int playerIndex, const QJsonObject& profile);
 
 private slots:
     void processLatestPackets();
-    void readPendingCemuhookDatagrams();
+    void submitPlayerState(int playerIndex);
+    void onControllerReady(int playerIndex, ControllerType type);
+    void onControllerFailed(int playerIndex, ControllerType type);
+    void onBackendVibration(quint32 padId, quint8 largeMotor, quint8 smallMotor);
 
 signals:
+    // A cada envio (at 125 Hz por jogador); a interface usa stateSnapshot()
     void gamepadStateUpdated(int playerIndex, const GamepadPacket& packet);
     void playerConnectedSignal(int playerIndex, const QString& type);
     void playerDisconnectedSignal(int playerIndex);
     void vibrationCommandReady(int playerIndex, const QByteArray& command);
-    void dsuClientConnected(const QString& address, quint16 port);
-    void dsuClientDisconnected();
+    void dsuClientConnected(const QString& address, quint16 port, int totalClients);
+    void dsuClientDisconnected(const QString& address, quint16 port, int totalClients);
 
 private:
-    void createGamepad(int playerIndex);
-    void cleanupGamepad(int playerIndex);
-    void handleX360Vibration(int playerIndex, UCHAR largeMotor, UCHAR smallMotor);
-    void handleDS4Vibration(int playerIndex, UCHAR largeMotor, UCHAR smallMotor);
-
-    // CORREO: Use tipos ViGEm corretos
-    VigemClient m_client;
-    VigemTarget m_targets[MAX_PLAYERS];
-    bool m_connected[MAX_PLAYERS];
+    void handleX360Vibration(int playerIndex, quint8 largeMotor, quint8 smallMotor);
+    void handleDS4Vibration(int playerIndex, quint8 largeMotor, quint8 smallMotor);
+
+    // Controles virtuais (plug assncrono, com reservas)
+    ControllerBackend* m_backend;
+    ControllerPool* m_pool;
+    bool m_connected[MAX_PLAYERS];   // Jogador conectado (o controle pode ainda estar plugando)
     QTimer* m_processingTimer;
+    TickMode m_tickMode = TickMode::Fixed;
     GamepadPacket m_latestPackets[MAX_PLAYERS];
     QAtomicInt m_dirtyFlags[MAX_PLAYERS];
     ControllerType m_controllerTypes[MAX_PLAYERS];
-
-    QUdpSocket* m_cemuhookSocket;
-    quint16 m_cemuhookPort;
-    QHostAddress m_cemuhookClientAddress;
-    quint16 m_cemuhookClientPort;
-    bool m_cemuhookClientSubscribed;
-    QElapsedTimer m_cemuhookClientTimer;
-    quint32 m_dsuPacketCounter[MAX_PLAYERS];
-    uint m_dsuLastKeepAlive[MAX_PLAYERS];
-
-    // CORREO: Callbacks com tipos corretos
-    static void CALLBACK x360NotificationCallback(
-        PVIGEM_CLIENT Client, PVIGEM_TARGET Target, UCHAR LargeMotor,
-        UCHAR SmallMotor, UCHAR LedNumber, PVOID UserData);
-
-    static void CALLBACK ds4NotificationCallback(
-        PVIGEM_CLIENT Client, PVIGEM_TARGET Target, UCHAR LargeMotor,
-        UCHAR SmallMotor, DS4_LIGHTBAR_COLOR LightbarColor, PVOID UserData);
+    MacroEngine* m_macroEngine;
+    GamepadPacket m_submittedStates[MAX_PLAYERS] = {};
+    quint32 m_stateSequence[MAX_PLAYERS] = {};
+
+    DsuServer* m_dsuServer;
+    MotionTimeline m_motionTimelines[MAX_PLAYERS];
+    QElapsedTimer m_motionClock;
+    qint64 m_lastMotionReportUs;
 };
 
 #endif
\ No newline at end of file
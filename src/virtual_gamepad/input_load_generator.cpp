@@ -0,0 +1,101 @@
+﻿#include "input_load_generator.h"
+#include <QDebug>
+#include <QtMath>
+
+InputLoadGenerator::InputLoadGenerator(QObject* parent)
+    : QObject(parent)
+{
+    m_timer = new QTimer(this);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    m_timer->setInterval(1);
+    connect(m_timer, &QTimer::timeout, this, &InputLoadGenerator::onTick);
+}
+
+InputLoadGenerator::~InputLoadGenerator()
+{
+    stop();
+}
+
+void InputLoadGenerator::start(quint32 playerMask, int rateHz, bool motionSamples)
+{
+    stop();
+
+    m_playerMask = playerMask & ((1u << MAX_PLAYERS) - 1);
+    m_rateHz = qBound(1, rateHz, 2000);
+    m_motionSamples = motionSamples;
+    m_sequence = 0;
+    m_generated = 0;
+
+    for (int i = 0; i < MAX_PLAYERS; ++i) {
+        if (m_playerMask & (1u << i)) emit playerConnected(i, "Simulado");
+    }
+
+    qDebug() << "Gerador de carga iniciado: jogadores" << QString::number(m_playerMask, 2)
+        << "a" << m_rateHz << "Hz" << (m_motionSamples ? "(com amostras de movimento)" : "");
+
+    m_clock.start();
+    m_timer->start();
+}
+
+void InputLoadGenerator::stop()
+{
+    if (!m_timer->isActive()) return;
+    m_timer->stop();
+
+    for (int i = 0; i < MAX_PLAYERS; ++i) {
+        if (m_playerMask & (1u << i)) emit playerDisconnected(i);
+    }
+    qDebug() << "Gerador de carga parado após" << m_generated << "pacotes";
+}
+
+void InputLoadGenerator::onTick()
+{
+    const qint64 due = m_clock.nsecsElapsed() * m_rateHz / 1000000000LL;
+
+    for (; m_sequence < due; ++m_sequence) {
+        const quint32 sensorUs = static_cast<quint32>(m_sequence * 1000000LL / m_rateHz);
+
+        for (int i = 0; i < MAX_PLAYERS; ++i) {
+            if (!(m_playerMask & (1u << i))) continue;
+
+            const GamepadPacket packet = makePacket(i, m_sequence, m_rateHz);
+            emit packetReceived(i, packet);
+
+            if (m_motionSamples) {
+                MotionSample sample;
+                sample.sensorTimestampUs = sensorUs;
+                sample.gyroX = packet.gyroX;
+                sample.gyroY = packet.gyroY;
+                sample.gyroZ = packet.gyroZ;
+                sample.accelX = packet.accelX;
+                sample.accelY = packet.accelY;
+                sample.accelZ = packet.accelZ;
+                emit motionSampleReceived(i, sample);
+            }
+            m_generated++;
+        }
+    }
+}
+
+// Analógicos em círculo, botões em sequência e giroscópio senoidal (valores em centésimos de grau/s)
+GamepadPacket InputLoadGenerator::makePacket(int playerIndex, qint64 sequence, int rateHz)
+{
+    const double t = static_cast<double>(sequence) / rateHz;
+    const double phase = 2.0 * M_PI * 0.5 * t + playerIndex;
+
+    GamepadPacket packet = {};
+    packet.buttons = static_cast<uint16_t>(1u << ((sequence / qMax(1, rateHz / 4)) % 16));
+    packet.leftStickX = static_cast<int8_t>(qCos(phase) * 127);
+    packet.leftStickY = static_cast<int8_t>(qSin(phase) * 127);
+    packet.rightStickX = static_cast<int8_t>(qSin(phase) * 127);
+    packet.rightStickY = static_cast<int8_t>(qCos(phase) * 127);
+    packet.leftTrigger = static_cast<uint8_t>((sequence * 3) & 0xFF);
+    packet.rightTrigger = static_cast<uint8_t>(255 - ((sequence * 3) & 0xFF));
+    packet.gyroX = static_cast<int16_t>(qSin(phase) * 9000);
+    packet.gyroY = static_cast<int16_t>(qCos(phase * 1.7) * 4500);
+    packet.gyroZ = static_cast<int16_t>(qSin(phase * 0.3) * 1500);
+    packet.accelX = 0;
+    packet.accelY = 0;
+    packet.accelZ = 4096;  // 1 g (escala do app)
+    return packet;
+}
@@ -0,0 +1,52 @@
+#ifndef INPUT_LOAD_GENERATOR_H
+#define INPUT_LOAD_GENERATOR_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QString>
+#include "../controller_types.h"
+#include "../protocol/gamepad_packet.h"
+
+// Gerador de entrada sintética para diagnóstico e benchmark.
+// Emite os mesmos sinais de um transporte real (conexão, pacotes e amostras
+// de movimento), então pode ser ligado direto nos slots do GamepadManager.
+// A taxa é mantida pela média: a cada tick do timer são emitidos todos os
+// pacotes vencidos desde o início, cada um com seu timestamp de sensor ideal.
+class InputLoadGenerator : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit InputLoadGenerator(QObject* parent = nullptr);
+    ~InputLoadGenerator();
+
+    // 'playerMask': bit i = jogador i. 'motionSamples': também emite amostras com relógio do sensor.
+    void start(quint32 playerMask, int rateHz, bool motionSamples);
+    void stop();
+
+    bool isRunning() const { return m_timer->isActive(); }
+    qint64 packetsGenerated() const { return m_generated; }
+
+signals:
+    void playerConnected(int playerIndex, const QString& type);
+    void playerDisconnected(int playerIndex);
+    void packetReceived(int playerIndex, const GamepadPacket& packet);
+    void motionSampleReceived(int playerIndex, const MotionSample& sample);
+
+private slots:
+    void onTick();
+
+private:
+    static GamepadPacket makePacket(int playerIndex, qint64 sequence, int rateHz);
+
+    QTimer* m_timer;
+    QElapsedTimer m_clock;
+    quint32 m_playerMask = 0;
+    int m_rateHz = 0;
+    bool m_motionSamples = false;
+    qint64 m_sequence = 0;
+    qint64 m_generated = 0;
+};
+
+#endif // INPUT_LOAD_GENERATOR_H
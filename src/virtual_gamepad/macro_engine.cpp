@@ -0,0 +1,283 @@
+﻿#include "macro_engine.h"
+#include "../utils/metrics.h"
+#include <QDebug>
+#include <QJsonArray>
+#include <algorithm>
+
+// Limites de sanidade para perfis enviados pela rede
+static constexpr int MAX_TURBO_BINDINGS = 16;
+static constexpr int MAX_MACROS = 16;
+static constexpr int MAX_MACRO_STEPS = 256;
+
+// Converte "buttons"/"trigger" (lista de nomes ou máscara numérica) em máscara
+static quint16 parseButtonMask(const QJsonValue& value)
+{
+    if (value.isDouble()) {
+        return static_cast<quint16>(value.toInt());
+    }
+
+    static const struct { const char* name; quint16 mask; } names[] = {
+        { "DPAD_UP", DPAD_UP }, { "DPAD_DOWN", DPAD_DOWN },
+        { "DPAD_LEFT", DPAD_LEFT }, { "DPAD_RIGHT", DPAD_RIGHT },
+        { "START", START }, { "SELECT", SELECT },
+        { "L3", L3 }, { "R3", R3 }, { "L1", L1 }, { "R1", R1 },
+        { "A", A }, { "B", B }, { "X", X }, { "Y", Y },
+    };
+
+    quint16 mask = 0;
+    const QJsonArray list = value.toArray();
+    for (const QJsonValue& item : list) {
+        const QString name = item.toString().toUpper();
+        for (const auto& entry : names) {
+            if (name == QLatin1String(entry.name)) {
+                mask |= entry.mask;
+                break;
+            }
+        }
+    }
+    return mask;
+}
+
+MacroProfile MacroProfile::fromJson(const QJsonObject& json)
+{
+    MacroProfile profile;
+
+    const QJsonArray turboList = json["turbo"].toArray();
+    for (const QJsonValue& item : turboList) {
+        if (profile.turbo.size() >= MAX_TURBO_BINDINGS) break;
+        const QJsonObject obj = item.toObject();
+
+        TurboBinding binding;
+        binding.buttonMask = parseButtonMask(obj["buttons"]);
+        const double hz = obj["hz"].toDouble(10.0);
+        binding.halfPeriodMs = std::clamp(static_cast<int>(500.0 / qMax(hz, 0.1)), 1, 5000);
+        if (binding.buttonMask != 0) profile.turbo.append(binding);
+    }
+
+    const QJsonArray macroList = json["macros"].toArray();
+    for (const QJsonValue& item : macroList) {
+        if (profile.macros.size() >= MAX_MACROS) break;
+        const QJsonObject obj = item.toObject();
+
+        MacroDefinition macro;
+        macro.triggerMask = parseButtonMask(obj["trigger"]);
+        const QJsonArray steps = obj["steps"].toArray();
+        for (const QJsonValue& stepValue : steps) {
+            if (macro.steps.size() >= MAX_MACRO_STEPS) break;
+            const QJsonObject stepObj = stepValue.toObject();
+            MacroStep step;
+            step.buttons = parseButtonMask(stepObj["buttons"]);
+            step.durationMs = std::clamp(stepObj["ms"].toInt(16), 1, 60000);
+            macro.steps.append(step);
+        }
+        if (macro.triggerMask != 0 && !macro.steps.isEmpty()) profile.macros.append(macro);
+    }
+
+    return profile;
+}
+
+// --- MACROENGINE ---
+
+MacroEngine::MacroEngine(QObject* parent)
+    : QObject(parent), m_wheel(0)
+{
+    m_clock.start();
+
+    // Timer de 1 ms só fica ativo enquanto houver bordas agendadas
+    m_tickTimer = new QTimer(this);
+    m_tickTimer->setTimerType(Qt::PreciseTimer);
+    m_tickTimer->setInterval(1);
+    connect(m_tickTimer, &QTimer::timeout, this, &MacroEngine::onTick);
+}
+
+quint32 MacroEngine::makeCookie(int playerIndex, TimerKind kind, int index)
+{
+    return (static_cast<quint32>(playerIndex) << 24) | (static_cast<quint32>(kind) << 16) | static_cast<quint32>(index & 0xFFFF);
+}
+
+qint64 MacroEngine::nowTick() const
+{
+    return m_clock.elapsed();
+}
+
+void MacroEngine::ensureRunning()
+{
+    if (!m_wheel.isEmpty() && !m_tickTimer->isActive()) {
+        m_tickTimer->start();
+    }
+}
+
+void MacroEngine::schedule(TimerWheel::TimerId& id, qint64 deadline, int playerIndex, TimerKind kind, int index)
+{
+    m_wheel.cancel(id);
+    m_wheel.fastForward(nowTick());
+    id = m_wheel.schedule(deadline, makeCookie(playerIndex, kind, index));
+    ensureRunning();
+}
+
+void MacroEngine::setProfile(int playerIndex, const MacroProfile& profile)
+{
+    if (playerIndex < 0 || playerIndex >= MAX_PLAYERS) return;
+
+    const quint16 held = m_players[playerIndex].physical;
+    clearPlayer(playerIndex);
+
+    PlayerState& st = m_players[playerIndex];
+    st.profile = profile;
+    st.turboTimers.fill(TimerWheel::INVALID_TIMER, profile.turbo.size());
+    st.consumedMask = 0;
+    for (const TurboBinding& binding : profile.turbo) st.consumedMask |= binding.buttonMask;
+    for (const MacroDefinition& macro : profile.macros) st.consumedMask |= macro.triggerMask;
+
+    qDebug() << "Perfil de macros do jogador" << (playerIndex + 1) << ":"
+        << profile.turbo.size() << "turbo," << profile.macros.size() << "macros";
+
+    // Reaplica os botões que já estavam pressionados
+    onInput(playerIndex, held);
+    emit outputChanged(playerIndex);
+}
+
+void MacroEngine::clearPlayer(int playerIndex)
+{
+    if (playerIndex < 0 || playerIndex >= MAX_PLAYERS) return;
+
+    PlayerState& st = m_players[playerIndex];
+    for (TimerWheel::TimerId id : st.turboTimers) m_wheel.cancel(id);
+    m_wheel.cancel(st.macroTimer);
+    st = PlayerState();
+}
+
+bool MacroEngine::hasProfile(int playerIndex) const
+{
+    if (playerIndex < 0 || playerIndex >= MAX_PLAYERS) return false;
+    return !m_players[playerIndex].profile.isEmpty();
+}
+
+void MacroEngine::onInput(int playerIndex, quint16 physicalButtons)
+{
+    if (playerIndex < 0 || playerIndex >= MAX_PLAYERS) return;
+
+    PlayerState& st = m_players[playerIndex];
+    const quint16 previous = st.physical;
+    st.physical = physicalButtons;
+    if (st.profile.isEmpty() || previous == physicalButtons) return;
+
+    const quint16 rising = physicalButtons & ~previous;
+    const qint64 now = nowTick();
+
+    // Turbo: liga na borda de subida e agenda a primeira alternância
+    for (int k = 0; k < st.profile.turbo.size(); ++k) {
+        const TurboBinding& binding = st.profile.turbo[k];
+        const quint16 held = physicalButtons & binding.buttonMask;
+
+        if (held == 0) {
+            m_wheel.cancel(st.turboTimers[k]);
+            st.turboTimers[k] = TimerWheel::INVALID_TIMER;
+            st.turboOutput &= ~binding.buttonMask;
+        }
+        else if (rising & binding.buttonMask) {
+            st.turboOutput |= held;
+            if (st.turboTimers[k] == TimerWheel::INVALID_TIMER) {
+                schedule(st.turboTimers[k], now + binding.halfPeriodMs, playerIndex, TurboToggle, k);
+            }
+        }
+    }
+
+    // Macros: borda de subida do gatilho inicia a sequência (se nenhuma estiver tocando)
+    if (st.activeMacro < 0) {
+        for (int m = 0; m < st.profile.macros.size(); ++m) {
+            if (rising & st.profile.macros[m].triggerMask) {
+                startMacro(playerIndex, m);
+                break;
+            }
+        }
+    }
+}
+
+void MacroEngine::startMacro(int playerIndex, int macroIndex)
+{
+    PlayerState& st = m_players[playerIndex];
+    const MacroDefinition& macro = st.profile.macros[macroIndex];
+
+    st.activeMacro = macroIndex;
+    st.activeStep = 0;
+    st.macroOutput = macro.steps[0].buttons;
+    schedule(st.macroTimer, nowTick() + macro.steps[0].durationMs, playerIndex, MacroStepEnd, macroIndex);
+}
+
+GamepadPacket MacroEngine::apply(int playerIndex, const GamepadPacket& packet) const
+{
+    if (playerIndex < 0 || playerIndex >= MAX_PLAYERS) return packet;
+
+    const PlayerState& st = m_players[playerIndex];
+    if (st.profile.isEmpty()) return packet;
+
+    GamepadPacket result = packet;
+    result.buttons = static_cast<uint16_t>((packet.buttons & ~st.consumedMask) | st.turboOutput | st.macroOutput);
+    return result;
+}
+
+void MacroEngine::onTick()
+{
+    m_wheel.advance(nowTick(), [this](quint32 cookie, qint64 deadline) {
+        onExpired(cookie, deadline);
+        });
+
+    // Reenvia o report de cada jogador cuja saída mudou neste tick
+    const quint32 changed = m_changedMask;
+    m_changedMask = 0;
+    for (int i = 0; i < MAX_PLAYERS; ++i) {
+        if (changed & (1u << i)) emit outputChanged(i);
+    }
+
+    if (m_wheel.isEmpty()) m_tickTimer->stop();
+}
+
+void MacroEngine::onExpired(quint32 cookie, qint64 deadline)
+{
+    // Precisão: atraso entre o instante agendado e o disparo real
+    static LatencyStat* lateness = Metrics::instance().latency("macro.edge_lateness_us");
+    lateness->record(m_clock.nsecsElapsed() / 1000 - deadline * 1000);
+
+    const int playerIndex = static_cast<int>(cookie >> 24);
+    const TimerKind kind = static_cast<TimerKind>((cookie >> 16) & 0xFF);
+    const int index = static_cast<int>(cookie & 0xFFFF);
+    if (playerIndex < 0 || playerIndex >= MAX_PLAYERS) return;
+
+    PlayerState& st = m_players[playerIndex];
+
+    if (kind == TurboToggle) {
+        if (index >= st.profile.turbo.size()) return;
+        st.turboTimers[index] = TimerWheel::INVALID_TIMER;
+
+        const TurboBinding& binding = st.profile.turbo[index];
+        const quint16 held = st.physical & binding.buttonMask;
+        if (held == 0) {
+            st.turboOutput &= ~binding.buttonMask;
+        }
+        else {
+            if (st.turboOutput & binding.buttonMask) st.turboOutput &= ~binding.buttonMask;
+            else st.turboOutput |= held;
+            // Agenda a partir do prazo anterior para não acumular atraso
+            schedule(st.turboTimers[index], deadline + binding.halfPeriodMs, playerIndex, TurboToggle, index);
+        }
+        m_changedMask |= (1u << playerIndex);
+    }
+    else if (kind == MacroStepEnd) {
+        st.macroTimer = TimerWheel::INVALID_TIMER;
+        if (st.activeMacro != index) return;
+
+        const MacroDefinition& macro = st.profile.macros[index];
+        st.activeStep++;
+        if (st.activeStep >= macro.steps.size()) {
+            st.macroOutput = 0;
+            st.activeMacro = -1;
+        }
+        else {
+            const MacroStep& step = macro.steps[st.activeStep];
+            st.macroOutput = step.buttons;
+            schedule(st.macroTimer, deadline + step.durationMs, playerIndex, MacroStepEnd, index);
+        }
+        m_changedMask |= (1u << playerIndex);
+    }
+}
@@ -0,0 +1,107 @@
+#ifndef MACRO_ENGINE_H
+#define MACRO_ENGINE_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QVector>
+#include <QJsonObject>
+#include "timer_wheel.h"
+#include "../controller_types.h"
+#include "../protocol/gamepad_packet.h"
+
+// --- PERFIL DE MACROS/TURBO DE UM JOGADOR ---
+
+// Turbo: enquanto o botão físico está pressionado, a saída alterna em 'hz'
+struct TurboBinding {
+    quint16 buttonMask = 0;
+    int halfPeriodMs = 33;
+};
+
+// Um passo da macro: botões mantidos pressionados por 'durationMs'
+struct MacroStep {
+    quint16 buttons = 0;
+    int durationMs = 0;
+};
+
+// Macro disparada pela borda de subida de 'triggerMask'
+struct MacroDefinition {
+    quint16 triggerMask = 0;
+    QVector<MacroStep> steps;
+};
+
+struct MacroProfile {
+    QVector<TurboBinding> turbo;
+    QVector<MacroDefinition> macros;
+
+    bool isEmpty() const { return turbo.isEmpty() && macros.isEmpty(); }
+
+    // Formato (enviado pelo app como {"type":"macro_profile", ...}):
+    // { "turbo":  [ { "buttons": ["A","R1"], "hz": 15 } ],
+    //   "macros": [ { "trigger": ["R3"], "steps": [ { "buttons": ["A"], "ms": 40 },
+    //                                               { "buttons": [],    "ms": 30 } ] } ] }
+    // "buttons"/"trigger" também aceitam a máscara numérica do GamepadPacket.
+    static MacroProfile fromJson(const QJsonObject& json);
+};
+
+// --- MOTOR DE TURBO/MACROS ---
+// Mantém as bordas agendadas num TimerWheel (1 tick = 1 ms) e gera a máscara de
+// botões sintetizada por jogador, independente da chegada de pacotes.
+// Roda na thread do GamepadManager.
+class MacroEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MacroEngine(QObject* parent = nullptr);
+
+    void setProfile(int playerIndex, const MacroProfile& profile);
+    void clearPlayer(int playerIndex);
+    bool hasProfile(int playerIndex) const;
+
+    // Chamado a cada pacote recebido com os botões físicos (detecta bordas)
+    void onInput(int playerIndex, quint16 physicalButtons);
+
+    // Aplica turbo/macros sobre o estado do jogador antes da conversão do report
+    GamepadPacket apply(int playerIndex, const GamepadPacket& packet) const;
+
+signals:
+    // A saída sintetizada mudou sem pacote novo: o report deve ser reenviado
+    void outputChanged(int playerIndex);
+
+private slots:
+    void onTick();
+
+private:
+    enum TimerKind : quint32 {
+        TurboToggle = 0,
+        MacroStepEnd = 1
+    };
+
+    struct PlayerState {
+        MacroProfile profile;
+        quint16 physical = 0;
+        quint16 consumedMask = 0;      // Botões físicos que não passam direto (turbo + gatilhos)
+        quint16 turboOutput = 0;
+        quint16 macroOutput = 0;
+        QVector<TimerWheel::TimerId> turboTimers;
+        int activeMacro = -1;
+        int activeStep = 0;
+        TimerWheel::TimerId macroTimer = TimerWheel::INVALID_TIMER;
+    };
+
+    static quint32 makeCookie(int playerIndex, TimerKind kind, int index);
+    qint64 nowTick() const;
+    void schedule(TimerWheel::TimerId& id, qint64 deadline, int playerIndex, TimerKind kind, int index);
+    void onExpired(quint32 cookie, qint64 deadline);
+    void startMacro(int playerIndex, int macroIndex);
+    void ensureRunning();
+
+    PlayerState m_players[MAX_PLAYERS];
+    TimerWheel m_wheel;
+    QElapsedTimer m_clock;
+    QTimer* m_tickTimer;
+    quint32 m_changedMask = 0;
+};
+
+#endif // MACRO_ENGINE_H
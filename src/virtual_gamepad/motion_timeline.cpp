@@ -0,0 +1,106 @@
+﻿#include "motion_timeline.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+
+// Giroscópio Z (graus/s) com componentes lenta, média e rápida mais um viés
+double gyroAt(double t)
+{
+    return 15.0 + 60.0 * std::sin(2 * PI * 0.5 * t) + 25.0 * std::sin(2 * PI * 3.1 * t)
+        + 8.0 * std::sin(2 * PI * 11.0 * t);
+}
+
+struct Sample {
+    double trueS;       // Instante real da leitura
+    uint32_t sensorUs;  // Relógio do celular (com deriva e wrap)
+    int64_t arrivalUs;  // Chegada no servidor
+    double gyro;
+};
+
+} // namespace
+
+QStringList MotionTimeline::runReplayBenchmark(int seconds)
+{
+    seconds = std::max(1, seconds);
+
+    const double rateHz = 200.0;
+    const double driftPpm = 50.0;
+    const int64_t tickUs = 8000;                 // Tick antigo do GamepadManager
+    const double burstPeriodS = 1.0;             // Power-save do Wi-Fi: segura tudo
+    const double burstLengthS = 0.030;           // por 30 ms a cada segundo
+    // O relógio do sensor dá a volta 10 s depois do início
+    const uint32_t sensorStart = 0xFFFFFFFFu - 10000000u;
+
+    std::mt19937 rng(20240611);
+    std::exponential_distribution<double> jitterMs(1.0 / 2.0);   // Média de 2 ms
+
+    // Sessão gravada: leitura no instante real, timestamp do celular e chegada FIFO
+    std::vector<Sample> session;
+    const int count = int(seconds * rateHz);
+    session.reserve(count);
+    int64_t lastArrival = 0;
+    double truthDeg = 0.0;
+    for (int i = 0; i < count; ++i) {
+        Sample sample;
+        sample.trueS = i / rateHz;
+        sample.gyro = gyroAt(sample.trueS);
+        sample.sensorUs = sensorStart + uint32_t(int64_t(sample.trueS * (1.0 + driftPpm * 1e-6) * 1e6));
+
+        double arrivalS = sample.trueS + 0.003 + jitterMs(rng) / 1000.0;
+        const double phase = std::fmod(arrivalS, burstPeriodS);
+        if (phase < burstLengthS) arrivalS += burstLengthS - phase;
+        sample.arrivalUs = std::max(lastArrival, int64_t(arrivalS * 1e6) + 1000000);
+        lastArrival = sample.arrivalUs;
+        session.push_back(sample);
+
+        // Verdade: cada leitura vale até a próxima (mesma regra do emulador)
+        truthDeg += sample.gyro / rateHz;
+    }
+
+    // 1. Tick antigo: a cada 8 ms o último estado chegado, com o relógio do servidor
+    double tickDeg = 0.0;
+    {
+        size_t next = 0;
+        double latest = 0.0;
+        bool have = false;
+        for (int64_t now = session.front().arrivalUs; now <= session.back().arrivalUs; now += tickUs) {
+            while (next < session.size() && session[next].arrivalUs <= now) latest = session[next++].gyro, have = true;
+            if (have) tickDeg += latest * tickUs * 1e-6;
+        }
+    }
+
+    // 2. Uma amostra por pacote, com o instante de chegada
+    double arrivalDeg = 0.0;
+    for (size_t i = 0; i + 1 < session.size(); ++i) {
+        arrivalDeg += session[i].gyro * (session[i + 1].arrivalUs - session[i].arrivalUs) * 1e-6;
+    }
+    arrivalDeg += session.back().gyro / rateHz;
+
+    // 3. Uma amostra por pacote, com esta linha do tempo
+    double timelineDeg = 0.0;
+    MotionTimeline timeline;
+    std::vector<uint64_t> dsu;
+    dsu.reserve(session.size());
+    for (const Sample& sample : session) {
+        uint64_t stamp = 0;
+        if (timeline.accept(sample.sensorUs, sample.arrivalUs, stamp)) dsu.push_back(stamp);
+    }
+    for (size_t i = 0; i + 1 < dsu.size(); ++i) {
+        timelineDeg += session[i].gyro * double(dsu[i + 1] - dsu[i]) * 1e-6;
+    }
+    timelineDeg += session.back().gyro / rateHz;
+
+    QStringList lines;
+    lines << QString("Sessão sintética: %1 s a %2 Hz, deriva +%3 ppm, jitter exp. 2 ms, rajadas de 30 ms/s, wrap aos 10 s")
+        .arg(seconds).arg(rateHz, 0, 'f', 0).arg(driftPpm, 0, 'f', 0);
+    lines << QString("  ângulo real (eixo Z): %1 graus").arg(truthDeg, 0, 'f', 2);
+    lines << QString("  tick de 8 ms, relógio do servidor:   erro %1 graus").arg(tickDeg - truthDeg, 0, 'f', 3);
+    lines << QString("  por amostra, instante de chegada:    erro %1 graus").arg(arrivalDeg - truthDeg, 0, 'f', 3);
+    lines << QString("  por amostra, MotionTimeline:         erro %1 graus (%2 amostras, %3 re-âncoras)")
+        .arg(timelineDeg - truthDeg, 0, 'f', 3).arg(int(dsu.size())).arg(timeline.reanchorCount());
+    return lines;
+}
@@ -0,0 +1,157 @@
+#ifndef MOTION_TIMELINE_H
+#define MOTION_TIMELINE_H
+
+#include <cstdint>
+#include <cmath>
+#include <QStringList>
+
+// Linha do tempo das amostras de movimento de um jogador.
+// Converte o timestamp de 32 bits do sensor do celular (µs, com wrap) para a
+// base de tempo DSU do servidor preservando os intervalos reais do sensor:
+//   dsu = sensor64 + offset, com o offset ancorado na chegada da primeira amostra
+// (ou após uma pausa) e corrigido no máximo 1 µs por amostra contra a deriva.
+// Também mede o erro de integração do giroscópio entre o relógio do sensor e
+// o relógio de chegada (o que o servidor via antes). Não é thread-safe.
+class MotionTimeline
+{
+public:
+    // Sem amostras há mais que isso: o DSU volta a sair pelo tick do servidor
+    static constexpr int64_t ACTIVE_WINDOW_US = 100000;
+    // Divergência que indica pausa do app/reinício do sensor: re-ancora
+    static constexpr int64_t REANCHOR_THRESHOLD_US = 250000;
+    // Recuo maior que isso é reinício do relógio, não reordenação
+    static constexpr uint32_t CLOCK_RESET_US = 1000000;
+
+    // Jogador saiu: esquece a âncora e as estatísticas
+    void reset()
+    {
+        *this = MotionTimeline();
+    }
+
+    // Retorna false para amostras repetidas ou reordenadas (devem ser descartadas)
+    bool accept(uint32_t sensorUs, int64_t arrivalUs, uint64_t& dsuTimestampUs)
+    {
+        if (m_valid) {
+            const uint32_t delta = sensorUs - m_lastSensor;
+            if (delta == 0) return false;
+            if (delta >= 0x80000000u) {
+                if (m_lastSensor - sensorUs < CLOCK_RESET_US) return false;
+                // Relógio do sensor reiniciou (app reaberto): nova âncora, mas o
+                // DSU continua crescente e as estatísticas continuam valendo
+                m_high = 0;
+                m_lastSensor = sensorUs;
+                int64_t mapped = arrivalUs;
+                if (mapped <= m_lastDsu) mapped = m_lastDsu + 1;
+                m_offset = mapped - static_cast<int64_t>(sensorUs);
+                m_sensorIntervalUs = mapped - m_lastDsu;
+                m_arrivalIntervalUs = arrivalUs - m_lastArrival;
+                m_lastDsu = mapped;
+                m_lastArrival = arrivalUs;
+                m_reanchors++;
+                m_clockResets++;
+                dsuTimestampUs = static_cast<uint64_t>(mapped);
+                return true;
+            }
+        }
+
+        if (!m_valid) {
+            m_valid = true;
+            m_high = 0;
+            m_lastSensor = sensorUs;
+            m_offset = arrivalUs - static_cast<int64_t>(sensorUs);
+            m_lastArrival = arrivalUs;
+            m_lastDsu = arrivalUs;
+            m_sensorIntervalUs = 0;
+            m_arrivalIntervalUs = 0;
+            dsuTimestampUs = static_cast<uint64_t>(arrivalUs);
+            return true;
+        }
+
+        if (sensorUs < m_lastSensor) m_high += (int64_t(1) << 32);
+        m_lastSensor = sensorUs;
+        const int64_t sensor64 = m_high + sensorUs;
+
+        int64_t mapped = sensor64 + m_offset;
+        const bool resumed = (arrivalUs - m_lastArrival) > ACTIVE_WINDOW_US;
+        if (resumed || mapped > arrivalUs + REANCHOR_THRESHOLD_US || mapped < arrivalUs - REANCHOR_THRESHOLD_US) {
+            // Após uma pausa o DSU pode ter usado o relógio do servidor: re-ancora
+            // na chegada para o timestamp continuar crescente
+            m_offset = arrivalUs - sensor64;
+            mapped = arrivalUs;
+            m_reanchors++;
+        }
+        else if (mapped > arrivalUs) {
+            // A âncora pegou uma chegada atrasada (ex: rajada do Wi-Fi). Corrige
+            // devagar para não distorcer os intervalos que o emulador integra.
+            m_offset -= 1;
+            mapped -= 1;
+        }
+        if (mapped <= m_lastDsu) mapped = m_lastDsu + 1;
+
+        m_sensorIntervalUs = mapped - m_lastDsu;
+        m_arrivalIntervalUs = arrivalUs - m_lastArrival;
+        m_lastDsu = mapped;
+        m_lastArrival = arrivalUs;
+        dsuTimestampUs = static_cast<uint64_t>(mapped);
+        return true;
+    }
+
+    bool isActive(int64_t nowUs) const
+    {
+        return m_valid && (nowUs - m_lastArrival) < ACTIVE_WINDOW_US;
+    }
+
+    int64_t sensorIntervalUs() const { return m_sensorIntervalUs; }
+    int64_t arrivalIntervalUs() const { return m_arrivalIntervalUs; }
+    int reanchorCount() const { return m_reanchors; }
+    int clockResetCount() const { return m_clockResets; }
+
+    // Integra o giroscópio (graus/s) da última amostra aceita pelos dois relógios
+    void integrate(double gx, double gy, double gz)
+    {
+        const double dtSensor = m_sensorIntervalUs * 1e-6;
+        const double dtArrival = m_arrivalIntervalUs * 1e-6;
+        m_errorX += gx * (dtArrival - dtSensor);
+        m_errorY += gy * (dtArrival - dtSensor);
+        m_errorZ += gz * (dtArrival - dtSensor);
+        m_integratedSamples++;
+    }
+
+    // Ângulo (graus) que a integração pelo relógio de chegada teria errado desde o último reset
+    double integrationErrorDeg() const
+    {
+        return std::sqrt(m_errorX * m_errorX + m_errorY * m_errorY + m_errorZ * m_errorZ);
+    }
+
+    int integratedSamples() const { return m_integratedSamples; }
+
+    void resetIntegration()
+    {
+        m_errorX = m_errorY = m_errorZ = 0.0;
+        m_integratedSamples = 0;
+    }
+
+    // --bench-motion: sessão sintética reproduzível (200 Hz, deriva do relógio
+    // do celular, jitter e rajadas do Wi-Fi, wrap do relógio) integrada pelo
+    // tick antigo, pela chegada e por esta linha do tempo
+    static QStringList runReplayBenchmark(int seconds);
+
+private:
+    bool m_valid = false;
+    uint32_t m_lastSensor = 0;
+    int64_t m_high = 0;
+    int64_t m_offset = 0;
+    int64_t m_lastArrival = 0;
+    int64_t m_lastDsu = 0;
+    int64_t m_sensorIntervalUs = 0;
+    int64_t m_arrivalIntervalUs = 0;
+    int m_reanchors = 0;
+    int m_clockResets = 0;
+
+    double m_errorX = 0.0;
+    double m_errorY = 0.0;
+    double m_errorZ = 0.0;
+    int m_integratedSamples = 0;
+};
+
+#endif // MOTION_TIMELINE_H
@@ -0,0 +1,51 @@
+﻿#include "null_backend.h"
+#include <QTimer>
+
+NullBackend::NullBackend(QObject* parent)
+    : ControllerBackend(parent)
+{
+}
+
+void NullBackend::shutdown()
+{
+    m_pending.clear();
+    m_plugged.clear();
+}
+
+quint32 NullBackend::beginPlug(ControllerType type)
+{
+    Q_UNUSED(type);
+
+    const quint32 padId = m_nextId++;
+    m_pending.insert(padId);
+
+    QTimer::singleShot(m_plugDelayMs, this, [this, padId]() {
+        // Removido antes de terminar: nada a avisar
+        if (!m_pending.remove(padId)) return;
+
+        if (m_failPlugs) {
+            emit plugFinished(padId, false);
+            return;
+        }
+        m_plugged.insert(padId);
+        emit plugFinished(padId, true);
+        });
+    return padId;
+}
+
+void NullBackend::unplug(quint32 padId)
+{
+    m_pending.remove(padId);
+    m_plugged.remove(padId);
+}
+
+void NullBackend::submit(quint32 padId, const GamepadPacket& packet)
+{
+    Q_UNUSED(packet);
+
+    if (!m_plugged.contains(padId)) {
+        m_dropped++;
+        return;
+    }
+    m_submissions++;
+}
@@ -0,0 +1,49 @@
+#ifndef NULL_BACKEND_H
+#define NULL_BACKEND_H
+
+#include <QSet>
+#include "controller_backend.h"
+
+// Backend sem driver: os controles só existem em memória. O plug termina
+// depois de um atraso configurável (simula a enumeração lenta do ViGEm) e
+// pode ser configurado para falhar. Os reports só são contados.
+// Roda em qualquer plataforma.
+class NullBackend : public ControllerBackend
+{
+    Q_OBJECT
+
+public:
+    explicit NullBackend(QObject* parent = nullptr);
+
+    const char* name() const override { return "null"; }
+
+    bool initialize() override { return true; }
+    void shutdown() override;
+
+    quint32 beginPlug(ControllerType type) override;
+    void unplug(quint32 padId) override;
+    void submit(quint32 padId, const GamepadPacket& packet) override;
+
+    // 0 = o plug termina na próxima volta do event loop
+    void setPlugDelay(int ms) { m_plugDelayMs = ms > 0 ? ms : 0; }
+    void setFailPlugs(bool fail) { m_failPlugs = fail; }
+
+    int pluggedCount() const { return m_plugged.size(); }
+    int pendingCount() const { return m_pending.size(); }
+    bool isPlugged(quint32 padId) const { return m_plugged.contains(padId); }
+
+    // Reports recebidos (os de controles não plugados são descartados)
+    qint64 submissions() const { return m_submissions; }
+    qint64 droppedSubmissions() const { return m_dropped; }
+
+private:
+    QSet<quint32> m_pending;
+    QSet<quint32> m_plugged;
+    quint32 m_nextId = 1;
+    int m_plugDelayMs = 0;
+    bool m_failPlugs = false;
+    qint64 m_submissions = 0;
+    qint64 m_dropped = 0;
+};
+
+#endif // NULL_BACKEND_H
@@ -0,0 +1,93 @@
+﻿#include "recording_backend.h"
+#include <QFile>
+
+RecordingBackend::RecordingBackend(QObject* parent)
+    : NullBackend(parent)
+{
+    m_clock.start();
+    connect(this, &ControllerBackend::plugFinished, this, &RecordingBackend::onPlugFinished);
+}
+
+quint32 RecordingBackend::beginPlug(ControllerType type)
+{
+    const quint32 padId = NullBackend::beginPlug(type);
+    if (padId) m_types.insert(padId, type);
+    return padId;
+}
+
+void RecordingBackend::unplug(quint32 padId)
+{
+    if (isPlugged(padId)) append(padId, Event::Unplug);
+    m_types.remove(padId);
+    NullBackend::unplug(padId);
+}
+
+void RecordingBackend::submit(quint32 padId, const GamepadPacket& packet)
+{
+    if (isPlugged(padId)) append(padId, Event::Report, packet);
+    NullBackend::submit(padId, packet);
+}
+
+void RecordingBackend::onPlugFinished(quint32 padId, bool ok)
+{
+    if (ok) append(padId, Event::Plug);
+    else m_types.remove(padId);
+}
+
+void RecordingBackend::append(quint32 padId, Event event, const GamepadPacket& packet)
+{
+    if (m_records.size() >= m_maxRecords) {
+        m_droppedRecords++;
+        return;
+    }
+
+    Record record;
+    record.timestampUs = m_clock.nsecsElapsed() / 1000;
+    record.padId = padId;
+    record.type = m_types.value(padId, ControllerType::DualShock4);
+    record.event = event;
+    record.packet = packet;
+    m_records.append(record);
+}
+
+void RecordingBackend::clearRecords()
+{
+    m_records.clear();
+    m_droppedRecords = 0;
+}
+
+// Formato: [us] pad tipo evento [campos do report]
+QByteArray RecordingBackend::toText(bool withTimestamps) const
+{
+    static const char* const eventNames[] = { "plug", "unplug", "report" };
+
+    QByteArray text;
+    text.reserve(m_records.size() * 96);
+    for (const Record& record : m_records) {
+        QByteArray line;
+        if (withTimestamps) line += QByteArray::number(record.timestampUs) + ' ';
+        line += QByteArray::number(record.padId) + ' ';
+        line += (record.type == ControllerType::Xbox360) ? "x360 " : "ds4 ";
+        line += eventNames[static_cast<int>(record.event)];
+
+        if (record.event == Event::Report) {
+            const GamepadPacket& p = record.packet;
+            line += " buttons=" + QByteArray::number(p.buttons, 16);
+            line += " ls=" + QByteArray::number(p.leftStickX) + ',' + QByteArray::number(p.leftStickY);
+            line += " rs=" + QByteArray::number(p.rightStickX) + ',' + QByteArray::number(p.rightStickY);
+            line += " lt=" + QByteArray::number(p.leftTrigger);
+            line += " rt=" + QByteArray::number(p.rightTrigger);
+            line += " gyro=" + QByteArray::number(p.gyroX) + ',' + QByteArray::number(p.gyroY) + ',' + QByteArray::number(p.gyroZ);
+            line += " accel=" + QByteArray::number(p.accelX) + ',' + QByteArray::number(p.accelY) + ',' + QByteArray::number(p.accelZ);
+        }
+        text += line + '\n';
+    }
+    return text;
+}
+
+bool RecordingBackend::saveTo(const QString& path, bool withTimestamps) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+    return file.write(toText(withTimestamps)) >= 0;
+}
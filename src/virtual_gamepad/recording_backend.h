@@ -0,0 +1,59 @@
+#ifndef RECORDING_BACKEND_H
+#define RECORDING_BACKEND_H
+
+#include <QVector>
+#include <QHash>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include "null_backend.h"
+
+// Backend que grava tudo o que o GamepadManager manda: plug, remoção e cada
+// report com timestamp. A saída em texto é estável (uma linha por evento),
+// então serve de referência para testes "golden" do caminho entrada -> report.
+class RecordingBackend : public NullBackend
+{
+    Q_OBJECT
+
+public:
+    enum class Event : quint8 { Plug, Unplug, Report };
+
+    struct Record {
+        qint64 timestampUs = 0;   // Desde a criação do backend
+        quint32 padId = 0;
+        ControllerType type = ControllerType::DualShock4;
+        Event event = Event::Report;
+        GamepadPacket packet;     // Só em Event::Report
+    };
+
+    explicit RecordingBackend(QObject* parent = nullptr);
+
+    const char* name() const override { return "recording"; }
+
+    quint32 beginPlug(ControllerType type) override;
+    void unplug(quint32 padId) override;
+    void submit(quint32 padId, const GamepadPacket& packet) override;
+
+    // Limite de eventos guardados (os seguintes são só contados)
+    void setMaxRecords(int count) { m_maxRecords = count > 0 ? count : 0; }
+    const QVector<Record>& records() const { return m_records; }
+    qint64 droppedRecords() const { return m_droppedRecords; }
+    void clearRecords();
+
+    // Sem timestamps a saída depende só da sequência de eventos
+    QByteArray toText(bool withTimestamps = true) const;
+    bool saveTo(const QString& path, bool withTimestamps = true) const;
+
+private slots:
+    void onPlugFinished(quint32 padId, bool ok);
+
+private:
+    void append(quint32 padId, Event event, const GamepadPacket& packet = GamepadPacket{});
+
+    QElapsedTimer m_clock;
+    QHash<quint32, ControllerType> m_types;
+    QVector<Record> m_records;
+    int m_maxRecords = 100000;
+    qint64 m_droppedRecords = 0;
+};
+
+#endif // RECORDING_BACKEND_H
@@ -0,0 +1,220 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <cstdint>
+#include <vector>
+
+// Timer wheel hierárquico (3 níveis: 256 x 64 x 64 ticks).
+// Inserção, cancelamento e disparo custam O(1) por timer; cada avanço de tick
+// custa O(1) amortizado (cascata de um slot a cada 256 ticks).
+// O tick é uma unidade abstrata (o MacroEngine usa 1 tick = 1 ms).
+// Não é thread-safe: deve ser usado pela thread dona.
+class TimerWheel
+{
+public:
+    using TimerId = uint64_t;
+    static constexpr TimerId INVALID_TIMER = 0;
+
+    explicit TimerWheel(int64_t startTick = 0)
+        : m_now(startTick)
+    {
+        for (auto& head : m_level0) head = NIL;
+        for (auto& head : m_level1) head = NIL;
+        for (auto& head : m_level2) head = NIL;
+    }
+
+    // Os slots guardam ponteiros para os próprios arrays: não copiável
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    int64_t now() const { return m_now; }
+    int size() const { return m_active; }
+    bool isEmpty() const { return m_active == 0; }
+
+    // Com a roda vazia, salta direto para 'tick' (evita percorrer ticks ociosos)
+    void fastForward(int64_t tick)
+    {
+        if (m_active == 0 && tick > m_now) m_now = tick;
+    }
+
+    // Agenda um timer para o tick 'deadline'. 'cookie' é devolvido no disparo.
+    TimerId schedule(int64_t deadline, uint32_t cookie)
+    {
+        uint32_t index;
+        if (m_freeHead != NIL) {
+            index = m_freeHead;
+            m_freeHead = m_entries[index].next;
+        }
+        else {
+            index = static_cast<uint32_t>(m_entries.size());
+            m_entries.push_back(Entry());
+        }
+
+        Entry& e = m_entries[index];
+        e.deadline = deadline;
+        e.cookie = cookie;
+        e.generation++;
+        e.active = true;
+        place(index);
+        m_active++;
+        return makeId(index, e.generation);
+    }
+
+    // Cancela um timer ainda pendente. Ids antigos/já disparados são ignorados.
+    bool cancel(TimerId id)
+    {
+        if (id == INVALID_TIMER) return false;
+        const uint32_t index = static_cast<uint32_t>(id & 0xFFFFFFFFu) - 1;
+        const uint32_t generation = static_cast<uint32_t>(id >> 32);
+        if (index >= m_entries.size()) return false;
+
+        Entry& e = m_entries[index];
+        if (!e.active || e.generation != generation) return false;
+
+        unlink(index);
+        release(index);
+        return true;
+    }
+
+    // Avança até 'target' disparando onExpire(cookie, deadline) para cada timer vencido.
+    // O callback pode agendar e cancelar timers, inclusive os que vencem no mesmo
+    // tick e ainda não dispararam (saem da lista de disparo e não disparam).
+    template <typename Fn>
+    void advance(int64_t target, Fn&& onExpire)
+    {
+        while (m_now < target) {
+            m_now++;
+            const uint32_t idx0 = static_cast<uint32_t>(m_now & L0_MASK);
+            if (idx0 == 0) {
+                const uint32_t idx1 = static_cast<uint32_t>((m_now >> L0_BITS) & L1_MASK);
+                if (idx1 == 0) {
+                    cascade(m_level2[(m_now >> (L0_BITS + L1_BITS)) & L2_MASK]);
+                }
+                cascade(m_level1[idx1]);
+            }
+
+            // Move o slot para a lista de disparo antes de disparar: o que o callback
+            // agenda vai para a roda, e o que ele cancela sai desta lista. Por isso
+            // o próximo é sempre lido da cabeça, depois de cada callback
+            m_firing = m_level0[idx0];
+            m_level0[idx0] = NIL;
+            for (uint32_t node = m_firing; node != NIL; node = m_entries[node].next) {
+                m_entries[node].slot = &m_firing;
+            }
+            while (m_firing != NIL) {
+                const uint32_t node = m_firing;
+                unlink(node);
+                Entry& e = m_entries[node];
+
+                if (e.deadline > m_now) {
+                    // Timer limitado pelo alcance máximo: recoloca
+                    place(node);
+                }
+                else {
+                    const uint32_t cookie = e.cookie;
+                    const int64_t deadline = e.deadline;
+                    release(node);
+                    onExpire(cookie, deadline);
+                }
+            }
+        }
+    }
+
+private:
+    static constexpr uint32_t NIL = 0xFFFFFFFFu;
+    static constexpr int L0_BITS = 8;
+    static constexpr int L1_BITS = 6;
+    static constexpr int L2_BITS = 6;
+    static constexpr int64_t L0_MASK = (1 << L0_BITS) - 1;
+    static constexpr int64_t L1_MASK = (1 << L1_BITS) - 1;
+    static constexpr int64_t L2_MASK = (1 << L2_BITS) - 1;
+    static constexpr int64_t L1_SPAN = int64_t(1) << L0_BITS;
+    static constexpr int64_t L2_SPAN = int64_t(1) << (L0_BITS + L1_BITS);
+    static constexpr int64_t MAX_SPAN = int64_t(1) << (L0_BITS + L1_BITS + L2_BITS);
+
+    struct Entry {
+        int64_t deadline = 0;
+        uint32_t cookie = 0;
+        uint32_t generation = 0;
+        uint32_t prev = NIL;
+        uint32_t next = NIL;
+        uint32_t* slot = nullptr;
+        bool active = false;
+    };
+
+    static TimerId makeId(uint32_t index, uint32_t generation)
+    {
+        return (static_cast<uint64_t>(generation) << 32) | (static_cast<uint64_t>(index) + 1);
+    }
+
+    // Durante a cascata o slot do tick atual ainda vai ser processado, então
+    // timers que vencem agora podem ir para ele; fora dela vão para o próximo tick.
+    void place(uint32_t index, bool cascading = false)
+    {
+        Entry& e = m_entries[index];
+        int64_t when = e.deadline;
+        if (cascading && when <= m_now) when = m_now;
+        else if (when <= m_now) when = m_now + 1;
+
+        const int64_t delta = when - m_now;
+        uint32_t* slot;
+        if (delta < L1_SPAN) {
+            slot = &m_level0[when & L0_MASK];
+        }
+        else if (delta < L2_SPAN) {
+            slot = &m_level1[(when >> L0_BITS) & L1_MASK];
+        }
+        else {
+            if (delta >= MAX_SPAN) when = m_now + MAX_SPAN - 1;
+            slot = &m_level2[(when >> (L0_BITS + L1_BITS)) & L2_MASK];
+        }
+
+        e.slot = slot;
+        e.prev = NIL;
+        e.next = *slot;
+        if (*slot != NIL) m_entries[*slot].prev = index;
+        *slot = index;
+    }
+
+    void unlink(uint32_t index)
+    {
+        Entry& e = m_entries[index];
+        if (e.prev != NIL) m_entries[e.prev].next = e.next;
+        else if (e.slot) *e.slot = e.next;
+        if (e.next != NIL) m_entries[e.next].prev = e.prev;
+        e.prev = e.next = NIL;
+        e.slot = nullptr;
+    }
+
+    void release(uint32_t index)
+    {
+        Entry& e = m_entries[index];
+        e.active = false;
+        e.next = m_freeHead;
+        m_freeHead = index;
+        m_active--;
+    }
+
+    void cascade(uint32_t& head)
+    {
+        uint32_t node = head;
+        head = NIL;
+        while (node != NIL) {
+            const uint32_t next = m_entries[node].next;
+            m_entries[node].prev = m_entries[node].next = NIL;
+            place(node, true);
+            node = next;
+        }
+    }
+
+    int64_t m_now;
+    int m_active = 0;
+    uint32_t m_freeHead = NIL;
+    uint32_t m_firing = NIL;            // Timers do tick em disparo
+    uint32_t m_level0[1 << L0_BITS];
+    uint32_t m_level1[1 << L1_BITS];
+    uint32_t m_level2[1 << L2_BITS];
+    std::vector<Entry> m_entries;
+};
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,177 @@
+﻿#include "uinput_backend.h"
+#include <QDebug>
+#include <QTimer>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/uinput.h>
+
+static const char* const UINPUT_PATH = "/dev/uinput";
+
+// Botões do GamepadPacket -> códigos evdev (layout de gamepad do kernel:
+// SOUTH/EAST/WEST/NORTH = A/B/X/Y no Xbox, Cruz/Círculo/Quadrado/Triângulo no DS4)
+static const struct { quint16 mask; quint16 code; } BUTTON_MAP[] = {
+    { A, BTN_SOUTH },
+    { B, BTN_EAST },
+    { X, BTN_WEST },
+    { Y, BTN_NORTH },
+    { L1, BTN_TL },
+    { R1, BTN_TR },
+    { L3, BTN_THUMBL },
+    { R3, BTN_THUMBR },
+    { SELECT, BTN_SELECT },
+    { START, BTN_START },
+};
+
+// Gatilho analógico acima disto também aperta o botão digital (igual ao DS4 do ViGEm)
+static constexpr int TRIGGER_BUTTON_THRESHOLD = 20;
+
+UinputBackend::UinputBackend(QObject* parent)
+    : ControllerBackend(parent)
+{
+}
+
+UinputBackend::~UinputBackend()
+{
+    shutdown();
+}
+
+bool UinputBackend::initialize()
+{
+    if (::access(UINPUT_PATH, W_OK) != 0) {
+        qCritical() << "Sem acesso de escrita a" << UINPUT_PATH << ":" << std::strerror(errno);
+        return false;
+    }
+    qDebug() << "uinput disponível para controles virtuais";
+    return true;
+}
+
+void UinputBackend::shutdown()
+{
+    const QList<quint32> pads = m_devices.keys();
+    for (quint32 padId : pads) {
+        unplug(padId);
+    }
+}
+
+int UinputBackend::createDevice(ControllerType type, quint32 padId)
+{
+    const int fd = ::open(UINPUT_PATH, O_WRONLY | O_NONBLOCK);
+    if (fd < 0) return -1;
+
+    bool ok = ::ioctl(fd, UI_SET_EVBIT, EV_KEY) == 0 && ::ioctl(fd, UI_SET_EVBIT, EV_ABS) == 0;
+    for (const auto& button : BUTTON_MAP) {
+        ok = ok && ::ioctl(fd, UI_SET_KEYBIT, button.code) == 0;
+    }
+    ok = ok && ::ioctl(fd, UI_SET_KEYBIT, BTN_TL2) == 0 && ::ioctl(fd, UI_SET_KEYBIT, BTN_TR2) == 0;
+
+    auto setupAxis = [fd](quint16 code, int minimum, int maximum, int fuzz, int flat) {
+        uinput_abs_setup axis;
+        std::memset(&axis, 0, sizeof(axis));
+        axis.code = code;
+        axis.absinfo.minimum = minimum;
+        axis.absinfo.maximum = maximum;
+        axis.absinfo.fuzz = fuzz;
+        axis.absinfo.flat = flat;
+        return ::ioctl(fd, UI_SET_ABSBIT, code) == 0 && ::ioctl(fd, UI_ABS_SETUP, &axis) == 0;
+    };
+    ok = ok && setupAxis(ABS_X, -32768, 32767, 16, 128) && setupAxis(ABS_Y, -32768, 32767, 16, 128)
+        && setupAxis(ABS_RX, -32768, 32767, 16, 128) && setupAxis(ABS_RY, -32768, 32767, 16, 128)
+        && setupAxis(ABS_Z, 0, 255, 0, 0) && setupAxis(ABS_RZ, 0, 255, 0, 0)
+        && setupAxis(ABS_HAT0X, -1, 1, 0, 0) && setupAxis(ABS_HAT0Y, -1, 1, 0, 0);
+
+    uinput_setup setup;
+    std::memset(&setup, 0, sizeof(setup));
+    setup.id.bustype = BUS_USB;
+    if (type == ControllerType::Xbox360) {
+        setup.id.vendor = 0x045e;    // Microsoft
+        setup.id.product = 0x028e;   // Xbox 360 Controller
+    }
+    else {
+        setup.id.vendor = 0x054c;    // Sony
+        setup.id.product = 0x05c4;   // DualShock 4
+    }
+    std::snprintf(setup.name, UINPUT_MAX_NAME_SIZE, "GamePadVirtual %s #%u",
+        type == ControllerType::Xbox360 ? "Xbox 360 Controller" : "DualShock 4", padId);
+
+    ok = ok && ::ioctl(fd, UI_DEV_SETUP, &setup) == 0 && ::ioctl(fd, UI_DEV_CREATE) == 0;
+    if (!ok) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+quint32 UinputBackend::beginPlug(ControllerType type)
+{
+    const quint32 padId = m_nextId++;
+
+    // A criação no kernel é rápida (o udev termina em segundo plano); o resultado
+    // sai pelo event loop para manter o contrato assíncrono do backend
+    Device device;
+    device.type = type;
+    device.fd = createDevice(type, padId);
+    const bool ok = device.fd >= 0;
+    if (ok) m_devices.insert(padId, device);
+    else qCritical() << "Falha ao criar controle uinput:" << std::strerror(errno);
+
+    QTimer::singleShot(0, this, [this, padId, ok]() {
+        // Removido antes de o resultado ser entregue
+        if (ok && !m_devices.contains(padId)) return;
+        emit plugFinished(padId, ok);
+        });
+    return padId;
+}
+
+void UinputBackend::unplug(quint32 padId)
+{
+    const auto it = m_devices.find(padId);
+    if (it == m_devices.end()) return;
+
+    ::ioctl(it->fd, UI_DEV_DESTROY);
+    ::close(it->fd);
+    m_devices.erase(it);
+}
+
+void UinputBackend::submit(quint32 padId, const GamepadPacket& packet)
+{
+    const auto it = m_devices.constFind(padId);
+    if (it == m_devices.constEnd()) return;
+
+    // Um report completo por envio; o kernel descarta os valores que não mudaram
+    input_event events[32];
+    int count = 0;
+    auto add = [&events, &count](quint16 type, quint16 code, int value) {
+        input_event& ev = events[count++];
+        std::memset(&ev, 0, sizeof(ev));
+        ev.type = type;
+        ev.code = code;
+        ev.value = value;
+    };
+    auto stick = [](int value) { return std::clamp(value * 257, -32768, 32767); };
+
+    for (const auto& button : BUTTON_MAP) {
+        add(EV_KEY, button.code, (packet.buttons & button.mask) ? 1 : 0);
+    }
+    add(EV_KEY, BTN_TL2, packet.leftTrigger > TRIGGER_BUTTON_THRESHOLD ? 1 : 0);
+    add(EV_KEY, BTN_TR2, packet.rightTrigger > TRIGGER_BUTTON_THRESHOLD ? 1 : 0);
+
+    // Eixo Y do pacote já cresce para baixo, como no evdev
+    add(EV_ABS, ABS_X, stick(packet.leftStickX));
+    add(EV_ABS, ABS_Y, stick(packet.leftStickY));
+    add(EV_ABS, ABS_RX, stick(packet.rightStickX));
+    add(EV_ABS, ABS_RY, stick(packet.rightStickY));
+    add(EV_ABS, ABS_Z, packet.leftTrigger);
+    add(EV_ABS, ABS_RZ, packet.rightTrigger);
+    add(EV_ABS, ABS_HAT0X, (packet.buttons & DPAD_RIGHT) ? 1 : (packet.buttons & DPAD_LEFT) ? -1 : 0);
+    add(EV_ABS, ABS_HAT0Y, (packet.buttons & DPAD_DOWN) ? 1 : (packet.buttons & DPAD_UP) ? -1 : 0);
+    add(EV_SYN, SYN_REPORT, 0);
+
+    if (::write(it->fd, events, sizeof(input_event) * count) < 0) {
+        qWarning() << "uinput: falha ao enviar report do controle" << padId << ":" << std::strerror(errno);
+    }
+}
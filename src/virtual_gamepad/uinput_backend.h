@@ -0,0 +1,41 @@
+#ifndef UINPUT_BACKEND_H
+#define UINPUT_BACKEND_H
+
+#include <QHash>
+#include "controller_backend.h"
+
+// Controles virtuais no Linux via /dev/uinput (precisa de permissão de escrita
+// no dispositivo, ex.: regra udev ou grupo "input"). Cada controle vira um
+// dispositivo evdev no layout padrão de gamepad do kernel, com o vendor/product
+// do controle original para o SDL e os jogos reconhecerem o tipo.
+// Ainda sem force feedback: a vibração não volta para o cliente.
+class UinputBackend : public ControllerBackend
+{
+    Q_OBJECT
+
+public:
+    explicit UinputBackend(QObject* parent = nullptr);
+    ~UinputBackend();
+
+    const char* name() const override { return "uinput"; }
+
+    bool initialize() override;
+    void shutdown() override;
+
+    quint32 beginPlug(ControllerType type) override;
+    void unplug(quint32 padId) override;
+    void submit(quint32 padId, const GamepadPacket& packet) override;
+
+private:
+    struct Device {
+        int fd = -1;
+        ControllerType type = ControllerType::DualShock4;
+    };
+
+    static int createDevice(ControllerType type, quint32 padId);
+
+    QHash<quint32, Device> m_devices;
+    quint32 m_nextId = 1;
+};
+
+#endif // UINPUT_BACKEND_H
@@ -0,0 +1,316 @@
+﻿// vigem_backend.cpp
+#define VIGEM_ENABLE_BUS_VERSION_1_17_X_FEATURES
+#define NOMINMAX
+#include "vigem_backend.h"
+#include <QDebug>
+#include <QMutex>
+#include <QThread>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <cstring>
+
+// O callback de vigem_target_add_async não recebe user data: o resultado é
+// encaminhado para a instância ativa (só existe um cliente ViGEm por processo)
+static QMutex s_instanceMutex;
+static VigemBackend* s_instance = nullptr;
+
+// Tempo máximo de espera por plugs em andamento ao desligar o cliente
+static constexpr int SHUTDOWN_WAIT_MS = 2000;
+
+VigemBackend::VigemBackend(QObject* parent)
+    : ControllerBackend(parent), m_client(nullptr)
+{
+    QMutexLocker locker(&s_instanceMutex);
+    s_instance = this;
+}
+
+VigemBackend::~VigemBackend()
+{
+    {
+        QMutexLocker locker(&s_instanceMutex);
+        if (s_instance == this) s_instance = nullptr;
+    }
+    shutdown();
+}
+
+bool VigemBackend::initialize()
+{
+    m_client = vigem_alloc();
+    if (m_client == nullptr) {
+        qCritical() << "Falha ao alocar cliente ViGEm";
+        return false;
+    }
+
+    const VIGEM_ERROR retval = vigem_connect(m_client);
+    if (!VIGEM_SUCCESS(retval)) {
+        qCritical() << "Falha ao conectar com ViGEm:" << retval;
+        vigem_free(m_client);
+        m_client = nullptr;
+        return false;
+    }
+
+    qDebug() << "ViGEm inicializado com sucesso";
+    return true;
+}
+
+void VigemBackend::shutdown()
+{
+    if (!m_client) return;
+
+    // As threads de plug ainda usam o cliente: espera terminarem antes de liberá-lo
+    QElapsedTimer waited;
+    waited.start();
+    while (m_addsInFlight.loadAcquire() > 0 && waited.elapsed() < SHUTDOWN_WAIT_MS) {
+        QThread::msleep(5);
+    }
+    if (m_addsInFlight.loadAcquire() > 0) {
+        qWarning() << "ViGEm: plugs ainda em andamento ao desligar; o cliente não será liberado";
+        return;
+    }
+
+    // Os resultados postados e ainda não entregues são tratados aqui
+    const QList<Target*> targets = m_targets.values();
+    for (Target* target : targets) {
+        releaseTarget(target);
+    }
+    m_targets.clear();
+
+    vigem_disconnect(m_client);
+    vigem_free(m_client);
+    m_client = nullptr;
+}
+
+quint32 VigemBackend::beginPlug(ControllerType type)
+{
+    if (!m_client) return 0;
+
+    Target* target = new Target;
+    target->backend = this;
+    target->id = m_nextId++;
+    target->type = type;
+    target->handle = (type == ControllerType::Xbox360) ? vigem_target_x360_alloc() : vigem_target_ds4_alloc();
+    if (!target->handle) {
+        delete target;
+        return 0;
+    }
+
+    m_targets.insert(target->id, target);
+    m_addsInFlight.ref();
+    const VIGEM_ERROR result = vigem_target_add_async(m_client, target->handle, &VigemBackend::addResultCallback);
+    if (!VIGEM_SUCCESS(result)) {
+        qCritical() << "Falha ao iniciar o plug do controle virtual:" << result;
+        m_addsInFlight.deref();
+        m_targets.remove(target->id);
+        vigem_target_free(target->handle);
+        delete target;
+        return 0;
+    }
+    return target->id;
+}
+
+void VigemBackend::unplug(quint32 padId)
+{
+    Target* target = m_targets.value(padId, nullptr);
+    if (!target) return;
+
+    if (!target->plugged) {
+        // A thread do ViGEm ainda usa o target: remove quando o plug terminar
+        target->removeWhenAdded = true;
+        return;
+    }
+    m_targets.remove(padId);
+    releaseTarget(target);
+}
+
+// Converte o estado do jogador no report do tipo do controle e envia
+void VigemBackend::submit(quint32 padId, const GamepadPacket& packet)
+{
+    const Target* pad = m_targets.value(padId, nullptr);
+    if (!pad || !pad->plugged || !m_client) return;
+
+    const PVIGEM_TARGET target = pad->handle;
+    const ControllerType type = pad->type;
+
+    if (type == ControllerType::Xbox360)
+    {
+        XUSB_REPORT report;
+        std::memset(&report, 0, sizeof(XUSB_REPORT));
+        XUSB_REPORT_INIT(&report);
+
+        // Botões Xbox 360 - CORREÇÃO APLICADA
+        report.wButtons = 0;
+        if (packet.buttons & A) report.wButtons |= XUSB_GAMEPAD_A;
+        if (packet.buttons & B) report.wButtons |= XUSB_GAMEPAD_B;
+        if (packet.buttons & X) report.wButtons |= XUSB_GAMEPAD_X;
+        if (packet.buttons & Y) report.wButtons |= XUSB_GAMEPAD_Y;
+        if (packet.buttons & L1) report.wButtons |= XUSB_GAMEPAD_LEFT_SHOULDER;
+        if (packet.buttons & R1) report.wButtons |= XUSB_GAMEPAD_RIGHT_SHOULDER;
+        if (packet.buttons & L3) report.wButtons |= XUSB_GAMEPAD_LEFT_THUMB;
+        if (packet.buttons & R3) report.wButtons |= XUSB_GAMEPAD_RIGHT_THUMB;
+        if (packet.buttons & SELECT) report.wButtons |= XUSB_GAMEPAD_BACK;
+        if (packet.buttons & START) report.wButtons |= XUSB_GAMEPAD_START;
+
+        // D-Pad
+        if (packet.buttons & DPAD_UP) report.wButtons |= XUSB_GAMEPAD_DPAD_UP;
+        if (packet.buttons & DPAD_DOWN) report.wButtons |= XUSB_GAMEPAD_DPAD_DOWN;
+        if (packet.buttons & DPAD_LEFT) report.wButtons |= XUSB_GAMEPAD_DPAD_LEFT;
+        if (packet.buttons & DPAD_RIGHT) report.wButtons |= XUSB_GAMEPAD_DPAD_RIGHT;
+
+        report.bLeftTrigger = packet.leftTrigger;
+        report.bRightTrigger = packet.rightTrigger;
+        report.sThumbLX = (packet.leftStickX == -128) ? -32768 : static_cast<SHORT>(packet.leftStickX * 257);
+        report.sThumbLY = (packet.leftStickY == -128) ? 32767 : static_cast<SHORT>(-packet.leftStickY * 257);
+        report.sThumbRX = (packet.rightStickX == -128) ? -32768 : static_cast<SHORT>(packet.rightStickX * 257);
+        report.sThumbRY = (packet.rightStickY == -128) ? 32767 : static_cast<SHORT>(-packet.rightStickY * 257);
+
+        vigem_target_x360_update(m_client, target, report);
+    }
+    else if (type == ControllerType::DualShock4)
+    {
+        DS4_REPORT_EX report;
+        std::memset(&report, 0, sizeof(DS4_REPORT_EX));
+
+        report.Report.bThumbLX = static_cast<BYTE>(std::clamp(packet.leftStickX + 128, 0, 255));
+        report.Report.bThumbLY = static_cast<BYTE>(std::clamp(packet.leftStickY + 128, 0, 255));
+        report.Report.bThumbRX = static_cast<BYTE>(std::clamp(packet.rightStickX + 128, 0, 255));
+        report.Report.bThumbRY = static_cast<BYTE>(std::clamp(packet.rightStickY + 128, 0, 255));
+        report.Report.bTriggerL = packet.leftTrigger;
+        report.Report.bTriggerR = packet.rightTrigger;
+
+        USHORT ds4Buttons = 0;
+        UINT dpad = 0x8;
+        if (packet.buttons & DPAD_UP && packet.buttons & DPAD_RIGHT) dpad = 1;
+        else if (packet.buttons & DPAD_DOWN && packet.buttons & DPAD_RIGHT) dpad = 3;
+        else if (packet.buttons & DPAD_DOWN && packet.buttons & DPAD_LEFT) dpad = 5;
+        else if (packet.buttons & DPAD_UP && packet.buttons & DPAD_LEFT) dpad = 7;
+        else if (packet.buttons & DPAD_UP) dpad = 0;
+        else if (packet.buttons & DPAD_RIGHT) dpad = 2;
+        else if (packet.buttons & DPAD_DOWN) dpad = 4;
+        else if (packet.buttons & DPAD_LEFT) dpad = 6;
+        ds4Buttons |= (dpad & 0xF);
+
+        // Botões DS4 - CORREÇÃO APLICADA
+        if (packet.buttons & X) ds4Buttons |= DS4_BUTTON_SQUARE;
+        if (packet.buttons & A) ds4Buttons |= DS4_BUTTON_CROSS;
+        if (packet.buttons & B) ds4Buttons |= DS4_BUTTON_CIRCLE;
+        if (packet.buttons & Y) ds4Buttons |= DS4_BUTTON_TRIANGLE;
+        if (packet.buttons & L1) ds4Buttons |= DS4_BUTTON_SHOULDER_LEFT;
+        if (packet.buttons & R1) ds4Buttons |= DS4_BUTTON_SHOULDER_RIGHT;
+        if (packet.buttons & L3) ds4Buttons |= DS4_BUTTON_THUMB_LEFT;
+        if (packet.buttons & R3) ds4Buttons |= DS4_BUTTON_THUMB_RIGHT;
+        if (packet.buttons & SELECT) ds4Buttons |= DS4_BUTTON_SHARE;
+        if (packet.buttons & START)  ds4Buttons |= DS4_BUTTON_OPTIONS;
+        if (packet.leftTrigger > 20)  ds4Buttons |= DS4_BUTTON_TRIGGER_LEFT;
+        if (packet.rightTrigger > 20) ds4Buttons |= DS4_BUTTON_TRIGGER_RIGHT;
+        report.Report.wButtons = ds4Buttons;
+
+        const float GYRO_SCALE = 32767.0f / 2000.0f;
+        const float APP_GYRO_SCALE = 100.0f;
+        const float safeGyroScale = (APP_GYRO_SCALE != 0.0f) ? APP_GYRO_SCALE : 1.0f;
+        report.Report.wGyroX = static_cast<SHORT>((packet.gyroX / safeGyroScale) * GYRO_SCALE);
+        report.Report.wGyroY = static_cast<SHORT>((packet.gyroY / safeGyroScale) * GYRO_SCALE);
+        report.Report.wGyroZ = static_cast<SHORT>((packet.gyroZ / safeGyroScale) * GYRO_SCALE);
+
+        const float ACCEL_SCALE = 32767.0f / 4.0f;
+        const float APP_ACCEL_SCALE = 4096.0f;
+        const float safeAccelScale = (APP_ACCEL_SCALE != 0.0f) ? APP_ACCEL_SCALE : 1.0f;
+        report.Report.wAccelX = static_cast<SHORT>((packet.accelX / safeAccelScale) * ACCEL_SCALE);
+        report.Report.wAccelY = static_cast<SHORT>((packet.accelY / safeAccelScale) * ACCEL_SCALE);
+        report.Report.wAccelZ = static_cast<SHORT>((packet.accelZ / safeAccelScale) * ACCEL_SCALE);
+
+        vigem_target_ds4_update_ex(m_client, target, report);
+    }
+}
+
+// Chamado numa thread do cliente ViGEm
+void CALLBACK VigemBackend::addResultCallback(PVIGEM_CLIENT Client, PVIGEM_TARGET Target, VIGEM_ERROR Result)
+{
+    Q_UNUSED(Client);
+
+    QMutexLocker locker(&s_instanceMutex);
+    if (!s_instance) return;
+
+    VigemBackend* backend = s_instance;
+    QMetaObject::invokeMethod(backend, [backend, Target, Result]() {
+        backend->onAddResult(Target, Result);
+        }, Qt::QueuedConnection);
+    backend->m_addsInFlight.deref();
+}
+
+void VigemBackend::onAddResult(PVIGEM_TARGET handle, VIGEM_ERROR result)
+{
+    Target* target = nullptr;
+    for (Target* candidate : std::as_const(m_targets)) {
+        if (candidate->handle == handle) {
+            target = candidate;
+            break;
+        }
+    }
+    if (!target) return;
+
+    if (!VIGEM_SUCCESS(result)) {
+        qCritical() << "Falha ao adicionar gamepad" << (target->type == ControllerType::Xbox360 ? "Xbox 360" : "DualShock 4") << ":" << result;
+        const bool notify = !target->removeWhenAdded;
+        const quint32 padId = target->id;
+        m_targets.remove(padId);
+        vigem_target_free(target->handle);
+        delete target;
+        if (notify) emit plugFinished(padId, false);
+        return;
+    }
+
+    target->plugged = true;
+    if (target->type == ControllerType::Xbox360) {
+        vigem_target_x360_register_notification(m_client, target->handle,
+            &VigemBackend::x360NotificationCallback, target);
+    }
+    else {
+        vigem_target_ds4_register_notification(m_client, target->handle,
+            &VigemBackend::ds4NotificationCallback, target);
+    }
+
+    if (target->removeWhenAdded) {
+        m_targets.remove(target->id);
+        releaseTarget(target);
+        return;
+    }
+    emit plugFinished(target->id, true);
+}
+
+void VigemBackend::releaseTarget(Target* target)
+{
+    if (target->plugged) {
+        if (target->type == ControllerType::Xbox360) {
+            vigem_target_x360_unregister_notification(target->handle);
+        }
+        else {
+            vigem_target_ds4_unregister_notification(target->handle);
+        }
+    }
+    // Também cobre o plug que terminou mas cujo resultado ainda não foi entregue
+    // (desligamento); para um target não plugado o cliente só retorna erro
+    vigem_target_remove(m_client, target->handle);
+    vigem_target_free(target->handle);
+    delete target;
+}
+
+// Callbacks de vibração (thread de notificação do ViGEm)
+VOID CALLBACK VigemBackend::x360NotificationCallback(
+    PVIGEM_CLIENT Client, PVIGEM_TARGET Target, UCHAR LargeMotor,
+    UCHAR SmallMotor, UCHAR LedNumber, PVOID UserData)
+{
+    Q_UNUSED(Client); Q_UNUSED(Target); Q_UNUSED(LedNumber);
+    const VigemBackend::Target* target = static_cast<const VigemBackend::Target*>(UserData);
+    if (!target) return;
+    emit target->backend->vibrationRequested(target->id, LargeMotor, SmallMotor);
+}
+
+VOID CALLBACK VigemBackend::ds4NotificationCallback(
+    PVIGEM_CLIENT Client, PVIGEM_TARGET Target, UCHAR LargeMotor,
+    UCHAR SmallMotor, DS4_LIGHTBAR_COLOR LightbarColor, PVOID UserData)
+{
+    Q_UNUSED(Client); Q_UNUSED(Target); Q_UNUSED(LightbarColor);
+    const VigemBackend::Target* target = static_cast<const VigemBackend::Target*>(UserData);
+    if (!target) return;
+    emit target->backend->vibrationRequested(target->id, LargeMotor, SmallMotor);
+}
@@ -0,0 +1,58 @@
+#ifndef VIGEM_BACKEND_H
+#define VIGEM_BACKEND_H
+
+#include <QHash>
+#include <QAtomicInt>
+#include "controller_backend.h"
+
+#include <Windows.h>
+#include <ViGEm/Client.h>
+
+// Controles virtuais do ViGEmBus. O plug usa vigem_target_add_async: a
+// enumeração acontece numa thread do cliente ViGEm e o resultado volta para a
+// thread principal por fila de eventos, sem travar o event loop.
+class VigemBackend : public ControllerBackend
+{
+    Q_OBJECT
+
+public:
+    explicit VigemBackend(QObject* parent = nullptr);
+    ~VigemBackend();
+
+    const char* name() const override { return "vigem"; }
+
+    bool initialize() override;
+    void shutdown() override;
+
+    quint32 beginPlug(ControllerType type) override;
+    void unplug(quint32 padId) override;
+    void submit(quint32 padId, const GamepadPacket& packet) override;
+
+private:
+    struct Target {
+        VigemBackend* backend = nullptr;
+        quint32 id = 0;
+        ControllerType type = ControllerType::DualShock4;
+        PVIGEM_TARGET handle = nullptr;
+        bool plugged = false;
+        bool removeWhenAdded = false;   // unplug() chegou com o plug em andamento
+    };
+
+    void onAddResult(PVIGEM_TARGET handle, VIGEM_ERROR result);
+    void releaseTarget(Target* target);
+
+    static void CALLBACK addResultCallback(PVIGEM_CLIENT Client, PVIGEM_TARGET Target, VIGEM_ERROR Result);
+    static void CALLBACK x360NotificationCallback(
+        PVIGEM_CLIENT Client, PVIGEM_TARGET Target, UCHAR LargeMotor,
+        UCHAR SmallMotor, UCHAR LedNumber, PVOID UserData);
+    static void CALLBACK ds4NotificationCallback(
+        PVIGEM_CLIENT Client, PVIGEM_TARGET Target, UCHAR LargeMotor,
+        UCHAR SmallMotor, DS4_LIGHTBAR_COLOR LightbarColor, PVOID UserData);
+
+    PVIGEM_CLIENT m_client;
+    QHash<quint32, Target*> m_targets;
+    quint32 m_nextId = 1;
+    QAtomicInt m_addsInFlight;
+};
+
+#endif // VIGEM_BACKEND_H